@@ -0,0 +1,120 @@
+/*
+ * $Id$
+ *
+ * Copyright 2008 Carpe Noctem, Distributed Systems Group,
+ * University of Kassel. All right reserved.
+ *
+ * The code is licensed under the Carpe Noctem Userfriendly BSD-Based
+ * License (CNUBBL). Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided that the
+ * conditions of the CNUBBL are met.
+ *
+ * You should have received a copy of the CNUBBL along with this
+ * software. The license is also available on our website:
+ * http://carpenoctem.das-lab.net/license.txt
+ */
+
+#include "ConfigArena.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+namespace castor {
+
+	const size_t ConfigArena::DefaultChunkSize;
+
+	ConfigArena::ConfigArena(size_t chunkSize) :
+		chunks(NULL), chunkSize(chunkSize), capacity(0), used(0)
+	{
+	}
+
+	ConfigArena::~ConfigArena() {
+		clear();
+	}
+
+	ConfigArena::Chunk *ConfigArena::grow(size_t size) {
+
+		bool oversized = (size > this->chunkSize);
+
+		if (!oversized) {
+			size = this->chunkSize;
+		}
+
+		Chunk *chunk = static_cast<Chunk *>(malloc(sizeof(Chunk) + size));
+
+		if (chunk == NULL) {
+			throw std::bad_alloc();
+		}
+
+		chunk->size = size;
+		chunk->used = 0;
+
+		// Oversized requests get a chunk of their own behind the current
+		// one, which keeps serving small allocations
+		if ((oversized) && (this->chunks != NULL)) {
+			chunk->next = this->chunks->next;
+			this->chunks->next = chunk;
+		} else {
+			chunk->next = this->chunks;
+			this->chunks = chunk;
+		}
+
+		this->capacity += size;
+
+		return chunk;
+	}
+
+	const char *ConfigArena::copy(const char *data, size_t size) {
+
+		if (size == 0) {
+			return "";
+		}
+
+		char *result = static_cast<char *>(allocate(size, 1));
+		memcpy(result, data, size);
+
+		return result;
+	}
+
+	void ConfigArena::splice(ConfigArena &other) {
+
+		if (other.chunks == NULL) {
+			return;
+		}
+
+		Chunk *last = other.chunks;
+
+		while (last->next != NULL) {
+			last = last->next;
+		}
+
+		// Behind the current chunk, like oversized chunks
+		if (this->chunks == NULL) {
+			this->chunks = other.chunks;
+		} else {
+			last->next = this->chunks->next;
+			this->chunks->next = other.chunks;
+		}
+
+		this->capacity += other.capacity;
+		this->used += other.used;
+
+		other.chunks = NULL;
+		other.capacity = 0;
+		other.used = 0;
+	}
+
+	void ConfigArena::clear() {
+
+		while (this->chunks != NULL) {
+			Chunk *next = this->chunks->next;
+			free(this->chunks);
+			this->chunks = next;
+		}
+
+		this->capacity = 0;
+		this->used = 0;
+	}
+}
+
@@ -0,0 +1,116 @@
+/*
+ * $Id$
+ *
+ * Copyright 2008 Carpe Noctem, Distributed Systems Group,
+ * University of Kassel. All right reserved.
+ *
+ * The code is licensed under the Carpe Noctem Userfriendly BSD-Based
+ * License (CNUBBL). Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided that the
+ * conditions of the CNUBBL are met.
+ *
+ * You should have received a copy of the CNUBBL along with this
+ * software. The license is also available on our website:
+ * http://carpenoctem.das-lab.net/license.txt
+ */
+
+#ifndef CASTOR_CONFIGARENA_H
+#define CASTOR_CONFIGARENA_H 1
+
+#include <cstddef>
+
+#include <boost/noncopyable.hpp>
+
+namespace castor {
+
+	/**
+	 * Bump allocator for configuration trees. Memory is handed out from large
+	 * chunks in allocation order and is never freed individually; clear() or
+	 * the destructor release all chunks at once. Objects placed in an arena
+	 * must therefore be trivially destructible.
+	 */
+	class ConfigArena : private boost::noncopyable {
+
+		protected:
+
+			struct Chunk {
+				Chunk *next;
+				size_t size;
+				size_t used;
+			};
+
+			Chunk *chunks;
+			size_t chunkSize;
+			size_t capacity;
+			size_t used;
+
+			Chunk *grow(size_t size);
+
+		public:
+
+			static const size_t DefaultChunkSize = 64 * 1024;
+
+			ConfigArena(size_t chunkSize = DefaultChunkSize);
+			~ConfigArena();
+
+			/**
+			 * Returns size bytes aligned to align, which has to be a power of
+			 * two not larger than the alignment of a pointer.
+			 */
+			void *allocate(size_t size, size_t align = sizeof(void *)) {
+
+				Chunk *chunk = this->chunks;
+
+				if (chunk != NULL) {
+
+					size_t offset = (chunk->used + align - 1) & ~(align - 1);
+
+					if (offset + size <= chunk->size) {
+						chunk->used = offset + size;
+						this->used += size;
+						return reinterpret_cast<char *>(chunk + 1) + offset;
+					}
+				}
+
+				chunk = grow(size + align);
+
+				size_t offset = (chunk->used + align - 1) & ~(align - 1);
+				chunk->used = offset + size;
+				this->used += size;
+
+				return reinterpret_cast<char *>(chunk + 1) + offset;
+			}
+
+			/**
+			 * Copies size bytes into the arena.
+			 */
+			const char *copy(const char *data, size_t size);
+
+			/**
+			 * Takes over all chunks of other, which is empty afterwards.
+			 */
+			void splice(ConfigArena &other);
+
+			/**
+			 * Releases all chunks.
+			 */
+			void clear();
+
+			/**
+			 * Number of bytes reserved from the system.
+			 */
+			size_t getCapacity() const {
+				return this->capacity;
+			}
+
+			/**
+			 * Number of bytes handed out.
+			 */
+			size_t getUsed() const {
+				return this->used;
+			}
+	};
+}
+
+#endif /* CASTOR_CONFIGARENA_H */
+
@@ -0,0 +1,270 @@
+/*
+ * $Id$
+ *
+ * Copyright 2008 Carpe Noctem, Distributed Systems Group,
+ * University of Kassel. All right reserved.
+ *
+ * The code is licensed under the Carpe Noctem Userfriendly BSD-Based
+ * License (CNUBBL). Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided that the
+ * conditions of the CNUBBL are met.
+ *
+ * You should have received a copy of the CNUBBL along with this
+ * software. The license is also available on our website:
+ * http://carpenoctem.das-lab.net/license.txt
+ */
+
+#include "ConfigBatch.h"
+
+#include <algorithm>
+#include <exception>
+#include <sstream>
+
+#include <boost/algorithm/string.hpp>
+
+namespace castor {
+
+	/**
+	 * Orders entries by their symbols, so entries with a common prefix are
+	 * adjacent and shorter paths come before the paths they are a prefix of.
+	 */
+	struct ConfigBatchOrder {
+
+		const std::vector<ConfigBatch::Entry> *entries;
+
+		ConfigBatchOrder(const std::vector<ConfigBatch::Entry> *entries) : entries(entries) {}
+
+		bool operator()(size_t a, size_t b) const {
+			return ((*this->entries)[a].symbols < (*this->entries)[b].symbols);
+		}
+	};
+
+	ConfigBatch::Target::~Target() {
+	}
+
+	ConfigBatch::ConfigBatch() :
+		entries(), order()
+	{
+	}
+
+	size_t ConfigBatch::append(const std::string &path, Target *target) {
+
+		Entry entry;
+
+		entry.path = path;
+		entry.target.reset(target);
+		entry.found = false;
+
+		boost::split(entry.components, path, boost::is_any_of("."));
+
+		for (size_t i = 0; i < entry.components.size(); i++) {
+			entry.hashes.push_back(ConfigSymbols::hash(entry.components[i].data(), entry.components[i].size()));
+		}
+
+		this->entries.push_back(entry);
+
+		return this->entries.size() - 1;
+	}
+
+	bool ConfigBatch::read(ConfigTree *tree) {
+
+		const ConfigSymbols &symbols = tree->getSymbols();
+
+		this->order.clear();
+
+		for (size_t i = 0; i < this->entries.size(); i++) {
+
+			Entry &entry = this->entries[i];
+
+			entry.found = false;
+			entry.error.clear();
+			entry.symbols.resize(entry.components.size());
+
+			bool known = true;
+
+			for (size_t j = 0; (j < entry.components.size()) && (known); j++) {
+				entry.symbols[j] = symbols.find(entry.components[j].data(), entry.components[j].size(), entry.hashes[j]);
+				known = (entry.symbols[j] != ConfigSymbols::Unknown);
+			}
+
+			// Names that have never been interned cannot be part of the tree
+			if (known) {
+				this->order.push_back(i);
+			}
+		}
+
+		std::sort(this->order.begin(), this->order.end(), ConfigBatchOrder(&this->entries));
+
+		walk(tree, tree->getRoot(), 0, 0, this->order.size());
+
+		bool result = true;
+
+		for (size_t i = 0; i < this->entries.size(); i++) {
+
+			Entry &entry = this->entries[i];
+
+			if (!entry.error.empty()) {
+				result = false;
+			} else if ((!entry.found) && (!entry.target->fallback())) {
+				fail(i, tree->getFilename(), "not found");
+				result = false;
+			}
+		}
+
+		return result;
+	}
+
+	size_t ConfigBatch::walk(ConfigTree *tree, ConfigNode *node, size_t depth, size_t begin, size_t end) {
+
+		// Entries that end here come first
+		size_t middle = begin;
+
+		while ((middle < end) && (this->entries[this->order[middle]].symbols.size() == depth)) {
+			middle++;
+		}
+
+		size_t found = assign(node, begin, middle);
+
+		if (middle == end) {
+			return found;
+		}
+
+		std::vector<Group> groups;
+
+		for (size_t i = middle; i < end; i++) {
+
+			const Entry &entry = this->entries[this->order[i]];
+
+			if ((groups.empty()) || (groups.back().symbol != entry.symbols[depth])) {
+				Group group = { entry.symbols[depth], i, i, 0 };
+				groups.push_back(group);
+			}
+
+			groups.back().end = i + 1;
+
+			if (!entry.found) {
+				groups.back().pending++;
+			}
+		}
+
+		const ConfigIndex &index = tree->getIndex();
+
+		if (index.covers(node)) {
+
+			for (size_t i = 0; i < groups.size(); i++) {
+
+				ConfigNode *first = NULL;
+				ConfigNode *last = NULL;
+
+				if ((groups[i].pending == 0) || (!index.find(node, groups[i].symbol, &first, &last))) {
+					continue;
+				}
+
+				for (ConfigNode *child = first; (child != NULL) && (groups[i].pending > 0); child = child->getNext()) {
+
+					if (child->getSymbol() == groups[i].symbol) {
+
+						size_t count = walk(tree, child, depth + 1, groups[i].begin, groups[i].end);
+
+						groups[i].pending -= count;
+						found += count;
+					}
+
+					if (child == last) break;
+				}
+			}
+
+		} else {
+
+			size_t pending = 0;
+
+			for (size_t i = 0; i < groups.size(); i++) {
+				pending += groups[i].pending;
+			}
+
+			// One pass over the children serves all groups
+			for (ConfigNode *child = node->getFirstChild(); (child != NULL) && (pending > 0); child = child->getNext()) {
+
+				size_t low = 0;
+				size_t high = groups.size();
+
+				while (low < high) {
+
+					size_t mid = (low + high) / 2;
+
+					if (groups[mid].symbol < child->getSymbol()) {
+						low = mid + 1;
+					} else {
+						high = mid;
+					}
+				}
+
+				if ((low == groups.size()) || (groups[low].symbol != child->getSymbol()) || (groups[low].pending == 0)) {
+					continue;
+				}
+
+				size_t count = walk(tree, child, depth + 1, groups[low].begin, groups[low].end);
+
+				groups[low].pending -= count;
+				pending -= count;
+				found += count;
+			}
+		}
+
+		return found;
+	}
+
+	size_t ConfigBatch::assign(ConfigNode *node, size_t begin, size_t end) {
+
+		size_t found = 0;
+
+		for (size_t i = begin; i < end; i++) {
+
+			Entry &entry = this->entries[this->order[i]];
+
+			if (entry.found) continue;
+
+			entry.found = true;
+			found++;
+
+			try {
+				entry.target->assign(node);
+			} catch (const std::exception &e) {
+
+				std::ostringstream ss;
+				ss << "Value of '" << entry.path << "' is invalid: " << e.what();
+				entry.error = ss.str();
+
+				entry.target->fallback();
+			}
+		}
+
+		return found;
+	}
+
+	void ConfigBatch::fail(size_t entry, const std::string &filename, const std::string &reason) {
+
+		std::ostringstream ss;
+		ss << "Path '" << this->entries[entry].path << "' " << reason << " in " << filename << "!";
+
+		this->entries[entry].error = ss.str();
+	}
+
+	std::vector<std::string> ConfigBatch::getErrors() const {
+
+		std::vector<std::string> result;
+
+		for (size_t i = 0; i < this->entries.size(); i++) {
+			if (!this->entries[i].error.empty()) {
+				result.push_back(this->entries[i].error);
+			}
+		}
+
+		return result;
+	}
+
+	void ConfigBatch::clear() {
+		this->entries.clear();
+		this->order.clear();
+	}
+}
@@ -0,0 +1,194 @@
+/*
+ * $Id$
+ *
+ * Copyright 2008 Carpe Noctem, Distributed Systems Group,
+ * University of Kassel. All right reserved.
+ *
+ * The code is licensed under the Carpe Noctem Userfriendly BSD-Based
+ * License (CNUBBL). Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided that the
+ * conditions of the CNUBBL are met.
+ *
+ * You should have received a copy of the CNUBBL along with this
+ * software. The license is also available on our website:
+ * http://carpenoctem.das-lab.net/license.txt
+ */
+
+#ifndef CASTOR_CONFIGBATCH_H
+#define CASTOR_CONFIGBATCH_H 1
+
+#include <vector>
+#include <string>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
+
+#include "ConfigTree.h"
+#include "ConfigConvert.h"
+
+namespace castor {
+
+	struct ConfigBatchOrder;
+
+	/**
+	 * A list of values to read in one go, e.g. all settings of a component:
+	 *
+	 *   ConfigBatch batch;
+	 *   batch.add("Drive.Motor.maxSpeed", &maxSpeed);
+	 *   batch.add("Drive.Motor.gain", &gain, 1.0);
+	 *   if (!config.read(batch)) ... batch.getErrors() ...
+	 *
+	 * read() resolves all paths in a single walk over the tree. Paths are
+	 * sorted, so common prefixes such as Drive.Motor are looked up once.
+	 * Every target receives the value of the first node at its path, like
+	 * get<T>(), or its default if there is no such node.
+	 *
+	 * Errors are reported per entry instead of being thrown: a missing
+	 * value without a default and a value that cannot be converted. A batch
+	 * can be read again, e.g. after every reload. It is not synchronized.
+	 */
+	class ConfigBatch : private boost::noncopyable {
+
+		friend struct ConfigBatchOrder;
+
+		protected:
+
+			class Target {
+
+				public:
+
+					virtual ~Target();
+
+					virtual void assign(const ConfigNode *node) = 0;
+
+					/**
+					 * Assigns the default value.
+					 * @return false if there is none
+					 */
+					virtual bool fallback() = 0;
+			};
+
+			template<typename T>
+				class TypedTarget : public Target {
+
+					protected:
+
+						T *target;
+						bool optional;
+						T d;
+
+					public:
+
+						TypedTarget(T *target, bool optional, const T &d) :
+							target(target), optional(optional), d(d)
+						{
+						}
+
+						virtual void assign(const ConfigNode *node) {
+							*this->target = ConfigConvert<T>::get(node);
+						}
+
+						virtual bool fallback() {
+
+							if (this->optional) {
+								*this->target = this->d;
+							}
+
+							return this->optional;
+						}
+				};
+
+			struct Entry {
+				std::string path;
+				std::vector<std::string> components;
+				std::vector<unsigned int> hashes;
+				boost::shared_ptr<Target> target;
+
+				std::vector<ConfigSymbol> symbols;
+				bool found;
+				std::string error;
+			};
+
+			/**
+			 * Entries of the same node that continue with the same symbol.
+			 */
+			struct Group {
+				ConfigSymbol symbol;
+				size_t begin;
+				size_t end;
+				size_t pending;
+			};
+
+			std::vector<Entry> entries;
+			std::vector<size_t> order;
+
+			size_t append(const std::string &path, Target *target);
+
+			size_t walk(ConfigTree *tree, ConfigNode *node, size_t depth, size_t begin, size_t end);
+			size_t assign(ConfigNode *node, size_t begin, size_t end);
+
+			void fail(size_t entry, const std::string &filename, const std::string &reason);
+
+		public:
+
+			ConfigBatch();
+
+			/**
+			 * Adds a value that has to be present.
+			 * @param path Dot-separated path, e.g. "Drive.Motor.maxSpeed"
+			 * @param target Receives the value, must stay valid as long as the
+			 * batch is read
+			 * @return Position of the entry, see isFound() and getError()
+			 */
+			template<typename T>
+				size_t add(const std::string &path, T *target) {
+					return append(path, new TypedTarget<T>(target, false, T()));
+				}
+
+			/**
+			 * Adds a value that is set to d if it is not present.
+			 */
+			template<typename T, typename D>
+				size_t add(const std::string &path, T *target, const D &d) {
+					return append(path, new TypedTarget<T>(target, true, T(d)));
+				}
+
+			/**
+			 * Reads all values from the given tree.
+			 * @return true if there were no errors
+			 */
+			bool read(ConfigTree *tree);
+
+			size_t size() const {
+				return this->entries.size();
+			}
+
+			const std::string &getPath(size_t entry) const {
+				return this->entries[entry].path;
+			}
+
+			/**
+			 * Returns whether the entry was present in the last tree read.
+			 */
+			bool isFound(size_t entry) const {
+				return this->entries[entry].found;
+			}
+
+			/**
+			 * Returns the error of the entry in the last read, empty if there
+			 * was none.
+			 */
+			const std::string &getError(size_t entry) const {
+				return this->entries[entry].error;
+			}
+
+			/**
+			 * Returns all errors of the last read.
+			 */
+			std::vector<std::string> getErrors() const;
+
+			void clear();
+	};
+}
+
+#endif /* CASTOR_CONFIGBATCH_H */
@@ -0,0 +1,262 @@
+/*
+ * $Id$
+ *
+ * Copyright 2008 Carpe Noctem, Distributed Systems Group,
+ * University of Kassel. All right reserved.
+ *
+ * The code is licensed under the Carpe Noctem Userfriendly BSD-Based
+ * License (CNUBBL). Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided that the
+ * conditions of the CNUBBL are met.
+ *
+ * You should have received a copy of the CNUBBL along with this
+ * software. The license is also available on our website:
+ * http://carpenoctem.das-lab.net/license.txt
+ */
+
+#include "ConfigBinary.h"
+#include "ConfigConvert.h"
+#include "ConfigException.h"
+#include "ConfigSink.h"
+
+#include <vector>
+#include <sstream>
+#include <cstring>
+#include <cerrno>
+
+#include <sys/stat.h>
+
+namespace castor {
+
+	const char ConfigBinary::Magic[8] = { 'C', 'A', 'S', 'T', 'O', 'R', 'C', '\0' };
+	const uint32_t ConfigBinary::Version;
+	const uint32_t ConfigBinary::ByteOrder;
+
+	static std::string invalid(const ConfigBuffer &buffer, const char *reason) {
+
+		std::ostringstream ss;
+		ss << "Invalid compiled configuration " << buffer.getFilename() << ": " << reason;
+
+		return ss.str();
+	}
+
+	bool ConfigBinary::isBinary(const ConfigBuffer &buffer) {
+		return ((buffer.size() >= sizeof(Header)) && (memcmp(buffer.begin(), Magic, sizeof(Magic)) == 0));
+	}
+
+	std::string ConfigBinary::getBinaryName(const std::string &filename) {
+		return filename + "c";
+	}
+
+	bool ConfigBinary::isCurrent(const std::string &binary, const std::string &source) {
+
+		struct stat binaryStat;
+		struct stat sourceStat;
+
+		if (stat(binary.c_str(), &binaryStat) != 0) {
+			return false;
+		}
+
+		if (stat(source.c_str(), &sourceStat) != 0) {
+			return true;
+		}
+
+		if (binaryStat.st_mtim.tv_sec != sourceStat.st_mtim.tv_sec) {
+			return (binaryStat.st_mtim.tv_sec > sourceStat.st_mtim.tv_sec);
+		}
+
+		return (binaryStat.st_mtim.tv_nsec >= sourceStat.st_mtim.tv_nsec);
+	}
+
+	void ConfigBinary::read(ConfigTree *tree, const ConfigBuffer &buffer) {
+
+		if (!isBinary(buffer)) {
+			throw ConfigException(invalid(buffer, "bad magic!"));
+		}
+
+		const Header *header = reinterpret_cast<const Header *>(buffer.begin());
+
+		if ((header->version != Version) || (header->byteOrder != ByteOrder)) {
+			throw ConfigException(invalid(buffer, "unsupported version or byte order!"));
+		}
+
+		size_t tables = sizeof(Header) + header->symbols * sizeof(Symbol) + static_cast<size_t>(header->nodes) * sizeof(Node);
+
+		if ((header->symbols == 0) || (tables + header->strings != buffer.size())) {
+			throw ConfigException(invalid(buffer, "truncated file!"));
+		}
+
+		const Symbol *symbols = reinterpret_cast<const Symbol *>(buffer.begin() + sizeof(Header));
+		const Node *nodes = reinterpret_cast<const Node *>(symbols + header->symbols);
+		const char *strings = buffer.begin() + tables;
+
+		// Symbols are stored in the order they were interned, starting with
+		// the name of the root node
+		ConfigSymbols &table = tree->getSymbols();
+		table.reserve(header->symbols + 1);
+
+		for (uint32_t i = 0; i < header->symbols; i++) {
+
+			if (static_cast<uint64_t>(symbols[i].offset) + symbols[i].length > header->strings) {
+				throw ConfigException(invalid(buffer, "symbol out of range!"));
+			}
+
+			if (table.intern(ConfigString(strings + symbols[i].offset, symbols[i].length), symbols[i].hash) != i + 1) {
+				throw ConfigException(invalid(buffer, "duplicate symbol!"));
+			}
+		}
+
+		std::vector<ConfigNode *> created(header->nodes + 1);
+		created[0] = tree->getRoot();
+
+		for (uint32_t i = 0; i < header->nodes; i++) {
+
+			const Node &node = nodes[i];
+
+			if ((node.parent > i) || (created[node.parent]->getType() != ConfigNode::Node) ||
+				(node.symbol > header->symbols) || (node.type > ConfigNode::Comment) ||
+				(static_cast<uint64_t>(node.offset) + node.length > header->strings))
+			{
+				throw ConfigException(invalid(buffer, "malformed node!"));
+			}
+
+			created[i + 1] = tree->createNode(created[node.parent], static_cast<ConfigNode::Type>(node.type), node.symbol,
+				ConfigString(strings + node.offset, node.length));
+
+			if (node.cached == ConfigNode::Integer) {
+				created[i + 1]->setCached(static_cast<long long>(node.cache.integer));
+			} else if (node.cached == ConfigNode::Real) {
+				created[i + 1]->setCached(node.cache.real);
+			}
+		}
+	}
+
+	static uint32_t append(std::string *strings, const ConfigString &value) {
+
+		if (strings->size() + value.size() > 0xffffffffu) {
+			throw ConfigException("Configuration too large to be compiled!");
+		}
+
+		uint32_t offset = strings->size();
+		strings->append(value.data(), value.size());
+
+		return offset;
+	}
+
+	void ConfigBinary::write(const ConfigTree &tree, std::ostream &os) {
+
+		std::vector<Symbol> symbols;
+		std::vector<Node> nodes;
+		std::string strings;
+
+		const ConfigSymbols &table = tree.getSymbols();
+
+		for (ConfigSymbol symbol = 1; symbol < table.size(); symbol++) {
+
+			Symbol entry;
+			memset(&entry, 0, sizeof(entry));
+
+			entry.length = table.getName(symbol).size();
+			entry.offset = append(&strings, table.getName(symbol));
+			entry.hash = table.getHash(symbol);
+
+			symbols.push_back(entry);
+		}
+
+		// Walk the tree in document order, parents always precede their
+		// children
+		std::vector<std::pair<const ConfigNode *, uint32_t> > stack;
+
+		std::vector<const ConfigNode *> children;
+
+		for (const ConfigNode *child = tree.getRoot()->getFirstChild(); child != NULL; child = child->getNext()) {
+			children.push_back(child);
+		}
+
+		for (size_t i = children.size(); i > 0; i--) {
+			stack.push_back(std::make_pair(children[i - 1], 0u));
+		}
+
+		while (!stack.empty()) {
+
+			const ConfigNode *node = stack.back().first;
+			uint32_t parent = stack.back().second;
+
+			stack.pop_back();
+
+			Node entry;
+			memset(&entry, 0, sizeof(entry));
+
+			entry.parent = parent;
+			entry.symbol = node->getSymbol();
+			entry.length = node->getValue().size();
+			entry.offset = append(&strings, node->getValue());
+			entry.type = node->getType();
+
+			// Pre-type numbers, so they are not parsed on every start
+			long long integer;
+			double real;
+
+			if (node->getType() == ConfigNode::Leaf) {
+				if (ConfigParse::integer(node->getValue().data(), node->getValue().size(), &integer)) {
+					entry.cached = ConfigNode::Integer;
+					entry.cache.integer = integer;
+				} else if (ConfigParse::real(node->getValue().data(), node->getValue().size(), &real)) {
+					entry.cached = ConfigNode::Real;
+					entry.cache.real = real;
+				}
+			}
+
+			nodes.push_back(entry);
+
+			uint32_t index = nodes.size();
+
+			children.clear();
+
+			for (const ConfigNode *child = node->getFirstChild(); child != NULL; child = child->getNext()) {
+				children.push_back(child);
+			}
+
+			for (size_t i = children.size(); i > 0; i--) {
+				stack.push_back(std::make_pair(children[i - 1], index));
+			}
+		}
+
+		Header header;
+		memset(&header, 0, sizeof(header));
+
+		memcpy(header.magic, Magic, sizeof(Magic));
+		header.version = Version;
+		header.byteOrder = ByteOrder;
+		header.symbols = symbols.size();
+		header.nodes = nodes.size();
+		header.strings = strings.size();
+
+		os.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+		if (!symbols.empty()) {
+			os.write(reinterpret_cast<const char *>(&symbols[0]), symbols.size() * sizeof(Symbol));
+		}
+
+		if (!nodes.empty()) {
+			os.write(reinterpret_cast<const char *>(&nodes[0]), nodes.size() * sizeof(Node));
+		}
+
+		os.write(strings.data(), strings.size());
+	}
+
+	void ConfigBinary::write(const ConfigTree &tree, const std::string &filename) {
+
+		std::ostringstream os(std::ios_base::out | std::ios_base::binary);
+		write(tree, os);
+
+		// Never rewrite a compiled file in place, a process loading it at the
+		// same time would read a partial file
+		ConfigReplaceSink sink(filename);
+
+		std::string data = os.str();
+		sink.write(data.data(), data.size());
+		sink.commit();
+	}
+}
+
@@ -0,0 +1,116 @@
+/*
+ * $Id$
+ *
+ * Copyright 2008 Carpe Noctem, Distributed Systems Group,
+ * University of Kassel. All right reserved.
+ *
+ * The code is licensed under the Carpe Noctem Userfriendly BSD-Based
+ * License (CNUBBL). Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided that the
+ * conditions of the CNUBBL are met.
+ *
+ * You should have received a copy of the CNUBBL along with this
+ * software. The license is also available on our website:
+ * http://carpenoctem.das-lab.net/license.txt
+ */
+
+#ifndef CASTOR_CONFIGBINARY_H
+#define CASTOR_CONFIGBINARY_H 1
+
+#include <string>
+#include <ostream>
+
+#include <stdint.h>
+
+#include "ConfigBuffer.h"
+#include "ConfigTree.h"
+
+namespace castor {
+
+	/**
+	 * Compiled configuration files (.confc). A compiled file consists of a
+	 * header, the symbol table with precomputed hashes, a flat array of all
+	 * nodes in document order and a string table. Leaves that hold a number
+	 * carry its parsed value as well.
+	 *
+	 * Loading a compiled file reads it into one buffer and links the nodes,
+	 * names and values stay views into that buffer. The format uses the byte order of the
+	 * machine it was compiled on, files from other machines are rejected.
+	 */
+	class ConfigBinary {
+
+		protected:
+
+			struct Header {
+				char magic[8];
+				uint32_t version;
+				uint32_t byteOrder;
+				uint32_t symbols;
+				uint32_t nodes;
+				uint64_t strings;
+			};
+
+			struct Symbol {
+				uint32_t offset;
+				uint32_t length;
+				uint32_t hash;
+				uint32_t reserved;
+			};
+
+			struct Node {
+				uint32_t parent;
+				uint32_t symbol;
+				uint32_t offset;
+				uint32_t length;
+				uint8_t type;
+				uint8_t cached;
+				uint16_t reserved;
+				uint32_t reserved2;
+				union {
+					int64_t integer;
+					double real;
+				} cache;
+			};
+
+			static const char Magic[8];
+			static const uint32_t Version = 1;
+			static const uint32_t ByteOrder = 0x01020304;
+
+		public:
+
+			/**
+			 * Returns whether the given buffer holds a compiled configuration.
+			 */
+			static bool isBinary(const ConfigBuffer &buffer);
+
+			/**
+			 * Returns the name of the compiled file for the given source.
+			 */
+			static std::string getBinaryName(const std::string &filename);
+
+			/**
+			 * Returns whether the compiled file exists and is not older than
+			 * its source. A compiled file without source counts as current.
+			 */
+			static bool isCurrent(const std::string &binary, const std::string &source);
+
+			/**
+			 * Links the nodes stored in the given buffer below the root of
+			 * tree, which has to be empty.
+			 * @throws ConfigException if the buffer is not a valid compiled
+			 * configuration
+			 */
+			static void read(ConfigTree *tree, const ConfigBuffer &buffer);
+
+			static void write(const ConfigTree &tree, std::ostream &os);
+
+			/**
+			 * Writes the compiled form of tree to the given file.
+			 * @throws ConfigException if the file cannot be written
+			 */
+			static void write(const ConfigTree &tree, const std::string &filename);
+	};
+}
+
+#endif /* CASTOR_CONFIGBINARY_H */
+
@@ -0,0 +1,111 @@
+/*
+ * $Id$
+ *
+ * Copyright 2008 Carpe Noctem, Distributed Systems Group,
+ * University of Kassel. All right reserved.
+ *
+ * The code is licensed under the Carpe Noctem Userfriendly BSD-Based
+ * License (CNUBBL). Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided that the
+ * conditions of the CNUBBL are met.
+ *
+ * You should have received a copy of the CNUBBL along with this
+ * software. The license is also available on our website:
+ * http://carpenoctem.das-lab.net/license.txt
+ */
+
+#include "ConfigBuffer.h"
+#include "ConfigException.h"
+
+#include <sstream>
+#include <cstring>
+#include <cerrno>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace castor {
+
+	ConfigBuffer::ConfigBuffer(const std::string &filename) :
+		filename(filename), content()
+	{
+	}
+
+	ConfigBuffer::~ConfigBuffer() {
+	}
+
+	ConfigBufferPtr ConfigBuffer::load(const std::string &filename) {
+
+		ConfigBufferPtr buffer(new ConfigBuffer(filename));
+
+		int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+
+		if (fd < 0) {
+			std::ostringstream ss;
+			ss << "Unable to open " << filename << ": " << strerror(errno);
+			throw ConfigException(ss.str());
+		}
+
+		struct stat st;
+
+		if (fstat(fd, &st) != 0) {
+			std::ostringstream ss;
+			ss << "Unable to stat " << filename << ": " << strerror(errno);
+			close(fd);
+			throw ConfigException(ss.str());
+		}
+
+		// One byte more to see the end without growing the buffer. The
+		// file may still shrink or grow while it is read, take what is there
+		buffer->content.resize(st.st_size + 1);
+
+		size_t length = 0;
+
+		for (;;) {
+
+			if (length == buffer->content.size()) {
+				buffer->content.resize(length + 65536);
+			}
+
+			ssize_t count = ::read(fd, &buffer->content[length], buffer->content.size() - length);
+
+			if (count < 0) {
+
+				if (errno == EINTR) {
+					continue;
+				}
+
+				std::ostringstream ss;
+				ss << "Unable to read " << filename << ": " << strerror(errno);
+				close(fd);
+				throw ConfigException(ss.str());
+			}
+
+			if (count == 0) {
+				break;
+			}
+
+			length += count;
+		}
+
+		buffer->content.resize(length);
+
+		close(fd);
+
+		return buffer;
+	}
+
+	ConfigBufferPtr ConfigBuffer::read(const std::string &filename, std::istream &content) {
+
+		ConfigBufferPtr buffer(new ConfigBuffer(filename));
+
+		std::ostringstream ss;
+		ss << content.rdbuf();
+		buffer->content = ss.str();
+
+		return buffer;
+	}
+}
+
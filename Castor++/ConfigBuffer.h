@@ -0,0 +1,92 @@
+/*
+ * $Id$
+ *
+ * Copyright 2008 Carpe Noctem, Distributed Systems Group,
+ * University of Kassel. All right reserved.
+ *
+ * The code is licensed under the Carpe Noctem Userfriendly BSD-Based
+ * License (CNUBBL). Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided that the
+ * conditions of the CNUBBL are met.
+ *
+ * You should have received a copy of the CNUBBL along with this
+ * software. The license is also available on our website:
+ * http://carpenoctem.das-lab.net/license.txt
+ */
+
+#ifndef CASTOR_CONFIGBUFFER_H
+#define CASTOR_CONFIGBUFFER_H 1
+
+#include <string>
+#include <istream>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
+
+namespace castor {
+
+	class ConfigBuffer;
+
+	typedef boost::shared_ptr<ConfigBuffer> ConfigBufferPtr;
+
+	/**
+	 * Immutable source text of a configuration, held in a private buffer.
+	 * The parser keeps views into this buffer, so it has to stay alive as
+	 * long as the nodes created from it.
+	 *
+	 * Files are read rather than kept mapped: the views would otherwise
+	 * refer to the live file, and a file that is rewritten in place, e.g.
+	 * by a shell redirection or by store(), would change under the tree or,
+	 * once truncated, raise SIGBUS on the next read.
+	 */
+	class ConfigBuffer : private boost::noncopyable {
+
+		protected:
+
+			std::string filename;
+			std::string content;
+
+			ConfigBuffer(const std::string &filename);
+
+		public:
+
+			~ConfigBuffer();
+
+			/**
+			 * Reads the given file with a single allocation of its size.
+			 * @param filename Path of the file
+			 * @throws ConfigException if the file cannot be opened or read
+			 */
+			static ConfigBufferPtr load(const std::string &filename);
+
+			/**
+			 * Reads the remaining content of the given stream.
+			 * @param filename Name used in error messages
+			 * @param content Stream to read from
+			 */
+			static ConfigBufferPtr read(const std::string &filename, std::istream &content);
+
+			const char *begin() const {
+				return this->content.data();
+			}
+
+			const char *end() const {
+				return begin() + size();
+			}
+
+			size_t size() const {
+				return this->content.size();
+			}
+
+			bool contains(const char *p) const {
+				return ((p >= begin()) && (p < end()));
+			}
+
+			const std::string &getFilename() const {
+				return this->filename;
+			}
+	};
+}
+
+#endif /* CASTOR_CONFIGBUFFER_H */
+
@@ -0,0 +1,204 @@
+/*
+ * $Id$
+ *
+ * Copyright 2008 Carpe Noctem, Distributed Systems Group,
+ * University of Kassel. All right reserved.
+ *
+ * The code is licensed under the Carpe Noctem Userfriendly BSD-Based
+ * License (CNUBBL). Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided that the
+ * conditions of the CNUBBL are met.
+ *
+ * You should have received a copy of the CNUBBL along with this
+ * software. The license is also available on our website:
+ * http://carpenoctem.das-lab.net/license.txt
+ */
+
+#include "ConfigCache.h"
+
+#include <set>
+#include <string>
+#include <cstring>
+#include <algorithm>
+
+#include <boost/thread/mutex.hpp>
+
+namespace castor {
+
+	const size_t ConfigCache::Size;
+
+	struct ConfigCacheEntry {
+		unsigned long generation;
+		unsigned long long hash;
+		std::string path;
+		std::vector<ConfigNode *> nodes;
+
+		ConfigCacheEntry() : generation(0), hash(0), path(), nodes() {}
+	};
+
+	/**
+	 * The table of one thread. Its counters are written by that thread only
+	 * and read by getStatistics().
+	 */
+	struct ConfigCacheTable {
+
+		std::vector<ConfigCacheEntry> entries;
+		unsigned long long hits;
+		unsigned long long misses;
+
+		ConfigCacheTable();
+		~ConfigCacheTable();
+
+		void count(unsigned long long *counter) {
+			__atomic_store_n(counter, *counter + 1, __ATOMIC_RELAXED);
+		}
+	};
+
+	static boost::mutex tablesLock;
+	static std::set<ConfigCacheTable *> tables;
+	static ConfigCache::Statistics finished = { 0, 0 };
+
+	static thread_local ConfigCacheTable table;
+
+	ConfigCacheTable::ConfigCacheTable() :
+		entries(), hits(0), misses(0)
+	{
+		boost::mutex::scoped_lock lock(tablesLock);
+		tables.insert(this);
+	}
+
+	ConfigCacheTable::~ConfigCacheTable() {
+
+		boost::mutex::scoped_lock lock(tablesLock);
+
+		finished.hits += this->hits;
+		finished.misses += this->misses;
+
+		tables.erase(this);
+	}
+
+	static unsigned long long hash(const ConfigKey *keys) {
+
+		unsigned long long result = 0xcbf29ce484222325ULL;
+
+		for (const ConfigKey *key = keys; !key->isNull(); key++) {
+
+			for (size_t i = 0; i < key->getCount(); i++) {
+				result = (result ^ key->getComponent(i).hash) * 0x100000001b3ULL;
+			}
+
+			if (key->getRest() < key->size()) {
+				result = (result ^ ConfigSymbols::hash(key->data() + key->getRest(), key->size() - key->getRest())) * 0x100000001b3ULL;
+			}
+		}
+
+		return result;
+	}
+
+	/**
+	 * Compares the keys to a path as joined by join().
+	 */
+	static bool equals(const std::string &path, const ConfigKey *keys) {
+
+		size_t position = 0;
+
+		for (const ConfigKey *key = keys; !key->isNull(); key++) {
+
+			if (key != keys) {
+
+				if ((position == path.size()) || (path[position] != '.')) {
+					return false;
+				}
+
+				position++;
+			}
+
+			if ((path.size() - position < key->size()) || (memcmp(path.data() + position, key->data(), key->size()) != 0)) {
+				return false;
+			}
+
+			position += key->size();
+		}
+
+		return (position == path.size());
+	}
+
+	static void join(const ConfigKey *keys, std::string *path) {
+
+		path->clear();
+
+		for (const ConfigKey *key = keys; !key->isNull(); key++) {
+
+			if (key != keys) {
+				*path += '.';
+			}
+
+			path->append(key->data(), key->size());
+		}
+	}
+
+	bool ConfigCache::find(const ConfigTree &tree, const ConfigKey *keys, std::vector<ConfigNode *> *result) {
+
+		if (table.entries.empty()) {
+			table.entries.resize(Size);
+		}
+
+		unsigned long long h = hash(keys);
+		size_t set = h & (Size - 2);
+
+		for (size_t i = set; i < set + 2; i++) {
+
+			const ConfigCacheEntry &entry = table.entries[i];
+
+			if ((entry.generation == tree.getGeneration()) && (entry.hash == h) && (equals(entry.path, keys))) {
+
+				result->insert(result->end(), entry.nodes.begin(), entry.nodes.end());
+				table.count(&table.hits);
+
+				return true;
+			}
+		}
+
+		table.count(&table.misses);
+
+		return false;
+	}
+
+	void ConfigCache::insert(const ConfigTree &tree, const ConfigKey *keys, const std::vector<ConfigNode *> &nodes) {
+
+		if (table.entries.empty()) {
+			table.entries.resize(Size);
+		}
+
+		unsigned long long h = hash(keys);
+		size_t set = h & (Size - 2);
+
+		// The older entry of the set is replaced
+		std::swap(table.entries[set], table.entries[set + 1]);
+
+		ConfigCacheEntry &entry = table.entries[set];
+
+		entry.generation = tree.getGeneration();
+		entry.hash = h;
+		entry.nodes = nodes;
+		join(keys, &entry.path);
+	}
+
+	void ConfigCache::clear() {
+		std::vector<ConfigCacheEntry>().swap(table.entries);
+	}
+
+	ConfigCache::Statistics ConfigCache::getStatistics() {
+
+		boost::mutex::scoped_lock lock(tablesLock);
+
+		Statistics result = finished;
+
+		for (std::set<ConfigCacheTable *>::const_iterator it = tables.begin(); it != tables.end(); ++it) {
+			result.hits += __atomic_load_n(&(*it)->hits, __ATOMIC_RELAXED);
+			result.misses += __atomic_load_n(&(*it)->misses, __ATOMIC_RELAXED);
+		}
+
+		return result;
+	}
+}
@@ -0,0 +1,77 @@
+/*
+ * $Id$
+ *
+ * Copyright 2008 Carpe Noctem, Distributed Systems Group,
+ * University of Kassel. All right reserved.
+ *
+ * The code is licensed under the Carpe Noctem Userfriendly BSD-Based
+ * License (CNUBBL). Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided that the
+ * conditions of the CNUBBL are met.
+ *
+ * You should have received a copy of the CNUBBL along with this
+ * software. The license is also available on our website:
+ * http://carpenoctem.das-lab.net/license.txt
+ */
+
+#ifndef CASTOR_CONFIGCACHE_H
+#define CASTOR_CONFIGCACHE_H 1
+
+#include <vector>
+
+#include "ConfigTree.h"
+#include "ConfigKey.h"
+
+namespace castor {
+
+	/**
+	 * Per-thread cache of path lookups, see Configuration::setThreadCache().
+	 *
+	 * Every thread has its own table of Size entries in sets of two, indexed
+	 * by a hash over the components of the path, that maps a path to the
+	 * nodes it refers to in a tree of a particular generation. As
+	 * generations are unique across all trees (see ConfigTree::touch()), an entry is valid exactly as long
+	 * as its tree has not been reloaded, extended or pruned, and a tree that
+	 * has been released can never be mistaken for another. Changed values
+	 * keep their nodes, so set() leaves the entries alone.
+	 *
+	 * A lookup that hits writes nothing but its own thread's counter.
+	 */
+	class ConfigCache {
+
+		public:
+
+			static const size_t Size = 1024;
+
+			struct Statistics {
+				unsigned long long hits;
+				unsigned long long misses;
+			};
+
+			/**
+			 * Appends the cached nodes of the given keys, which end with a
+			 * null key, to result.
+			 * @return false if the path is not cached for the current
+			 * generation of the tree
+			 */
+			static bool find(const ConfigTree &tree, const ConfigKey *keys, std::vector<ConfigNode *> *result);
+
+			/**
+			 * Caches the nodes of the given keys.
+			 */
+			static void insert(const ConfigTree &tree, const ConfigKey *keys, const std::vector<ConfigNode *> &nodes);
+
+			/**
+			 * Drops all entries of the calling thread.
+			 */
+			static void clear();
+
+			/**
+			 * Returns the hits and misses of all threads, including those
+			 * that have finished.
+			 */
+			static Statistics getStatistics();
+	};
+}
+
+#endif /* CASTOR_CONFIGCACHE_H */
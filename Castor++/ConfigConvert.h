@@ -0,0 +1,246 @@
+/*
+ * $Id$
+ *
+ * Copyright 2008 Carpe Noctem, Distributed Systems Group,
+ * University of Kassel. All right reserved.
+ *
+ * The code is licensed under the Carpe Noctem Userfriendly BSD-Based
+ * License (CNUBBL). Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided that the
+ * conditions of the CNUBBL are met.
+ *
+ * You should have received a copy of the CNUBBL along with this
+ * software. The license is also available on our website:
+ * http://carpenoctem.das-lab.net/license.txt
+ */
+
+#ifndef CASTOR_CONFIGCONVERT_H
+#define CASTOR_CONFIGCONVERT_H 1
+
+#include <string>
+#include <limits>
+#include <cstdlib>
+#include <cerrno>
+#include <cctype>
+#include <typeinfo>
+
+#if __cplusplus >= 201703L
+#  include <charconv>
+#endif
+
+#include <boost/lexical_cast.hpp>
+
+#include "ConfigNode.h"
+
+namespace castor {
+
+	/**
+	 * Parsers for the textual representation of values. They work on the
+	 * (not NUL-terminated) views of the tree and accept the same input as
+	 * boost::lexical_cast.
+	 */
+	struct ConfigParse {
+
+		static bool integer(const char *data, size_t size, long long *result) {
+
+			const char *p = data;
+			const char *end = data + size;
+			bool negative = false;
+
+			if ((p < end) && ((*p == '-') || (*p == '+'))) {
+				negative = (*p == '-');
+				p++;
+			}
+
+			if (p == end) {
+				return false;
+			}
+
+			unsigned long long value = 0;
+			unsigned long long limit = (negative ?
+				static_cast<unsigned long long>(std::numeric_limits<long long>::max()) + 1 :
+				static_cast<unsigned long long>(std::numeric_limits<long long>::max()));
+
+			for (; p < end; p++) {
+
+				unsigned int digit = static_cast<unsigned char>(*p) - '0';
+
+				if ((digit > 9) || (value > (limit - digit) / 10)) {
+					return false;
+				}
+
+				value = value * 10 + digit;
+			}
+
+			*result = (negative ? static_cast<long long>(0 - value) : static_cast<long long>(value));
+
+			return true;
+		}
+
+		static bool real(const char *data, size_t size, double *result) {
+
+			if ((size > 0) && (*data == '+')) {
+				data++;
+				size--;
+			}
+
+			if (size == 0) {
+				return false;
+			}
+
+#if defined(__cpp_lib_to_chars) && (__cpp_lib_to_chars >= 201611L)
+			std::from_chars_result r = std::from_chars(data, data + size, *result);
+			return ((r.ec == std::errc()) && (r.ptr == data + size));
+#else
+			std::string value(data, size);
+			char *end = NULL;
+
+			errno = 0;
+			*result = strtod(value.c_str(), &end);
+
+			return ((errno == 0) && (end == value.c_str() + value.size()));
+#endif
+		}
+
+		static bool boolean(const char *data, size_t size) {
+
+			// Everything but "false", "no" and "0" (in any case) is true
+			static const char *falses[] = { "false", "no", "0" };
+
+			for (size_t i = 0; i < sizeof(falses) / sizeof(falses[0]); i++) {
+
+				size_t j = 0;
+
+				for (; (j < size) && (falses[i][j] != '\0'); j++) {
+					if (tolower(static_cast<unsigned char>(data[j])) != falses[i][j]) break;
+				}
+
+				if ((j == size) && (falses[i][j] == '\0')) {
+					return false;
+				}
+			}
+
+			return true;
+		}
+	};
+
+	/**
+	 * Converts the value of a leaf to T. Arithmetic types are parsed once and
+	 * cached in the node, later conversions to the same kind are a plain load.
+	 * All other types go through boost::lexical_cast.
+	 */
+	template<typename T>
+		struct ConfigConvert {
+
+			static T get(const ConfigNode *node) {
+				return boost::lexical_cast<T>(node->getValue().str());
+			}
+		};
+
+	template<>
+		struct ConfigConvert<std::string> {
+
+			static std::string get(const ConfigNode *node) {
+				return node->getValue().str();
+			}
+		};
+
+	template<>
+		struct ConfigConvert<bool> {
+
+			static bool get(const ConfigNode *node) {
+
+				if (node->isCached(ConfigNode::Bool)) {
+					return node->getCachedBool();
+				}
+
+				bool value = ConfigParse::boolean(node->getValue().data(), node->getValue().size());
+				node->setCached(value);
+
+				return value;
+			}
+		};
+
+	template<typename T>
+		struct ConfigConvertInteger {
+
+			static T get(const ConfigNode *node) {
+
+				long long value;
+
+				if (node->isCached(ConfigNode::Integer)) {
+					value = node->getCachedInteger();
+				} else {
+
+					if (!ConfigParse::integer(node->getValue().data(), node->getValue().size(), &value)) {
+						return boost::lexical_cast<T>(node->getValue().str());
+					}
+
+					node->setCached(value);
+				}
+
+				if (std::numeric_limits<T>::is_signed) {
+
+					if ((value < static_cast<long long>(std::numeric_limits<T>::min())) ||
+						(value > static_cast<long long>(std::numeric_limits<T>::max())))
+					{
+						throw boost::bad_lexical_cast(typeid(std::string), typeid(T));
+					}
+
+				} else {
+
+					// Like lexical_cast, negative values wrap around
+					unsigned long long magnitude = (value < 0 ?
+						0 - static_cast<unsigned long long>(value) : static_cast<unsigned long long>(value));
+
+					if (magnitude > static_cast<unsigned long long>(std::numeric_limits<T>::max())) {
+						throw boost::bad_lexical_cast(typeid(std::string), typeid(T));
+					}
+				}
+
+				return static_cast<T>(value);
+			}
+		};
+
+	template<typename T>
+		struct ConfigConvertReal {
+
+			static T get(const ConfigNode *node) {
+
+				double value;
+
+				if (node->isCached(ConfigNode::Real)) {
+					value = node->getCachedReal();
+				} else {
+
+					if (!ConfigParse::real(node->getValue().data(), node->getValue().size(), &value)) {
+						return boost::lexical_cast<T>(node->getValue().str());
+					}
+
+					node->setCached(value);
+				}
+
+				// Like lexical_cast, values that do not fit are an error
+				if ((value > static_cast<double>(std::numeric_limits<T>::max())) ||
+					(value < -static_cast<double>(std::numeric_limits<T>::max())))
+				{
+					throw boost::bad_lexical_cast(typeid(std::string), typeid(T));
+				}
+
+				return static_cast<T>(value);
+			}
+		};
+
+	template<> struct ConfigConvert<short> : public ConfigConvertInteger<short> {};
+	template<> struct ConfigConvert<unsigned short> : public ConfigConvertInteger<unsigned short> {};
+	template<> struct ConfigConvert<int> : public ConfigConvertInteger<int> {};
+	template<> struct ConfigConvert<unsigned int> : public ConfigConvertInteger<unsigned int> {};
+	template<> struct ConfigConvert<long> : public ConfigConvertInteger<long> {};
+	template<> struct ConfigConvert<unsigned long> : public ConfigConvertInteger<unsigned long> {};
+	template<> struct ConfigConvert<long long> : public ConfigConvertInteger<long long> {};
+	template<> struct ConfigConvert<float> : public ConfigConvertReal<float> {};
+	template<> struct ConfigConvert<double> : public ConfigConvertReal<double> {};
+}
+
+#endif /* CASTOR_CONFIGCONVERT_H */
+
@@ -0,0 +1,216 @@
+/*
+ * $Id$
+ *
+ * Copyright 2008 Carpe Noctem, Distributed Systems Group,
+ * University of Kassel. All right reserved.
+ *
+ * The code is licensed under the Carpe Noctem Userfriendly BSD-Based
+ * License (CNUBBL). Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided that the
+ * conditions of the CNUBBL are met.
+ *
+ * You should have received a copy of the CNUBBL along with this
+ * software. The license is also available on our website:
+ * http://carpenoctem.das-lab.net/license.txt
+ */
+
+#include "ConfigIndex.h"
+
+namespace castor {
+
+	ConfigIndex::ConfigIndex() :
+		entries(), count(0), threshold(0), built(false)
+	{
+	}
+
+	void ConfigIndex::setThreshold(unsigned int threshold) {
+
+		this->threshold = threshold;
+		reset();
+	}
+
+	void ConfigIndex::reset() {
+
+		std::vector<Entry>().swap(this->entries);
+
+		this->count = 0;
+		this->built = false;
+	}
+
+	void ConfigIndex::rehash(size_t size) {
+
+		std::vector<Entry> old(size);
+		old.swap(this->entries);
+
+		size_t mask = size - 1;
+
+		for (size_t i = 0; i < old.size(); i++) {
+
+			if (old[i].parent == NULL) continue;
+
+			size_t slot = hash(old[i].parent, old[i].symbol) & mask;
+
+			while (this->entries[slot].parent != NULL) {
+				slot = (slot + 1) & mask;
+			}
+
+			this->entries[slot] = old[i];
+		}
+	}
+
+	size_t ConfigIndex::locate(const ConfigNode *parent, ConfigSymbol symbol) const {
+
+		if (this->count == 0) {
+			return this->entries.size();
+		}
+
+		size_t mask = this->entries.size() - 1;
+		size_t slot = hash(parent, symbol) & mask;
+
+		for (; this->entries[slot].parent != NULL; slot = (slot + 1) & mask) {
+
+			const Entry &entry = this->entries[slot];
+
+			if ((entry.parent == parent) && (entry.symbol == symbol)) {
+				return slot;
+			}
+		}
+
+		return this->entries.size();
+	}
+
+	void ConfigIndex::insert(ConfigNode *child) {
+
+		// Comments have no name and are never looked up
+		if (child->getType() == ConfigNode::Comment) {
+			return;
+		}
+
+		if (2 * (this->count + 1) > this->entries.size()) {
+			rehash(this->entries.size() < 64 ? 64 : 2 * this->entries.size());
+		}
+
+		const ConfigNode *parent = child->getParent();
+		ConfigSymbol symbol = child->getSymbol();
+
+		size_t mask = this->entries.size() - 1;
+		size_t slot = hash(parent, symbol) & mask;
+
+		for (; this->entries[slot].parent != NULL; slot = (slot + 1) & mask) {
+
+			Entry &entry = this->entries[slot];
+
+			if ((entry.parent == parent) && (entry.symbol == symbol)) {
+
+				if (entry.first == NULL) {
+					entry.first = child;
+				}
+
+				entry.last = child;
+				return;
+			}
+		}
+
+		Entry &entry = this->entries[slot];
+
+		entry.parent = parent;
+		entry.symbol = symbol;
+		entry.first = child;
+		entry.last = child;
+
+		this->count++;
+	}
+
+	void ConfigIndex::reindex(const ConfigNode *parent) {
+
+		// Empty the ranges first, they may be outdated or refer to removed
+		// nodes
+		for (ConfigNode *child = parent->getFirstChild(); child != NULL; child = child->getNext()) {
+
+			size_t slot = locate(parent, child->getSymbol());
+
+			if (slot < this->entries.size()) {
+				this->entries[slot].first = NULL;
+				this->entries[slot].last = NULL;
+			}
+		}
+
+		for (ConfigNode *child = parent->getFirstChild(); child != NULL; child = child->getNext()) {
+			insert(child);
+		}
+	}
+
+	void ConfigIndex::build(ConfigNode *node) {
+
+		bool indexed = (node->getChildCount() >= this->threshold);
+
+		for (ConfigNode *child = node->getFirstChild(); child != NULL; child = child->getNext()) {
+
+			if (indexed) {
+				insert(child);
+			}
+
+			if (child->getFirstChild() != NULL) {
+				build(child);
+			}
+		}
+	}
+
+	bool ConfigIndex::find(const ConfigNode *parent, ConfigSymbol symbol, ConfigNode **first, ConfigNode **last) const {
+
+		size_t slot = locate(parent, symbol);
+
+		// The range of a name whose nodes have all been removed is empty
+		if ((slot == this->entries.size()) || (this->entries[slot].first == NULL)) {
+			return false;
+		}
+
+		*first = this->entries[slot].first;
+		*last = this->entries[slot].last;
+
+		return true;
+	}
+
+	void ConfigIndex::add(ConfigNode *child) {
+
+		if (!this->built) {
+			return;
+		}
+
+		ConfigNode *parent = child->getParent();
+
+		if (parent->getChildCount() < this->threshold) {
+			return;
+		}
+
+		// Index all children if the parent just became wide enough, or if the
+		// child went in between its siblings
+		if ((parent->getChildCount() == this->threshold) || (child != parent->getLastChild())) {
+			reindex(parent);
+		} else {
+			insert(child);
+		}
+	}
+
+	void ConfigIndex::remove(ConfigNode *child) {
+
+		if (!this->built) {
+			return;
+		}
+
+		ConfigNode *parent = child->getParent();
+		size_t slot = locate(parent, child->getSymbol());
+
+		// The range of its name may end at the child, but there may also be no
+		// sibling of that name left to reindex it
+		if (slot < this->entries.size()) {
+			this->entries[slot].first = NULL;
+			this->entries[slot].last = NULL;
+		}
+
+		if (parent->getChildCount() >= this->threshold) {
+			reindex(parent);
+		}
+	}
+}
+
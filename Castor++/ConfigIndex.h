@@ -0,0 +1,138 @@
+/*
+ * $Id$
+ *
+ * Copyright 2008 Carpe Noctem, Distributed Systems Group,
+ * University of Kassel. All right reserved.
+ *
+ * The code is licensed under the Carpe Noctem Userfriendly BSD-Based
+ * License (CNUBBL). Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided that the
+ * conditions of the CNUBBL are met.
+ *
+ * You should have received a copy of the CNUBBL along with this
+ * software. The license is also available on our website:
+ * http://carpenoctem.das-lab.net/license.txt
+ */
+
+#ifndef CASTOR_CONFIGINDEX_H
+#define CASTOR_CONFIGINDEX_H 1
+
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#include "ConfigNode.h"
+
+namespace castor {
+
+	/**
+	 * Hash index over the children of wide sections. For every node with at
+	 * least getThreshold() children it maps (parent, name) to the range of
+	 * siblings between the first and the last child of that name, so a lookup
+	 * no longer scans all children.
+	 *
+	 * The index is disabled by default (threshold 0). The tree builds it
+	 * when it has been loaded or the threshold has been set, and keeps it up
+	 * to date when nodes are added or removed. Lookups only read it, so they
+	 * may run in several threads at once.
+	 */
+	class ConfigIndex : private boost::noncopyable {
+
+		protected:
+
+			struct Entry {
+				const ConfigNode *parent;
+				ConfigSymbol symbol;
+				ConfigNode *first;
+				ConfigNode *last;
+			};
+
+			std::vector<Entry> entries;
+			size_t count;
+			unsigned int threshold;
+			bool built;
+
+			static size_t hash(const ConfigNode *parent, ConfigSymbol symbol) {
+
+				size_t h = reinterpret_cast<size_t>(parent) * 0x9e3779b97f4a7c15ULL;
+				return (h ^ (h >> 29)) + symbol * 0x85ebca6bU;
+			}
+
+			void rehash(size_t size);
+			size_t locate(const ConfigNode *parent, ConfigSymbol symbol) const;
+			void insert(ConfigNode *child);
+			void reindex(const ConfigNode *parent);
+			void build(ConfigNode *node);
+
+		public:
+
+			ConfigIndex();
+
+			/**
+			 * Sets the minimum number of children a node needs to be indexed;
+			 * 0 disables the index. Changing the threshold drops the index
+			 * until the next prepare().
+			 */
+			void setThreshold(unsigned int threshold);
+
+			unsigned int getThreshold() const {
+				return this->threshold;
+			}
+
+			bool isBuilt() const {
+				return this->built;
+			}
+
+			/**
+			 * Returns whether the children of the given node are indexed.
+			 */
+			bool covers(const ConfigNode *parent) const {
+				return ((this->built) && (parent->getChildCount() >= this->threshold));
+			}
+
+			/**
+			 * Builds the index for the tree below root if it is enabled and
+			 * has not been built yet.
+			 */
+			void prepare(ConfigNode *root) {
+
+				if ((this->threshold > 0) && (!this->built)) {
+					build(root);
+					this->built = true;
+				}
+			}
+
+			/**
+			 * Looks up the children of parent with the given name. Only valid
+			 * if covers() returned true for parent.
+			 * @return false if there are no such children
+			 */
+			bool find(const ConfigNode *parent, ConfigSymbol symbol, ConfigNode **first, ConfigNode **last) const;
+
+			/**
+			 * Registers a node that has just been linked to its parent.
+			 */
+			void add(ConfigNode *child);
+
+			/**
+			 * Unregisters a node that has just been unlinked from its parent.
+			 */
+			void remove(ConfigNode *child);
+
+			/**
+			 * Drops the index until the next prepare().
+			 */
+			void reset();
+
+			size_t size() const {
+				return this->count;
+			}
+
+			size_t getMemoryUsage() const {
+				return this->entries.capacity() * sizeof(Entry);
+			}
+	};
+}
+
+#endif /* CASTOR_CONFIGINDEX_H */
+
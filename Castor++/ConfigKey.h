@@ -0,0 +1,284 @@
+/*
+ * $Id$
+ *
+ * Copyright 2008 Carpe Noctem, Distributed Systems Group,
+ * University of Kassel. All right reserved.
+ *
+ * The code is licensed under the Carpe Noctem Userfriendly BSD-Based
+ * License (CNUBBL). Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided that the
+ * conditions of the CNUBBL are met.
+ *
+ * You should have received a copy of the CNUBBL along with this
+ * software. The license is also available on our website:
+ * http://carpenoctem.das-lab.net/license.txt
+ */
+
+#ifndef CASTOR_CONFIGKEY_H
+#define CASTOR_CONFIGKEY_H 1
+
+#include <string>
+#include <cstring>
+#include <cstddef>
+#include <vector>
+#include <type_traits>
+#include <cstdarg>
+
+#include "ConfigString.h"
+#include "ConfigSymbols.h"
+
+/**
+ * Collects the NULL-terminated arguments of the varargs API into a vector
+ * of keys that ends with a null key.
+ */
+#define CONSUME_KEYS(path) \
+std::vector<castor::ConfigKey> keys;\
+{\
+	va_list ap;\
+	va_start(ap, path);\
+	for (const char *temp = const_cast<const char *>(path); temp != NULL; temp = va_arg(ap, const char *)) { \
+		keys.push_back(castor::ConfigKey(temp, strlen(temp))); \
+	} \
+	va_end(ap); \
+}\
+keys.push_back(castor::ConfigKey());
+
+/**
+ * Marks the entry points of the varargs API, so that calls that miss the
+ * terminating NULL are warned about.
+ */
+#ifdef __GNUC__
+#	define CASTOR_SENTINEL __attribute__((sentinel))
+#else
+#	define CASTOR_SENTINEL
+#endif
+
+namespace castor {
+
+	/**
+	 * One argument of a lookup such as get<int>("Drive", "Motor.maxSpeed"):
+	 * a dot-separated path, split into components that carry their symbol
+	 * hash. The constructors are constexpr, so keys built from literals are
+	 * split and hashed by the compiler; declaring them constexpr guarantees
+	 * it:
+	 *
+	 *   static constexpr ConfigKey motor("Drive.Motor");
+	 *   config.get<int>(motor, "maxSpeed");
+	 *
+	 * A key keeps a pointer to the path, it must not outlive it. The first
+	 * MaxComponents components are split in advance, the remainder of longer
+	 * paths when they are resolved.
+	 */
+	class ConfigKey {
+
+		public:
+
+			static const size_t MaxComponents = 8;
+
+			struct Component {
+				unsigned int offset;
+				unsigned int size;
+				unsigned int hash;
+
+				constexpr Component() : offset(0), size(0), hash(0) {}
+			};
+
+		protected:
+
+			const char *path;
+			size_t length;
+			size_t count;
+			size_t rest;
+			Component components[MaxComponents];
+
+			static constexpr size_t measure(const char *path, size_t max) {
+
+				size_t size = 0;
+
+				while ((size < max) && (path[size] != '\0')) {
+					size++;
+				}
+
+				return size;
+			}
+
+		public:
+
+			/**
+			 * The terminator of a path, the NULL of the old argument lists.
+			 */
+			constexpr ConfigKey() :
+				path(NULL), length(0), count(0), rest(0), components()
+			{
+			}
+
+			constexpr ConfigKey(const char *path, size_t length) :
+				path(path), length(length), count(0), rest(length), components()
+			{
+				size_t begin = 0;
+
+				for (size_t i = 0; i <= length; i++) {
+
+					if ((i < length) && (path[i] != '.')) continue;
+
+					if (this->count == MaxComponents) {
+						this->rest = begin;
+						break;
+					}
+
+					this->components[this->count].offset = begin;
+					this->components[this->count].size = i - begin;
+					this->components[this->count].hash = ConfigSymbols::hash(path + begin, i - begin);
+					this->count++;
+
+					begin = i + 1;
+				}
+			}
+
+			template<size_t N>
+				constexpr ConfigKey(const char (&path)[N]) :
+					ConfigKey(path, measure(path, N - 1))
+				{
+				}
+
+			constexpr bool isNull() const {
+				return (this->path == NULL);
+			}
+
+			constexpr const char *data() const {
+				return this->path;
+			}
+
+			constexpr size_t size() const {
+				return this->length;
+			}
+
+			/**
+			 * Returns the number of components split in advance.
+			 */
+			constexpr size_t getCount() const {
+				return this->count;
+			}
+
+			constexpr const Component &getComponent(size_t i) const {
+				return this->components[i];
+			}
+
+			/**
+			 * Returns the offset of the components that are not split in
+			 * advance, size() if there are none.
+			 */
+			constexpr size_t getRest() const {
+				return this->rest;
+			}
+	};
+
+	/**
+	 * Turns the arguments of a lookup into keys. Character arrays
+	 * (literals) use the constexpr constructor, strings are split at run
+	 * time. A null pointer ends the path.
+	 *
+	 * get() of a literal is a constant expression. Within a lookup such as
+	 * get<int>("Drive", "Motor") the keys are local to the call, so folding
+	 * them is up to the optimizer; a constexpr ConfigKey guarantees it.
+	 */
+	template<typename T, typename Enable = void>
+		struct ConfigKeyArgument {
+			static const bool valid = false;
+		};
+
+	template<size_t N>
+		struct ConfigKeyArgument<char[N]> {
+
+			static const bool valid = true;
+
+			static constexpr ConfigKey get(const char (&path)[N]) {
+				return ConfigKey(path);
+			}
+		};
+
+	template<>
+		struct ConfigKeyArgument<const char *> {
+
+			static const bool valid = true;
+
+			static ConfigKey get(const char *path) {
+				return (path == NULL ? ConfigKey() : ConfigKey(path, strlen(path)));
+			}
+		};
+
+	template<>
+		struct ConfigKeyArgument<char *> : public ConfigKeyArgument<const char *> {
+		};
+
+	template<>
+		struct ConfigKeyArgument<std::string> {
+
+			static const bool valid = true;
+
+			static ConfigKey get(const std::string &path) {
+				return ConfigKey(path.data(), path.size());
+			}
+		};
+
+	template<>
+		struct ConfigKeyArgument<ConfigString> {
+
+			static const bool valid = true;
+
+			static ConfigKey get(const ConfigString &path) {
+				return ConfigKey(path.data(), path.size());
+			}
+		};
+
+	template<>
+		struct ConfigKeyArgument<ConfigKey> {
+
+			static const bool valid = true;
+
+			static const ConfigKey &get(const ConfigKey &key) {
+				return key;
+			}
+		};
+
+	/**
+	 * True if all of the given types are accepted by ConfigKeyArgument.
+	 */
+	template<typename... Arguments>
+		struct ConfigKeyList {
+			static const bool valid = true;
+		};
+
+	template<typename First, typename... Arguments>
+		struct ConfigKeyList<First, Arguments...> {
+			static const bool valid = ConfigKeyArgument<First>::valid && ConfigKeyList<Arguments...>::valid;
+		};
+
+	/**
+	 * True if the given types are arguments of the variadic API: a list of
+	 * ConfigKeyList, but not a single C string. That is a call of the
+	 * varargs API, which takes a const char * and has to end with NULL; a
+	 * single path goes through a ConfigKey or a ConfigPath instead.
+	 */
+	template<typename... Arguments>
+		struct ConfigKeyArguments {
+			static const bool valid = ConfigKeyList<Arguments...>::valid;
+		};
+
+	template<size_t N>
+		struct ConfigKeyArguments<char[N]> {
+			static const bool valid = false;
+		};
+
+	template<>
+		struct ConfigKeyArguments<const char *> {
+			static const bool valid = false;
+		};
+
+	template<>
+		struct ConfigKeyArguments<char *> {
+			static const bool valid = false;
+		};
+}
+
+#endif /* CASTOR_CONFIGKEY_H */
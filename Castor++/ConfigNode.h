@@ -0,0 +1,287 @@
+/*
+ * $Id$
+ *
+ * Copyright 2008 Carpe Noctem, Distributed Systems Group,
+ * University of Kassel. All right reserved.
+ *
+ * The code is licensed under the Carpe Noctem Userfriendly BSD-Based
+ * License (CNUBBL). Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided that the
+ * conditions of the CNUBBL are met.
+ *
+ * You should have received a copy of the CNUBBL along with this
+ * software. The license is also available on our website:
+ * http://carpenoctem.das-lab.net/license.txt
+ */
+
+#ifndef CASTOR_CONFIGNODE_H
+#define CASTOR_CONFIGNODE_H 1
+
+#include "ConfigString.h"
+#include "ConfigSymbols.h"
+
+namespace castor {
+
+	/**
+	 * A node of the configuration tree. Nodes are placed in the arena of their
+	 * Configuration in the order they are parsed, i.e. depth-first, and link
+	 * to their children intrusively. Names are symbols of the configuration
+	 * (see Configuration::getName()), comments keep their text as value.
+	 * Nodes are released together with the arena.
+	 */
+	class ConfigNode {
+
+		public:
+
+			typedef enum {
+				Node = 0,
+				Leaf = 1,
+				Comment = 2,
+			} Type;
+
+			/**
+			 * Kinds of parsed values cached for a leaf, see ConfigConvert.
+			 * Every kind has a slot of its own, so a leaf read as double and
+			 * as int is parsed once for each. A slot is only ever written
+			 * with the value parsed from the same text, so concurrent readers
+			 * of a snapshot that fill it at the same time agree.
+			 */
+			typedef enum {
+				None = 0,
+				Bool = 1,
+				Integer = 2,
+				Real = 3,
+			} Cached;
+
+		protected:
+
+			ConfigString value;
+			ConfigNode *parent;
+			ConfigNode *firstChild;
+			ConfigNode *lastChild;
+			ConfigNode *next;
+			unsigned int childCount;
+			ConfigSymbol symbol;
+			unsigned short depth;
+			unsigned char type;
+			mutable unsigned char cached;
+			mutable long long integer;
+			mutable double real;
+			mutable unsigned long long hash;
+
+			/**
+			 * Bits of cached: one per kind that has been cached, and the
+			 * value of a cached bool.
+			 */
+			static unsigned char flag(Cached kind) {
+				return static_cast<unsigned char>(1 << kind);
+			}
+
+			static const unsigned char True = 1 << 4;
+
+		public:
+
+			ConfigNode(Type type, ConfigSymbol symbol, const ConfigString &value) :
+				value(value), parent(NULL), firstChild(NULL), lastChild(NULL),
+				next(NULL), childCount(0), symbol(symbol), depth(0), type(type), cached(0), integer(0), real(0), hash(0)
+			{
+			}
+
+			/**
+			 * Appends the given node to the children of this node.
+			 */
+			void append(ConfigNode *child) {
+
+				child->parent = this;
+				child->depth = this->depth + 1;
+
+				if (this->lastChild == NULL) {
+					this->firstChild = child;
+				} else {
+					this->lastChild->next = child;
+				}
+
+				this->lastChild = child;
+				this->childCount++;
+			}
+
+			/**
+			 * Inserts the given node after previous, one of the children of
+			 * this node, or as the first child if previous is NULL.
+			 */
+			void insert(ConfigNode *child, ConfigNode *previous) {
+
+				if (previous == this->lastChild) {
+					append(child);
+					return;
+				}
+
+				child->parent = this;
+				child->depth = this->depth + 1;
+
+				if (previous == NULL) {
+					child->next = this->firstChild;
+					this->firstChild = child;
+				} else {
+					child->next = previous->next;
+					previous->next = child;
+				}
+
+				this->childCount++;
+			}
+
+			/**
+			 * Moves all children of other, which has to be at the same depth,
+			 * behind the children of this node.
+			 */
+			void adopt(ConfigNode *other) {
+
+				if (other->firstChild == NULL) {
+					return;
+				}
+
+				for (ConfigNode *child = other->firstChild; child != NULL; child = child->next) {
+					child->parent = this;
+				}
+
+				if (this->lastChild == NULL) {
+					this->firstChild = other->firstChild;
+				} else {
+					this->lastChild->next = other->firstChild;
+				}
+
+				this->lastChild = other->lastChild;
+				this->childCount += other->childCount;
+
+				other->firstChild = NULL;
+				other->lastChild = NULL;
+				other->childCount = 0;
+			}
+
+			/**
+			 * Unlinks the given child. It keeps its parent, so its path can
+			 * still be told.
+			 */
+			void remove(ConfigNode *child) {
+
+				ConfigNode *previous = NULL;
+
+				for (ConfigNode *node = this->firstChild; node != child; node = node->next) {
+					if (node == NULL) return;
+					previous = node;
+				}
+
+				if (previous == NULL) {
+					this->firstChild = child->next;
+				} else {
+					previous->next = child->next;
+				}
+
+				if (this->lastChild == child) {
+					this->lastChild = previous;
+				}
+
+				child->next = NULL;
+				this->childCount--;
+			}
+
+			ConfigNode *getFirstChild() const {
+				return this->firstChild;
+			}
+
+			ConfigNode *getLastChild() const {
+				return this->lastChild;
+			}
+
+			ConfigNode *getNext() const {
+				return this->next;
+			}
+
+			unsigned int getChildCount() const {
+				return this->childCount;
+			}
+
+			ConfigNode *getParent() const {
+				return this->parent;
+			}
+
+			const ConfigString &getValue() const {
+				return this->value;
+			}
+
+			void setValue(const ConfigString &value) {
+				this->value = value;
+				this->cached = 0;
+			}
+
+			bool isCached(Cached kind) const {
+				return ((__atomic_load_n(&this->cached, __ATOMIC_ACQUIRE) & flag(kind)) != 0);
+			}
+
+			bool getCachedBool() const {
+				return ((__atomic_load_n(&this->cached, __ATOMIC_ACQUIRE) & True) != 0);
+			}
+
+			long long getCachedInteger() const {
+				return __atomic_load_n(&this->integer, __ATOMIC_RELAXED);
+			}
+
+			double getCachedReal() const {
+
+				double result;
+				__atomic_load(&this->real, &result, __ATOMIC_RELAXED);
+
+				return result;
+			}
+
+			void setCached(bool value) const {
+				__atomic_fetch_or(&this->cached, static_cast<unsigned char>(flag(Bool) | (value ? True : 0)), __ATOMIC_RELEASE);
+			}
+
+			void setCached(long long value) const {
+				__atomic_store_n(&this->integer, value, __ATOMIC_RELAXED);
+				__atomic_fetch_or(&this->cached, flag(Integer), __ATOMIC_RELEASE);
+			}
+
+			void setCached(double value) const {
+				__atomic_store(&this->real, &value, __ATOMIC_RELAXED);
+				__atomic_fetch_or(&this->cached, flag(Real), __ATOMIC_RELEASE);
+			}
+
+			/**
+			 * Returns the content hash of the subtree, 0 if it has not been
+			 * computed since the subtree changed, see ConfigTree::getHash().
+			 * Concurrent readers may compute it at the same time, they all
+			 * store the same value.
+			 */
+			unsigned long long getHash() const {
+				return __atomic_load_n(&this->hash, __ATOMIC_RELAXED);
+			}
+
+			void setHash(unsigned long long hash) const {
+				__atomic_store_n(&this->hash, hash, __ATOMIC_RELAXED);
+			}
+
+			ConfigSymbol getSymbol() const {
+				return this->symbol;
+			}
+
+			/**
+			 * Only for moving nodes between symbol tables, see ConfigTree::merge().
+			 */
+			void setSymbol(ConfigSymbol symbol) {
+				this->symbol = symbol;
+			}
+
+			int getDepth() const {
+				return this->depth;
+			}
+
+			Type getType() const {
+				return static_cast<Type>(this->type);
+			}
+	};
+}
+
+#endif /* CASTOR_CONFIGNODE_H */
+
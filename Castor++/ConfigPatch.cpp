@@ -0,0 +1,364 @@
+/*
+ * $Id$
+ *
+ * Copyright 2008 Carpe Noctem, Distributed Systems Group,
+ * University of Kassel. All right reserved.
+ *
+ * The code is licensed under the Carpe Noctem Userfriendly BSD-Based
+ * License (CNUBBL). Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided that the
+ * conditions of the CNUBBL are met.
+ *
+ * You should have received a copy of the CNUBBL along with this
+ * software. The license is also available on our website:
+ * http://carpenoctem.das-lab.net/license.txt
+ */
+
+#include "ConfigPatch.h"
+
+#include <algorithm>
+
+namespace castor {
+
+	const size_t ConfigPatch::None;
+
+	static std::string append(const std::string &path, const ConfigString &name) {
+
+		std::string result(path);
+
+		if (!result.empty()) {
+			result += '.';
+		}
+
+		result.append(name.data(), name.size());
+
+		return result;
+	}
+
+	ConfigPatch::ConfigPatch() :
+		changes()
+	{
+	}
+
+	ConfigPatch ConfigPatch::diff(const ConfigTree &a, const ConfigTree &b) {
+
+		ConfigPatch result;
+		std::vector<ConfigChange::Step> steps;
+
+		if (a.getHash(a.getRoot()) != b.getHash(b.getRoot())) {
+			result.compare(a, a.getRoot(), b, b.getRoot(), steps, std::string());
+		}
+
+		return result;
+	}
+
+	/**
+	 * A child in the part of a section where the names differ, by the
+	 * symbol of its name in the old tree.
+	 */
+	struct ConfigPatchEntry {
+		ConfigSymbol symbol;
+		size_t position;
+
+		bool operator<(const ConfigPatchEntry &other) const {
+			return ((this->symbol < other.symbol) || ((this->symbol == other.symbol) && (this->position < other.position)));
+		}
+	};
+
+	/**
+	 * Returns how many siblings of the same name precede node.
+	 */
+	static unsigned int occurrence(const ConfigNode *node) {
+
+		unsigned int result = 0;
+
+		for (const ConfigNode *child = node->getParent()->getFirstChild(); child != node; child = child->getNext()) {
+			if ((child->getType() != ConfigNode::Comment) && (child->getSymbol() == node->getSymbol())) {
+				result++;
+			}
+		}
+
+		return result;
+	}
+
+	/**
+	 * Skips comments.
+	 */
+	static inline const ConfigNode *next(const ConfigNode *node) {
+
+		while ((node != NULL) && (node->getType() == ConfigNode::Comment)) {
+			node = node->getNext();
+		}
+
+		return node;
+	}
+
+	static void rest(const ConfigNode *node, std::vector<const ConfigNode *> *result) {
+
+		for (; node != NULL; node = next(node->getNext())) {
+			result->push_back(node);
+		}
+	}
+
+	/**
+	 * Drops the partners that are out of order: only the longest run of
+	 * partners that is ordered in both trees stays, the others are removed
+	 * and added again. Otherwise a patch could not tell a section that only
+	 * lists its children in another order from an unchanged one. Partners
+	 * of another type are replaced anyway, their order does not count.
+	 */
+	static void unorder(const std::vector<const ConfigNode *> &xs, const std::vector<const ConfigNode *> &ys,
+		std::vector<size_t> *partners)
+	{
+
+		const size_t None = ConfigPatch::None;
+
+		// Patience sorting: tails[k] ends the best run of length k + 1 found
+		// so far, links lead back through the run
+		std::vector<size_t> tails;
+		std::vector<size_t> links(partners->size(), None);
+
+		for (size_t j = 0; j < partners->size(); j++) {
+
+			size_t position = (*partners)[j];
+
+			if ((position == None) || (xs[position]->getType() != ys[j]->getType())) continue;
+
+			size_t low = 0;
+			size_t high = tails.size();
+
+			while (low < high) {
+
+				size_t middle = (low + high) / 2;
+
+				if ((*partners)[tails[middle]] < position) {
+					low = middle + 1;
+				} else {
+					high = middle;
+				}
+			}
+
+			links[j] = (low > 0 ? tails[low - 1] : None);
+
+			if (low == tails.size()) {
+				tails.push_back(j);
+			} else {
+				tails[low] = j;
+			}
+		}
+
+		std::vector<bool> ordered(partners->size(), false);
+
+		for (size_t j = (tails.empty() ? None : tails.back()); j != None; j = links[j]) {
+			ordered[j] = true;
+		}
+
+		for (size_t j = 0; j < partners->size(); j++) {
+			if (!ordered[j] && ((*partners)[j] != None) && (xs[(*partners)[j]]->getType() == ys[j]->getType())) {
+				(*partners)[j] = None;
+			}
+		}
+	}
+
+	void ConfigPatch::compare(const ConfigTree &a, const ConfigNode *x, const ConfigTree &b, const ConfigNode *y,
+		std::vector<ConfigChange::Step> &steps, const std::string &path)
+	{
+		// Usually both sections list the same names in the same order, at
+		// least up to the first node that has been added or removed
+		const ConfigNode *xc = next(x->getFirstChild());
+		const ConfigNode *yc = next(y->getFirstChild());
+
+		for (; (xc != NULL) && (yc != NULL); xc = next(xc->getNext()), yc = next(yc->getNext())) {
+
+			// Equal hashes imply equal names
+			if (a.getHash(xc) == b.getHash(yc)) continue;
+
+			if (!(a.getName(xc) == b.getName(yc))) break;
+
+			match(a, xc, b, yc, steps, path);
+		}
+
+		if ((xc == NULL) && (yc == NULL)) {
+			return;
+		}
+
+		// The rest is matched by name and order among that name
+		std::vector<const ConfigNode *> xs;
+		std::vector<const ConfigNode *> ys;
+
+		rest(xc, &xs);
+		rest(yc, &ys);
+
+		std::vector<ConfigPatchEntry> xe(xs.size());
+		std::vector<ConfigPatchEntry> ye(ys.size());
+
+		for (size_t i = 0; i < xs.size(); i++) {
+			xe[i].symbol = xs[i]->getSymbol();
+			xe[i].position = i;
+		}
+
+		for (size_t i = 0; i < ys.size(); i++) {
+
+			const ConfigString &name = b.getName(ys[i]);
+
+			ye[i].symbol = a.getSymbols().find(name.data(), name.size());
+			ye[i].position = i;
+		}
+
+		std::sort(xe.begin(), xe.end());
+		std::sort(ye.begin(), ye.end());
+
+		// Position in xs of the child each one in ys is compared to
+		std::vector<size_t> partners(ys.size(), None);
+
+		for (size_t i = 0, j = 0; (i < xe.size()) && (j < ye.size()); ) {
+
+			if (xe[i].symbol < ye[j].symbol) {
+				i++;
+			} else if (ye[j].symbol < xe[i].symbol) {
+				j++;
+			} else {
+				partners[ye[j].position] = xe[i].position;
+				i++;
+				j++;
+			}
+		}
+
+		unorder(xs, ys, &partners);
+
+		std::vector<bool> matched(xs.size(), false);
+
+		for (size_t j = 0; j < ys.size(); j++) {
+			if (partners[j] != None) {
+				matched[partners[j]] = true;
+				match(a, xs[partners[j]], b, ys[j], steps, path);
+			} else {
+				add(b, ys[j], steps, None, append(path, b.getName(ys[j])));
+			}
+		}
+
+		for (size_t i = 0; i < xs.size(); i++) {
+
+			if (matched[i]) continue;
+
+			const ConfigString &name = a.getName(xs[i]);
+
+			ConfigChange::Step step = { name.str(), occurrence(xs[i]) };
+			steps.push_back(step);
+
+			remove(xs[i], steps, append(path, name));
+
+			steps.pop_back();
+		}
+	}
+
+	void ConfigPatch::match(const ConfigTree &a, const ConfigNode *x, const ConfigTree &b, const ConfigNode *y,
+		std::vector<ConfigChange::Step> &steps, const std::string &path)
+	{
+		if (a.getHash(x) == b.getHash(y)) {
+			return;
+		}
+
+		const ConfigString &name = a.getName(x);
+		std::string childPath = append(path, name);
+
+		ConfigChange::Step step = { name.str(), occurrence(x) };
+		steps.push_back(step);
+
+		if (x->getType() != y->getType()) {
+
+			remove(x, steps, childPath);
+			steps.pop_back();
+			add(b, y, steps, None, childPath);
+
+			return;
+		}
+
+		if (y->getType() == ConfigNode::Leaf) {
+
+			ConfigChange change;
+
+			change.kind = ConfigChange::Changed;
+			change.type = ConfigNode::Leaf;
+			change.path = childPath;
+			change.name = step.name;
+			change.value = y->getValue().str();
+			change.previous = x->getValue().str();
+			change.steps = steps;
+			change.parent = None;
+
+			this->changes.push_back(change);
+
+		} else {
+			compare(a, x, b, y, steps, childPath);
+		}
+
+		steps.pop_back();
+	}
+
+	void ConfigPatch::add(const ConfigTree &b, const ConfigNode *node, const std::vector<ConfigChange::Step> &steps,
+		size_t parent, const std::string &path)
+	{
+		ConfigChange change;
+
+		change.kind = ConfigChange::Added;
+		change.type = node->getType();
+		change.path = path;
+		change.name = b.getName(node).str();
+		change.parent = parent;
+
+		if (node->getType() == ConfigNode::Leaf) {
+			change.value = node->getValue().str();
+		}
+
+		change.after.index = 0;
+
+		if (parent == None) {
+
+			change.steps = steps;
+
+			// The previous sibling exists in the patched tree by the time
+			// this change is applied, matched or added before
+			const ConfigNode *previous = NULL;
+
+			for (const ConfigNode *child = node->getParent()->getFirstChild(); child != node; child = child->getNext()) {
+				if (child->getType() != ConfigNode::Comment) {
+					previous = child;
+				}
+			}
+
+			if (previous != NULL) {
+				change.after.name = b.getName(previous).str();
+				change.after.index = occurrence(previous);
+			}
+		}
+
+		this->changes.push_back(change);
+
+		size_t position = this->changes.size() - 1;
+
+		for (const ConfigNode *child = node->getFirstChild(); child != NULL; child = child->getNext()) {
+			if (child->getType() != ConfigNode::Comment) {
+				add(b, child, steps, position, append(path, b.getName(child)));
+			}
+		}
+	}
+
+	void ConfigPatch::remove(const ConfigNode *node, const std::vector<ConfigChange::Step> &steps, const std::string &path) {
+
+		ConfigChange change;
+
+		change.kind = ConfigChange::Removed;
+		change.type = node->getType();
+		change.path = path;
+		change.name = steps.back().name;
+		change.steps = steps;
+		change.parent = None;
+
+		if (node->getType() == ConfigNode::Leaf) {
+			change.previous = node->getValue().str();
+		}
+
+		this->changes.push_back(change);
+	}
+}
@@ -0,0 +1,161 @@
+/*
+ * $Id$
+ *
+ * Copyright 2008 Carpe Noctem, Distributed Systems Group,
+ * University of Kassel. All right reserved.
+ *
+ * The code is licensed under the Carpe Noctem Userfriendly BSD-Based
+ * License (CNUBBL). Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided that the
+ * conditions of the CNUBBL are met.
+ *
+ * You should have received a copy of the CNUBBL along with this
+ * software. The license is also available on our website:
+ * http://carpenoctem.das-lab.net/license.txt
+ */
+
+#ifndef CASTOR_CONFIGPATCH_H
+#define CASTOR_CONFIGPATCH_H 1
+
+#include <vector>
+#include <string>
+
+#include "ConfigTree.h"
+
+namespace castor {
+
+	/**
+	 * One difference between two trees.
+	 */
+	struct ConfigChange {
+
+		typedef enum {
+			Added = 0,
+			Removed = 1,
+			Changed = 2,
+		} Kind;
+
+		/**
+		 * A node is identified by its name and by how many siblings of the
+		 * same name precede it.
+		 */
+		struct Step {
+			std::string name;
+			unsigned int index;
+		};
+
+		Kind kind;
+		ConfigNode::Type type;
+
+		/**
+		 * Dot-separated path of the node, e.g. "Drive.Motor.maxSpeed".
+		 */
+		std::string path;
+
+		/**
+		 * Name of the node, the last component of path.
+		 */
+		std::string name;
+
+		/**
+		 * New value of an added or changed leaf.
+		 */
+		std::string value;
+
+		/**
+		 * Old value of a removed or changed leaf.
+		 */
+		std::string previous;
+
+		/**
+		 * Location in the old tree of the node that is removed or changed,
+		 * or of the section a node is added to. Empty if the section has
+		 * been added by the change at position parent.
+		 */
+		std::vector<Step> steps;
+		size_t parent;
+
+		/**
+		 * Where an added node goes: after the sibling of this name and index
+		 * in the new tree, or first if the name is empty. The index counts
+		 * the siblings that are kept or added, so it holds once the removals
+		 * of the patch are done. Not used for the children of an added
+		 * section, they keep their order.
+		 */
+		Step after;
+	};
+
+	/**
+	 * The differences between two trees, see diff(). Comments are not
+	 * compared.
+	 *
+	 * Children are matched by name and order among the siblings of that
+	 * name, so the n-th "Robot" of a section in one tree is compared to the
+	 * n-th "Robot" in the other. Subtrees with the same hash (see
+	 * ConfigTree::getHash()) are skipped without looking at them, so two
+	 * large trees that differ in a few values are compared in time
+	 * proportional to the changes and the width of the sections they are
+	 * in. Sections are compared pairwise as long as both list the same
+	 * names, only the rest of a section is sorted by name. Children that
+	 * have changed their order are removed and added again, as the hash
+	 * depends on the order: a patch is empty if and only if the hashes of
+	 * both trees are equal.
+	 *
+	 * Added subtrees are listed node by node, parents first. A node whose
+	 * type changed is removed and added again.
+	 */
+	class ConfigPatch {
+
+		public:
+
+			static const size_t None = static_cast<size_t>(-1);
+
+			typedef std::vector<ConfigChange>::const_iterator const_iterator;
+
+		protected:
+
+			std::vector<ConfigChange> changes;
+
+			void compare(const ConfigTree &a, const ConfigNode *x, const ConfigTree &b, const ConfigNode *y,
+				std::vector<ConfigChange::Step> &steps, const std::string &path);
+
+			void match(const ConfigTree &a, const ConfigNode *x, const ConfigTree &b, const ConfigNode *y,
+				std::vector<ConfigChange::Step> &steps, const std::string &path);
+
+			void add(const ConfigTree &b, const ConfigNode *node, const std::vector<ConfigChange::Step> &steps,
+				size_t parent, const std::string &path);
+
+			void remove(const ConfigNode *node, const std::vector<ConfigChange::Step> &steps, const std::string &path);
+
+		public:
+
+			ConfigPatch();
+
+			/**
+			 * Returns the changes that turn a into b.
+			 */
+			static ConfigPatch diff(const ConfigTree &a, const ConfigTree &b);
+
+			size_t size() const {
+				return this->changes.size();
+			}
+
+			bool empty() const {
+				return this->changes.empty();
+			}
+
+			const ConfigChange &operator[](size_t i) const {
+				return this->changes[i];
+			}
+
+			const_iterator begin() const {
+				return this->changes.begin();
+			}
+
+			const_iterator end() const {
+				return this->changes.end();
+			}
+	};
+}
+
+#endif /* CASTOR_CONFIGPATCH_H */
@@ -0,0 +1,91 @@
+/*
+ * $Id$
+ *
+ * Copyright 2008 Carpe Noctem, Distributed Systems Group,
+ * University of Kassel. All right reserved.
+ *
+ * The code is licensed under the Carpe Noctem Userfriendly BSD-Based
+ * License (CNUBBL). Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided that the
+ * conditions of the CNUBBL are met.
+ *
+ * You should have received a copy of the CNUBBL along with this
+ * software. The license is also available on our website:
+ * http://carpenoctem.das-lab.net/license.txt
+ */
+
+#ifndef CASTOR_CONFIGPATH_H
+#define CASTOR_CONFIGPATH_H 1
+
+#include <vector>
+#include <string>
+
+#include <boost/algorithm/string.hpp>
+
+namespace castor {
+
+	class ConfigSnapshot;
+	class ConfigNode;
+
+	/**
+	 * A precompiled configuration path. The path is split once on
+	 * construction; the nodes it refers to are looked up on first use and
+	 * cached until the tree of the configuration changes (load(), create(),
+	 * clear()), so a handle can be kept across reloads.
+	 *
+	 * A handle caches the nodes of the tree it was used with last. It is not
+	 * synchronized and must not be shared between threads.
+	 */
+	class ConfigPath {
+
+		friend class ConfigSnapshot;
+
+		protected:
+
+			std::vector<std::string> components;
+
+			mutable unsigned long generation;
+			mutable std::vector<ConfigNode *> nodes;
+
+		public:
+
+			/**
+			 * @param path Dot-separated path, e.g. "Drive.Motor.maxSpeed"
+			 */
+			ConfigPath(const std::string &path) :
+				components(), generation(0), nodes()
+			{
+				boost::split(this->components, path, boost::is_any_of("."));
+			}
+
+			ConfigPath(const std::vector<std::string> &components) :
+				components(components), generation(0), nodes()
+			{
+			}
+
+			ConfigPath(const ConfigPath &other) :
+				components(other.components), generation(0), nodes()
+			{
+			}
+
+			ConfigPath &operator=(const ConfigPath &other) {
+
+				this->components = other.components;
+				this->generation = 0;
+				this->nodes.clear();
+
+				return *this;
+			}
+
+			const std::vector<std::string> &getComponents() const {
+				return this->components;
+			}
+
+			std::string str() const {
+				return boost::algorithm::join(this->components, ".");
+			}
+	};
+}
+
+#endif /* CASTOR_CONFIGPATH_H */
+
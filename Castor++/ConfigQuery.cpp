@@ -0,0 +1,180 @@
+/*
+ * $Id$
+ *
+ * Copyright 2008 Carpe Noctem, Distributed Systems Group,
+ * University of Kassel. All right reserved.
+ *
+ * The code is licensed under the Carpe Noctem Userfriendly BSD-Based
+ * License (CNUBBL). Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided that the
+ * conditions of the CNUBBL are met.
+ *
+ * You should have received a copy of the CNUBBL along with this
+ * software. The license is also available on our website:
+ * http://carpenoctem.das-lab.net/license.txt
+ */
+
+#include "ConfigQuery.h"
+#include "ConfigException.h"
+
+#include <sstream>
+
+#include <boost/algorithm/string.hpp>
+
+namespace castor {
+
+	const size_t ConfigQuery::MaxComponents;
+
+	ConfigQuery::ConfigQuery(const std::string &pattern) :
+		pattern(pattern), components()
+	{
+		compile();
+	}
+
+	ConfigQuery::ConfigQuery(const char *pattern) :
+		pattern(pattern), components()
+	{
+		compile();
+	}
+
+	void ConfigQuery::compile() {
+
+		std::vector<std::string> names;
+		boost::split(names, this->pattern, boost::is_any_of("."));
+
+		if (names.size() > MaxComponents) {
+			std::ostringstream ss;
+			ss << "Pattern '" << this->pattern << "' has more than " << MaxComponents << " components!";
+			throw ConfigException(ss.str());
+		}
+
+		for (size_t i = 0; i < names.size(); i++) {
+
+			Component component;
+
+			component.kind = (names[i] == "**" ? Descendants : (names[i] == "*" ? Any : Name));
+			component.name = names[i];
+			component.hash = ConfigSymbols::hash(names[i].data(), names[i].size());
+
+			// Repeated ** match the same as one
+			if ((component.kind == Descendants) && (!this->components.empty()) && (this->components.back().kind == Descendants)) {
+				continue;
+			}
+
+			this->components.push_back(component);
+		}
+	}
+
+	/**
+	 * Adds the positions reachable without consuming a node: ** may match
+	 * no level at all.
+	 */
+	ConfigQuery::States ConfigQuery::close(States states) const {
+
+		for (size_t i = 0; i < this->components.size(); i++) {
+			if ((states & (1ull << i)) && (this->components[i].kind == Descendants)) {
+				states |= (1ull << (i + 1));
+			}
+		}
+
+		return states;
+	}
+
+	void ConfigQuery::collect(ConfigTree *tree, std::vector<ConfigNode *> *result) const {
+
+		const ConfigSymbols &names = tree->getSymbols();
+		std::vector<ConfigSymbol> symbols(this->components.size(), ConfigSymbols::Unknown);
+
+		// Names that have never been interned match no node
+		for (size_t i = 0; i < this->components.size(); i++) {
+			if (this->components[i].kind == Name) {
+				symbols[i] = names.find(this->components[i].name.data(), this->components[i].name.size(), this->components[i].hash);
+			}
+		}
+
+		walk(tree, tree->getRoot(), close(1), symbols, result);
+	}
+
+	void ConfigQuery::walk(ConfigTree *tree, ConfigNode *node, States states, const std::vector<ConfigSymbol> &symbols, std::vector<ConfigNode *> *result) const {
+
+		size_t size = this->components.size();
+
+		if (states & (1ull << size)) {
+			result->push_back(node);
+		}
+
+		// Positions reached by any child, and positions that wait for a name
+		States any = 0;
+		States named = 0;
+
+		for (size_t i = 0; i < size; i++) {
+
+			if (!(states & (1ull << i))) continue;
+
+			switch (this->components[i].kind) {
+				case Name:
+					if (symbols[i] != ConfigSymbols::Unknown) named |= (1ull << i);
+					break;
+				case Any:
+					any |= (1ull << (i + 1));
+					break;
+				case Descendants:
+					any |= (1ull << i);
+					break;
+			}
+		}
+
+		if ((any == 0) && (named == 0)) {
+			return;
+		}
+
+		ConfigNode *first = node->getFirstChild();
+		ConfigNode *last = node->getLastChild();
+
+		// Children with one particular name are all that can match
+		if (any == 0) {
+
+			ConfigSymbol symbol = ConfigSymbols::Unknown;
+			bool single = true;
+
+			for (size_t i = 0; i < size; i++) {
+
+				if (!(named & (1ull << i))) continue;
+
+				if ((symbol != ConfigSymbols::Unknown) && (symbol != symbols[i])) {
+					single = false;
+					break;
+				}
+
+				symbol = symbols[i];
+			}
+
+			if ((single) &&
+				(tree->getIndex().covers(node)) &&
+				(!tree->getIndex().find(node, symbol, &first, &last)))
+			{
+				return;
+			}
+		}
+
+		for (ConfigNode *child = first; child != NULL; child = child->getNext()) {
+
+			if (child->getType() != ConfigNode::Comment) {
+
+				States next = any;
+
+				for (size_t i = 0; i < size; i++) {
+					if ((named & (1ull << i)) && (child->getSymbol() == symbols[i])) {
+						next |= (1ull << (i + 1));
+					}
+				}
+
+				if (next != 0) {
+					walk(tree, child, close(next), symbols, result);
+				}
+			}
+
+			if (child == last) break;
+		}
+	}
+}
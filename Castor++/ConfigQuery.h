@@ -0,0 +1,97 @@
+/*
+ * $Id$
+ *
+ * Copyright 2008 Carpe Noctem, Distributed Systems Group,
+ * University of Kassel. All right reserved.
+ *
+ * The code is licensed under the Carpe Noctem Userfriendly BSD-Based
+ * License (CNUBBL). Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided that the
+ * conditions of the CNUBBL are met.
+ *
+ * You should have received a copy of the CNUBBL along with this
+ * software. The license is also available on our website:
+ * http://carpenoctem.das-lab.net/license.txt
+ */
+
+#ifndef CASTOR_CONFIGQUERY_H
+#define CASTOR_CONFIGQUERY_H 1
+
+#include <vector>
+#include <string>
+
+#include "ConfigTree.h"
+
+namespace castor {
+
+	/**
+	 * A path pattern with wildcards: "*" matches any one node (sections and
+	 * values, but not comments), "**" any number of levels including none.
+	 *
+	 *   Sensors.*.Calibration.offset
+	 *   Team.**.ip
+	 *
+	 * collect() walks the tree once and tracks all positions in the pattern
+	 * a node can be at, so every node is visited at most once and reported
+	 * at most once, in document order. Where only names can match, the
+	 * child index is used instead of scanning the children.
+	 *
+	 * A query is immutable after construction and may be shared between
+	 * threads.
+	 */
+	class ConfigQuery {
+
+		public:
+
+			/**
+			 * Maximum number of components of a pattern.
+			 */
+			static const size_t MaxComponents = 63;
+
+		protected:
+
+			typedef unsigned long long States;
+
+			enum Kind {
+				Name,
+				Any,
+				Descendants
+			};
+
+			struct Component {
+				Kind kind;
+				std::string name;
+				unsigned int hash;
+			};
+
+			std::string pattern;
+			std::vector<Component> components;
+
+			void compile();
+
+			States close(States states) const;
+
+			void walk(ConfigTree *tree, ConfigNode *node, States states, const std::vector<ConfigSymbol> &symbols, std::vector<ConfigNode *> *result) const;
+
+		public:
+
+			/**
+			 * @param pattern Dot-separated pattern, e.g. "Team.**.ip"
+			 * @throws ConfigException if it has more than MaxComponents
+			 * components
+			 */
+			ConfigQuery(const std::string &pattern);
+			ConfigQuery(const char *pattern);
+
+			/**
+			 * Appends all nodes of the tree that match to result.
+			 */
+			void collect(ConfigTree *tree, std::vector<ConfigNode *> *result) const;
+
+			const std::string &str() const {
+				return this->pattern;
+			}
+	};
+}
+
+#endif /* CASTOR_CONFIGQUERY_H */
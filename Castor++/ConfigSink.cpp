@@ -0,0 +1,169 @@
+/*
+ * $Id$
+ *
+ * Copyright 2008 Carpe Noctem, Distributed Systems Group,
+ * University of Kassel. All right reserved.
+ *
+ * The code is licensed under the Carpe Noctem Userfriendly BSD-Based
+ * License (CNUBBL). Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided that the
+ * conditions of the CNUBBL are met.
+ *
+ * You should have received a copy of the CNUBBL along with this
+ * software. The license is also available on our website:
+ * http://carpenoctem.das-lab.net/license.txt
+ */
+
+#include "ConfigSink.h"
+#include "ConfigException.h"
+
+#include <sstream>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <boost/atomic.hpp>
+
+namespace castor {
+
+	const size_t ConfigWriter::BufferSize;
+
+	ConfigSink::~ConfigSink() {
+	}
+
+	void ConfigStringSink::write(const char *data, size_t size) {
+		this->target->append(data, size);
+	}
+
+	void ConfigStreamSink::write(const char *data, size_t size) {
+
+		this->target->write(data, size);
+
+		if (!*this->target) {
+			throw ConfigException("Unable to write configuration to stream!");
+		}
+	}
+
+	void ConfigFileSink::write(const char *data, size_t size) {
+
+		while (size > 0) {
+
+			ssize_t written = ::write(this->fd, data, size);
+
+			if (written < 0) {
+
+				if (errno == EINTR) continue;
+
+				std::ostringstream ss;
+				ss << "Unable to write " << this->filename << ": " << strerror(errno);
+				throw ConfigException(ss.str());
+			}
+
+			data += written;
+			size -= written;
+		}
+	}
+
+	static std::string fileError(const std::string &action, const std::string &filename) {
+
+		std::ostringstream ss;
+		ss << "Unable to " << action << " " << filename << ": " << strerror(errno);
+
+		return ss.str();
+	}
+
+	static std::string temporary(const std::string &target) {
+
+		static boost::atomic<unsigned int> counter(0);
+
+		std::ostringstream ss;
+		ss << target << ".tmp." << getpid() << "." << counter++;
+
+		return ss.str();
+	}
+
+	/**
+	 * Follows symbolic links to the file they refer to, so that the file is
+	 * replaced rather than the link. A file that does not exist yet keeps
+	 * the given name.
+	 */
+	static std::string resolve(const std::string &target) {
+
+		char *path = realpath(target.c_str(), NULL);
+
+		if (path == NULL) {
+			return target;
+		}
+
+		std::string result(path);
+		free(path);
+
+		return result;
+	}
+
+	ConfigReplaceSink::ConfigReplaceSink(const std::string &target) :
+		ConfigFileSink(-1, std::string()), target(resolve(target))
+	{
+		this->filename = temporary(this->target);
+		this->fd = open(this->filename.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+
+		if (this->fd < 0) {
+			throw ConfigException(fileError("create", this->filename));
+		}
+	}
+
+	ConfigReplaceSink::~ConfigReplaceSink() {
+
+		if (this->fd >= 0) {
+			close(this->fd);
+		}
+
+		if (!this->filename.empty()) {
+			unlink(this->filename.c_str());
+		}
+	}
+
+	void ConfigReplaceSink::commit() {
+
+		// Keep the permissions of the file that is replaced
+		struct stat st;
+
+		if ((stat(this->target.c_str(), &st) == 0) && (fchmod(this->fd, st.st_mode & 07777) != 0)) {
+			throw ConfigException(fileError("change mode of", this->filename));
+		}
+
+		if (fsync(this->fd) != 0) {
+			throw ConfigException(fileError("sync", this->filename));
+		}
+
+		int fd = this->fd;
+		this->fd = -1;
+
+		if (close(fd) != 0) {
+			throw ConfigException(fileError("close", this->filename));
+		}
+
+		if (rename(this->filename.c_str(), this->target.c_str()) != 0) {
+			throw ConfigException(fileError("rename to " + this->target, this->filename));
+		}
+
+		this->filename.clear();
+
+		// Make the rename itself durable
+		std::string::size_type slash = this->target.rfind('/');
+		std::string directory = (slash == std::string::npos ? std::string(".") : this->target.substr(0, (slash == 0 ? 1 : slash)));
+
+		int dir = open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+		if (dir >= 0) {
+			fsync(dir);
+			close(dir);
+		}
+	}
+}
+
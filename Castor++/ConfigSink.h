@@ -0,0 +1,203 @@
+/*
+ * $Id$
+ *
+ * Copyright 2008 Carpe Noctem, Distributed Systems Group,
+ * University of Kassel. All right reserved.
+ *
+ * The code is licensed under the Carpe Noctem Userfriendly BSD-Based
+ * License (CNUBBL). Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided that the
+ * conditions of the CNUBBL are met.
+ *
+ * You should have received a copy of the CNUBBL along with this
+ * software. The license is also available on our website:
+ * http://carpenoctem.das-lab.net/license.txt
+ */
+
+#ifndef CASTOR_CONFIGSINK_H
+#define CASTOR_CONFIGSINK_H 1
+
+#include <string>
+#include <ostream>
+#include <cstring>
+
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_array.hpp>
+
+#include "ConfigString.h"
+
+namespace castor {
+
+	/**
+	 * Destination of serialized configurations, see
+	 * ConfigSnapshot::serialize(). Receives the output in blocks of up to
+	 * ConfigWriter::BufferSize characters.
+	 */
+	class ConfigSink {
+
+		public:
+
+			virtual ~ConfigSink();
+
+			virtual void write(const char *data, size_t size) = 0;
+	};
+
+	class ConfigStringSink : public ConfigSink {
+
+		protected:
+
+			std::string *target;
+
+		public:
+
+			ConfigStringSink(std::string *target) : target(target) {}
+
+			virtual void write(const char *data, size_t size);
+	};
+
+	class ConfigStreamSink : public ConfigSink {
+
+		protected:
+
+			std::ostream *target;
+
+		public:
+
+			ConfigStreamSink(std::ostream *target) : target(target) {}
+
+			virtual void write(const char *data, size_t size);
+	};
+
+	/**
+	 * Writes to a file descriptor, retrying short writes.
+	 * @throws ConfigException if writing fails
+	 */
+	class ConfigFileSink : public ConfigSink {
+
+		protected:
+
+			int fd;
+			std::string filename;
+
+		public:
+
+			ConfigFileSink(int fd, const std::string &filename) : fd(fd), filename(filename) {}
+
+			virtual void write(const char *data, size_t size);
+	};
+
+	/**
+	 * Replaces a file as a whole. The output goes to a new temporary file
+	 * next to it, which commit() syncs and renames over the file, so
+	 * readers see either the old or the new file, never a partial one.
+	 * Symbolic links are followed, the file they refer to is replaced.
+	 * The temporary file is removed again unless it has been committed.
+	 */
+	class ConfigReplaceSink : public ConfigFileSink, private boost::noncopyable {
+
+		protected:
+
+			std::string target;
+
+		public:
+
+			/**
+			 * Creates the temporary file for target, a name no other writer
+			 * uses.
+			 * @throws ConfigException if it cannot be created
+			 */
+			ConfigReplaceSink(const std::string &target);
+			virtual ~ConfigReplaceSink();
+
+			/**
+			 * Renames the temporary file to the target once it is on disk,
+			 * with the permissions of the file it replaces, and syncs the
+			 * directory to make the rename durable.
+			 * @throws ConfigException if any of these steps fails, the target
+			 * is unchanged then
+			 */
+			void commit();
+	};
+
+	/**
+	 * Collects small pieces of output in a fixed buffer and passes them on to
+	 * a sink in large blocks. The buffer is allocated once, not on the stack
+	 * of the caller, nothing is allocated while writing.
+	 */
+	class ConfigWriter : private boost::noncopyable {
+
+		public:
+
+			static const size_t BufferSize = 64 * 1024;
+
+		protected:
+
+			ConfigSink *sink;
+			size_t used;
+			boost::scoped_array<char> buffer;
+
+		public:
+
+			ConfigWriter(ConfigSink *sink) : sink(sink), used(0), buffer(new char[BufferSize]) {}
+
+			~ConfigWriter() {
+				// Exceptions of the sink must not escape, call flush() to see them
+				try { flush(); } catch (...) {}
+			}
+
+			void write(const char *data, size_t size) {
+
+				if (this->used + size > BufferSize) {
+
+					flush();
+
+					if (size > BufferSize) {
+						this->sink->write(data, size);
+						return;
+					}
+				}
+
+				memcpy(this->buffer.get() + this->used, data, size);
+				this->used += size;
+			}
+
+			void write(const ConfigString &value) {
+				write(value.data(), value.size());
+			}
+
+			void put(char c) {
+
+				if (this->used == BufferSize) {
+					flush();
+				}
+
+				this->buffer[this->used++] = c;
+			}
+
+			/**
+			 * Writes the given number of spaces.
+			 */
+			void indent(size_t count) {
+
+				static const char spaces[] = "                                                                ";
+
+				for (; count > sizeof(spaces) - 1; count -= sizeof(spaces) - 1) {
+					write(spaces, sizeof(spaces) - 1);
+				}
+
+				write(spaces, count);
+			}
+
+			void flush() {
+
+				if (this->used > 0) {
+					size_t used = this->used;
+					this->used = 0;
+					this->sink->write(this->buffer.get(), used);
+				}
+			}
+	};
+}
+
+#endif /* CASTOR_CONFIGSINK_H */
+
@@ -0,0 +1,264 @@
+/*
+ * $Id$
+ *
+ * Copyright 2008 Carpe Noctem, Distributed Systems Group,
+ * University of Kassel. All right reserved.
+ *
+ * The code is licensed under the Carpe Noctem Userfriendly BSD-Based
+ * License (CNUBBL). Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided that the
+ * conditions of the CNUBBL are met.
+ *
+ * You should have received a copy of the CNUBBL along with this
+ * software. The license is also available on our website:
+ * http://carpenoctem.das-lab.net/license.txt
+ */
+
+#include "ConfigSnapshot.h"
+
+namespace castor {
+
+	ConfigSnapshot::ConfigSnapshot() :
+		tree(), threadCache(false)
+	{
+	}
+
+	ConfigSnapshot::ConfigSnapshot(ConfigTreePtr tree, bool threadCache) :
+		tree(tree), threadCache(threadCache)
+	{
+	}
+
+	void ConfigSnapshot::serialize_internal(ConfigWriter *writer, const ConfigNode *node) {
+
+		if (node == NULL) return;
+
+		writer->indent(4 * node->getDepth());
+
+		if (node->getType() == ConfigNode::Node) {
+
+			writer->put('[');
+			writer->write(this->tree->getName(node));
+			writer->write("]\n", 2);
+
+			for (const ConfigNode *child = node->getFirstChild(); child != NULL; child = child->getNext()) {
+				serialize_internal(writer, child);
+			}
+
+			writer->indent(4 * node->getDepth());
+			writer->write("[!", 2);
+			writer->write(this->tree->getName(node));
+			writer->write("]\n", 2);
+
+		} else if (node -> getType() == ConfigNode::Leaf) {
+
+			writer->write(this->tree->getName(node));
+			writer->write(" = ", 3);
+			writer->write(node->getValue());
+			writer->put('\n');
+
+		} else { // Comment
+
+			writer->write("# ", 2);
+			writer->write(node->getValue());
+			writer->put('\n');
+
+		}
+	}
+
+	std::string ConfigSnapshot::serialize() {
+
+		std::string result;
+		ConfigStringSink sink(&result);
+
+		serialize(sink);
+
+		return result;
+	}
+
+	void ConfigSnapshot::serialize(ConfigSink &sink) {
+
+		ConfigWriter writer(&sink);
+
+		serialize_internal(&writer, this->tree->getRoot());
+
+		writer.flush();
+	}
+
+	void ConfigSnapshot::collect(const ConfigKey *keys, std::vector<ConfigNode *> *result) {
+
+		if ((this->threadCache) && (ConfigCache::find(*this->tree, keys, result))) {
+			return;
+		}
+
+		std::vector<ConfigSymbol> path;
+		size_t size = result->size();
+
+		if (this->tree->resolve(keys, &path)) {
+			this->tree->collect(this->tree->getRoot(), path, 0, result);
+		}
+
+		if (this->threadCache) {
+			ConfigCache::insert(*this->tree, keys, std::vector<ConfigNode *>(result->begin() + size, result->end()));
+		}
+	}
+
+	const std::vector<ConfigNode *> &ConfigSnapshot::collect(const ConfigPath &path) {
+
+		if (path.generation != this->tree->getGeneration()) {
+
+			std::vector<ConfigSymbol> symbols;
+
+			path.nodes.clear();
+
+			if (this->tree->resolve(path.components, &symbols)) {
+				this->tree->collect(this->tree->getRoot(), symbols, 0, &path.nodes);
+			}
+
+			path.generation = this->tree->getGeneration();
+		}
+
+		return path.nodes;
+	}
+
+	void ConfigSnapshot::collectSections(const ConfigKey *keys, std::vector<ConfigNode *> *result) {
+
+		std::vector<ConfigNode *> sections;
+
+		collect(keys, &sections);
+
+		for (size_t i = 0; i < sections.size(); i++) {
+			for (ConfigNode *child = sections[i]->getFirstChild(); child != NULL; child = child->getNext()) {
+				result->push_back(child);
+			}
+		}
+	}
+
+	std::string ConfigSnapshot::pathNotFound(const std::vector<std::string> *params)
+	{
+		std::ostringstream os;
+
+		if ((params == NULL) || (params->size() == 0))
+		{
+			os << "Empty path not found in " << this->tree->getFilename() << "!" << std::endl;
+		}
+		else
+		{
+			os << "Path '" << (*params)[0];
+
+			for (size_t i = 1; i < params->size(); i++) {
+				os << "." << (*params)[i];
+			}
+
+			os << "' not found in " << this->tree->getFilename() << "!" << std::endl;
+		}
+
+		return os.str();
+	}
+
+	std::string ConfigSnapshot::pathNotFound(const ConfigKey *keys)
+	{
+		std::vector<std::string> params;
+
+		for (const ConfigKey *key = keys; !key->isNull(); key++) {
+
+			std::vector<std::string> components;
+			boost::split(components, std::string(key->data(), key->size()), boost::is_any_of("."));
+
+			params.insert(params.end(), components.begin(), components.end());
+		}
+
+		return pathNotFound(&params);
+	}
+
+	std::vector<std::string> ConfigSnapshot::sections(const ConfigKey *keys)
+	{
+		// Get relevant nodes
+		std::vector<ConfigNode *> nodes;
+		collectSections(keys, &nodes);
+
+		// If there are no nodes, exit
+		if (nodes.size() == 0) {
+			throw ConfigException(pathNotFound(keys));
+		}
+
+		// Copy only the sections
+		std::vector<std::string> result;
+		for (size_t i = 0; i < nodes.size(); i++) {
+			if (nodes[i]->getType() == ConfigNode::Node) {
+				result.push_back(this->tree->getName(nodes[i]));
+			}
+		}
+
+		return result;
+	}
+
+	std::vector<std::string> ConfigSnapshot::names(const ConfigKey *keys)
+	{
+		// Get relevant nodes
+		std::vector<ConfigNode *> nodes;
+		collect(keys, &nodes);
+
+		// If there are no nodes, exit
+		if (nodes.size() == 0) {
+			throw ConfigException(pathNotFound(keys));
+		}
+
+		// Copy only the keys
+		std::vector<std::string> result;
+		for (size_t i = 0; i < nodes.size(); i++) {
+			if (nodes[i]->getType() == ConfigNode::Leaf) {
+				result.push_back(this->tree->getName(nodes[i]));
+			}
+		}
+
+		return result;
+	}
+
+	std::vector<std::string> ConfigSnapshot::trySections(const std::string &d, const ConfigKey *keys)
+	{
+		// Get relevant nodes
+		std::vector<ConfigNode *> nodes;
+		collect(keys, &nodes);
+
+		// If there are no nodes, return the default one
+		if (nodes.size() == 0) {
+			std::vector<std::string> result(1);
+			result.push_back(d);
+			return result;
+		}
+
+		// Copy only the sections
+		std::vector<std::string> result;
+		for (size_t i = 0; i < nodes.size(); i++) {
+			if (nodes[i]->getType() == ConfigNode::Node) {
+				result.push_back(this->tree->getName(nodes[i]));
+			}
+		}
+
+		return result;
+	}
+
+	std::vector<std::string> ConfigSnapshot::tryNames(const std::string &d, const ConfigKey *keys)
+	{
+		// Get relevant nodes
+		std::vector<ConfigNode *> nodes;
+		collect(keys, &nodes);
+
+		// If there are no nodes, return the default one
+		if (nodes.size() == 0) {
+			std::vector<std::string> result(1);
+			result.push_back(d);
+			return result;
+		}
+
+		// Copy only the sections
+		std::vector<std::string> result;
+		for (size_t i = 0; i < nodes.size(); i++) {
+			if (nodes[i]->getType() == ConfigNode::Leaf) {
+				result.push_back(this->tree->getName(nodes[i]));
+			}
+		}
+
+		return result;
+	}
+}
@@ -0,0 +1,464 @@
+/*
+ * $Id$
+ *
+ * Copyright 2008 Carpe Noctem, Distributed Systems Group,
+ * University of Kassel. All right reserved.
+ *
+ * The code is licensed under the Carpe Noctem Userfriendly BSD-Based
+ * License (CNUBBL). Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided that the
+ * conditions of the CNUBBL are met.
+ *
+ * You should have received a copy of the CNUBBL along with this
+ * software. The license is also available on our website:
+ * http://carpenoctem.das-lab.net/license.txt
+ */
+
+#ifndef CASTOR_CONFIGSNAPSHOT_H
+#define CASTOR_CONFIGSNAPSHOT_H 1
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <type_traits>
+#include <cstdarg>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "ConfigException.h"
+#include "ConfigTree.h"
+#include "ConfigConvert.h"
+#include "ConfigPath.h"
+#include "ConfigKey.h"
+#include "ConfigBatch.h"
+#include "ConfigQuery.h"
+#include "ConfigPatch.h"
+#include "ConfigCache.h"
+#include "ConfigSink.h"
+
+namespace castor {
+
+	/**
+	 * Read access to one version of a configuration. A snapshot keeps its
+	 * tree alive, so it stays valid and unchanged no matter how often the
+	 * Configuration it was taken from is reloaded in the meantime. Copying a
+	 * snapshot is cheap.
+	 *
+	 * The tree owns the bytes its names and values refer to: the buffers
+	 * are private copies of the files, never views of the files themselves,
+	 * so neither a rewrite nor a removal of a file affects a snapshot.
+	 *
+	 * Lookups fill caches (typed values, ConfigPath handles) but never change
+	 * the tree, so a snapshot may be read from several threads as long as
+	 * every thread uses its own ConfigPath handles.
+	 */
+	class ConfigSnapshot {
+
+		protected:
+
+			ConfigTreePtr tree;
+			bool threadCache;
+
+			void serialize_internal(ConfigWriter *writer, const ConfigNode *node);
+
+			template<typename Target>
+				Target convert(const ConfigNode *node) {
+					return ConfigConvert<Target>::get(node);
+				}
+
+			/**
+			 * Appends the nodes the given keys refer to to result. The list
+			 * of keys ends with a null key.
+			 */
+			void collect(const ConfigKey *keys, std::vector<ConfigNode *> *result);
+			void collectSections(const ConfigKey *keys, std::vector<ConfigNode *> *result);
+
+			std::vector<std::string> sections(const ConfigKey *keys);
+			std::vector<std::string> names(const ConfigKey *keys);
+			std::vector<std::string> trySections(const std::string &d, const ConfigKey *keys);
+			std::vector<std::string> tryNames(const std::string &d, const ConfigKey *keys);
+
+			template<typename T>
+				T lookup(const ConfigKey *keys) {
+
+					std::vector<ConfigNode *> nodes;
+					collect(keys, &nodes);
+
+					if (nodes.size() == 0) {
+						throw ConfigException(pathNotFound(keys));
+					}
+
+					return convert<T>(nodes[0]);
+				}
+
+			template<typename T>
+				std::vector<T> lookupAll(const ConfigKey *keys)
+				{
+					// Get relevant nodes
+					std::vector<ConfigNode *> nodes;
+					collect(keys, &nodes);
+
+					// If there are no nodes, exit
+					if (nodes.size() == 0) {
+						throw ConfigException(pathNotFound(keys));
+					}
+
+					// Copy only all values over
+					std::vector<T> result;
+					for (size_t i = 0; i < nodes.size(); i++) {
+						result.push_back(convert<T>(nodes[i]));
+					}
+
+					return result;
+
+				}
+
+			template<typename T>
+				T tryLookup(T d, const ConfigKey *keys) {
+
+					std::vector<ConfigNode *> nodes;
+
+					collect(keys, &nodes);
+
+					if (nodes.size() == 0) {
+						return d;
+					}
+
+					return convert<T>(nodes[0]);
+				}
+
+			template<typename T>
+				boost::shared_ptr<std::vector<T> > tryLookupAll(T d, const ConfigKey *keys) {
+
+					std::vector<ConfigNode *> nodes;
+
+					collect(keys, &nodes);
+
+					boost::shared_ptr<std::vector<T> > result(new std::vector<T>());
+
+					if (nodes.size() == 0) {
+
+						result->push_back(d);
+
+						return result;
+					}
+
+					for (size_t i = 0; i < nodes.size(); i++) {
+						result->push_back(convert<T>(nodes[i]));
+					}
+
+					return result;
+				}
+
+			std::string pathNotFound(const std::vector<std::string> *params);
+			std::string pathNotFound(const ConfigKey *keys);
+
+		public:
+
+			ConfigSnapshot();
+			ConfigSnapshot(ConfigTreePtr tree, bool threadCache = false);
+
+			bool isValid() const {
+				return (this->tree.get() != NULL);
+			}
+
+			ConfigTreePtr getTree() const {
+				return this->tree;
+			}
+
+			/**
+			 * Returns whether path lookups go through the per-thread
+			 * ConfigCache.
+			 */
+			bool getThreadCache() const {
+				return this->threadCache;
+			}
+
+			ConfigNode *getRoot() const {
+				return this->tree->getRoot();
+			}
+
+			/**
+			 * Returns the name of the given node (empty for comments).
+			 */
+			const ConfigString &getName(const ConfigNode *node) const {
+				return this->tree->getName(node);
+			}
+
+			const ConfigSymbols &getSymbols() const {
+				return this->tree->getSymbols();
+			}
+
+			const ConfigArena &getArena() const {
+				return this->tree->getArena();
+			}
+
+			const ConfigIndex &getIndex() const {
+				return this->tree->getIndex();
+			}
+
+			const std::string &getFilename() const {
+				return this->tree->getFilename();
+			}
+
+			/**
+			 * Returns a value that changes whenever nodes are added or
+			 * removed. Generations are unique across all configurations.
+			 */
+			unsigned long getGeneration() const {
+				return this->tree->getGeneration();
+			}
+
+			/**
+			 * Returns the content hash of the whole tree, see
+			 * ConfigTree::getHash().
+			 */
+			unsigned long long getHash() const {
+				return this->tree->getHash(this->tree->getRoot());
+			}
+
+			/**
+			 * Returns the changes that turn a into b, see ConfigPatch.
+			 */
+			static ConfigPatch diff(const ConfigSnapshot &a, const ConfigSnapshot &b) {
+				return ConfigPatch::diff(*a.tree, *b.tree);
+			}
+
+			/**
+			 * Returns the nodes the given path refers to. The result is cached
+			 * in the handle and stays valid until the generation changes.
+			 */
+			const std::vector<ConfigNode *> &collect(const ConfigPath &path);
+
+			std::string serialize();
+
+			/**
+			 * Streams the serialized tree to the given sink.
+			 */
+			void serialize(ConfigSink &sink);
+
+			/**
+			 * Returns the value of the first node at the given path. Every
+			 * argument is a key or a dot-separated string, e.g.
+			 * get<int>("Drive", "Motor.maxSpeed"). Literals are split and
+			 * hashed at compile time, see ConfigKey. A single C string is
+			 * taken by the former API below, a single path is passed as a
+			 * ConfigKey instead: get<int>(ConfigKey("Drive.Motor.maxSpeed")).
+			 * @throws ConfigException if there is no such node
+			 */
+			template<typename T, typename... Keys>
+				typename std::enable_if<ConfigKeyArguments<Keys...>::valid, T>::type get(const Keys &... path) {
+
+					const ConfigKey keys[] = {ConfigKeyArgument<Keys>::get(path)..., ConfigKey()};
+
+					return lookup<T>(keys);
+				}
+
+			/**
+			 * The former API, the arguments end with NULL:
+			 * get<int>("Drive", "Motor.maxSpeed", NULL). The path is split at
+			 * run time. GCC warns about calls that miss the NULL.
+			 */
+			template<typename T>
+				CASTOR_SENTINEL T get(const char *path, ...) {
+
+					CONSUME_KEYS(path);
+
+					return lookup<T>(&keys[0]);
+				}
+
+			template<typename T, typename... Keys>
+				typename std::enable_if<ConfigKeyArguments<Keys...>::valid, std::vector<T> >::type getAll(const Keys &... path) {
+
+					const ConfigKey keys[] = {ConfigKeyArgument<Keys>::get(path)..., ConfigKey()};
+
+					return lookupAll<T>(keys);
+				}
+
+			template<typename T>
+				CASTOR_SENTINEL std::vector<T> getAll(const char *path, ...) {
+
+					CONSUME_KEYS(path);
+
+					return lookupAll<T>(&keys[0]);
+				}
+
+			template<typename T, typename... Keys>
+				typename std::enable_if<ConfigKeyArguments<Keys...>::valid, T>::type tryGet(T d, const Keys &... path) {
+
+					const ConfigKey keys[] = {ConfigKeyArgument<Keys>::get(path)..., ConfigKey()};
+
+					return tryLookup<T>(d, keys);
+				}
+
+			template<typename T>
+				CASTOR_SENTINEL T tryGet(T d, const char *path, ...) {
+
+					CONSUME_KEYS(path);
+
+					return tryLookup<T>(d, &keys[0]);
+				}
+
+			template<typename T, typename... Keys>
+				typename std::enable_if<ConfigKeyArguments<Keys...>::valid, boost::shared_ptr<std::vector<T> > >::type tryGetAll(T d, const Keys &... path) {
+
+					const ConfigKey keys[] = {ConfigKeyArgument<Keys>::get(path)..., ConfigKey()};
+
+					return tryLookupAll<T>(d, keys);
+				}
+
+			template<typename T>
+				CASTOR_SENTINEL boost::shared_ptr<std::vector<T> > tryGetAll(T d, const char *path, ...) {
+
+					CONSUME_KEYS(path);
+
+					return tryLookupAll<T>(d, &keys[0]);
+				}
+
+			template<typename T>
+				T get(const ConfigPath &path) {
+
+					const std::vector<ConfigNode *> &nodes = collect(path);
+
+					if (nodes.size() == 0) {
+						throw ConfigException(pathNotFound(&path.getComponents()));
+					}
+
+					return convert<T>(nodes[0]);
+				}
+
+			template<typename T>
+				std::vector<T> getAll(const ConfigPath &path) {
+
+					const std::vector<ConfigNode *> &nodes = collect(path);
+
+					if (nodes.size() == 0) {
+						throw ConfigException(pathNotFound(&path.getComponents()));
+					}
+
+					std::vector<T> result;
+					for (size_t i = 0; i < nodes.size(); i++) {
+						result.push_back(convert<T>(nodes[i]));
+					}
+
+					return result;
+				}
+
+			template<typename T>
+				T tryGet(T d, const ConfigPath &path) {
+
+					const std::vector<ConfigNode *> &nodes = collect(path);
+
+					if (nodes.size() == 0) {
+						return d;
+					}
+
+					return convert<T>(nodes[0]);
+				}
+
+			template<typename... Keys>
+				typename std::enable_if<ConfigKeyArguments<Keys...>::valid, std::vector<std::string> >::type getSections(const Keys &... path) {
+
+					const ConfigKey keys[] = {ConfigKeyArgument<Keys>::get(path)..., ConfigKey()};
+
+					return sections(keys);
+				}
+
+			/**
+			 * Returns all nodes that match the given pattern, e.g.
+			 * "Sensors.*.Calibration.offset", in document order. The nodes
+			 * stay valid as long as the tree of this snapshot.
+			 * @see ConfigQuery
+			 */
+			std::vector<ConfigNode *> query(const ConfigQuery &query) {
+
+				std::vector<ConfigNode *> result;
+				query.collect(this->tree.get(), &result);
+
+				return result;
+			}
+
+			/**
+			 * Returns the values of all nodes that match the given pattern.
+			 */
+			template<typename T>
+				std::vector<T> queryAll(const ConfigQuery &query) {
+
+					std::vector<ConfigNode *> nodes;
+					query.collect(this->tree.get(), &nodes);
+
+					std::vector<T> result;
+					result.reserve(nodes.size());
+
+					for (size_t i = 0; i < nodes.size(); i++) {
+						result.push_back(convert<T>(nodes[i]));
+					}
+
+					return result;
+				}
+
+			/**
+			 * Reads all values of the given batch in one walk over the tree.
+			 * @return true if there were no errors, see ConfigBatch
+			 */
+			bool read(ConfigBatch &batch) {
+				return batch.read(this->tree.get());
+			}
+
+			CASTOR_SENTINEL std::vector<std::string> getSections(const char *path, ...) {
+
+				CONSUME_KEYS(path);
+
+				return sections(&keys[0]);
+			}
+
+			template<typename... Keys>
+				typename std::enable_if<ConfigKeyArguments<Keys...>::valid, std::vector<std::string> >::type getNames(const Keys &... path) {
+
+					const ConfigKey keys[] = {ConfigKeyArgument<Keys>::get(path)..., ConfigKey()};
+
+					return names(keys);
+				}
+
+			CASTOR_SENTINEL std::vector<std::string> getNames(const char *path, ...) {
+
+				CONSUME_KEYS(path);
+
+				return names(&keys[0]);
+			}
+
+			template<typename... Keys>
+				typename std::enable_if<ConfigKeyArguments<Keys...>::valid, std::vector<std::string> >::type tryGetSections(std::string d, const Keys &... path) {
+
+					const ConfigKey keys[] = {ConfigKeyArgument<Keys>::get(path)..., ConfigKey()};
+
+					return trySections(d, keys);
+				}
+
+			CASTOR_SENTINEL std::vector<std::string> tryGetSections(std::string d, const char *path, ...) {
+
+				CONSUME_KEYS(path);
+
+				return trySections(d, &keys[0]);
+			}
+
+			template<typename... Keys>
+				typename std::enable_if<ConfigKeyArguments<Keys...>::valid, std::vector<std::string> >::type tryGetNames(std::string d, const Keys &... path) {
+
+					const ConfigKey keys[] = {ConfigKeyArgument<Keys>::get(path)..., ConfigKey()};
+
+					return tryNames(d, keys);
+				}
+
+			CASTOR_SENTINEL std::vector<std::string> tryGetNames(std::string d, const char *path, ...) {
+
+				CONSUME_KEYS(path);
+
+				return tryNames(d, &keys[0]);
+			}
+	};
+}
+
+#endif /* CASTOR_CONFIGSNAPSHOT_H */
+
@@ -0,0 +1,105 @@
+/*
+ * $Id$
+ *
+ * Copyright 2008 Carpe Noctem, Distributed Systems Group,
+ * University of Kassel. All right reserved.
+ *
+ * The code is licensed under the Carpe Noctem Userfriendly BSD-Based
+ * License (CNUBBL). Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided that the
+ * conditions of the CNUBBL are met.
+ *
+ * You should have received a copy of the CNUBBL along with this
+ * software. The license is also available on our website:
+ * http://carpenoctem.das-lab.net/license.txt
+ */
+
+#ifndef CASTOR_CONFIGSTRING_H
+#define CASTOR_CONFIGSTRING_H 1
+
+#include <string>
+#include <cstring>
+#include <ostream>
+
+namespace castor {
+
+	/**
+	 * A string view into either a configuration buffer (see ConfigBuffer) or
+	 * the arena of the configuration it belongs to (see ConfigArena). It does
+	 * not own its characters and is only valid as long as their storage.
+	 */
+	class ConfigString {
+
+		protected:
+
+			const char *ptr;
+			size_t len;
+
+		public:
+
+			ConfigString() :
+				ptr(""), len(0)
+			{
+			}
+
+			ConfigString(const char *data, size_t size) :
+				ptr(data), len(size)
+			{
+			}
+
+			/**
+			 * Views a NUL-terminated string, e.g. a literal.
+			 */
+			ConfigString(const char *value) :
+				ptr(value), len(strlen(value))
+			{
+			}
+
+			const char *data() const {
+				return this->ptr;
+			}
+
+			size_t size() const {
+				return this->len;
+			}
+
+			bool empty() const {
+				return (this->len == 0);
+			}
+
+			std::string str() const {
+				return std::string(this->ptr, this->len);
+			}
+
+			operator std::string() const {
+				return str();
+			}
+
+			bool equals(const char *data, size_t size) const {
+				return ((this->len == size) && (memcmp(this->ptr, data, size) == 0));
+			}
+
+			bool operator==(const ConfigString &other) const {
+				return equals(other.data(), other.size());
+			}
+
+			bool operator==(const std::string &other) const {
+				return equals(other.data(), other.size());
+			}
+
+			bool operator!=(const ConfigString &other) const {
+				return !(*this == other);
+			}
+
+			bool operator!=(const std::string &other) const {
+				return !(*this == other);
+			}
+	};
+
+	inline std::ostream &operator<<(std::ostream &os, const ConfigString &s) {
+		return os.write(s.data(), s.size());
+	}
+}
+
+#endif /* CASTOR_CONFIGSTRING_H */
+
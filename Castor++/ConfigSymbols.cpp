@@ -0,0 +1,130 @@
+/*
+ * $Id$
+ *
+ * Copyright 2008 Carpe Noctem, Distributed Systems Group,
+ * University of Kassel. All right reserved.
+ *
+ * The code is licensed under the Carpe Noctem Userfriendly BSD-Based
+ * License (CNUBBL). Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided that the
+ * conditions of the CNUBBL are met.
+ *
+ * You should have received a copy of the CNUBBL along with this
+ * software. The license is also available on our website:
+ * http://carpenoctem.das-lab.net/license.txt
+ */
+
+#include "ConfigSymbols.h"
+
+#include <algorithm>
+
+namespace castor {
+
+	const ConfigSymbol ConfigSymbols::Empty;
+	const ConfigSymbol ConfigSymbols::Unknown;
+
+	ConfigSymbols::ConfigSymbols() :
+		names(), hashes(), slots()
+	{
+		clear();
+	}
+
+	void ConfigSymbols::clear() {
+
+		this->names.clear();
+		this->hashes.clear();
+		this->slots.assign(64, Empty);
+
+		this->names.push_back(ConfigString());
+		this->hashes.push_back(hash("", 0));
+	}
+
+	void ConfigSymbols::rehash(size_t size) {
+
+		this->slots.assign(size, Empty);
+
+		size_t mask = size - 1;
+
+		for (ConfigSymbol symbol = 1; symbol < this->names.size(); symbol++) {
+
+			size_t slot = this->hashes[symbol] & mask;
+
+			while (this->slots[slot] != Empty) {
+				slot = (slot + 1) & mask;
+			}
+
+			this->slots[slot] = symbol;
+		}
+	}
+
+	ConfigSymbol ConfigSymbols::find(const char *data, size_t size, unsigned int hash) const {
+
+		if (size == 0) {
+			return Empty;
+		}
+
+		size_t mask = this->slots.size() - 1;
+		size_t slot = hash & mask;
+
+		// Open addressing with linear probing, the table is never more than
+		// half full, so there always is an empty slot to stop at
+		for (ConfigSymbol symbol; (symbol = this->slots[slot]) != Empty; slot = (slot + 1) & mask) {
+
+			if ((this->hashes[symbol] == hash) && (this->names[symbol].equals(data, size))) {
+				return symbol;
+			}
+		}
+
+		return Unknown;
+	}
+
+	void ConfigSymbols::reserve(size_t count) {
+
+		size_t size = this->slots.size();
+
+		while (size < 2 * count) {
+			size *= 2;
+		}
+
+		// Grow geometrically, reserve() may be called for every merged tree
+		if (count > this->names.capacity()) {
+			this->names.reserve(std::max(count, 2 * this->names.capacity()));
+			this->hashes.reserve(std::max(count, 2 * this->hashes.capacity()));
+		}
+
+		if (size != this->slots.size()) {
+			rehash(size);
+		}
+	}
+
+	ConfigSymbol ConfigSymbols::intern(const ConfigString &name, unsigned int h) {
+
+		ConfigSymbol symbol = find(name.data(), name.size(), h);
+
+		if (symbol != Unknown) {
+			return symbol;
+		}
+
+		symbol = this->names.size();
+
+		this->names.push_back(name);
+		this->hashes.push_back(h);
+
+		if (2 * this->names.size() > this->slots.size()) {
+			rehash(2 * this->slots.size());
+		} else {
+
+			size_t mask = this->slots.size() - 1;
+			size_t slot = h & mask;
+
+			while (this->slots[slot] != Empty) {
+				slot = (slot + 1) & mask;
+			}
+
+			this->slots[slot] = symbol;
+		}
+
+		return symbol;
+	}
+}
+
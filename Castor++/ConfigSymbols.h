@@ -0,0 +1,115 @@
+/*
+ * $Id$
+ *
+ * Copyright 2008 Carpe Noctem, Distributed Systems Group,
+ * University of Kassel. All right reserved.
+ *
+ * The code is licensed under the Carpe Noctem Userfriendly BSD-Based
+ * License (CNUBBL). Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided that the
+ * conditions of the CNUBBL are met.
+ *
+ * You should have received a copy of the CNUBBL along with this
+ * software. The license is also available on our website:
+ * http://carpenoctem.das-lab.net/license.txt
+ */
+
+#ifndef CASTOR_CONFIGSYMBOLS_H
+#define CASTOR_CONFIGSYMBOLS_H 1
+
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#include "ConfigString.h"
+
+namespace castor {
+
+	typedef unsigned int ConfigSymbol;
+
+	/**
+	 * Interned node names of a configuration. Every distinct name is stored
+	 * once and identified by a small integer, so comparing names means
+	 * comparing symbols. Symbol 0 is always the empty name.
+	 *
+	 * The table keeps views only, the interned names have to live as long as
+	 * the table (usually they point into the buffers or the arena of the
+	 * owning Configuration).
+	 */
+	class ConfigSymbols : private boost::noncopyable {
+
+		protected:
+
+			std::vector<ConfigString> names;
+			std::vector<unsigned int> hashes;
+			std::vector<ConfigSymbol> slots;
+
+			void rehash(size_t size);
+
+		public:
+
+			static const ConfigSymbol Empty = 0;
+			static const ConfigSymbol Unknown = ~0u;
+
+			ConfigSymbols();
+
+			/**
+			 * FNV-1a hash of the given characters. Usable in constant
+			 * expressions, see ConfigKey.
+			 */
+			static constexpr unsigned int hash(const char *data, size_t size) {
+
+				unsigned int h = 2166136261u;
+
+				for (size_t i = 0; i < size; i++) {
+					h = (h ^ static_cast<unsigned char>(data[i])) * 16777619u;
+				}
+
+				return h;
+			}
+
+			/**
+			 * Returns the symbol of the given name, adding it if necessary.
+			 */
+			ConfigSymbol intern(const ConfigString &name) {
+				return intern(name, hash(name.data(), name.size()));
+			}
+
+			/**
+			 * Same as above, with the hash of the name already known.
+			 */
+			ConfigSymbol intern(const ConfigString &name, unsigned int hash);
+
+			/**
+			 * Makes room for the given number of symbols without rehashing.
+			 */
+			void reserve(size_t count);
+
+			/**
+			 * Returns the symbol of the given name or Unknown if the name has
+			 * never been interned.
+			 */
+			ConfigSymbol find(const char *data, size_t size) const {
+				return find(data, size, hash(data, size));
+			}
+
+			ConfigSymbol find(const char *data, size_t size, unsigned int hash) const;
+
+			const ConfigString &getName(ConfigSymbol symbol) const {
+				return this->names[symbol];
+			}
+
+			unsigned int getHash(ConfigSymbol symbol) const {
+				return this->hashes[symbol];
+			}
+
+			size_t size() const {
+				return this->names.size();
+			}
+
+			void clear();
+	};
+}
+
+#endif /* CASTOR_CONFIGSYMBOLS_H */
+
@@ -0,0 +1,510 @@
+/*
+ * $Id$
+ *
+ * Copyright 2008 Carpe Noctem, Distributed Systems Group,
+ * University of Kassel. All right reserved.
+ *
+ * The code is licensed under the Carpe Noctem Userfriendly BSD-Based
+ * License (CNUBBL). Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided that the
+ * conditions of the CNUBBL are met.
+ *
+ * You should have received a copy of the CNUBBL along with this
+ * software. The license is also available on our website:
+ * http://carpenoctem.das-lab.net/license.txt
+ */
+
+#include "ConfigTree.h"
+
+#include <new>
+#include <cstring>
+
+#include <boost/atomic.hpp>
+
+namespace castor {
+
+	ConfigTree::ConfigTree() :
+		arena(), symbols(), index(), root(NULL), buffers(), source(), filename(), generation(0),
+		changes(), changed(), version(0), stored(0)
+	{
+		this->root = createNode(NULL, ConfigNode::Node, this->symbols.intern("root"), ConfigString());
+
+		touch();
+	}
+
+	void ConfigTree::touch() {
+
+		// Shared by all trees, so a handle that moves between trees never
+		// mistakes one for another
+		static boost::atomic<unsigned long> generations(0);
+
+		this->generation = ++generations;
+	}
+
+	ConfigNode *ConfigTree::createNode(ConfigNode *parent, ConfigNode::Type type, ConfigSymbol symbol, const ConfigString &value) {
+
+		ConfigNode *node = new (this->arena.allocate(sizeof(ConfigNode))) ConfigNode(type, symbol, value);
+
+		if (parent != NULL) {
+			parent->append(node);
+		}
+
+		return node;
+	}
+
+	bool ConfigTree::inBuffers(const char *p) const {
+
+		for (size_t i = 0; i < this->buffers.size(); i++) {
+			if (this->buffers[i]->contains(p)) return true;
+		}
+
+		return false;
+	}
+
+	ConfigTreePtr ConfigTree::clone() const {
+
+		ConfigTreePtr result(new ConfigTree());
+
+		result->buffers = this->buffers;
+		result->source = this->source;
+		result->filename = this->filename;
+		result->index.setThreshold(this->index.getThreshold());
+		result->changes = this->changes;
+		result->version = this->version;
+		result->stored = this->stored;
+
+		// Interning in the same order yields the same symbols
+		for (ConfigSymbol symbol = 1; symbol < this->symbols.size(); symbol++) {
+
+			const ConfigString &name = this->symbols.getName(symbol);
+
+			if (inBuffers(name.data())) {
+				result->symbols.intern(name);
+			} else {
+				result->symbols.intern(ConfigString(result->arena.copy(name.data(), name.size()), name.size()));
+			}
+		}
+
+		for (const ConfigNode *child = this->root->getFirstChild(); child != NULL; child = child->getNext()) {
+			result->clone(*this, child, result->root);
+		}
+
+		std::map<const ConfigNode *, size_t>::const_iterator it = this->changed.find(this->root);
+
+		if (it != this->changed.end()) {
+			result->changes[it->second].node = result->root;
+			result->changed[result->root] = it->second;
+		}
+
+		// Removed nodes have not been cloned, their parents carry the change
+		if (result->changed.size() < result->changes.size()) {
+
+			std::vector<bool> cloned(result->changes.size(), false);
+			std::vector<Change> changes;
+
+			for (it = result->changed.begin(); it != result->changed.end(); ++it) {
+				cloned[it->second] = true;
+			}
+
+			result->changed.clear();
+
+			for (size_t i = 0; i < cloned.size(); i++) {
+				if (cloned[i]) {
+					result->changed[result->changes[i].node] = changes.size();
+					changes.push_back(result->changes[i]);
+				}
+			}
+
+			result->changes.swap(changes);
+		}
+
+		result->index.prepare(result->root);
+
+		return result;
+	}
+
+	ConfigNode *ConfigTree::clone(const ConfigTree &other, const ConfigNode *node, ConfigNode *parent) {
+
+		ConfigString value = node->getValue();
+
+		if ((!value.empty()) && (!other.inBuffers(value.data()))) {
+			value = ConfigString(this->arena.copy(value.data(), value.size()), value.size());
+		}
+
+		ConfigNode *result = createNode(parent, node->getType(), node->getSymbol(), value);
+
+		result->setHash(node->getHash());
+
+		// Changes move over to the corresponding nodes
+		if (!other.changed.empty()) {
+
+			std::map<const ConfigNode *, size_t>::const_iterator it = other.changed.find(node);
+
+			if (it != other.changed.end()) {
+
+				Change &change = this->changes[it->second];
+
+				change.node = result;
+
+				// Only originals in the shared buffers stay valid
+				if (!other.inBuffers(change.original.data())) {
+					change.original = ConfigString();
+				}
+
+				this->changed[result] = it->second;
+			}
+		}
+
+		for (const ConfigNode *child = node->getFirstChild(); child != NULL; child = child->getNext()) {
+			clone(other, child, result);
+		}
+
+		return result;
+	}
+
+	ConfigNode *ConfigTree::graft(const ConfigTree &other, const ConfigNode *node, ConfigNode *parent, const char *from, size_t size, const char *to) {
+
+		ConfigSymbol symbol = ConfigSymbols::Empty;
+
+		if (node->getType() != ConfigNode::Comment) {
+
+			const ConfigString &name = other.getName(node);
+
+			symbol = this->symbols.find(name.data(), name.size());
+
+			if (symbol == ConfigSymbols::Unknown) {
+				if ((name.data() >= from) && (name.data() < from + size)) {
+					symbol = this->symbols.intern(ConfigString(to + (name.data() - from), name.size()));
+				} else {
+					symbol = this->symbols.intern(ConfigString(this->arena.copy(name.data(), name.size()), name.size()));
+				}
+			}
+		}
+
+		ConfigString value = node->getValue();
+
+		if ((value.data() >= from) && (value.data() < from + size)) {
+			value = ConfigString(to + (value.data() - from), value.size());
+		} else if (!value.empty()) {
+			value = ConfigString(this->arena.copy(value.data(), value.size()), value.size());
+		}
+
+		ConfigNode *result = createNode(parent, node->getType(), symbol, value);
+
+		result->setHash(node->getHash());
+
+		for (const ConfigNode *child = node->getFirstChild(); child != NULL; child = child->getNext()) {
+			graft(other, child, result, from, size, to);
+		}
+
+		return result;
+	}
+
+	static void translate(ConfigNode *node, const std::vector<ConfigSymbol> &symbols) {
+
+		for (ConfigNode *child = node->getFirstChild(); child != NULL; child = child->getNext()) {
+			child->setSymbol(symbols[child->getSymbol()]);
+			translate(child, symbols);
+		}
+	}
+
+	void ConfigTree::merge(ConfigTree &other) {
+
+		std::vector<ConfigSymbol> symbols;
+
+		importSymbols(other, &symbols);
+		other.renumber(symbols);
+		adopt(other);
+	}
+
+	void ConfigTree::importSymbols(const ConfigTree &other, std::vector<ConfigSymbol> *symbols) {
+
+		symbols->resize(other.symbols.size());
+
+		this->symbols.reserve(this->symbols.size() + other.symbols.size());
+
+		for (ConfigSymbol symbol = 1; symbol < other.symbols.size(); symbol++) {
+			(*symbols)[symbol] = this->symbols.intern(other.symbols.getName(symbol), other.symbols.getHash(symbol));
+		}
+	}
+
+	void ConfigTree::renumber(const std::vector<ConfigSymbol> &symbols) {
+		translate(this->root, symbols);
+	}
+
+	void ConfigTree::adopt(ConfigTree &other) {
+
+		this->root->adopt(other.root);
+		this->arena.splice(other.arena);
+
+		other.symbols.clear();
+		other.index.reset();
+	}
+
+	ConfigNode *ConfigTree::locate(const ConfigTree &other, const ConfigNode *node) const {
+
+		// Record the position of every ancestor among its siblings and
+		// replay them from the root of this tree
+		std::vector<unsigned int> positions;
+
+		for (; node != other.root; node = node->getParent()) {
+
+			unsigned int position = 0;
+
+			for (const ConfigNode *sibling = node->getParent()->getFirstChild(); sibling != node; sibling = sibling->getNext()) {
+				position++;
+			}
+
+			positions.push_back(position);
+		}
+
+		ConfigNode *result = this->root;
+
+		for (size_t i = positions.size(); i > 0; i--) {
+
+			result = result->getFirstChild();
+
+			for (unsigned int j = 0; j < positions[i - 1]; j++) {
+				result = result->getNext();
+			}
+		}
+
+		return result;
+	}
+
+	ConfigTree::Change &ConfigTree::change(ConfigNode *node) {
+
+		this->version++;
+
+		// The hashes of all subtrees that contain the node are outdated
+		for (const ConfigNode *parent = node; parent != NULL; parent = parent->getParent()) {
+			parent->setHash(0);
+		}
+
+		std::map<const ConfigNode *, size_t>::iterator it = this->changed.find(node);
+
+		if (it != this->changed.end()) {
+			this->changes[it->second].version = this->version;
+			return this->changes[it->second];
+		}
+
+		Change change = { node, node->getValue(), false, this->version };
+
+		this->changed[node] = this->changes.size();
+		this->changes.push_back(change);
+
+		return this->changes.back();
+	}
+
+	void ConfigTree::setValue(ConfigNode *node, const std::string &value) {
+		change(node);
+		node->setValue(copy(value));
+	}
+
+	ConfigNode *ConfigTree::addNode(ConfigNode *parent, ConfigNode::Type type, const std::string &name, const std::string &value) {
+
+		ConfigSymbol symbol = this->symbols.find(name.data(), name.size());
+
+		if (symbol == ConfigSymbols::Unknown) {
+			symbol = this->symbols.intern(copy(name));
+		}
+
+		ConfigNode *node = createNode(parent, type, symbol, copy(value));
+
+		this->index.add(node);
+		change(parent).children = true;
+
+		return node;
+	}
+
+	ConfigNode *ConfigTree::insertNode(ConfigNode *parent, ConfigNode *previous, ConfigNode::Type type, const std::string &name,
+		const std::string &value)
+	{
+		ConfigSymbol symbol = this->symbols.find(name.data(), name.size());
+
+		if (symbol == ConfigSymbols::Unknown) {
+			symbol = this->symbols.intern(copy(name));
+		}
+
+		ConfigNode *node = createNode(NULL, type, symbol, copy(value));
+
+		change(parent).children = true;
+		parent->insert(node, previous);
+
+		this->index.add(node);
+
+		return node;
+	}
+
+	void ConfigTree::removeNode(ConfigNode *node) {
+
+		ConfigNode *parent = node->getParent();
+
+		change(parent).children = true;
+		parent->remove(node);
+
+		this->index.remove(node);
+	}
+
+	std::string ConfigTree::getPath(const ConfigNode *node) const {
+
+		std::vector<const ConfigNode *> nodes;
+
+		for (; (node != NULL) && (node != this->root); node = node->getParent()) {
+			nodes.push_back(node);
+		}
+
+		std::string result;
+
+		for (size_t i = nodes.size(); i > 0; i--) {
+
+			const ConfigString &name = getName(nodes[i - 1]);
+
+			if (i < nodes.size()) {
+				result += '.';
+			}
+
+			result.append(name.data(), name.size());
+		}
+
+		return result;
+	}
+
+	bool ConfigTree::resolve(const std::vector<std::string> &params, std::vector<ConfigSymbol> *path) const {
+
+		path->resize(params.size());
+
+		for (size_t i = 0; i < params.size(); i++) {
+
+			(*path)[i] = this->symbols.find(params[i].data(), params[i].size());
+
+			// A name that has never been interned cannot be part of the tree
+			if ((*path)[i] == ConfigSymbols::Unknown) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	bool ConfigTree::resolve(const ConfigKey *keys, std::vector<ConfigSymbol> *path) const {
+
+		path->clear();
+
+		for (const ConfigKey *key = keys; !key->isNull(); key++) {
+
+			for (size_t i = 0; i < key->getCount(); i++) {
+
+				const ConfigKey::Component &component = key->getComponent(i);
+				ConfigSymbol symbol = this->symbols.find(key->data() + component.offset, component.size, component.hash);
+
+				if (symbol == ConfigSymbols::Unknown) {
+					return false;
+				}
+
+				path->push_back(symbol);
+			}
+
+			// Components beyond ConfigKey::MaxComponents
+			if (key->getRest() < key->size()) {
+
+				const char *begin = key->data() + key->getRest();
+				const char *end = key->data() + key->size();
+
+				for (;;) {
+
+					const char *dot = static_cast<const char *>(memchr(begin, '.', end - begin));
+					const char *stop = (dot == NULL ? end : dot);
+					ConfigSymbol symbol = this->symbols.find(begin, stop - begin);
+
+					if (symbol == ConfigSymbols::Unknown) {
+						return false;
+					}
+
+					path->push_back(symbol);
+
+					if (dot == NULL) break;
+
+					begin = dot + 1;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	void ConfigTree::collect(ConfigNode *node, const std::vector<ConfigSymbol> &path, size_t offset, std::vector<ConfigNode *> *result) {
+
+		if (offset == path.size()) {
+			result->push_back(node);
+			return;
+		}
+
+		ConfigNode *first = node->getFirstChild();
+		ConfigNode *last = node->getLastChild();
+
+		if ((this->index.covers(node)) &&
+			(!this->index.find(node, path[offset], &first, &last)))
+		{
+			return;
+		}
+
+		for (ConfigNode *child = first; child != NULL; child = child->getNext()) {
+
+			if (child->getSymbol() == path[offset]) {
+				collect(child, path, offset + 1, result);
+			}
+
+			if (child == last) break;
+		}
+	}
+
+	static inline unsigned long long mix(unsigned long long hash, const char *data, size_t size) {
+
+		// FNV-1a, 64 bit
+		for (size_t i = 0; i < size; i++) {
+			hash = (hash ^ static_cast<unsigned char>(data[i])) * 0x100000001b3ULL;
+		}
+
+		return hash;
+	}
+
+	static inline unsigned long long mix(unsigned long long hash, unsigned long long value) {
+		return (hash ^ (value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2))) * 0x100000001b3ULL;
+	}
+
+	unsigned long long ConfigTree::getHash(const ConfigNode *node) const {
+
+		unsigned long long hash = node->getHash();
+
+		if (hash != 0) {
+			return hash;
+		}
+
+		const ConfigString &name = getName(node);
+		const ConfigString &value = node->getValue();
+
+		hash = mix(0xcbf29ce484222325ULL, node->getType());
+		hash = mix(mix(hash, name.size()), name.data(), name.size());
+
+		if (node->getType() == ConfigNode::Leaf) {
+			hash = mix(mix(hash, value.size()), value.data(), value.size());
+		}
+
+		for (const ConfigNode *child = node->getFirstChild(); child != NULL; child = child->getNext()) {
+			if (child->getType() != ConfigNode::Comment) {
+				hash = mix(hash, getHash(child));
+			}
+		}
+
+		// 0 marks a hash that has not been computed
+		if (hash == 0) {
+			hash = 1;
+		}
+
+		node->setHash(hash);
+
+		return hash;
+	}
+}
+
@@ -0,0 +1,296 @@
+/*
+ * $Id$
+ *
+ * Copyright 2008 Carpe Noctem, Distributed Systems Group,
+ * University of Kassel. All right reserved.
+ *
+ * The code is licensed under the Carpe Noctem Userfriendly BSD-Based
+ * License (CNUBBL). Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided that the
+ * conditions of the CNUBBL are met.
+ *
+ * You should have received a copy of the CNUBBL along with this
+ * software. The license is also available on our website:
+ * http://carpenoctem.das-lab.net/license.txt
+ */
+
+#ifndef CASTOR_CONFIGTREE_H
+#define CASTOR_CONFIGTREE_H 1
+
+#include <vector>
+#include <string>
+#include <map>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
+
+#include "ConfigArena.h"
+#include "ConfigBuffer.h"
+#include "ConfigString.h"
+#include "ConfigSymbols.h"
+#include "ConfigKey.h"
+#include "ConfigNode.h"
+#include "ConfigIndex.h"
+
+namespace castor {
+
+	class ConfigTree;
+
+	typedef boost::shared_ptr<ConfigTree> ConfigTreePtr;
+
+	/**
+	 * One version of a configuration: the nodes, their arena, the symbol
+	 * table, the child index and the buffers the nodes refer to. Loading a
+	 * configuration always builds a new tree, see Configuration.
+	 */
+	class ConfigTree : private boost::noncopyable {
+
+		public:
+
+			/**
+			 * A node that has been changed since the tree was parsed.
+			 */
+			struct Change {
+				ConfigNode *node;
+				ConfigString original;
+				bool children;
+				unsigned long version;
+			};
+
+		protected:
+
+			ConfigArena arena;
+			ConfigSymbols symbols;
+			ConfigIndex index;
+			ConfigNode *root;
+			std::vector<ConfigBufferPtr> buffers;
+			ConfigBufferPtr source;
+			std::string filename;
+			unsigned long generation;
+
+			std::vector<Change> changes;
+			std::map<const ConfigNode *, size_t> changed;
+			unsigned long version;
+			unsigned long stored;
+
+			Change &change(ConfigNode *node);
+
+			ConfigNode *clone(const ConfigTree &other, const ConfigNode *node, ConfigNode *parent);
+
+		public:
+
+			ConfigTree();
+
+			/**
+			 * Returns a deep copy of this tree. The copy shares the buffers,
+			 * names and values that live in the arena are copied.
+			 */
+			ConfigTreePtr clone() const;
+
+			/**
+			 * Returns the node of this tree that corresponds to the given node
+			 * of other, which has to be the tree this one was cloned from.
+			 */
+			ConfigNode *locate(const ConfigTree &other, const ConfigNode *node) const;
+
+			/**
+			 * Copies the subtree below node of other into this tree. Names and
+			 * values within the given range of source text are relocated to
+			 * the same offset in to, everything else is copied into the arena,
+			 * so the copy does not depend on the buffers of other.
+			 */
+			ConfigNode *graft(const ConfigTree &other, const ConfigNode *node, ConfigNode *parent, const char *from, size_t size, const char *to);
+
+			/**
+			 * Moves all top-level nodes of other behind those of this tree and
+			 * takes over its arena. Names are interned into this tree, so their
+			 * characters have to live in a buffer of this tree or in the arena
+			 * of other. Other must not be used afterwards.
+			 */
+			void merge(ConfigTree &other);
+
+			/**
+			 * The steps of merge(): interns the names of other into this tree
+			 * and returns the symbols they got.
+			 */
+			void importSymbols(const ConfigTree &other, std::vector<ConfigSymbol> *symbols);
+
+			/**
+			 * Replaces the symbol of every node by the one given for it. Trees
+			 * may be renumbered concurrently.
+			 */
+			void renumber(const std::vector<ConfigSymbol> &symbols);
+
+			void adopt(ConfigTree &other);
+
+			ConfigNode *createNode(ConfigNode *parent, ConfigNode::Type type, ConfigSymbol symbol, const ConfigString &value);
+
+			/**
+			 * Copies the given characters into the arena of this tree.
+			 */
+			ConfigString copy(const std::string &value) {
+				return ConfigString(this->arena.copy(value.data(), value.size()), value.size());
+			}
+
+			/**
+			 * Keeps the given buffer alive as long as this tree.
+			 */
+			void addBuffer(ConfigBufferPtr buffer) {
+				this->buffers.push_back(buffer);
+			}
+
+			/**
+			 * Returns whether the given characters live in one of the buffers
+			 * of this tree.
+			 */
+			bool inBuffers(const char *p) const;
+
+			/**
+			 * Returns the buffer this tree has been parsed from, if any. See
+			 * getChanges() for what has been changed since.
+			 */
+			const ConfigBufferPtr &getSource() const {
+				return this->source;
+			}
+
+			void setSource(ConfigBufferPtr source) {
+				this->source = source;
+			}
+
+			/**
+			 * Replaces the value of the given node by a copy of value and
+			 * records the change.
+			 */
+			void setValue(ConfigNode *node, const std::string &value);
+
+			/**
+			 * Appends a new node to parent, interns its name and registers it
+			 * in the index. The change is recorded for parent.
+			 */
+			ConfigNode *addNode(ConfigNode *parent, ConfigNode::Type type, const std::string &name, const std::string &value);
+
+			/**
+			 * Like addNode(), but places the new node after previous, or
+			 * first if previous is NULL.
+			 */
+			ConfigNode *insertNode(ConfigNode *parent, ConfigNode *previous, ConfigNode::Type type, const std::string &name,
+				const std::string &value);
+
+			/**
+			 * Unlinks the given node and its subtree. The change is recorded
+			 * for its parent and the index is updated.
+			 */
+			void removeNode(ConfigNode *node);
+
+			/**
+			 * Returns the nodes changed since the tree was parsed, each once,
+			 * with its value at that time.
+			 */
+			const std::vector<Change> &getChanges() const {
+				return this->changes;
+			}
+
+			/**
+			 * Returns whether the tree has been changed since setStored().
+			 */
+			bool isDirty() const {
+				return (this->version != this->stored);
+			}
+
+			bool isDirty(const Change &change) const {
+				return (change.version > this->stored);
+			}
+
+			/**
+			 * Marks all changes as stored.
+			 */
+			void setStored() {
+				this->stored = this->version;
+			}
+
+			/**
+			 * Returns the dot-separated path of the given node.
+			 */
+			std::string getPath(const ConfigNode *node) const;
+
+			/**
+			 * Returns a hash over the names, values and structure of the
+			 * subtree below node, comments aside. Subtrees with the same
+			 * content have the same hash, no matter which tree they are part
+			 * of. Hashes are computed on demand and kept in the nodes until a
+			 * change below them, so after a change only the path up to the
+			 * root is hashed again.
+			 */
+			unsigned long long getHash(const ConfigNode *node) const;
+
+			const std::string &getFilename() const {
+				return this->filename;
+			}
+
+			void setFilename(const std::string &filename) {
+				this->filename = filename;
+			}
+
+			/**
+			 * Assigns a new, globally unique generation.
+			 */
+			void touch();
+
+			unsigned long getGeneration() const {
+				return this->generation;
+			}
+
+			ConfigNode *getRoot() const {
+				return this->root;
+			}
+
+			const ConfigString &getName(const ConfigNode *node) const {
+				return this->symbols.getName(node->getSymbol());
+			}
+
+			ConfigSymbols &getSymbols() {
+				return this->symbols;
+			}
+
+			const ConfigSymbols &getSymbols() const {
+				return this->symbols;
+			}
+
+			ConfigIndex &getIndex() {
+				return this->index;
+			}
+
+			const ConfigIndex &getIndex() const {
+				return this->index;
+			}
+
+			ConfigArena &getArena() {
+				return this->arena;
+			}
+
+			const ConfigArena &getArena() const {
+				return this->arena;
+			}
+
+			/**
+			 * Translates the given names into symbols.
+			 * @return false if one of them is not part of the tree
+			 */
+			bool resolve(const std::vector<std::string> &params, std::vector<ConfigSymbol> *path) const;
+
+			/**
+			 * Same as above for a list of keys that ends with a null key.
+			 * Components split in advance are looked up by their hash.
+			 */
+			bool resolve(const ConfigKey *keys, std::vector<ConfigSymbol> *path) const;
+
+			/**
+			 * Appends all nodes below node that match path, starting at the
+			 * given offset, to result.
+			 */
+			void collect(ConfigNode *node, const std::vector<ConfigSymbol> &path, size_t offset, std::vector<ConfigNode *> *result);
+	};
+}
+
+#endif /* CASTOR_CONFIGTREE_H */
+
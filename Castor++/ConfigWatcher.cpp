@@ -0,0 +1,356 @@
+/*
+ * $Id$
+ *
+ * Copyright 2008 Carpe Noctem, Distributed Systems Group,
+ * University of Kassel. All right reserved.
+ *
+ * The code is licensed under the Carpe Noctem Userfriendly BSD-Based
+ * License (CNUBBL). Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided that the
+ * conditions of the CNUBBL are met.
+ *
+ * You should have received a copy of the CNUBBL along with this
+ * software. The license is also available on our website:
+ * http://carpenoctem.das-lab.net/license.txt
+ */
+
+#include "ConfigWatcher.h"
+#include "ConfigException.h"
+
+#include <sstream>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+
+#include <sys/inotify.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace castor {
+
+	// Completed writes and renames only, a file that is still being written
+	// is not worth reloading
+	static const uint32_t WatchEvents = IN_CLOSE_WRITE | IN_MOVED_TO;
+
+	ConfigWatcher::ConfigWatcher(unsigned int delay) :
+		fd(-1), wakeup(-1), delay(delay), files(), errorHandler(),
+		mutex(), idle(), reloading(NULL), reloader(), thread(), running(false)
+	{
+		this->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+		if (this->fd < 0) {
+			std::ostringstream ss;
+			ss << "Unable to initialize inotify: " << strerror(errno);
+			throw ConfigException(ss.str());
+		}
+
+		this->wakeup = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+		if (this->wakeup < 0) {
+			std::ostringstream ss;
+			ss << "Unable to create event descriptor: " << strerror(errno);
+			close(this->fd);
+			throw ConfigException(ss.str());
+		}
+	}
+
+	ConfigWatcher::~ConfigWatcher() {
+
+		stop();
+
+		close(this->wakeup);
+		close(this->fd);
+	}
+
+	long long ConfigWatcher::now() {
+
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+
+		return static_cast<long long>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+	}
+
+	void ConfigWatcher::watch(Configuration &config) {
+
+		const std::string &filename = config.getFilename();
+
+		// Watch the directory, the file itself may be replaced
+		std::string::size_type slash = filename.rfind('/');
+		std::string directory = (slash == std::string::npos ? std::string(".") : filename.substr(0, (slash == 0 ? 1 : slash)));
+		std::string name = (slash == std::string::npos ? filename : filename.substr(slash + 1));
+
+		boost::mutex::scoped_lock lock(this->mutex);
+
+		int wd = inotify_add_watch(this->fd, directory.c_str(), WatchEvents);
+
+		if (wd < 0) {
+			std::ostringstream ss;
+			ss << "Unable to watch " << directory << ": " << strerror(errno);
+			throw ConfigException(ss.str());
+		}
+
+		File file = { &config, false, 0 };
+		this->files.insert(std::make_pair(Key(wd, name), file));
+	}
+
+	void ConfigWatcher::unwatch(Configuration &config) {
+
+		boost::mutex::scoped_lock lock(this->mutex);
+
+		std::multimap<Key, File>::iterator it = this->files.begin();
+
+		while (it != this->files.end()) {
+
+			if (it->second.config != &config) {
+				++it;
+				continue;
+			}
+
+			int wd = it->first.first;
+
+			this->files.erase(it++);
+
+			// Drop the directory once no other file in it is watched
+			bool used = false;
+
+			for (std::multimap<Key, File>::iterator other = this->files.begin(); other != this->files.end(); ++other) {
+				if (other->first.first == wd) used = true;
+			}
+
+			if (!used) {
+				inotify_rm_watch(this->fd, wd);
+			}
+		}
+
+		// A reload in another thread may still use the configuration, unless
+		// it is the reload that called this
+		while ((this->reloading == &config) && (this->reloader != boost::this_thread::get_id())) {
+			this->idle.wait(lock);
+		}
+	}
+
+	void ConfigWatcher::setErrorHandler(ErrorHandler handler) {
+
+		boost::mutex::scoped_lock lock(this->mutex);
+
+		this->errorHandler = handler;
+	}
+
+	void ConfigWatcher::read() {
+
+		char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+
+		for (;;) {
+
+			ssize_t length = ::read(this->fd, buffer, sizeof(buffer));
+
+			if (length <= 0) {
+				break;
+			}
+
+			for (char *p = buffer; p < buffer + length; p += sizeof(struct inotify_event) + reinterpret_cast<struct inotify_event *>(p)->len) {
+
+				const struct inotify_event *event = reinterpret_cast<const struct inotify_event *>(p);
+
+				if (event->len == 0) {
+					continue;
+				}
+
+				// Every event pushes the reload back, so it happens once the
+				// file has been quiet for a while
+				typedef std::multimap<Key, File>::iterator Iterator;
+				std::pair<Iterator, Iterator> range = this->files.equal_range(Key(event->wd, event->name));
+
+				for (Iterator it = range.first; it != range.second; ++it) {
+					it->second.pending = true;
+					it->second.deadline = now() + this->delay;
+				}
+			}
+		}
+	}
+
+	size_t ConfigWatcher::process(bool rethrow) {
+
+		long long time = now();
+		size_t count = 0;
+
+		boost::mutex::scoped_lock lock(this->mutex);
+
+		for (;;) {
+
+			Configuration *config = NULL;
+
+			for (std::multimap<Key, File>::iterator it = this->files.begin(); it != this->files.end(); ++it) {
+
+				File &file = it->second;
+
+				if ((file.pending) && (file.deadline <= time)) {
+					file.pending = false;
+					config = file.config;
+					break;
+				}
+			}
+
+			if (config == NULL) {
+				break;
+			}
+
+			ErrorHandler handler = this->errorHandler;
+
+			// Reload without the lock, subscribers and the error handler may
+			// call watch() and unwatch()
+			this->reloading = config;
+			this->reloader = boost::this_thread::get_id();
+
+			lock.unlock();
+
+			try {
+
+				try {
+					config->reload();
+					count++;
+				} catch (const ConfigException &e) {
+
+					if (rethrow) {
+						throw;
+					}
+
+					if (handler) {
+						handler(config, e.what());
+					}
+				}
+
+			} catch (...) {
+
+				lock.lock();
+				this->reloading = NULL;
+				this->idle.notify_all();
+				throw;
+			}
+
+			lock.lock();
+			this->reloading = NULL;
+			this->idle.notify_all();
+		}
+
+		return count;
+	}
+
+	size_t ConfigWatcher::poll(int timeout) {
+		return wait(timeout, true);
+	}
+
+	size_t ConfigWatcher::wait(int timeout, bool rethrow) {
+
+		{
+			boost::mutex::scoped_lock lock(this->mutex);
+
+			// Wake up in time for the next pending reload
+			long long time = now();
+
+			for (std::multimap<Key, File>::const_iterator it = this->files.begin(); it != this->files.end(); ++it) {
+
+				if (!it->second.pending) continue;
+
+				long long wait = std::max(it->second.deadline - time, 0LL);
+
+				if ((timeout < 0) || (wait < timeout)) {
+					timeout = static_cast<int>(wait);
+				}
+			}
+		}
+
+		struct pollfd fds[2] = {
+			{ this->fd, POLLIN, 0 },
+			{ this->wakeup, POLLIN, 0 }
+		};
+
+		if (::poll(fds, 2, timeout) < 0) {
+
+			if (errno == EINTR) {
+				return 0;
+			}
+
+			std::ostringstream ss;
+			ss << "Unable to wait for configuration changes: " << strerror(errno);
+			throw ConfigException(ss.str());
+		}
+
+		if (fds[1].revents & POLLIN) {
+			uint64_t value;
+			while (::read(this->wakeup, &value, sizeof(value)) > 0);
+		}
+
+		{
+			boost::mutex::scoped_lock lock(this->mutex);
+
+			read();
+		}
+
+		return process(rethrow);
+	}
+
+	void ConfigWatcher::run() {
+
+		for (;;) {
+
+			{
+				boost::mutex::scoped_lock lock(this->mutex);
+
+				if (!this->running) break;
+			}
+
+			try {
+				wait(-1, false);
+			} catch (const ConfigException &e) {
+
+				ErrorHandler handler;
+
+				{
+					boost::mutex::scoped_lock lock(this->mutex);
+
+					handler = this->errorHandler;
+				}
+
+				if (handler) {
+					handler(NULL, e.what());
+				}
+			}
+		}
+	}
+
+	void ConfigWatcher::start() {
+
+		boost::mutex::scoped_lock lock(this->mutex);
+
+		if (this->running) {
+			return;
+		}
+
+		this->running = true;
+		this->thread = boost::thread(&ConfigWatcher::run, this);
+	}
+
+	void ConfigWatcher::stop() {
+
+		{
+			boost::mutex::scoped_lock lock(this->mutex);
+
+			if (!this->running) {
+				return;
+			}
+
+			this->running = false;
+		}
+
+		uint64_t value = 1;
+
+		ssize_t result = write(this->wakeup, &value, sizeof(value));
+		(void) result;
+
+		this->thread.join();
+	}
+}
+
@@ -0,0 +1,154 @@
+/*
+ * $Id$
+ *
+ * Copyright 2008 Carpe Noctem, Distributed Systems Group,
+ * University of Kassel. All right reserved.
+ *
+ * The code is licensed under the Carpe Noctem Userfriendly BSD-Based
+ * License (CNUBBL). Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided that the
+ * conditions of the CNUBBL are met.
+ *
+ * You should have received a copy of the CNUBBL along with this
+ * software. The license is also available on our website:
+ * http://carpenoctem.das-lab.net/license.txt
+ */
+
+#ifndef CASTOR_CONFIGWATCHER_H
+#define CASTOR_CONFIGWATCHER_H 1
+
+#include <map>
+#include <string>
+
+#include <boost/noncopyable.hpp>
+#include <boost/function.hpp>
+#include <boost/thread.hpp>
+#include <boost/atomic.hpp>
+
+#include "Configuration.h"
+
+namespace castor {
+
+	/**
+	 * Reloads configurations when their files change. The watcher listens for
+	 * inotify events on the directories of the watched files, so files that
+	 * are replaced by renaming another file over them (as most editors do on
+	 * save) are noticed as well. A file counts as changed once it has been
+	 * closed after writing or another file has been renamed over it, a file
+	 * that is still being written is left alone.
+	 *
+	 * Events are coalesced: a file is reloaded once no further event arrived
+	 * for getDelay() milliseconds, so a burst of writes or a save-rename
+	 * sequence causes a single Configuration::reload().
+	 *
+	 * Reloads run without the lock of the watcher, so subscribers of the
+	 * configurations and the error handler may watch and unwatch files.
+	 *
+	 * The watcher either runs in the thread calling poll() or in a thread of
+	 * its own, see start(). In the latter case it is the writer of the watched
+	 * configurations, which should be in snapshot mode and only be read using
+	 * Configuration::snapshot() by other threads.
+	 */
+	class ConfigWatcher : private boost::noncopyable {
+
+		public:
+
+			typedef boost::function<void (Configuration *, const std::string &)> ErrorHandler;
+
+		protected:
+
+			struct File {
+				Configuration *config;
+				bool pending;
+				long long deadline;
+			};
+
+			/**
+			 * Watch descriptor of the directory and name of the file in it.
+			 * inotify returns the same descriptor for a directory however its
+			 * path is spelled and reports names relative to it.
+			 */
+			typedef std::pair<int, std::string> Key;
+
+			int fd;
+			int wakeup;
+			boost::atomic<unsigned int> delay;
+
+			std::multimap<Key, File> files;
+
+			ErrorHandler errorHandler;
+
+			boost::mutex mutex;
+			boost::condition_variable idle;
+			Configuration *reloading;
+			boost::thread::id reloader;
+			boost::thread thread;
+			bool running;
+
+			static long long now();
+
+			void read();
+			size_t process(bool rethrow);
+			size_t wait(int timeout, bool rethrow);
+			void run();
+
+		public:
+
+			/**
+			 * @param delay Quiet period in milliseconds before a changed file
+			 * is reloaded
+			 * @throws ConfigException if inotify is not available
+			 */
+			ConfigWatcher(unsigned int delay = 100);
+			~ConfigWatcher();
+
+			/**
+			 * Reloads the given configuration whenever its file changes. The
+			 * configuration has to outlive the watch.
+			 */
+			void watch(Configuration &config);
+
+			/**
+			 * Stops watching the given configuration. Waits for a reload of it
+			 * by another thread to finish, so it may be destroyed afterwards.
+			 */
+			void unwatch(Configuration &config);
+
+			/**
+			 * Sets the quiet period, see ConfigWatcher(). May be called while
+			 * the watcher runs, it applies to the next change of a file.
+			 */
+			void setDelay(unsigned int delay) {
+				this->delay = delay;
+			}
+
+			unsigned int getDelay() const {
+				return this->delay;
+			}
+
+			/**
+			 * Called with the configuration and the reason if a reload by the
+			 * thread of the watcher failed. The previous content stays in
+			 * place in that case. The configuration is NULL if waiting for
+			 * changes failed.
+			 */
+			void setErrorHandler(ErrorHandler handler);
+
+			/**
+			 * Waits up to timeout milliseconds for changes and reloads the
+			 * files that have been quiet long enough.
+			 * @return Number of reloaded configurations
+			 * @throws ConfigException if a reload fails
+			 */
+			size_t poll(int timeout);
+
+			/**
+			 * Polls in a thread of its own until stop() is called.
+			 */
+			void start();
+			void stop();
+	};
+}
+
+#endif /* CASTOR_CONFIGWATCHER_H */
+
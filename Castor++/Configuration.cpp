@@ -16,423 +16,1191 @@
 
 #include "Configuration.h"
 
+#include <map>
+#include <set>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+
+#include <boost/atomic.hpp>
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+
+#include <boost/shared_ptr.hpp>
+
 namespace castor {
 
 	Configuration::Configuration() :
-		filename(),
-		configRoot(new ConfigNode("root"))
-	{}
+		ConfigSnapshot(), filename(), published(), snapshots(false), indexThreshold(0), parseThreads(1), parseMinimum(1024 * 1024),
+		subscriptionsLock(), subscriptions(), lastSubscription(0), executor()
+	{
+		clear();
+	}
 
 	Configuration::Configuration(std::string filename) :
-		filename(filename), configRoot(new ConfigNode("root"))
+		ConfigSnapshot(), filename(filename), published(), snapshots(false), indexThreshold(0), parseThreads(1), parseMinimum(1024 * 1024),
+		subscriptionsLock(), subscriptions(), lastSubscription(0), executor()
 	{
 		load(filename);
 	}
 
 	Configuration::Configuration(std::string filename, const std::string content) :
-		filename(filename), configRoot(new ConfigNode("root"))
+		ConfigSnapshot(), filename(filename), published(), snapshots(false), indexThreshold(0), parseThreads(1), parseMinimum(1024 * 1024),
+		subscriptionsLock(), subscriptions(), lastSubscription(0), executor()
 	{
-		load(filename, boost::shared_ptr<std::istream>(new std::istringstream(content)), false, false);
+		load(filename, boost::shared_ptr<std::istream>(new std::istringstream(content)), false, true);
 	}
 
-	void Configuration::load(std::string filename, boost::shared_ptr<std::istream> content, bool, bool) {
+	/**
+	 * Returns whether filename names a compiled file, see ConfigBinary.
+	 */
+	static bool isBinaryName(const std::string &filename) {
+
+		static const std::string suffix = ".confc";
+
+		return ((filename.size() > suffix.size()) && (filename.compare(filename.size() - suffix.size(), suffix.size(), suffix) == 0));
+	}
+
+	void Configuration::load(std::string filename) {
+
+		// The configuration always refers to the source, a compiled file is
+		// only a faster way to read it
+		std::string source = filename;
+		std::string binary = ConfigBinary::getBinaryName(filename);
+
+		if (isBinaryName(filename)) {
+			source = filename.substr(0, filename.size() - 1);
+			binary = filename;
+		}
+
+		if (ConfigBinary::isCurrent(binary, source)) {
+
+			ConfigBufferPtr buffer = ConfigBuffer::load(binary);
+
+			if (ConfigBinary::isBinary(*buffer)) {
+				load(source, buffer, true);
+				return;
+			}
+		}
+
+		load(source, ConfigBuffer::load(source), true);
+	}
+
+	void Configuration::load(std::string filename, boost::shared_ptr<std::istream> content, bool, bool replace) {
+		load(filename, ConfigBuffer::read(filename, *content), replace);
+	}
+
+	void Configuration::load(std::string filename, ConfigBufferPtr buffer, bool replace) {
+
+		// Parse off to the side, the current tree stays untouched if the
+		// content turns out to be malformed
+		ConfigTreePtr next;
+
+		if ((replace) || (this->tree.get() == NULL)) {
+			next.reset(new ConfigTree());
+		} else {
+			next = this->tree->clone();
+		}
+
+		next->getIndex().setThreshold(this->indexThreshold);
+		next->setFilename(filename);
+		next->addBuffer(buffer);
+
+		if (ConfigBinary::isBinary(*buffer)) {
+
+			if (!replace) {
+				throw ConfigException("Compiled configuration " + buffer->getFilename() + " cannot be merged!");
+			}
+
+			ConfigBinary::read(next.get(), *buffer);
+
+		} else {
+
+			if ((this->parseThreads != 1) && (buffer->size() >= this->parseMinimum)) {
+				parse(next.get(), *buffer, this->parseThreads);
+			} else {
+				parse(next.get(), *buffer);
+			}
+
+			// A merged tree is not the parse of any single buffer
+			next->setSource(replace ? buffer : ConfigBufferPtr());
+		}
+
+		next->touch();
 
 		this->filename = filename;
+		this->tree = next;
 
-		int linePos = 0;
-		int chrPos = 0;
+		publish();
+	}
 
-		std::string line;
+	void Configuration::reload() {
 
-		ConfigNode *currentNode = this->configRoot.get();
+		ConfigTreePtr current = this->tree;
+		ConfigBufferPtr source = current->getSource();
 
-		while (content->good()) {
+		// Compiled files are not split into sections, neither is anything
+		// that has been changed since it was loaded
+		if ((source.get() == NULL) || (!current->getChanges().empty()) || (ConfigBinary::isCurrent(ConfigBinary::getBinaryName(this->filename), this->filename))) {
+			load(this->filename);
+			return;
+		}
 
-			std::getline(*content, line);
-			boost::algorithm::trim_left(line);
+		ConfigBufferPtr buffer = ConfigBuffer::load(this->filename);
 
-			int lineLen = line.size();
+		// Sections can only be taken over from the current tree if it still
+		// is the parse of the old file. Its buffer is a private copy, so it
+		// is intact however the file has been changed
+		std::vector<Chunk> before;
+		std::vector<Chunk> after;
 
-			chrPos = 1;
+		if ((source->getFilename() != this->filename) ||
+			(!split(*source, &before, true)) || (!split(*buffer, &after, true)))
+		{
+			load(this->filename, buffer, true);
+			return;
+		}
 
-			linePos++;
+		std::multimap<unsigned long long, std::pair<const Chunk *, const ConfigNode *> > reusable;
+		const ConfigNode *node = current->getRoot()->getFirstChild();
 
-			while (chrPos < lineLen - 1) {
+		for (size_t i = 0; i < before.size(); i++) {
 
-				if (line.size() == 0) break;
+			reusable.insert(std::make_pair(before[i].hash, std::make_pair(&before[i], node)));
 
-				switch (line[0]) {
+			for (unsigned int j = 0; j < before[i].nodes; j++) {
+				node = node->getNext();
+			}
+		}
 
-					case '#':
-						{
-							std::string comment = line.substr(1, line.size() - 1);
+		ConfigTreePtr next(new ConfigTree());
 
-							boost::trim(comment);
-							currentNode->create(ConfigNode::Comment, comment);
+		next->getIndex().setThreshold(this->indexThreshold);
+		next->setFilename(this->filename);
+		next->addBuffer(buffer);
 
-							chrPos += line.size() - 1;
-						}
-						continue;
+		for (size_t i = 0; i < after.size(); i++) {
 
-					case '<':
-					case '[':
-						{
-							size_t end = line.find(']');
+			const Chunk &chunk = after[i];
+			size_t size = chunk.end - chunk.begin;
+			bool reused = false;
 
-							if (end == std::string::npos) {
-								end = line.find('>');
-							}
+			typedef std::multimap<unsigned long long, std::pair<const Chunk *, const ConfigNode *> >::const_iterator Iterator;
+			std::pair<Iterator, Iterator> range = reusable.equal_range(chunk.hash);
 
-							if ((line.size() < 2) || (end == std::string::npos)) {
-								std::ostringstream ss;
-								ss << "Parse error in " << filename << ", line " << linePos << " character " << chrPos << ": malformed tag!";
-								throw ConfigException(ss.str());
-							}
+			for (Iterator it = range.first; (it != range.second) && (!reused); ++it) {
 
-							if (end - 1 == 0) {
-								std::ostringstream ss;
-								ss << "Parse error in " << filename << ", line " << linePos << " character " << chrPos << ": malformed tag, tag name empty!";
-								throw ConfigException(ss.str());
-							}
+				const Chunk &old = *it->second.first;
 
-							std::string name = line.substr(1, end - 1);
+				if ((size_t)(old.end - old.begin) != size || memcmp(old.begin, chunk.begin, size) != 0) {
+					continue;
+				}
 
-							if ((name[0] == '/') || (name[0] == '!')) {
+				node = it->second.second;
 
-								if (currentNode == NULL) {
-									std::ostringstream ss;
-									ss << "Parse error in " << filename << ", line " << linePos << " character " << chrPos << ": no opening tag found!";
-									throw ConfigException(ss.str());
-								}
+				for (unsigned int j = 0; j < old.nodes; j++, node = node->getNext()) {
+					next->graft(*current, node, next->getRoot(), old.begin, size, chunk.begin);
+				}
 
-								if (name.compare(1, name.size() - 1, currentNode->getName()) != 0) {
-									std::ostringstream ss;
-									ss << "Parse error in " << filename << ", line " << linePos << " character " << chrPos << ": closing tag does not match opening tag!";
-									throw ConfigException(ss.str());
-								}
+				reused = true;
+			}
 
-								currentNode = currentNode->getParent();
-							} else {
-								currentNode = currentNode->create(name);
-							}
+			if (!reused) {
+				parse(next.get(), *buffer, chunk);
+			}
+		}
 
-							if (end <= line.size() - 1) {
-								line = line.substr(end + 1, line.size() - end - 1);
-							}
+		next->setSource(buffer);
+		next->touch();
 
-							chrPos += (end + 1);
-						}
-						break;
+		this->tree = next;
 
-					default:
-						chrPos++;
+		publish();
+	}
 
-						if ((line[0] != ' ') && (line[0] != '\t')) {
+	void Configuration::clear() {
 
-							size_t curPos = 0;
-							bool inString = false;
+		ConfigTreePtr next(new ConfigTree());
 
-							std::ostringstream ss;
+		next->getIndex().setThreshold(this->indexThreshold);
+		next->setFilename(this->filename);
 
-							while (curPos < line.size()) {
+		this->tree = next;
 
-								// TODO: This was commented out; why? phb
-								if ((!inString) &&
-									((line[curPos] == '[') || (line[curPos] == '<')))
-								{
-									curPos--;
-									break;
-								}
+		publish();
+	}
 
-								if (line[curPos] == '"') {
-									inString = !inString;
-									curPos++;
-								}
+	ConfigTree *Configuration::edit() {
 
-								if (curPos < line.size()) {
+		// In snapshot mode, changes go to a private copy of the published
+		// tree until they are committed
+		if ((this->snapshots) && (this->tree == this->published)) {
+			this->tree = this->published->clone();
+		}
 
-									ss << line[curPos];
-									curPos++;
-								}
-							}
+		return this->tree.get();
+	}
 
-							line = (curPos >= line.size() - 1 ? "" : line.substr(curPos + 1, line.size() - curPos - 1));
+	void Configuration::publish() {
 
-							chrPos += (curPos - 1);
+		// Readers never build the index themselves
+		this->tree->getIndex().prepare(this->tree->getRoot());
 
-							std::string element = ss.str();
-							std::string key;
-							std::string value;
+		boost::atomic_store(&this->published, this->tree);
 
-							size_t eq = element.find('=');
+		notify();
+	}
 
-							if (eq != std::string::npos) {
-								key = element.substr(0, eq - 1);
-								value = element.substr(eq + 1, element.size() - eq - 1);
+	void Configuration::commit() {
 
-								boost::algorithm::trim(key);
-								boost::algorithm::trim(value);
-							}
+		if (this->tree != this->published) {
+			publish();
+		} else {
+			notify();
+		}
+	}
 
-							boost::any a(value);
+	/**
+	 * Combines the hashes of the nodes a query matches.
+	 */
+	static unsigned long long digest(ConfigTree *tree, const ConfigQuery &query) {
 
-							currentNode->create(key, a);
+		std::vector<ConfigNode *> nodes;
+		unsigned long long result = 0xcbf29ce484222325ULL;
 
-						} else {
-							line = line.substr(1, line.size() - 1);
-						}
+		query.collect(tree, &nodes);
 
-						break;
+		for (size_t i = 0; i < nodes.size(); i++) {
+			result = (result ^ tree->getHash(nodes[i])) * 0x100000001b3ULL;
+		}
+
+		return (result ^ nodes.size()) * 0x100000001b3ULL;
+	}
+
+	void Configuration::notify() {
+
+		ConfigSnapshot snapshot(this->published, this->threadCache);
+		std::vector<Subscription> changed;
+		Executor executor;
+
+		{
+			boost::mutex::scoped_lock lock(this->subscriptionsLock);
+
+			executor = this->executor;
+
+			for (size_t i = 0; i < this->subscriptions.size(); i++) {
+
+				Subscription &subscription = this->subscriptions[i];
+				unsigned long long hash = digest(this->published.get(), subscription.query);
+
+				if (hash != subscription.hash) {
+					subscription.hash = hash;
+					changed.push_back(subscription);
 				}
 			}
 		}
 
+		if (changed.empty()) {
+			return;
+		}
 
-		if (this->configRoot.get() != currentNode) {
-			std::ostringstream ss;
-			ss << "Parse error in " << filename << ", line " << linePos << " character " << line.size() << ": no closing tag found!";
-			throw ConfigException(ss.str());
+		if (executor) {
+			executor(boost::bind(&Configuration::dispatch, snapshot, changed));
+		} else {
+			dispatch(snapshot, changed);
 		}
 	}
 
-	void Configuration::serialize_internal(std::ostringstream *ss, ConfigNode *node) {
+	void Configuration::dispatch(const ConfigSnapshot &snapshot, const std::vector<Subscription> &subscriptions) {
 
-		if (node == NULL) return;
+		std::string error;
 
-		if (node->getType() == ConfigNode::Node) {
+		// A failing subscriber does not keep the others from being called
+		for (size_t i = 0; i < subscriptions.size(); i++) {
+			try {
+				subscriptions[i].subscriber(snapshot, subscriptions[i].query.str());
+			} catch (const std::exception &e) {
+				if (error.empty()) {
+					error = "Subscriber of '" + subscriptions[i].query.str() + "' failed: " + e.what();
+				}
+			}
+		}
 
-			*ss << std::string(4 * node->getDepth(), ' ') << "[" << node->getName() << "]" << std::endl;
-			
-			for (std::vector<ConfigNodePtr>::iterator itr = node->getChildren()->begin();
-				 itr != node->getChildren()->end(); itr++)
-			{
-				serialize_internal(ss, (*itr).get());
+		if (!error.empty()) {
+			throw ConfigException(error);
+		}
+	}
+
+	size_t Configuration::subscribe(const std::string &path, Subscriber subscriber) {
+
+		Subscription subscription = { 0, ConfigQuery(path), subscriber, 0 };
+
+		subscription.hash = digest(this->published.get(), subscription.query);
+
+		boost::mutex::scoped_lock lock(this->subscriptionsLock);
+
+		subscription.id = ++this->lastSubscription;
+		this->subscriptions.push_back(subscription);
+
+		return subscription.id;
+	}
+
+	void Configuration::unsubscribe(size_t id) {
+
+		boost::mutex::scoped_lock lock(this->subscriptionsLock);
+
+		for (size_t i = 0; i < this->subscriptions.size(); i++) {
+			if (this->subscriptions[i].id == id) {
+				this->subscriptions.erase(this->subscriptions.begin() + i);
+				return;
 			}
+		}
+	}
+
+	void Configuration::setExecutor(Executor executor) {
+
+		boost::mutex::scoped_lock lock(this->subscriptionsLock);
+
+		this->executor = executor;
+	}
 
-			*ss << std::string(4 * node->getDepth(), ' ') << "[!" << node->getName() << "]" << std::endl;
+	ConfigSnapshot Configuration::snapshot() const {
+		return ConfigSnapshot(boost::atomic_load(&this->published), this->threadCache);
+	}
 
-		} else if (node -> getType() == ConfigNode::Leaf) {
+	void Configuration::setSnapshots(bool snapshots) {
 
-			*ss << std::string(4 * node->getDepth(), ' ') << node->getName() << " = " << boost::any_cast<std::string>(node->getValue()) << std::endl;
+		commit();
 
-		} else { // Comment
+		this->snapshots = snapshots;
+	}
 
-			*ss << std::string(4 * node->getDepth(), ' ') << "# " << node->getName() << std::endl;
+	void Configuration::setThreadCache(bool enabled) {
+		this->threadCache = enabled;
+	}
 
+	void Configuration::setParseThreads(unsigned int threads, size_t minimumSize) {
+
+		this->parseThreads = threads;
+		this->parseMinimum = minimumSize;
+	}
+
+	void Configuration::setIndexThreshold(unsigned int threshold) {
+
+		this->indexThreshold = threshold;
+
+		if (!this->snapshots) {
+			this->tree->getIndex().setThreshold(threshold);
+			this->tree->getIndex().prepare(this->tree->getRoot());
 		}
 	}
 
-	void Configuration::store() {
+	ConfigNode *Configuration::create(ConfigNode *parent, ConfigNode::Type type, const std::string &name, const std::string &value) {
 
-		if (this->filename.size() > 0) {
-			store(this->filename);
+		ConfigTree *before = this->tree.get();
+		ConfigTree *tree = edit();
+
+		if (tree != before) {
+			parent = tree->locate(*before, parent);
 		}
+
+		ConfigNode *node = tree->addNode(parent, type, name, value);
+
+		tree->touch();
+
+		return node;
 	}
 
-	void Configuration::store(std::string filename) {
+	void Configuration::remove(ConfigNode *node) {
 
-		std::ostringstream ss;
-		std::ofstream os(filename.c_str(), std::ios_base::out);
+		ConfigTree *before = this->tree.get();
+		ConfigTree *tree = edit();
 
-		serialize_internal(&ss, this->configRoot.get());
+		if (tree != before) {
+			node = tree->locate(*before, node);
+		}
+
+		if (node == tree->getRoot()) {
+			throw ConfigException("The root of " + tree->getFilename() + " cannot be removed!");
+		}
 
-		os << ss.str();
+		tree->removeNode(node);
+		tree->touch();
 	}
 
-	std::string Configuration::serialize() {
+	/**
+	 * Returns the child of node the given step leads to, NULL if there is
+	 * none.
+	 */
+	static ConfigNode *follow(ConfigTree *tree, ConfigNode *node, const ConfigChange::Step &step) {
 
-		std::ostringstream ss;
-		serialize_internal(&ss, this->configRoot.get());
+		ConfigSymbol symbol = tree->getSymbols().find(step.name.data(), step.name.size());
+		unsigned int index = 0;
 
-		return ss.str();
+		if (symbol == ConfigSymbols::Unknown) {
+			return NULL;
+		}
+
+		for (ConfigNode *child = node->getFirstChild(); child != NULL; child = child->getNext()) {
+			if ((child->getType() != ConfigNode::Comment) && (child->getSymbol() == symbol) && (index++ == step.index)) {
+				return child;
+			}
+		}
+
+		return NULL;
 	}
 
-	void Configuration::collect(ConfigNode *node, std::vector<std::string> *params, size_t offset, std::vector<ConfigNode *> *result) {
+	/**
+	 * Returns the node the given steps lead to, NULL if there is none.
+	 */
+	static ConfigNode *follow(ConfigTree *tree, const std::vector<ConfigChange::Step> &steps) {
+
+		ConfigNode *node = tree->getRoot();
+
+		for (size_t i = 0; (i < steps.size()) && (node != NULL); i++) {
+			node = follow(tree, node, steps[i]);
+		}
+
+		return node;
+	}
 
-		std::vector<ConfigNodePtr> *children = node->getChildren();
+	/**
+	 * Returns the node an added node goes after, NULL to add it first. A
+	 * sibling that cannot be found puts it last.
+	 */
+	static ConfigNode *position(ConfigTree *tree, ConfigNode *parent, const ConfigChange::Step &after) {
 
-		if (offset == params->size()) {
-			result->push_back(node);
+		if (after.name.empty()) {
+			return NULL;
+		}
+
+		ConfigNode *previous = follow(tree, parent, after);
+
+		return (previous != NULL ? previous : parent->getLastChild());
+	}
+
+	void Configuration::apply(const ConfigPatch &patch) {
+
+		if (patch.empty()) {
 			return;
 		}
 
-		for (size_t i = offset; i < params->size(); i++) {
-			
-			bool found = false;
+		ConfigTree *tree = edit();
+		std::vector<ConfigNode *> nodes(patch.size(), NULL);
+
+		for (size_t i = 0; i < patch.size(); i++) {
 
-			for (size_t j = 0; j < children->size(); j++) {
+			const ConfigChange &change = patch[i];
+			bool valid;
 
-				if ((*children)[j]->getName().compare((*params)[i]) == 0) {
-					collect((*children)[j].get(), params, offset + 1, result);
-					found = true;
+			if (change.parent != ConfigPatch::None) {
+				valid = ((change.parent < i) && (patch[change.parent].kind == ConfigChange::Added) && (patch[change.parent].type == ConfigNode::Node));
+			} else {
+
+				nodes[i] = follow(tree, change.steps);
+
+				switch (change.kind) {
+					case ConfigChange::Added:
+						valid = ((nodes[i] != NULL) && (nodes[i]->getType() == ConfigNode::Node));
+						break;
+					case ConfigChange::Removed:
+						valid = ((nodes[i] != NULL) && (nodes[i] != tree->getRoot()));
+						break;
+					default:
+						valid = ((nodes[i] != NULL) && (nodes[i]->getType() == ConfigNode::Leaf));
+						break;
 				}
 			}
 
-			if (!found) return;
+			if (!valid) {
+				std::ostringstream ss;
+				ss << "Patch does not apply to " << tree->getFilename() << ": no match for '" << change.path << "'!";
+				throw ConfigException(ss.str());
+			}
 		}
-	}
 
-	void Configuration::collectSections(ConfigNode *node, std::vector<std::string> *params, size_t offset, std::vector<ConfigNode *> *result) {
+		// Removals go first, so that the siblings added nodes are placed
+		// after are counted among the nodes that stay only
+		for (size_t i = 0; i < patch.size(); i++) {
+			if (patch[i].kind == ConfigChange::Removed) {
+				tree->removeNode(nodes[i]);
+			}
+		}
 
-		std::vector<ConfigNodePtr> *children = node->getChildren();
+		for (size_t i = 0; i < patch.size(); i++) {
 
-//		for(unsigned int i = 0; i < children->size(); i++){
-//			std::cout << "Children " << i << " " << (*children)[i]->getName().c_str() << std::endl;
-//		}
+			const ConfigChange &change = patch[i];
 
-//		std::cout << "offset " << offset << std::endl;
-//		std::cout << "params->size " << params->size() << std::endl;
+			switch (change.kind) {
+				case ConfigChange::Added:
 
-		if (offset == params->size()) {
-//			std::cout << "pushed " << node->getName().c_str() << std::endl;
+					if (change.parent == ConfigPatch::None) {
+						nodes[i] = tree->insertNode(nodes[i], position(tree, nodes[i], change.after), change.type, change.name, change.value);
+					} else {
+						nodes[i] = tree->addNode(nodes[change.parent], change.type, change.name, change.value);
+					}
 
-			//result->push_back(node);
-			for(unsigned int i = 0; i < children->size(); i++){
-	
-				result->push_back((*children)[i].get());
-	
+					break;
+				case ConfigChange::Removed:
+					break;
+				case ConfigChange::Changed:
+					tree->setValue(nodes[i], change.value);
+					break;
 			}
+		}
 
-			return;
+		tree->touch();
+	}
+
+	static inline bool isBlank(char c) {
+		return ((c == ' ') || (c == '\t') || (c == '\r') || (c == '\v') || (c == '\f'));
+	}
+
+	static inline void trim(const char *&begin, const char *&end) {
+
+		while ((begin < end) && isBlank(*begin)) begin++;
+		while ((end > begin) && isBlank(*(end - 1))) end--;
+	}
+
+	static std::string parseError(const std::string &filename, int line, int column, const char *reason) {
+
+		std::ostringstream ss;
+		ss << "Parse error in " << filename << ", line " << line << " character " << column << ": " << reason;
+
+		return ss.str();
+	}
+
+	/**
+	 * Strips the quotes from a (trimmed) value. Values that are quoted as a
+	 * whole stay views into the buffer, only quotes within a value require a
+	 * copy.
+	 */
+	static ConfigString unquote(ConfigArena &arena, const char *begin, const char *end) {
+
+		const char *quote = static_cast<const char *>(memchr(begin, '"', end - begin));
+
+		if (quote == NULL) {
+			return ConfigString(begin, end - begin);
 		}
 
-		for (size_t i = offset; i < params->size(); i++) {
-			
-			bool found = false;
+		if ((quote == begin) && (end - begin >= 2) && (*(end - 1) == '"') &&
+			(memchr(begin + 1, '"', end - begin - 2) == NULL))
+		{
+			begin++;
+			end--;
+			trim(begin, end);
+
+			return ConfigString(begin, end - begin);
+		}
+
+		char *value = static_cast<char *>(arena.allocate(end - begin, 1));
+		char *last = value;
+
+		for (const char *p = begin; p < end; p++) {
+			if (*p != '"') *last++ = *p;
+		}
+
+		const char *first = value;
+		const char *valueEnd = last;
+		trim(first, valueEnd);
+
+		return ConfigString(first, valueEnd - first);
+	}
+
+	/**
+	 * 64-bit FNV-1a, only used to find candidates for identical chunks.
+	 */
+	static unsigned long long hashChunk(const char *data, size_t size) {
+
+		unsigned long long h = 14695981039346656037ULL;
+
+		for (size_t i = 0; i < size; i++) {
+			h = (h ^ static_cast<unsigned char>(data[i])) * 1099511628211ULL;
+		}
+
+		return h;
+	}
+
+	bool Configuration::split(const ConfigBuffer &buffer, std::vector<Chunk> *chunks, bool hash) {
 
-			for (size_t j = 0; j < children->size(); j++) {
+		const char *pos = buffer.begin();
+		const char *end = buffer.end();
 
-				if ((*children)[j]->getName().compare((*params)[i]) == 0) {
-//					std::cout << "found true with " << (*children)[j]->getName().c_str() << std::endl;
-					collectSections((*children)[j].get(), params, offset + 1, result);
-					found = true;
+		Chunk chunk = { pos, pos, 1, 0, 0 };
+		int linePos = 1;
+		int depth = 0;
+
+		while (pos < end) {
+
+			const char *eol = static_cast<const char *>(memchr(pos, '\n', end - pos));
+
+			if (eol == NULL) {
+				eol = end;
+			}
+
+			while (pos < eol) {
+
+				if (isBlank(*pos)) {
+					pos++;
+					continue;
 				}
+
+				switch (*pos) {
+
+					case '#':
+						if (depth == 0) chunk.nodes++;
+						pos = eol;
+						break;
+
+					case '<':
+					case '[':
+						{
+							const char *close = static_cast<const char *>(memchr(pos, ']', eol - pos));
+
+							if (close == NULL) {
+								close = static_cast<const char *>(memchr(pos, '>', eol - pos));
+							}
+
+							if ((close == NULL) || (close == pos + 1)) {
+								return false;
+							}
+
+							if ((pos[1] == '/') || (pos[1] == '!')) {
+
+								if (--depth < 0) {
+									return false;
+								}
+
+								// A top-level section ends the current chunk
+								if (depth == 0) {
+
+									chunk.end = close + 1;
+									chunk.hash = (hash ? hashChunk(chunk.begin, chunk.end - chunk.begin) : 0);
+									chunks->push_back(chunk);
+
+									chunk.begin = chunk.end;
+									chunk.line = linePos;
+									chunk.nodes = 0;
+								}
+							} else {
+								if (depth++ == 0) chunk.nodes++;
+							}
+
+							pos = close + 1;
+						}
+						break;
+
+					default:
+						{
+							const char *last = pos;
+							bool eq = false;
+							bool inString = false;
+
+							for (; last < eol; last++) {
+
+								if (*last == '"') {
+									inString = !inString;
+								} else if (!inString) {
+									if ((*last == '[') || (*last == '<')) break;
+									if (*last == '=') eq = true;
+								}
+							}
+
+							if ((eq) && (depth == 0)) chunk.nodes++;
+
+							pos = last;
+						}
+						break;
+				}
+			}
+
+			if (eol < end) {
+				linePos++;
 			}
 
-			if (!found) return;
+			pos = (eol < end ? eol + 1 : end);
+		}
+
+		if (depth != 0) {
+			return false;
+		}
+
+		if (chunk.begin < end) {
+			chunk.end = end;
+			chunk.hash = (hash ? hashChunk(chunk.begin, chunk.end - chunk.begin) : 0);
+			chunks->push_back(chunk);
 		}
+
+		return true;
 	}
 
-	std::string Configuration::pathNotFound(std::vector<std::string> *params)
-	{
-		std::ostringstream os;
+	void Configuration::parse(ConfigTree *tree, const ConfigBuffer &buffer) {
 
-		if ((params == NULL) || (params->size() == 0))
-		{
-			os << "Empty path not found in " << this->filename << "!" << std::endl;
+		Chunk chunk = { buffer.begin(), buffer.end(), 1, 0, 0 };
+
+		parse(tree, buffer, chunk);
+	}
+
+	void Configuration::parse(ConfigTree *tree, const ConfigBuffer &buffer, const Chunk &chunk) {
+
+		const std::string &filename = buffer.getFilename();
+
+		const char *pos = chunk.begin;
+		const char *end = chunk.end;
+
+		// Chunks may start in the middle of a line, columns count from the
+		// start of that line
+		const char *lineStart = pos;
+
+		while ((lineStart > buffer.begin()) && (*(lineStart - 1) != '\n')) {
+			lineStart--;
 		}
-		else
-		{
-			os << "Path '" << (*params)[0];
 
-			for (size_t i = 1; i < params->size(); i++) {
-				os << "." << (*params)[i];
+		int linePos = chunk.line - 1;
+
+		ConfigNode *currentNode = tree->getRoot();
+
+		while (pos < end) {
+
+			if (pos != chunk.begin) {
+				lineStart = pos;
 			}
 
-			os << "' not found in " << this->filename << "!" << std::endl;
+			const char *eol = static_cast<const char *>(memchr(pos, '\n', end - pos));
+
+			if (eol == NULL) {
+				eol = end;
+			}
+
+			linePos++;
+
+			while (pos < eol) {
+
+				if (isBlank(*pos)) {
+					pos++;
+					continue;
+				}
+
+				switch (*pos) {
+
+					case '#':
+						{
+							const char *begin = pos + 1;
+							const char *last = eol;
+
+							trim(begin, last);
+							tree->createNode(currentNode, ConfigNode::Comment, ConfigSymbols::Empty, ConfigString(begin, last - begin));
+
+							pos = eol;
+						}
+						break;
+
+					case '<':
+					case '[':
+						{
+							const char *close = static_cast<const char *>(memchr(pos, ']', eol - pos));
+
+							if (close == NULL) {
+								close = static_cast<const char *>(memchr(pos, '>', eol - pos));
+							}
+
+							if (close == NULL) {
+								throw ConfigException(parseError(filename, linePos, pos - lineStart + 1, "malformed tag!"));
+							}
+
+							if (close == pos + 1) {
+								throw ConfigException(parseError(filename, linePos, pos - lineStart + 1, "malformed tag, tag name empty!"));
+							}
+
+							const char *name = pos + 1;
+
+							if ((*name == '/') || (*name == '!')) {
+
+								if (currentNode == tree->getRoot()) {
+									throw ConfigException(parseError(filename, linePos, pos - lineStart + 1, "no opening tag found!"));
+								}
+
+								if (!tree->getName(currentNode).equals(name + 1, close - name - 1)) {
+									throw ConfigException(parseError(filename, linePos, pos - lineStart + 1, "closing tag does not match opening tag!"));
+								}
+
+								currentNode = currentNode->getParent();
+							} else {
+								currentNode = tree->createNode(currentNode, ConfigNode::Node, tree->getSymbols().intern(ConfigString(name, close - name)), ConfigString());
+							}
+
+							pos = close + 1;
+						}
+						break;
+
+					default:
+						{
+							// A key/value pair extends to the end of the line or
+							// to the next tag that is not within quotes
+							const char *last = pos;
+							const char *eq = NULL;
+							bool inString = false;
+
+							for (; last < eol; last++) {
+
+								if (*last == '"') {
+									inString = !inString;
+								} else if (!inString) {
+									if ((*last == '[') || (*last == '<')) break;
+									if ((*last == '=') && (eq == NULL)) eq = last;
+								}
+							}
+
+							if (eq != NULL) {
+
+								const char *keyBegin = pos;
+								const char *keyEnd = eq;
+								const char *valueBegin = eq + 1;
+								const char *valueEnd = last;
+
+								trim(keyBegin, keyEnd);
+								trim(valueBegin, valueEnd);
+
+								tree->createNode(currentNode, ConfigNode::Leaf, tree->getSymbols().intern(ConfigString(keyBegin, keyEnd - keyBegin)), unquote(tree->getArena(), valueBegin, valueEnd));
+							}
+
+							pos = last;
+						}
+						break;
+				}
+			}
+
+			pos = (eol < end ? eol + 1 : end);
 		}
 
-		return os.str();
+		if (tree->getRoot() != currentNode) {
+			throw ConfigException(parseError(filename, linePos, 1, "no closing tag found!"));
+		}
 	}
 
-	std::vector<std::string> Configuration::getSections(const char *path, ...)
-	{
-		CONSUME_PARAMS(path);
+	void Configuration::parseBatches(const ConfigBuffer *buffer, const std::vector<Chunk> *chunks, std::vector<Batch> *batches, boost::atomic<size_t> *next) {
 
-		// Get relevant nodes
-		std::vector<ConfigNode *> nodes;
-		collectSections(this->configRoot.get(), params.get(), 0, &nodes);
+		for (size_t i; (i = (*next)++) < batches->size(); ) {
 
-		// If there are no nodes, exit
-		if (nodes.size() == 0) {
-			throw ConfigException(pathNotFound(params.get()));
-		}
+			Batch &batch = (*batches)[i];
 
-		// Copy only the sections
-		std::vector<std::string> result;
-		for (size_t i = 0; i < nodes.size(); i++) {
-			if (nodes[i]->getType() == ConfigNode::Node) {
-				result.push_back(nodes[i]->getName());
+			try {
+
+				batch.tree.reset(new ConfigTree());
+
+				for (size_t j = batch.first; j < batch.last; j++) {
+					parse(batch.tree.get(), *buffer, (*chunks)[j]);
+				}
+
+			} catch (const std::exception &e) {
+				batch.error = e.what();
 			}
 		}
+	}
 
-		return result;
+	void Configuration::renumberBatches(std::vector<Batch> *batches, boost::atomic<size_t> *next) {
+
+		for (size_t i; (i = (*next)++) < batches->size(); ) {
+			(*batches)[i].tree->renumber((*batches)[i].symbols);
+		}
 	}
 
-	std::vector<std::string> Configuration::getNames(const char *path, ...)
-	{
-		CONSUME_PARAMS(path);
+	void Configuration::parse(ConfigTree *tree, const ConfigBuffer &buffer, unsigned int threads) {
 
-		// Get relevant nodes
-		std::vector<ConfigNode *> nodes;
-		collect(this->configRoot.get(), params.get(), 0, &nodes);
+		if (threads == 0) {
+			threads = std::max(boost::thread::hardware_concurrency(), 1u);
+		}
+
+		std::vector<Chunk> chunks;
 
-		// If there are no nodes, exit
-		if (nodes.size() == 0) {
-			throw ConfigException(pathNotFound(params.get()));
+		// Malformed content is left to the serial parser, which knows where
+		// exactly it went wrong
+		if ((threads < 2) || (!split(buffer, &chunks, false)) || (chunks.size() < 2)) {
+			parse(tree, buffer);
+			return;
 		}
 
-		// Copy only the keys
-		std::vector<std::string> result;
-		for (size_t i = 0; i < nodes.size(); i++) {
-			if (nodes[i]->getType() == ConfigNode::Leaf) {
-				result.push_back(nodes[i]->getName());
+		// A few batches per thread of about the same size balance the load
+		std::vector<Batch> batches;
+		size_t target = buffer.size() / (4 * threads) + 1;
+
+		for (size_t i = 0; i < chunks.size(); ) {
+
+			Batch batch;
+			batch.first = i;
+
+			for (size_t size = 0; (i < chunks.size()) && (size < target); i++) {
+				size += chunks[i].end - chunks[i].begin;
 			}
+
+			batch.last = i;
+			batches.push_back(batch);
 		}
 
-		return result;
-	}
+		boost::atomic<size_t> next(0);
+		boost::thread_group group;
 
-	std::vector<std::string> Configuration::tryGetSections(std::string d, const char *path, ...)
-	{
-		CONSUME_PARAMS(path);
+		for (unsigned int i = 1; (i < threads) && (i < batches.size()); i++) {
+			group.create_thread(boost::bind(&Configuration::parseBatches, &buffer, &chunks, &batches, &next));
+		}
 
-		// Get relevant nodes
-		std::vector<ConfigNode *> nodes;
-		collect(this->configRoot.get(), params.get(), 0, &nodes);
+		parseBatches(&buffer, &chunks, &batches, &next);
+		group.join_all();
+
+		// Report the first error in source order
+		for (size_t i = 0; i < batches.size(); i++) {
+			if (!batches[i].error.empty()) {
+				throw ConfigException(batches[i].error);
+			}
+		}
+
+		// Only interning the names is serial, the nodes of every batch are
+		// renumbered by the pool again
+		for (size_t i = 0; i < batches.size(); i++) {
+			tree->importSymbols(*batches[i].tree, &batches[i].symbols);
+		}
+
+		next = 0;
 
-		// If there are no nodes, return the default one
-		if (nodes.size() == 0) {
-			std::vector<std::string> result(1);
-			result.push_back(d);
-			return result;
+		for (unsigned int i = 1; (i < threads) && (i < batches.size()); i++) {
+			group.create_thread(boost::bind(&Configuration::renumberBatches, &batches, &next));
 		}
 
-		// Copy only the sections
+		renumberBatches(&batches, &next);
+		group.join_all();
+
+		for (size_t i = 0; i < batches.size(); i++) {
+			tree->adopt(*batches[i].tree);
+		}
+	}
+
+	void Configuration::store() {
+
+		if (this->filename.size() > 0) {
+			store(this->filename);
+		}
+	}
+
+	std::vector<std::string> Configuration::dirtyPaths() const {
+
+		const std::vector<ConfigTree::Change> &changes = this->tree->getChanges();
 		std::vector<std::string> result;
-		for (size_t i = 0; i < nodes.size(); i++) {
-			if (nodes[i]->getType() == ConfigNode::Node) {
-				result.push_back(nodes[i]->getName());
+		std::set<const ConfigNode *> sections;
+
+		for (size_t i = 0; i < changes.size(); i++) {
+			if ((this->tree->isDirty(changes[i])) && (changes[i].children)) {
+				sections.insert(changes[i].node);
+			}
+		}
+
+		for (size_t i = 0; i < changes.size(); i++) {
+
+			if (!this->tree->isDirty(changes[i])) continue;
+
+			// Changes below a section that got or lost children, including
+			// those of removed nodes, are covered by the section
+			bool covered = false;
+
+			for (const ConfigNode *node = changes[i].node->getParent(); (node != NULL) && (!covered); node = node->getParent()) {
+				covered = (sections.count(node) > 0);
+			}
+
+			if (!covered) {
+				result.push_back(this->tree->getPath(changes[i].node));
 			}
 		}
 
 		return result;
 	}
 
-	std::vector<std::string> Configuration::tryGetNames(std::string d, const char *path, ...)
-	{
-		CONSUME_PARAMS(path);
+	/**
+	 * A range of the source text and what replaces it: either the value of
+	 * a leaf or the serialization of consecutive top-level nodes.
+	 */
+	struct ConfigEdit {
+		size_t begin;
+		size_t end;
+		const ConfigNode *node;
+		unsigned int nodes;
+
+		bool operator<(const ConfigEdit &other) const {
+			return (this->begin < other.begin);
+		}
+	};
 
-		// Get relevant nodes
-		std::vector<ConfigNode *> nodes;
-		collect(this->configRoot.get(), params.get(), 0, &nodes);
+	bool Configuration::patch(ConfigWriter *writer) {
+
+		ConfigTree *tree = this->tree.get();
+		const ConfigBufferPtr &source = tree->getSource();
+		const std::vector<ConfigTree::Change> &changes = tree->getChanges();
 
-		// If there are no nodes, return the default one
-		if (nodes.size() == 0) {
-			std::vector<std::string> result(1);
-			result.push_back(d);
-			return result;
+		if (source.get() == NULL) {
+			return false;
 		}
 
-		// Copy only the sections
-		std::vector<std::string> result;
-		for (size_t i = 0; i < nodes.size(); i++) {
-			if (nodes[i]->getType() == ConfigNode::Leaf) {
-				result.push_back(nodes[i]->getName());
+		std::vector<ConfigEdit> edits;
+		std::set<const ConfigNode *> sections;
+
+		for (size_t i = 0; i < changes.size(); i++) {
+
+			const ConfigTree::Change &change = changes[i];
+
+			// New top-level nodes cannot be placed within the source
+			if (change.node == tree->getRoot()) {
+				return false;
+			}
+
+			if ((!change.children) && (change.node->getType() == ConfigNode::Leaf) &&
+				(!change.original.empty()) && (source->contains(change.original.data())))
+			{
+				size_t begin = change.original.data() - source->begin();
+				ConfigEdit edit = { begin, begin + change.original.size(), change.node, 0 };
+
+				edits.push_back(edit);
+				continue;
+			}
+
+			// Anything else rewrites the top-level node it belongs to
+			const ConfigNode *node = change.node;
+
+			while (node->getParent() != tree->getRoot()) {
+				node = node->getParent();
 			}
+
+			sections.insert(node);
 		}
 
-		return result;
+		if (!sections.empty()) {
+
+			std::vector<Chunk> chunks;
+
+			if ((!split(*source, &chunks, false))) {
+				return false;
+			}
+
+			std::vector<ConfigEdit> values;
+			const ConfigNode *node = tree->getRoot()->getFirstChild();
+
+			values.swap(edits);
+
+			for (size_t i = 0; i < chunks.size(); i++) {
+
+				ConfigEdit edit = { 0, 0, node, chunks[i].nodes };
+				bool rewrite = false;
+
+				for (unsigned int j = 0; j < chunks[i].nodes; j++, node = node->getNext()) {
+
+					// The tree does not match the source any more
+					if (node == NULL) {
+						return false;
+					}
+
+					rewrite = (rewrite || (sections.count(node) > 0));
+				}
+
+				if (!rewrite) continue;
+
+				// Whitespace around the nodes is left as it is, the
+				// rewrite covers whole lines
+				const char *begin = chunks[i].begin;
+				const char *end = chunks[i].end;
+
+				while ((begin < end) && ((isBlank(*begin)) || (*begin == '\n'))) begin++;
+				while ((begin > chunks[i].begin) && (isBlank(*(begin - 1)))) begin--;
+				while ((end > begin) && ((isBlank(*(end - 1))) || (*(end - 1) == '\n'))) end--;
+
+				const char *eol = end;
+
+				while ((eol < source->end()) && (isBlank(*eol))) eol++;
+
+				if ((eol < source->end()) && (*eol == '\n')) {
+					end = eol + 1;
+				}
+
+				edit.begin = begin - source->begin();
+				edit.end = end - source->begin();
+
+				edits.push_back(edit);
+			}
+
+			if (node != NULL) {
+				return false;
+			}
+
+			// Values within rewritten chunks are part of the rewrite
+			for (size_t i = 0; i < values.size(); i++) {
+
+				bool covered = false;
+
+				for (size_t j = 0; (j < edits.size()) && (!covered); j++) {
+					covered = ((values[i].begin >= edits[j].begin) && (values[i].end <= edits[j].end));
+				}
+
+				if (!covered) {
+					edits.push_back(values[i]);
+				}
+			}
+		}
+
+		std::sort(edits.begin(), edits.end());
+
+		size_t position = 0;
+
+		for (size_t i = 0; i < edits.size(); i++) {
+
+			const ConfigEdit &edit = edits[i];
+
+			writer->write(source->begin() + position, edit.begin - position);
+
+			if (edit.nodes == 0) {
+				writer->write(edit.node->getValue());
+			} else {
+
+				// Chunks may start on the line another one ends
+				if ((edit.begin > 0) && (source->begin()[edit.begin - 1] != '\n')) {
+					writer->put('\n');
+				}
+
+				const ConfigNode *node = edit.node;
+
+				for (unsigned int j = 0; j < edit.nodes; j++, node = node->getNext()) {
+					serialize_internal(writer, node);
+				}
+			}
+
+			position = edit.end;
+		}
+
+		writer->write(source->begin() + position, source->size() - position);
+
+		return true;
+	}
+
+	void Configuration::store(std::string filename) {
+
+		// Text never goes to a compiled file, it would be taken for the
+		// source by the next load()
+		if (isBinaryName(filename)) {
+			ConfigBinary::write(*this->tree, filename);
+			return;
+		}
+
+		ConfigReplaceSink sink(filename);
+		ConfigWriter writer(&sink);
+
+		// Only the file the tree has been parsed from can be patched
+		ConfigBufferPtr source = this->tree->getSource();
+
+		if ((source.get() == NULL) || (source->getFilename() != filename) || (!patch(&writer))) {
+			serialize_internal(&writer, this->tree->getRoot());
+		}
+
+		writer.flush();
+		sink.commit();
+
+		if (filename == this->filename) {
+			this->tree->setStored();
+		}
 	}
-};
 
+}
@@ -21,298 +21,367 @@
 #include <string>
 #include <iostream>
 #include <fstream>
-#include <cstdarg>
 #include <sstream>
 #include <string>
+#include <type_traits>
 #include <cstdarg>
 
 #include <boost/algorithm/string.hpp>
 #include <boost/lexical_cast.hpp>
 #include <boost/shared_ptr.hpp>
-#include <boost/any.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/atomic.hpp>
+#include <boost/function.hpp>
+#include <boost/thread/mutex.hpp>
 
 #include "ConfigException.h"
-
-#define CONSUME_PARAMS(path) \
-boost::shared_ptr<std::vector<std::string> > params(new std::vector<std::string>());\
-if (path != NULL) {\
-	va_list ap;\
-	va_start(ap, path);\
-	const char *temp = path;\
-	do { \
-		std::vector<std::string> result; \
-		boost::split(result, temp, boost::is_any_of(".")); \
-		for (size_t i = 0; i < result.size(); i++) { \
-			params->push_back(result[i]); \
-		} \
-	} while ((temp = va_arg(ap, const char *)) != NULL); \
-	va_end(ap); \
-}
+#include "ConfigBuffer.h"
+#include "ConfigBinary.h"
+#include "ConfigTree.h"
+#include "ConfigPath.h"
+#include "ConfigSnapshot.h"
 
 namespace castor {
 
-	class ConfigNode;
-
-	typedef boost::shared_ptr<ConfigNode> ConfigNodePtr;
-
-	class ConfigNode {
+	/**
+	 * A configuration file and its tree. All read access is inherited from
+	 * ConfigSnapshot and refers to the tree of the configuration itself.
+	 *
+	 * load() always parses into a new tree and only replaces the current one
+	 * once parsing succeeded. In snapshot mode (see setSnapshots()) the
+	 * published tree is immutable: other threads take a snapshot() and read
+	 * from it without ever blocking on or seeing a reload, while set() and
+	 * create() work on a private copy that becomes visible with commit().
+	 */
+	class Configuration : public ConfigSnapshot, private boost::noncopyable {
 
 		public:
 
-			typedef enum {
-				Node = 0,
-				Leaf = 1,
-				Comment = 2,
-			} Type;
+			/**
+			 * Called with the new content and the path it subscribed to.
+			 */
+			typedef boost::function<void (const ConfigSnapshot &, const std::string &)> Subscriber;
 
-		protected:
-
-			std::string name;
-			boost::any value;
-			ConfigNode *parent;
-			std::vector<ConfigNodePtr> children;
-			int depth;
-			Type type;
-
-		public:
-
-			ConfigNode(std::string name) :
-				name(name), value(), parent(NULL), children(), depth(0), type(Node)
-			{
-			}
-
-			ConfigNode(Type type, std::string name) :
-				name(name), value(), parent(NULL), children(), depth(0), type(type)
-			{
-			}
-
-			ConfigNode(std::string name, boost::any &value) :
-				name(name), value(value), parent(NULL), children(), depth(0), type(Leaf)
-			{
-			}
-
-			ConfigNode(const ConfigNode &other) :
-				name(other.name), value(other.value), parent(other.parent),
-				children(other.children), depth(other.depth), type(other.type)
-			{
-			}
-
-			~ConfigNode() {
-//				std::cout << "deleting " << this->name << std::endl;
-			}
-
-			ConfigNode *create(std::string name) {
-				this->children.push_back(ConfigNodePtr(new ConfigNode(name)));
-				this->children.back()->setParent(this);
-				return this->children.back().get();
-			}
-
-			ConfigNode *create(Type type, std::string name) {
-				this->children.push_back(ConfigNodePtr(new ConfigNode(type, name)));
-				this->children.back()->setParent(this);
-				return this->children.back().get();
-			}
-
-			ConfigNode *create(std::string name, boost::any &value) {
-				this->children.push_back(ConfigNodePtr(new ConfigNode(name, value)));
-				this->children.back()->setParent(this);
-				return this->children.back().get();
-			}
-
-			std::vector<ConfigNodePtr> *getChildren() {
-				return &this->children;
-			}
-
-			ConfigNode *getParent() {
-				return this->parent;
-			}
-
-			void setParent(ConfigNode *parent) {
-				this->parent = parent;
-				this->depth = parent->depth + 1;
-			}
-
-			const boost::any &getValue() const {
-				return this->value;
-			}
-
-			void setValue(boost::any &value) {
-				this->value = value;
-			}
-
-			const std::string &getName() const {
-				return this->name;
-			}
-
-			int getDepth() const {
-				return this->depth;
-			}
-
-			Type getType() const {
-				return this->type;
-			}
-
-			ConfigNode &operator=(const ConfigNode &other) {
-
-				this->name = other.name;
-				this->value = other.value;
-				this->parent = other.parent;
-				this->children = other.children;
-				this->depth = other.depth;
-				this->type = other.type;
-
-				return *this;
-			}
-	};
-
-	class Configuration {
+			/**
+			 * Runs the given task, e.g. by queueing it for a worker thread.
+			 */
+			typedef boost::function<void (const boost::function<void ()> &)> Executor;
 
 		protected:
 
+			struct Subscription {
+				size_t id;
+				ConfigQuery query;
+				Subscriber subscriber;
+				unsigned long long hash;
+			};
+
 			std::string filename;
 
-			ConfigNodePtr configRoot;
+			ConfigTreePtr published;
+
+			bool snapshots;
+
+			unsigned int indexThreshold;
+
+			unsigned int parseThreads;
+
+			size_t parseMinimum;
+
+			boost::mutex subscriptionsLock;
+			std::vector<Subscription> subscriptions;
+			size_t lastSubscription;
+			Executor executor;
+
+			/**
+			 * A run of source text that ends with a top-level section (or at
+			 * the end of the buffer) and the number of top-level nodes in it.
+			 */
+			struct Chunk {
+				const char *begin;
+				const char *end;
+				int line;
+				unsigned int nodes;
+				unsigned long long hash;
+			};
+
+			/**
+			 * Consecutive chunks parsed into a tree of their own.
+			 */
+			struct Batch {
+				size_t first;
+				size_t last;
+				ConfigTreePtr tree;
+				std::vector<ConfigSymbol> symbols;
+				std::string error;
+			};
+
+			/**
+			 * Splits the given buffer into chunks along the same rules as
+			 * parse().
+			 * @param hash Compute the hashes of the chunks
+			 * @return false if the content is malformed, parse() reports why
+			 */
+			static bool split(const ConfigBuffer &buffer, std::vector<Chunk> *chunks, bool hash);
+
+			static void parse(ConfigTree *tree, const ConfigBuffer &buffer);
+			static void parse(ConfigTree *tree, const ConfigBuffer &buffer, const Chunk &chunk);
+
+			/**
+			 * Parses the chunks of buffer on the given number of threads and
+			 * merges the results into tree in source order.
+			 */
+			static void parse(ConfigTree *tree, const ConfigBuffer &buffer, unsigned int threads);
+			static void parseBatches(const ConfigBuffer *buffer, const std::vector<Chunk> *chunks, std::vector<Batch> *batches, boost::atomic<size_t> *next);
+			static void renumberBatches(std::vector<Batch> *batches, boost::atomic<size_t> *next);
+
+			ConfigTree *edit();
+
+			/**
+			 * Calls the subscribers whose nodes differ from the last time.
+			 */
+			void notify();
+
+			static void dispatch(const ConfigSnapshot &snapshot, const std::vector<Subscription> &subscriptions);
+
+			/**
+			 * Writes the source of the tree with the changes made since it
+			 * was parsed, see store().
+			 * @return false if this is not possible, nothing has been written
+			 */
+			bool patch(ConfigWriter *writer);
 
-			void serialize_internal(std::ostringstream *ss, ConfigNode *node);
+			template<typename T>
+				void assign(T value, const ConfigKey *keys) {
 
-			template<typename Target>
-				Target convert(std::string value) {
+					ConfigTree *tree = edit();
 
-					if (typeid(Target) == typeid(bool)) {
+					std::vector<ConfigNode *> nodes;
 
-						boost::algorithm::to_lower(value);
+					collect(keys, &nodes);
 
-						if (("false" == value) || ("no" == value) || ("0" == value)) {
-							return boost::lexical_cast<Target>(false);
+					for (size_t i = 0; i < nodes.size(); i++) {
+						if (nodes[i]->getType() == ConfigNode::Leaf) {
+							tree->setValue(nodes[i], boost::lexical_cast<std::string>(value));
 						}
-
-						return boost::lexical_cast<Target>(true);
 					}
-
-					printf("Value %s\n", value.c_str());
-
-					return boost::lexical_cast<Target>(value);
 				}
 
-			void collect(ConfigNode *node, std::vector<std::string> *params, size_t offset, std::vector<ConfigNode *> *result);
-			void collectSections(ConfigNode *node, std::vector<std::string> *params, size_t offset, std::vector<ConfigNode *> *result);
-			std::string pathNotFound(std::vector<std::string> *params);
+			void publish();
 
 		public:
 			Configuration();
 			Configuration(std::string filename);
 			Configuration(std::string filename, const std::string content);
 
-			inline void load(std::string filename) { load(filename, boost::shared_ptr<std::ifstream>(new std::ifstream(filename.c_str(), std::ifstream::in)), false, false); }
-
+			/**
+			 * Loads the given file, replacing the current content. The file is
+			 * read into one private buffer and parsed in place, names and values
+			 * refer to that buffer until they are changed using set().
+			 *
+			 * If a compiled version of the file (see ConfigBinary) exists and
+			 * is not older than the file, it is loaded instead. Vice versa, a
+			 * compiled file that is older than its source, or that is not
+			 * compiled at all, is ignored. Either way the configuration
+			 * refers to the source afterwards, store() writes text there.
+			 * @param filename Path of the configuration file or of its
+			 * compiled version
+			 */
+			void load(std::string filename);
+
+			/**
+			 * Loads configuration data from a stream, e.g. content that is only
+			 * available in memory. The stream is read completely before parsing.
+			 * @param replace Discard the current content first
+			 */
 			void load(std::string filename, boost::shared_ptr<std::istream> content, bool create, bool replace);
 
-			void store();
-			void store(std::string filename);
-
-			std::string serialize();
-
-			template<typename T>
-				T get(const char *path, ...) {
-
-					CONSUME_PARAMS(path);
-
-					std::vector<ConfigNode *> nodes;
-					collect(this->configRoot.get(), params.get(), 0, &nodes);
-
-					if (nodes.size() == 0) {
-						throw ConfigException(pathNotFound(params.get()));
-					}
-
-					return convert<T>(boost::any_cast<std::string>(nodes[0]->getValue()));
-				}
-
-			template<typename T>
-				std::vector<T> getAll(const char *path, ...)
-				{
-					CONSUME_PARAMS(path);
-		
-					// Get relevant nodes
-					std::vector<ConfigNode *> nodes;
-					collect(this->configRoot.get(), params.get(), 0, &nodes);
-		
-					// If there are no nodes, exit
-					if (nodes.size() == 0) {
-						throw ConfigException(pathNotFound(params.get()));
-					}
-		
-					// Copy only all values over
-					std::vector<T> result;
-					for (size_t i = 0; i < nodes.size(); i++) {
-						result.push_back(convert<T>(boost::any_cast<std::string>(nodes[i]->getValue())));
-					}
+			/**
+			 * Loads configuration data from a buffer, either text or a
+			 * compiled configuration. Compiled configurations always replace
+			 * the current content.
+			 */
+			void load(std::string filename, ConfigBufferPtr buffer, bool replace);
+
+			/**
+			 * Loads the file of this configuration again. If the current tree
+			 * has not been changed since it was loaded from the file, only the
+			 * top-level sections whose text differs are parsed again, all
+			 * others are copied over.
+			 */
+			void reload();
+
+			/**
+			 * Discards all nodes and releases the memory of the tree at once.
+			 */
+			void clear();
+
+			/**
+			 * Creates a new node below the given parent. Name and value are
+			 * copied into the arena of this configuration.
+			 */
+			ConfigNode *create(ConfigNode *parent, ConfigNode::Type type, const std::string &name, const std::string &value = std::string());
+
+			/**
+			 * Removes the given node and everything below it.
+			 */
+			void remove(ConfigNode *node);
+
+			/**
+			 * Applies the changes of a patch, e.g. one returned by diff(). All
+			 * nodes are looked up before anything is changed, then the removed
+			 * ones are removed. Added nodes are placed after the sibling they
+			 * follow in the new tree, so the order of the children is the
+			 * same as there.
+			 * @throws ConfigException if a node the patch refers to does not
+			 * exist, the configuration is unchanged then
+			 */
+			void apply(const ConfigPatch &patch);
+
+			/**
+			 * Enables the child index for sections with at least the given
+			 * number of children (0 disables it). A lower threshold speeds up
+			 * lookups in more sections at the cost of memory. In snapshot mode
+			 * the setting applies to trees loaded afterwards.
+			 * @see ConfigIndex
+			 */
+			void setIndexThreshold(unsigned int threshold);
+
+			/**
+			 * Enables the per-thread cache of path lookups for this
+			 * configuration and the snapshots taken from it. A repeated
+			 * get() then costs a probe of a table of the calling thread
+			 * instead of resolving the path. Handy for hot paths read from
+			 * many threads, pointless for paths read once.
+			 * @see ConfigCache
+			 */
+			void setThreadCache(bool enabled);
+
+			/**
+			 * Parses files of at least minimumSize bytes on the given number
+			 * of threads. The content is split at top-level sections, so this
+			 * pays off for large files with many of them. 0 uses one thread
+			 * per core, 1 (the default) disables parallel parsing.
+			 */
+			void setParseThreads(unsigned int threads, size_t minimumSize = 1024 * 1024);
+
+			unsigned int getParseThreads() const {
+				return this->parseThreads;
+			}
 
-					return result;
+			/**
+			 * Enables or disables snapshot mode.
+			 */
+			void setSnapshots(bool snapshots);
 
-				}
+			bool getSnapshots() const {
+				return this->snapshots;
+			}
 
-			template<typename T>
-				T tryGet(T d, const char *path, ...) {
+			/**
+			 * Returns the published tree. Safe to call from any thread, also
+			 * while another thread reloads the configuration.
+			 */
+			ConfigSnapshot snapshot() const;
+
+			/**
+			 * Publishes the changes made by set(), create(), remove() and
+			 * apply() in snapshot mode and notifies the subscribers of the
+			 * nodes they changed, in either mode.
+			 */
+			void commit();
+
+			/**
+			 * Calls subscriber whenever the nodes at the given path, or
+			 * anything below them, change. The path may contain wildcards,
+			 * see ConfigQuery.
+			 *
+			 * Subscribers are notified after load(), reload() and clear()
+			 * and by commit(), once per subscription no matter how many of
+			 * its nodes changed. What changed is told by the subtree hashes
+			 * (see ConfigTree::getHash()), so a reload that leaves a
+			 * section as it was does not call its subscribers, and comments
+			 * are ignored.
+			 *
+			 * Subscribers run in the thread that made the change unless an
+			 * executor has been set. They must not change this
+			 * configuration. If one throws, the others are called anyway
+			 * and a ConfigException is thrown afterwards, by the method that
+			 * notified or within the executor.
+			 * @return Id of the subscription for unsubscribe()
+			 */
+			size_t subscribe(const std::string &path, Subscriber subscriber);
+
+			/**
+			 * Removes a subscription. A notification that has already been
+			 * handed to the executor may still call it.
+			 */
+			void unsubscribe(size_t id);
+
+			/**
+			 * Hands each batch of notifications to the given executor as a
+			 * single task, so slow subscribers do not stall the thread that
+			 * loads or commits. An empty executor runs them in place.
+			 */
+			void setExecutor(Executor executor);
+
+			/**
+			 * Writes the configuration to its file.
+			 *
+			 * If the tree has been parsed from the same file, only the
+			 * changes are applied to its text: changed values are replaced
+			 * in place and the top-level sections that got new nodes are
+			 * serialized again, everything else, including formatting and
+			 * comments, is copied over. Other files receive the serialized
+			 * tree, compiled files (ending in .confc) the compiled one.
+			 */
+			void store();
+			void store(std::string filename);
 
-					CONSUME_PARAMS(path);
+			/**
+			 * Returns whether the configuration has been changed since it was
+			 * loaded or stored to its file.
+			 */
+			bool isDirty() const {
+				return this->tree->isDirty();
+			}
 
-					std::vector<ConfigNode *> nodes;
+			/**
+			 * Returns the paths of the nodes changed since the configuration
+			 * was loaded or stored to its file. Changes below a node that got
+			 * or lost children are reported as that node.
+			 */
+			std::vector<std::string> dirtyPaths() const;
 
-					collect(this->configRoot.get(), params.get(), 0, &nodes);
+			template<typename T, typename... Keys>
+				typename std::enable_if<ConfigKeyArguments<Keys...>::valid>::type set(T value, const Keys &... path) {
 
-					if (nodes.size() == 0) {
-						return d;
-					}
+					const ConfigKey keys[] = {ConfigKeyArgument<Keys>::get(path)..., ConfigKey()};
 
-					return convert<T>(boost::any_cast<std::string>(nodes[0]->getValue()));
+					assign(value, keys);
 				}
 
 			template<typename T>
-				boost::shared_ptr<std::vector<T> > tryGetAll(T d, const char *path, ...) {
-
-					CONSUME_PARAMS(path);
-
-					std::vector<ConfigNode *> nodes;
+				CASTOR_SENTINEL void set(T value, const char *path, ...) {
 
-					collect(this->configRoot.get(), params.get(), 0, &nodes);
+					CONSUME_KEYS(path);
 
-					boost::shared_ptr<std::vector<T> > result(new std::vector<T>());
-
-					if (nodes.size() == 0) {
-
-						result->push_back(d);
-
-						return result;
-					}
-
-					for (int i = 0; i < nodes.size(); i++) {
-						result->push_back(convert<T>(boost::any_cast<std::string>(nodes[i]->getValue())));
-					}
-
-					return result;
+					assign(value, &keys[0]);
 				}
 
 			template<typename T>
-				void set(T value, const char *path, ...) {
-
-					CONSUME_PARAMS(path);
+				void set(T value, const ConfigPath &path) {
 
-					std::vector<ConfigNode *> nodes;
+					ConfigTree *tree = edit();
 
-					collect(this->configRoot.get(), params.get(), 0, &nodes);
+					const std::vector<ConfigNode *> &nodes = collect(path);
 
-					for (int i = 0; i < nodes.size(); i++) {
+					for (size_t i = 0; i < nodes.size(); i++) {
 						if (nodes[i]->getType() == ConfigNode::Leaf) {
-							nodes[i]->setValue(value);
+							tree->setValue(nodes[i], boost::lexical_cast<std::string>(value));
 						}
 					}
 				}
-
-			std::vector<std::string> getSections(const char *path, ...);
-			std::vector<std::string> getNames(const char *path, ...);
-
-			std::vector<std::string> tryGetSections(std::string d, const char *path, ...);
-			std::vector<std::string> tryGetNames(std::string d, const char *path, ...);
 	};
 
 };
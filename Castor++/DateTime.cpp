@@ -0,0 +1,642 @@
+/*
+ * $Id$
+ *
+ * Copyright 2008 Carpe Noctem, Distributed Systems Group,
+ * University of Kassel. All right reserved.
+ *
+ * The code is licensed under the Carpe Noctem Userfriendly BSD-Based
+ * License (CNUBBL). Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided that the
+ * conditions of the CNUBBL are met.
+ *
+ * You should have received a copy of the CNUBBL along with this
+ * software. The license is also available on our website:
+ * http://carpenoctem.das-lab.net/license.txt
+ */
+
+#include "DateTime.h"
+#include "Exception.h"
+
+#include <atomic>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#  include <cpuid.h>
+#  include <x86intrin.h>
+#  define CASTOR_DATETIME_TSC 1
+#endif
+
+#ifndef CLOCK_REALTIME_COARSE
+#  define CLOCK_REALTIME_COARSE CLOCK_REALTIME
+#endif
+
+namespace castor {
+
+	// Resync of the Tsc clock, and the span of its first calibration
+	static const long long TSC_RESYNC = DateTime::TicksPerSecond;
+	static const long long TSC_CALIBRATION = DateTime::TicksPerSecond / 500;
+
+	static std::atomic<int> selected(DateTime::Realtime);
+
+	static inline long long ticks(clockid_t id) {
+		struct timespec ts;
+		clock_gettime(id, &ts);
+		return (static_cast<long long>(ts.tv_sec) + EPOCH_ADJUST) * DateTime::TicksPerSecond + ts.tv_nsec / 100;
+	}
+
+	/**
+	 * CLOCK_MONOTONIC is counted from boot; the offset to the wall clock
+	 * is taken once, from the closest of a few readings.
+	 */
+	struct MonotonicClock {
+
+		long long offset;
+
+		MonotonicClock() : offset(0) {
+
+			long long best = -1;
+
+			for (int i = 0; i < 5; i++) {
+
+				long long before = ticks(CLOCK_MONOTONIC);
+				long long now = ticks(CLOCK_REALTIME);
+				long long after = ticks(CLOCK_MONOTONIC);
+
+				if ((best < 0) || (after - before < best)) {
+					best = after - before;
+					this->offset = now - before - (after - before) / 2;
+				}
+			}
+		}
+
+		inline long long read() const {
+			return ticks(CLOCK_MONOTONIC) + this->offset;
+		}
+	};
+
+	static const MonotonicClock &monotonic() {
+		static const MonotonicClock result;
+		return result;
+	}
+
+#ifdef CASTOR_DATETIME_TSC
+
+	static bool invariant() {
+
+		unsigned int a, b, c, d;
+
+		// Bit 8 of EDX in leaf 0x80000007: the counter runs at a constant
+		// rate in all power states
+		if (!__get_cpuid(0x80000007, &a, &b, &c, &d)) return false;
+
+		return (d & (1U << 8)) != 0;
+	}
+
+	/**
+	 * ticks = base + (counter - cycles) * scale / 2^32, with cycles and
+	 * base a pair of readings of the counter and CLOCK_REALTIME.
+	 *
+	 * Readers take the three values under a sequence lock. The first
+	 * reader past the resync takes a new pair and the scale over the
+	 * second since the last one; others read CLOCK_REALTIME meanwhile.
+	 */
+	class TscClock {
+
+		protected:
+
+			std::atomic<unsigned int> sequence;
+			std::atomic<unsigned long long> cycles;
+			std::atomic<long long> base;
+			std::atomic<unsigned long long> scale;
+			std::atomic<long long> resync;
+			std::atomic<bool> syncing;
+
+			/**
+			 * Reads the counter and CLOCK_REALTIME close together: the
+			 * closest of a few readings, the counter taken in the middle.
+			 */
+			static void sample(unsigned long long &cycles, long long &ticks) {
+
+				unsigned long long best = ~0ULL;
+
+				cycles = 0;
+				ticks = 0;
+
+				for (int i = 0; i < 3; i++) {
+
+					unsigned long long before = __rdtsc();
+					long long now = castor::ticks(CLOCK_REALTIME);
+					unsigned long long after = __rdtsc();
+
+					if (after - before < best) {
+						best = after - before;
+						cycles = before + best / 2;
+						ticks = now;
+					}
+				}
+			}
+
+			static unsigned long long rate(unsigned long long cycles, long long ticks) {
+				return static_cast<unsigned long long>((static_cast<unsigned __int128>(ticks) << 32) / cycles);
+			}
+
+			void publish(unsigned long long cycles, long long ticks, unsigned long long scale) {
+
+				unsigned int s = this->sequence.load(std::memory_order_relaxed);
+
+				this->sequence.store(s + 1, std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_release);
+
+				this->cycles.store(cycles, std::memory_order_relaxed);
+				this->base.store(ticks, std::memory_order_relaxed);
+				this->scale.store(scale, std::memory_order_relaxed);
+
+				// TSC_RESYNC in cycles
+				this->resync.store(static_cast<long long>((static_cast<unsigned __int128>(TSC_RESYNC) << 32) / scale),
+					std::memory_order_relaxed);
+
+				this->sequence.store(s + 2, std::memory_order_release);
+			}
+
+			long long synchronize() {
+
+				unsigned long long c;
+				long long t;
+
+				sample(c, t);
+
+				unsigned long long previous = this->cycles.load(std::memory_order_relaxed);
+				long long elapsed = t - this->base.load(std::memory_order_relaxed);
+				unsigned long long scale = this->scale.load(std::memory_order_relaxed);
+
+				// Keep the scale when the wall clock was set meanwhile
+				if ((c > previous) && (elapsed > 0)) {
+
+					unsigned long long measured = rate(c - previous, elapsed);
+
+					if ((measured > scale - scale / 1024) && (measured < scale + scale / 1024)) {
+						scale = measured;
+					}
+				}
+
+				this->publish(c, t, scale);
+
+				return t;
+			}
+
+		public:
+
+			TscClock() :
+				sequence(0), cycles(0), base(0), scale(0), resync(0), syncing(false)
+			{
+				unsigned long long first, last;
+				long long start, now;
+
+				// Again if the wall clock was set meanwhile
+				do {
+					sample(first, start);
+
+					do {
+						sample(last, now);
+					} while ((now >= start) && (now - start < TSC_CALIBRATION));
+				} while ((now < start) || (now - start > 2 * TSC_CALIBRATION) || (last <= first));
+
+				this->publish(last, now, rate(last - first, now - start));
+			}
+
+			long long read() {
+
+				unsigned long long counter = __rdtsc();
+				unsigned long long cycles, scale;
+				long long base, resync;
+				unsigned int s;
+
+				do {
+					s = this->sequence.load(std::memory_order_acquire);
+
+					cycles = this->cycles.load(std::memory_order_relaxed);
+					base = this->base.load(std::memory_order_relaxed);
+					scale = this->scale.load(std::memory_order_relaxed);
+					resync = this->resync.load(std::memory_order_relaxed);
+
+					std::atomic_thread_fence(std::memory_order_acquire);
+				} while ((s & 1) || (s != this->sequence.load(std::memory_order_relaxed)));
+
+				// Counters of other cores may be a few cycles behind
+				long long delta = static_cast<long long>(counter - cycles);
+
+				if (delta < 0) delta = 0;
+
+				if (delta < resync) {
+					return base + static_cast<long long>((static_cast<unsigned __int128>(delta) * scale) >> 32);
+				}
+
+				if (this->syncing.exchange(true, std::memory_order_acquire)) {
+					return ticks(CLOCK_REALTIME);
+				}
+
+				long long result = this->synchronize();
+
+				this->syncing.store(false, std::memory_order_release);
+
+				return result;
+			}
+	};
+
+	static TscClock &tsc() {
+		static TscClock result;
+		return result;
+	}
+
+#endif /* CASTOR_DATETIME_TSC */
+
+	bool DateTime::isTscAvailable() {
+#ifdef CASTOR_DATETIME_TSC
+		static const bool result = invariant();
+		return result;
+#else
+		return false;
+#endif
+	}
+
+	static inline long long now(DateTime::Clock clock) {
+
+		switch (clock) {
+			case DateTime::Monotonic:
+				return monotonic().read();
+			case DateTime::Coarse:
+				return ticks(CLOCK_REALTIME_COARSE);
+#ifdef CASTOR_DATETIME_TSC
+			case DateTime::Tsc:
+				if (DateTime::isTscAvailable()) return tsc().read();
+				return ticks(CLOCK_REALTIME);
+#endif
+			default:
+				return ticks(CLOCK_REALTIME);
+		}
+	}
+
+	DateTime DateTime::getUtcNow() {
+		return DateTime(now(static_cast<Clock>(selected.load(std::memory_order_relaxed))));
+	}
+
+	unsigned long long DateTime::getUtcNowC() {
+		return static_cast<unsigned long long>(now(static_cast<Clock>(selected.load(std::memory_order_relaxed))));
+	}
+
+	DateTime DateTime::getUtcNow(Clock clock) {
+		return DateTime(now(clock));
+	}
+
+	DateTime::Clock DateTime::getClock() {
+		return static_cast<Clock>(selected.load(std::memory_order_relaxed));
+	}
+
+	DateTime::Clock DateTime::setClock(Clock clock) {
+
+		if ((clock < Realtime) || (clock > Tsc) || ((clock == Tsc) && !isTscAvailable())) {
+			clock = Realtime;
+		}
+
+		// Take the offset or calibrate now rather than on the first read
+		if (clock == Monotonic) monotonic();
+#ifdef CASTOR_DATETIME_TSC
+		if (clock == Tsc) tsc();
+#endif
+
+		selected.store(clock, std::memory_order_relaxed);
+
+		return clock;
+	}
+
+	// Days from 0000-03-01 to 0001-01-01
+	static const long long DAYS_FROM_MARCH = 306;
+
+	static const long long SCALE[] = { 10000000, 1000000, 100000, 10000, 1000, 100, 10, 1 };
+
+	static inline long long floorDiv(long long value, long long unit) {
+		long long result = value / unit;
+		return result - ((value % unit) < 0 ? 1 : 0);
+	}
+
+	static inline bool isLeap(long long year) {
+		return ((year % 4) == 0) && (((year % 100) != 0) || ((year % 400) == 0));
+	}
+
+	static inline int daysInMonth(long long year, int month) {
+		static const int days[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+		return days[month - 1] + ((month == 2) && isLeap(year) ? 1 : 0);
+	}
+
+	/**
+	 * Days since 0001-01-01 of a date in the proleptic Gregorian calendar,
+	 * counted in eras of 400 years from March, so February comes last.
+	 */
+	static long long toDays(long long year, int month, long long day) {
+
+		year -= (month <= 2) ? 1 : 0;
+
+		long long era = floorDiv(year, 400);
+		long long yoe = year - era * 400;
+		long long doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5;
+
+		return era * 146097 + yoe * 365 + yoe / 4 - yoe / 100 + doy + day - 1 - DAYS_FROM_MARCH;
+	}
+
+	static void fromDays(long long days, long long *year, int *month, int *day) {
+
+		days += DAYS_FROM_MARCH;
+
+		long long era = floorDiv(days, 146097);
+		long long doe = days - era * 146097;
+		long long yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+		long long doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+		long long mp = (5 * doy + 2) / 153;
+
+		*day = static_cast<int>(doy - (153 * mp + 2) / 5 + 1);
+		*month = static_cast<int>(mp < 10 ? mp + 3 : mp - 9);
+		*year = yoe + era * 400 + ((*month <= 2) ? 1 : 0);
+	}
+
+	static inline void digits2(char *p, unsigned int value) {
+		p[0] = static_cast<char>('0' + value / 10);
+		p[1] = static_cast<char>('0' + value % 10);
+	}
+
+	static inline void digits4(char *p, unsigned int value) {
+		digits2(p, value / 100);
+		digits2(p + 2, value % 100);
+	}
+
+	/**
+	 * The date and second last formatted by this thread, in both formats.
+	 * Within a second only the fraction is written.
+	 */
+	struct DateTimePrefix {
+		long long day;
+		long long second;
+		char iso[19];
+		char compact[15];
+	};
+
+	static thread_local DateTimePrefix prefix = { -1, -1, { 0 }, { 0 } };
+
+	static inline const DateTimePrefix &lookup(long long ticks) {
+
+		DateTimePrefix &p = prefix;
+		long long second = ticks / DateTime::TicksPerSecond;
+
+		if (second == p.second) {
+			return p;
+		}
+
+		long long day = second / 86400;
+
+		if (day != p.day) {
+
+			long long year;
+			int month, d;
+
+			fromDays(day, &year, &month, &d);
+
+			digits4(p.iso, static_cast<unsigned int>(year));
+			p.iso[4] = '-';
+			digits2(p.iso + 5, month);
+			p.iso[7] = '-';
+			digits2(p.iso + 8, d);
+			p.iso[10] = 'T';
+
+			memcpy(p.compact, p.iso, 4);
+			memcpy(p.compact + 4, p.iso + 5, 2);
+			memcpy(p.compact + 6, p.iso + 8, 3);
+
+			p.day = day;
+		}
+
+		unsigned int s = static_cast<unsigned int>(second - day * 86400);
+
+		digits2(p.iso + 11, s / 3600);
+		p.iso[13] = ':';
+		digits2(p.iso + 14, (s / 60) % 60);
+		p.iso[16] = ':';
+		digits2(p.iso + 17, s % 60);
+
+		memcpy(p.compact + 9, p.iso + 11, 2);
+		memcpy(p.compact + 11, p.iso + 14, 2);
+		memcpy(p.compact + 13, p.iso + 17, 2);
+
+		p.second = second;
+
+		return p;
+	}
+
+	static size_t format(long long ticks, char *buffer, size_t size, int digits, bool compact) {
+
+		digits = (digits < 0) ? 0 : ((digits > 7) ? 7 : digits);
+
+		size_t length = (compact ? 15 : 19) + (digits > 0 ? digits + 1 : 0) + 1;
+
+		if ((size <= length) || (ticks < 0) || (ticks > DateTime::MaxTicks)) {
+			if (size > 0) buffer[0] = '\0';
+			return 0;
+		}
+
+		const DateTimePrefix &p = lookup(ticks);
+		char *q = buffer;
+
+		if (compact) {
+			memcpy(q, p.compact, 15);
+			q += 15;
+		} else {
+			memcpy(q, p.iso, 19);
+			q += 19;
+		}
+
+		if (digits > 0) {
+
+			unsigned int fraction = static_cast<unsigned int>((ticks % DateTime::TicksPerSecond) / SCALE[digits]);
+
+			*q = '.';
+
+			for (int i = digits; i > 0; i--) {
+				q[i] = static_cast<char>('0' + fraction % 10);
+				fraction /= 10;
+			}
+
+			q += digits + 1;
+		}
+
+		q[0] = 'Z';
+		q[1] = '\0';
+
+		return length;
+	}
+
+	/**
+	 * Reads count decimal digits.
+	 */
+	static inline bool number(const char *&p, const char *end, int count, int *result) {
+
+		if (end - p < count) return false;
+
+		int value = 0;
+
+		for (int i = 0; i < count; i++) {
+
+			unsigned int digit = static_cast<unsigned int>(p[i] - '0');
+
+			if (digit > 9) return false;
+
+			value = value * 10 + static_cast<int>(digit);
+		}
+
+		p += count;
+		*result = value;
+
+		return true;
+	}
+
+	static inline bool separator(const char *&p, const char *end, bool extended, char c) {
+
+		if (!extended) return true;
+		if ((p == end) || (*p != c)) return false;
+
+		p++;
+
+		return true;
+	}
+
+	DateTime DateTime::fromCalendar(int year, int month, int day, int hour, int minute, int second, long long ticks) {
+
+		long long months = static_cast<long long>(year) * 12 + month - 1;
+		long long y = floorDiv(months, 12);
+		int m = static_cast<int>(months - y * 12) + 1;
+
+		long long seconds = static_cast<long long>(hour) * 3600 + static_cast<long long>(minute) * 60 + second;
+
+		return DateTime(toDays(y, m, day) * TicksPerDay + seconds * TicksPerSecond + ticks);
+	}
+
+	void DateTime::getCalendar(int *year, int *month, int *day, int *hour, int *minute, int *second,
+		long long *fraction) const
+	{
+		long long days = floorDiv(this->ticks, TicksPerDay);
+		long long rest = this->ticks - days * TicksPerDay;
+		long long y;
+		int m, d;
+
+		fromDays(days, &y, &m, &d);
+
+		if (year != NULL) *year = static_cast<int>(y);
+		if (month != NULL) *month = m;
+		if (day != NULL) *day = d;
+		if (hour != NULL) *hour = static_cast<int>(rest / TicksPerHour);
+		if (minute != NULL) *minute = static_cast<int>((rest / TicksPerMinute) % 60);
+		if (second != NULL) *second = static_cast<int>((rest / TicksPerSecond) % 60);
+		if (fraction != NULL) *fraction = rest % TicksPerSecond;
+	}
+
+	DateTime DateTime::addMonths(int months) const {
+
+		long long days = floorDiv(this->ticks, TicksPerDay);
+		long long rest = this->ticks - days * TicksPerDay;
+		long long y;
+		int m, d;
+
+		fromDays(days, &y, &m, &d);
+
+		long long total = y * 12 + m - 1 + months;
+
+		y = floorDiv(total, 12);
+		m = static_cast<int>(total - y * 12) + 1;
+
+		if (d > daysInMonth(y, m)) d = daysInMonth(y, m);
+
+		return DateTime(toDays(y, m, d) * TicksPerDay + rest);
+	}
+
+	DateTime DateTime::truncate(long long unit) const {
+
+		if (unit <= 0) {
+			throw Exception("Invalid unit for truncate: %lld!", unit);
+		}
+
+		long long rest = this->ticks % unit;
+
+		return DateTime(this->ticks - rest - (rest < 0 ? unit : 0));
+	}
+
+	size_t DateTime::formatIso(char *buffer, size_t size, int digits) const {
+		return format(this->ticks, buffer, size, digits, false);
+	}
+
+	size_t DateTime::formatCompact(char *buffer, size_t size, int digits) const {
+		return format(this->ticks, buffer, size, digits, true);
+	}
+
+	bool DateTime::parse(const char *data, size_t size, DateTime *result) {
+
+		const char *p = data;
+		const char *end = data + size;
+		int year, month, day, hour = 0, minute = 0, second = 0;
+		long long fraction = 0, offset = 0;
+
+		if (!number(p, end, 4, &year)) return false;
+
+		bool extended = (p != end) && (*p == '-');
+
+		if (!separator(p, end, extended, '-') || !number(p, end, 2, &month)) return false;
+		if (!separator(p, end, extended, '-') || !number(p, end, 2, &day)) return false;
+
+		if ((month < 1) || (month > 12) || (day < 1) || (day > daysInMonth(year, month)) || (year < 1)) return false;
+
+		if ((p != end) && ((*p == 'T') || (*p == ' '))) {
+
+			p++;
+
+			if (!number(p, end, 2, &hour)) return false;
+			if (!separator(p, end, extended, ':') || !number(p, end, 2, &minute)) return false;
+			if (!separator(p, end, extended, ':') || !number(p, end, 2, &second)) return false;
+
+			if ((hour > 23) || (minute > 59) || (second > 59)) return false;
+
+			if ((p != end) && ((*p == '.') || (*p == ','))) {
+
+				int count = 0;
+
+				for (p++; (p != end) && (static_cast<unsigned int>(*p - '0') <= 9); p++, count++) {
+					if (count < 7) fraction = fraction * 10 + (*p - '0');
+				}
+
+				if (count == 0) return false;
+				if (count < 7) fraction *= SCALE[count];
+			}
+
+			if ((p != end) && (*p == 'Z')) {
+				p++;
+			} else if ((p != end) && ((*p == '+') || (*p == '-'))) {
+
+				int sign = (*p++ == '-') ? -1 : 1;
+				int hours, minutes = 0;
+
+				if (!number(p, end, 2, &hours)) return false;
+
+				if (p != end) {
+					if (*p == ':') p++;
+					if (!number(p, end, 2, &minutes)) return false;
+				}
+
+				if ((hours > 23) || (minutes > 59)) return false;
+
+				offset = sign * (hours * TicksPerHour + minutes * TicksPerMinute);
+			}
+		}
+
+		if (p != end) return false;
+
+		*result = DateTime(toDays(year, month, day) * TicksPerDay + hour * TicksPerHour + minute * TicksPerMinute
+			+ second * TicksPerSecond + fraction - offset);
+
+		return true;
+	}
+}
@@ -3,11 +3,12 @@
 
 #include <sys/time.h>
 #include <time.h>
+#include <stddef.h>
 
 #define EPOCH_ADJUST (62135596800LL)
 
 namespace castor {
-	
+
 	struct DateTime {
 
 		protected:
@@ -16,6 +17,59 @@ namespace castor {
 
 		public:
 
+			/**
+			 * Sources of getUtcNow(). All of them give ticks of 100 ns since
+			 * 0001-01-01 UTC.
+			 */
+			typedef enum {
+				/**
+				 * CLOCK_REALTIME, the wall clock at full resolution. Steps
+				 * when the system time is set.
+				 */
+				Realtime = 0,
+
+				/**
+				 * CLOCK_MONOTONIC plus the offset to CLOCK_REALTIME taken on
+				 * first use. Never goes back, but does not follow later
+				 * changes of the system time.
+				 */
+				Monotonic = 1,
+
+				/**
+				 * CLOCK_REALTIME_COARSE, the wall clock as of the last timer
+				 * interrupt: the cheapest, with a resolution of some ms.
+				 */
+				Coarse = 2,
+
+				/**
+				 * The time stamp counter of the CPU, scaled to ticks and
+				 * synchronized with CLOCK_REALTIME every second. It may step
+				 * by the drift of that second on a resync. Only available
+				 * where the counter runs at a constant rate, see setClock().
+				 */
+				Tsc = 3,
+			} Clock;
+
+			static const long long TicksPerMillisecond = 10000LL;
+			static const long long TicksPerSecond = 10000000LL;
+			static const long long TicksPerMinute = 60 * TicksPerSecond;
+			static const long long TicksPerHour = 60 * TicksPerMinute;
+			static const long long TicksPerDay = 24 * TicksPerHour;
+
+			/**
+			 * The last tick of 9999-12-31, the end of the range that can be
+			 * formatted and parsed.
+			 */
+			static const long long MaxTicks = 3652059 * TicksPerDay - 1;
+
+			/**
+			 * Buffer sizes for all digits of the fraction and the
+			 * terminating zero: 0001-01-01T00:00:00.0000000Z and
+			 * 00010101T000000.0000000Z
+			 */
+			static const size_t IsoLength = 29;
+			static const size_t CompactLength = 25;
+
 			/**
 			 * Initialize structure using a time value in 100 ns resolution
 			 * @param ticks Tocks (100 ns resolution
@@ -28,25 +82,135 @@ namespace castor {
 			{
 			}
 
-			static inline DateTime getUtcNow() {
-				struct timeval tv;
-				memset(&tv, 0, sizeof(tv));
-				gettimeofday(&tv, NULL);
-				return DateTime(((static_cast<unsigned long long>(tv.tv_sec) + EPOCH_ADJUST) * 1000000 + tv.tv_usec) * 10);
+			/**
+			 * Returns the current time of the clock selected by setClock().
+			 */
+			static DateTime getUtcNow();
+
+			static unsigned long long getUtcNowC();
+
+			/**
+			 * Returns the current time of the given clock. Tsc falls back to
+			 * Realtime where it is not available.
+			 */
+			static DateTime getUtcNow(Clock clock);
+
+			/**
+			 * Returns the clock getUtcNow() reads, Realtime by default.
+			 */
+			static Clock getClock();
+
+			/**
+			 * Selects the clock getUtcNow() reads for all threads. Tsc
+			 * requires an invariant time stamp counter, otherwise Realtime
+			 * is selected instead.
+			 * @return The clock selected
+			 */
+			static Clock setClock(Clock clock);
+
+			/**
+			 * Returns whether the Tsc clock is available on this CPU.
+			 */
+			static bool isTscAvailable();
+
+			inline long long getTicks() const {
+				return this->ticks;
+			}
+
+			/**
+			 * Returns the time of the given date and time of day. Values out
+			 * of range carry over, e.g. month 13 is January of the next year.
+			 */
+			static DateTime fromCalendar(int year, int month, int day, int hour = 0, int minute = 0, int second = 0,
+				long long ticks = 0);
+
+			/**
+			 * Splits the time into its date and time of day. Any pointer may
+			 * be NULL; fraction receives the ticks within the second.
+			 */
+			void getCalendar(int *year, int *month, int *day, int *hour = NULL, int *minute = NULL,
+				int *second = NULL, long long *fraction = NULL) const;
+
+			inline DateTime add(long long ticks) const {
+				return DateTime(this->ticks + ticks);
+			}
+
+			/**
+			 * Adds calendar months, keeping the time of day. The day is
+			 * limited to the length of the resulting month, so a month after
+			 * 01-31 is 02-28 or 02-29.
+			 */
+			DateTime addMonths(int months) const;
+
+			inline DateTime addYears(int years) const {
+				return this->addMonths(12 * years);
 			}
 
-			static inline unsigned long long getUtcNowC() {
-				struct timeval tv;
-				memset(&tv, 0, sizeof(tv));
-				gettimeofday(&tv, NULL);
-				return (((static_cast<unsigned long long>(tv.tv_sec) + EPOCH_ADJUST) * 1000000 + tv.tv_usec) * 10);
+			/**
+			 * Returns this - other in ticks.
+			 */
+			inline long long diff(const DateTime &other) const {
+				return this->ticks - other.ticks;
 			}
 
-			inline long long getTicks() {
-				return this->ticks;
+			/**
+			 * Rounds down to a multiple of unit ticks, e.g. TicksPerSecond or
+			 * TicksPerDay. As 0001-01-01 was a Monday, 7 * TicksPerDay gives
+			 * the start of the ISO week.
+			 * @throws Exception if unit is not positive
+			 */
+			DateTime truncate(long long unit) const;
+
+			/**
+			 * Writes the time as ISO 8601 in UTC, 2009-06-15T13:45:30.1234567Z,
+			 * with `digits` (0 to 7) digits of the fraction, truncated, and a
+			 * terminating zero. Does not allocate; the date and second are
+			 * taken from a per-thread cache of the last second formatted.
+			 * @return The length without the terminating zero, or 0 if the
+			 * buffer is too small or the time is before 0001-01-01 or after
+			 * MaxTicks
+			 */
+			size_t formatIso(char *buffer, size_t size, int digits = 7) const;
+
+			/**
+			 * Like formatIso(), in the basic format of ISO 8601 without
+			 * separators in the date and time: 20090615T134530.1234567Z
+			 */
+			size_t formatCompact(char *buffer, size_t size, int digits = 7) const;
+
+			/**
+			 * Parses both formats of formatIso() and formatCompact(), with any
+			 * number of digits of the fraction (digits past 7 are truncated),
+			 * a space instead of the T, and a zone of Z, +hh:mm, +hhmm or +hh,
+			 * or none for UTC. A date alone is midnight.
+			 * @return false if data is not such a time
+			 */
+			static bool parse(const char *data, size_t size, DateTime *result);
+
+			inline bool operator == (const DateTime &other) const {
+				return this->ticks == other.ticks;
+			}
+
+			inline bool operator != (const DateTime &other) const {
+				return this->ticks != other.ticks;
+			}
+
+			inline bool operator < (const DateTime &other) const {
+				return this->ticks < other.ticks;
+			}
+
+			inline bool operator <= (const DateTime &other) const {
+				return this->ticks <= other.ticks;
+			}
+
+			inline bool operator > (const DateTime &other) const {
+				return this->ticks > other.ticks;
+			}
+
+			inline bool operator >= (const DateTime &other) const {
+				return this->ticks >= other.ticks;
 			}
 	};
 }
 
 #endif /* CASTOR_DATETIME_H */
-
@@ -27,159 +27,306 @@ OTHER DEALINGS IN THE SOFTWARE.
 
 namespace castor {
 
-class fixed {
+/*
+ * Q-format fixed point numbers: a sign bit, IntBits bits left and FracBits
+ * bits right of the binary point, in 32 or 64 bits. Fixed is Q15.16.
+ *
+ * Everything is constexpr. Products and quotients are computed in the
+ * next wider integer, chosen at compile time by FixedStorage. What happens
+ * on overflow and to the bits right of the result is up to the policies:
+ *
+ *   FixedWrap       results wrap around like those of unsigned int, values
+ *                   converted from out of range floats become the smallest
+ *                   number as with the conversion instructions of x86
+ *   FixedSaturate   results are clamped to the range, dividing by zero
+ *                   gives the end of the range of the dividend's sign
+ *
+ *   FixedTruncate   results are rounded down, like the arithmetic shift,
+ *                   floats toward zero like a cast
+ *   FixedRound      results are rounded to nearest, ties away from zero
+ */
+
+template <int Bits> struct FixedStorage;
+
+template <> struct FixedStorage<32> {
+	typedef int Type;
+	typedef unsigned int Unsigned;
+	typedef long long Wide;
+};
 
-private:
+template <> struct FixedStorage<64> {
+	typedef long long Type;
+	typedef unsigned long long Unsigned;
+	typedef __int128 Wide;
+};
 
-	int	g; // the guts
+template <typename S> struct FixedLimits {
+	static constexpr typename S::Type max = static_cast<typename S::Type>(~static_cast<typename S::Unsigned>(0) >> 1);
+	static constexpr typename S::Type min = -max - 1;
+	// 2^(Bits - 1)
+	static constexpr double range = static_cast<double>(static_cast<typename S::Unsigned>(1) << (sizeof(typename S::Type) * 8 - 1));
+};
 
-const static int BP = 16;  // how many low bits are right of Binary Point
-const static int BP2 = BP * 2;  // how many low bits are right of Binary Point
-const static int BPhalf = BP / 2;  // how many low bits are right of Binary Point
-const static int STEP = 1.0 / (1<<BP); // smallest STEP we can represent
+struct FixedWrap {
 
-	// for private construction via guts
-	enum FixedRaw { RAW };
-	Fixed(FixedRaw, int guts) : g(guts) {}
+	static const bool saturating = false;
 
+	template <typename S, typename W> static constexpr typename S::Type narrow(W value) {
+		return static_cast<typename S::Type>(static_cast<typename S::Unsigned>(value));
+	}
 
-public:
-	Fixed() : g(0) {}
-	Fixed(const Fixed& a) : g( a.g ) {}
-	Fixed(float a) : g( int(a / (float)STEP) ) {}
-	Fixed(double a) : g( int(a / (double)STEP) ) {}
-	Fixed(int a) : g( a << BP ) {}
-	Fixed(long a) : g( a << BP ) {}
-	Fixed& operator =(const Fixed& a) { g= a.g; return *this; }
-	Fixed& operator =(float a) { g= Fixed(a).g; return *this; }
-	Fixed& operator =(double a) { g= Fixed(a).g; return *this; }
-	Fixed& operator =(int a) { g= Fixed(a).g; return *this; }
-	Fixed& operator =(long a) { g= Fixed(a).g; return *this; }
-
-	operator float() { return g * (float)STEP; }
-	operator double() { return g * (double)STEP; }
-	operator int() { return g>>BP; }
-	operator long() { return g>>BP; }
-
-	Fixed operator +() const { return Fixed(RAW,g); }
-	Fixed operator -() const { return Fixed(RAW,-g); }
-
-	Fixed operator +(const Fixed& a) const { return Fixed(RAW, g + a.g); }
-	Fixed operator -(const Fixed& a) const { return Fixed(RAW, g - a.g); }
-#if 1
-	// more acurate, using long long
-	Fixed operator *(const Fixed& a) const { return Fixed(RAW,  (int)( ((long long)g * (long long)a.g ) >> BP)); }
-#else
-	// faster, but with only half as many bits right of binary point
-	Fixed operator *(const Fixed& a) const { return Fixed(RAW, (g>>BPhalf) * (a.g>>BPhalf) ); }
-#endif
-	Fixed operator /(const Fixed& a) const { return Fixed(RAW, int( (((long long)g << BP2) / (long long)(a.g)) >> BP) ); }
-
-	Fixed operator +(float a) const { return Fixed(RAW, g + Fixed(a).g); }
-	Fixed operator -(float a) const { return Fixed(RAW, g - Fixed(a).g); }
-	Fixed operator *(float a) const { return Fixed(RAW, (g>>BPhalf) * (Fixed(a).g>>BPhalf) ); }
-	Fixed operator /(float a) const { return Fixed(RAW, int( (((long long)g << BP2) / (long long)(Fixed(a).g)) >> BP) ); }
-
-	Fixed operator +(double a) const { return Fixed(RAW, g + Fixed(a).g); }
-	Fixed operator -(double a) const { return Fixed(RAW, g - Fixed(a).g); }
-	Fixed operator *(double a) const { return Fixed(RAW, (g>>BPhalf) * (Fixed(a).g>>BPhalf) ); }
-	Fixed operator /(double a) const { return Fixed(RAW, int( (((long long)g << BP2) / (long long)(Fixed(a).g)) >> BP) ); }
-
-	Fixed& operator +=(Fixed a) { return *this = *this + a; return *this; }
-	Fixed& operator -=(Fixed a) { return *this = *this - a; return *this; }
-	Fixed& operator *=(Fixed a) { return *this = *this * a; return *this; }
-	Fixed& operator /=(Fixed a) { return *this = *this / a; return *this; }
-
-	Fixed& operator +=(int a) { return *this = *this + (Fixed)a; return *this; }
-	Fixed& operator -=(int a) { return *this = *this - (Fixed)a; return *this; }
-	Fixed& operator *=(int a) { return *this = *this * (Fixed)a; return *this; }
-	Fixed& operator /=(int a) { return *this = *this / (Fixed)a; return *this; }
-
-	Fixed& operator +=(long a) { return *this = *this + (Fixed)a; return *this; }
-	Fixed& operator -=(long a) { return *this = *this - (Fixed)a; return *this; }
-	Fixed& operator *=(long a) { return *this = *this * (Fixed)a; return *this; }
-	Fixed& operator /=(long a) { return *this = *this / (Fixed)a; return *this; }
-
-	Fixed& operator +=(float a) { return *this = *this + a; return *this; }
-	Fixed& operator -=(float a) { return *this = *this - a; return *this; }
-	Fixed& operator *=(float a) { return *this = *this * a; return *this; }
-	Fixed& operator /=(float a) { return *this = *this / a; return *this; }
-
-	Fixed& operator +=(double a) { return *this = *this + a; return *this; }
-	Fixed& operator -=(double a) { return *this = *this - a; return *this; }
-	Fixed& operator *=(double a) { return *this = *this * a; return *this; }
-	Fixed& operator /=(double a) { return *this = *this / a; return *this; }
-
-	bool operator ==(const Fixed& a) const { return g == a.g; }
-	bool operator !=(const Fixed& a) const { return g != a.g; }
-	bool operator <=(const Fixed& a) const { return g <= a.g; }
-	bool operator >=(const Fixed& a) const { return g >= a.g; }
-	bool operator  <(const Fixed& a) const { return g  < a.g; }
-	bool operator  >(const Fixed& a) const { return g  > a.g; }
-
-	bool operator ==(float a) const { return g == Fixed(a).g; }
-	bool operator !=(float a) const { return g != Fixed(a).g; }
-	bool operator <=(float a) const { return g <= Fixed(a).g; }
-	bool operator >=(float a) const { return g >= Fixed(a).g; }
-	bool operator  <(float a) const { return g  < Fixed(a).g; }
-	bool operator  >(float a) const { return g  > Fixed(a).g; }
-
-	bool operator ==(double a) const { return g == Fixed(a).g; }
-	bool operator !=(double a) const { return g != Fixed(a).g; }
-	bool operator <=(double a) const { return g <= Fixed(a).g; }
-	bool operator >=(double a) const { return g >= Fixed(a).g; }
-	bool operator  <(double a) const { return g  < Fixed(a).g; }
-	bool operator  >(double a) const { return g  > Fixed(a).g; }
+	template <typename S> static constexpr typename S::Type integer(long long value, int bits) {
+		return static_cast<typename S::Type>(static_cast<typename S::Unsigned>(static_cast<unsigned long long>(value) << bits));
+	}
+
+	// value has no bits right of the point that matter any more
+	template <typename S> static constexpr typename S::Type floating(double value) {
+		return ((value > -FixedLimits<S>::range - 1.0) && (value < FixedLimits<S>::range)) ?
+			static_cast<typename S::Type>(value) : FixedLimits<S>::min;
+	}
+};
+
+struct FixedSaturate {
+
+	static const bool saturating = true;
+
+	template <typename S, typename W> static constexpr typename S::Type narrow(W value) {
+		return (value > FixedLimits<S>::max) ? FixedLimits<S>::max :
+			(value < FixedLimits<S>::min) ? FixedLimits<S>::min : static_cast<typename S::Type>(value);
+	}
+
+	template <typename S> static constexpr typename S::Type integer(long long value, int bits) {
+		return (value > (FixedLimits<S>::max >> bits)) ? FixedLimits<S>::max :
+			(value < (FixedLimits<S>::min >> bits)) ? FixedLimits<S>::min :
+			static_cast<typename S::Type>(static_cast<typename S::Wide>(value) * (static_cast<typename S::Wide>(1) << bits));
+	}
+
+	template <typename S> static constexpr typename S::Type floating(double value) {
+		return (value != value) ? 0 : (value >= FixedLimits<S>::range) ? FixedLimits<S>::max :
+			(value <= -FixedLimits<S>::range - 1.0) ? FixedLimits<S>::min : static_cast<typename S::Type>(value);
+	}
+};
+
+struct FixedTruncate {
+
+	template <typename W> static constexpr W shift(W value, int bits) {
+		return value >> bits;
+	}
+
+	template <typename W> static constexpr W divide(W dividend, W divisor) {
+		return dividend / divisor - (((dividend % divisor) != 0) && ((dividend < 0) != (divisor < 0)) ? 1 : 0);
+	}
+
+	static constexpr double integral(double value) {
+		return value;
+	}
 };
 
-inline Fixed operator +(float a, const Fixed& b) { return Fixed(a)+b; }
-inline Fixed operator -(float a, const Fixed& b) { return Fixed(a)-b; }
-inline Fixed operator *(float a, const Fixed& b) { return Fixed(a)*b; }
-inline Fixed operator /(float a, const Fixed& b) { return Fixed(a)/b; }
+struct FixedRound {
 
-inline bool operator ==(float a, const Fixed& b) { return Fixed(a) == b; }
-inline bool operator !=(float a, const Fixed& b) { return Fixed(a) != b; }
-inline bool operator <=(float a, const Fixed& b) { return Fixed(a) <= b; }
-inline bool operator >=(float a, const Fixed& b) { return Fixed(a) >= b; }
-inline bool operator  <(float a, const Fixed& b) { return Fixed(a)  < b; }
-inline bool operator  >(float a, const Fixed& b) { return Fixed(a)  > b; }
+	template <typename W> static constexpr W shift(W value, int bits) {
+		return (bits == 0) ? value : (value >= 0) ? ((value + (static_cast<W>(1) << (bits - 1))) >> bits) :
+			-((-value + (static_cast<W>(1) << (bits - 1))) >> bits);
+	}
 
+	template <typename W> static constexpr W divide(W dividend, W divisor) {
+		return (((dividend < 0) != (divisor < 0)) ? -1 : 1) *
+			(((dividend < 0 ? -dividend : dividend) + (divisor < 0 ? -divisor : divisor) / 2) / (divisor < 0 ? -divisor : divisor));
+	}
 
+	// value - whole is exact, so there is no double rounding as with adding 0.5
+	static constexpr double integral(double value) {
+		return ((value > -4503599627370496.0) && (value < 4503599627370496.0)) ?
+			nearest(value, static_cast<double>(static_cast<long long>(value))) : value;
+	}
 
-inline Fixed operator +(double a, const Fixed& b) { return Fixed(a)+b; }
-inline Fixed operator -(double a, const Fixed& b) { return Fixed(a)-b; }
-inline Fixed operator *(double a, const Fixed& b) { return Fixed(a)*b; }
-inline Fixed operator /(double a, const Fixed& b) { return Fixed(a)/b; }
+	static constexpr double nearest(double value, double whole) {
+		return (value - whole >= 0.5) ? whole + 1.0 : (value - whole <= -0.5) ? whole - 1.0 : whole;
+	}
+};
 
-inline bool operator ==(double a, const Fixed& b) { return Fixed(a) == b; }
-inline bool operator !=(double a, const Fixed& b) { return Fixed(a) != b; }
-inline bool operator <=(double a, const Fixed& b) { return Fixed(a) <= b; }
-inline bool operator >=(double a, const Fixed& b) { return Fixed(a) >= b; }
-inline bool operator  <(double a, const Fixed& b) { return Fixed(a)  < b; }
-inline bool operator  >(double a, const Fixed& b) { return Fixed(a)  > b; }
+template <int IntBits, int FracBits, typename Overflow = FixedWrap, typename Rounding = FixedTruncate>
+class FixedPoint {
 
+public:
 
-int& operator +=(int& a, const Fixed& b) { a = (Fixed)a + b; return a; }
-int& operator -=(int& a, const Fixed& b) { a = (Fixed)a - b; return a; }
-int& operator *=(int& a, const Fixed& b) { a = (Fixed)a * b; return a; }
-int& operator /=(int& a, const Fixed& b) { a = (Fixed)a / b; return a; }
+	static const int Bits = 1 + IntBits + FracBits;
 
-long& operator +=(long& a, const Fixed& b) { a = (Fixed)a + b; return a; }
-long& operator -=(long& a, const Fixed& b) { a = (Fixed)a - b; return a; }
-long& operator *=(long& a, const Fixed& b) { a = (Fixed)a * b; return a; }
-long& operator /=(long& a, const Fixed& b) { a = (Fixed)a / b; return a; }
+	static_assert((IntBits >= 0) && (FracBits >= 0) && ((Bits == 32) || (Bits == 64)),
+		"FixedPoint needs a sign bit and IntBits + FracBits of 31 or 63");
 
-float& operator +=(float& a, const Fixed& b) { a = a + b; return a; }
-float& operator -=(float& a, const Fixed& b) { a = a - b; return a; }
-float& operator *=(float& a, const Fixed& b) { a = a * b; return a; }
-float& operator /=(float& a, const Fixed& b) { a = a / b; return a; }
+	typedef FixedStorage<Bits> Storage;
+	typedef typename Storage::Type Raw;
+	typedef typename Storage::Wide Wide;
 
-double& operator +=(double& a, const Fixed& b) { a = a + b; return a; }
-double& operator -=(double& a, const Fixed& b) { a = a - b; return a; }
-double& operator *=(double& a, const Fixed& b) { a = a * b; return a; }
-double& operator /=(double& a, const Fixed& b) { a = a / b; return a; }
+	static constexpr Wide ONE = static_cast<Wide>(1) << FracBits;
+	static constexpr double STEP = 1.0 / static_cast<double>(ONE); // smallest STEP we can represent
+
+private:
+
+	Raw	g; // the guts
+
+	// for private construction via guts
+	enum FixedRaw { RAW };
+	constexpr FixedPoint(FixedRaw, Raw guts) : g(guts) {}
+
+	template <typename W> static constexpr FixedPoint narrow(W value) { return FixedPoint(RAW, Overflow::template narrow<Storage>(value)); }
+	static constexpr Raw integer(long long a) { return Overflow::template integer<Storage>(a, FracBits); }
+	static constexpr Raw floating(double a) { return Overflow::template floating<Storage>(Rounding::integral(a * static_cast<double>(ONE))); }
+
+public:
+	constexpr FixedPoint() : g(0) {}
+
+	// the guts, e.g. for the batch kernels in FixedKernels.h
+	static constexpr FixedPoint fromRaw(Raw guts) { return FixedPoint(RAW, guts); }
+	constexpr Raw getRaw() const { return g; }
+
+	static constexpr FixedPoint getMax() { return FixedPoint(RAW, FixedLimits<Storage>::max); }
+	static constexpr FixedPoint getMin() { return FixedPoint(RAW, FixedLimits<Storage>::min); }
+
+	constexpr FixedPoint(const FixedPoint& a) : g( a.g ) {}
+	constexpr FixedPoint(float a) : g( floating(a) ) {}
+	constexpr FixedPoint(double a) : g( floating(a) ) {}
+	constexpr FixedPoint(int a) : g( integer(a) ) {}
+	constexpr FixedPoint(long a) : g( integer(a) ) {}
+
+	// from another Q-format, with this one's policies
+	template <int I, int F, typename O, typename R>
+	explicit constexpr FixedPoint(const FixedPoint<I, F, O, R>& a) : g( (F <= FracBits) ?
+		Overflow::template narrow<Storage>(static_cast<__int128>(a.getRaw()) * (static_cast<__int128>(1) << (FracBits - F < 0 ? 0 : FracBits - F))) :
+		Overflow::template narrow<Storage>(Rounding::shift(static_cast<__int128>(a.getRaw()), F - FracBits < 0 ? 0 : F - FracBits)) ) {}
+
+	constexpr FixedPoint& operator =(const FixedPoint& a) { g= a.g; return *this; }
+	constexpr FixedPoint& operator =(float a) { g= FixedPoint(a).g; return *this; }
+	constexpr FixedPoint& operator =(double a) { g= FixedPoint(a).g; return *this; }
+	constexpr FixedPoint& operator =(int a) { g= FixedPoint(a).g; return *this; }
+	constexpr FixedPoint& operator =(long a) { g= FixedPoint(a).g; return *this; }
+
+	constexpr operator float() const { return static_cast<float>(g) * static_cast<float>(STEP); }
+	constexpr operator double() const { return static_cast<double>(g) * STEP; }
+	constexpr operator int() const { return static_cast<int>(g>>FracBits); }
+	constexpr operator long() const { return static_cast<long>(g>>FracBits); }
+
+	constexpr FixedPoint operator +() const { return FixedPoint(RAW,g); }
+	constexpr FixedPoint operator -() const { return narrow(-static_cast<Wide>(g)); }
+
+	constexpr FixedPoint operator +(const FixedPoint& a) const { return narrow(static_cast<Wide>(g) + a.g); }
+	constexpr FixedPoint operator -(const FixedPoint& a) const { return narrow(static_cast<Wide>(g) - a.g); }
+	constexpr FixedPoint operator *(const FixedPoint& a) const { return narrow(Rounding::shift(static_cast<Wide>(g) * a.g, FracBits)); }
+	constexpr FixedPoint operator /(const FixedPoint& a) const {
+		return (Overflow::saturating && (a.g == 0)) ? ((g < 0) ? getMin() : getMax()) :
+			narrow(Rounding::divide(static_cast<Wide>(g) * ONE, static_cast<Wide>(a.g)));
+	}
+
+	constexpr FixedPoint operator +(float a) const { return *this + FixedPoint(a); }
+	constexpr FixedPoint operator -(float a) const { return *this - FixedPoint(a); }
+	constexpr FixedPoint operator *(float a) const { return *this * FixedPoint(a); }
+	constexpr FixedPoint operator /(float a) const { return *this / FixedPoint(a); }
+
+	constexpr FixedPoint operator +(double a) const { return *this + FixedPoint(a); }
+	constexpr FixedPoint operator -(double a) const { return *this - FixedPoint(a); }
+	constexpr FixedPoint operator *(double a) const { return *this * FixedPoint(a); }
+	constexpr FixedPoint operator /(double a) const { return *this / FixedPoint(a); }
+
+	constexpr FixedPoint& operator +=(FixedPoint a) { return *this = *this + a; }
+	constexpr FixedPoint& operator -=(FixedPoint a) { return *this = *this - a; }
+	constexpr FixedPoint& operator *=(FixedPoint a) { return *this = *this * a; }
+	constexpr FixedPoint& operator /=(FixedPoint a) { return *this = *this / a; }
+
+	constexpr FixedPoint& operator +=(int a) { return *this = *this + (FixedPoint)a; }
+	constexpr FixedPoint& operator -=(int a) { return *this = *this - (FixedPoint)a; }
+	constexpr FixedPoint& operator *=(int a) { return *this = *this * (FixedPoint)a; }
+	constexpr FixedPoint& operator /=(int a) { return *this = *this / (FixedPoint)a; }
+
+	constexpr FixedPoint& operator +=(long a) { return *this = *this + (FixedPoint)a; }
+	constexpr FixedPoint& operator -=(long a) { return *this = *this - (FixedPoint)a; }
+	constexpr FixedPoint& operator *=(long a) { return *this = *this * (FixedPoint)a; }
+	constexpr FixedPoint& operator /=(long a) { return *this = *this / (FixedPoint)a; }
+
+	constexpr FixedPoint& operator +=(float a) { return *this = *this + a; }
+	constexpr FixedPoint& operator -=(float a) { return *this = *this - a; }
+	constexpr FixedPoint& operator *=(float a) { return *this = *this * a; }
+	constexpr FixedPoint& operator /=(float a) { return *this = *this / a; }
+
+	constexpr FixedPoint& operator +=(double a) { return *this = *this + a; }
+	constexpr FixedPoint& operator -=(double a) { return *this = *this - a; }
+	constexpr FixedPoint& operator *=(double a) { return *this = *this * a; }
+	constexpr FixedPoint& operator /=(double a) { return *this = *this / a; }
+
+	constexpr bool operator ==(const FixedPoint& a) const { return g == a.g; }
+	constexpr bool operator !=(const FixedPoint& a) const { return g != a.g; }
+	constexpr bool operator <=(const FixedPoint& a) const { return g <= a.g; }
+	constexpr bool operator >=(const FixedPoint& a) const { return g >= a.g; }
+	constexpr bool operator  <(const FixedPoint& a) const { return g  < a.g; }
+	constexpr bool operator  >(const FixedPoint& a) const { return g  > a.g; }
+
+	constexpr bool operator ==(float a) const { return g == FixedPoint(a).g; }
+	constexpr bool operator !=(float a) const { return g != FixedPoint(a).g; }
+	constexpr bool operator <=(float a) const { return g <= FixedPoint(a).g; }
+	constexpr bool operator >=(float a) const { return g >= FixedPoint(a).g; }
+	constexpr bool operator  <(float a) const { return g  < FixedPoint(a).g; }
+	constexpr bool operator  >(float a) const { return g  > FixedPoint(a).g; }
+
+	constexpr bool operator ==(double a) const { return g == FixedPoint(a).g; }
+	constexpr bool operator !=(double a) const { return g != FixedPoint(a).g; }
+	constexpr bool operator <=(double a) const { return g <= FixedPoint(a).g; }
+	constexpr bool operator >=(double a) const { return g >= FixedPoint(a).g; }
+	constexpr bool operator  <(double a) const { return g  < FixedPoint(a).g; }
+	constexpr bool operator  >(double a) const { return g  > FixedPoint(a).g; }
+};
+
+typedef FixedPoint<15, 16> Fixed;
+
+#define CASTOR_FIXED_TEMPLATE template <int I, int F, typename O, typename R>
+#define CASTOR_FIXED FixedPoint<I, F, O, R>
+
+CASTOR_FIXED_TEMPLATE constexpr CASTOR_FIXED operator +(float a, const CASTOR_FIXED& b) { return CASTOR_FIXED(a)+b; }
+CASTOR_FIXED_TEMPLATE constexpr CASTOR_FIXED operator -(float a, const CASTOR_FIXED& b) { return CASTOR_FIXED(a)-b; }
+CASTOR_FIXED_TEMPLATE constexpr CASTOR_FIXED operator *(float a, const CASTOR_FIXED& b) { return CASTOR_FIXED(a)*b; }
+CASTOR_FIXED_TEMPLATE constexpr CASTOR_FIXED operator /(float a, const CASTOR_FIXED& b) { return CASTOR_FIXED(a)/b; }
+
+CASTOR_FIXED_TEMPLATE constexpr bool operator ==(float a, const CASTOR_FIXED& b) { return CASTOR_FIXED(a) == b; }
+CASTOR_FIXED_TEMPLATE constexpr bool operator !=(float a, const CASTOR_FIXED& b) { return CASTOR_FIXED(a) != b; }
+CASTOR_FIXED_TEMPLATE constexpr bool operator <=(float a, const CASTOR_FIXED& b) { return CASTOR_FIXED(a) <= b; }
+CASTOR_FIXED_TEMPLATE constexpr bool operator >=(float a, const CASTOR_FIXED& b) { return CASTOR_FIXED(a) >= b; }
+CASTOR_FIXED_TEMPLATE constexpr bool operator  <(float a, const CASTOR_FIXED& b) { return CASTOR_FIXED(a)  < b; }
+CASTOR_FIXED_TEMPLATE constexpr bool operator  >(float a, const CASTOR_FIXED& b) { return CASTOR_FIXED(a)  > b; }
+
+CASTOR_FIXED_TEMPLATE constexpr CASTOR_FIXED operator +(double a, const CASTOR_FIXED& b) { return CASTOR_FIXED(a)+b; }
+CASTOR_FIXED_TEMPLATE constexpr CASTOR_FIXED operator -(double a, const CASTOR_FIXED& b) { return CASTOR_FIXED(a)-b; }
+CASTOR_FIXED_TEMPLATE constexpr CASTOR_FIXED operator *(double a, const CASTOR_FIXED& b) { return CASTOR_FIXED(a)*b; }
+CASTOR_FIXED_TEMPLATE constexpr CASTOR_FIXED operator /(double a, const CASTOR_FIXED& b) { return CASTOR_FIXED(a)/b; }
+
+CASTOR_FIXED_TEMPLATE constexpr bool operator ==(double a, const CASTOR_FIXED& b) { return CASTOR_FIXED(a) == b; }
+CASTOR_FIXED_TEMPLATE constexpr bool operator !=(double a, const CASTOR_FIXED& b) { return CASTOR_FIXED(a) != b; }
+CASTOR_FIXED_TEMPLATE constexpr bool operator <=(double a, const CASTOR_FIXED& b) { return CASTOR_FIXED(a) <= b; }
+CASTOR_FIXED_TEMPLATE constexpr bool operator >=(double a, const CASTOR_FIXED& b) { return CASTOR_FIXED(a) >= b; }
+CASTOR_FIXED_TEMPLATE constexpr bool operator  <(double a, const CASTOR_FIXED& b) { return CASTOR_FIXED(a)  < b; }
+CASTOR_FIXED_TEMPLATE constexpr bool operator  >(double a, const CASTOR_FIXED& b) { return CASTOR_FIXED(a)  > b; }
+
+CASTOR_FIXED_TEMPLATE constexpr int& operator +=(int& a, const CASTOR_FIXED& b) { a = (CASTOR_FIXED)a + b; return a; }
+CASTOR_FIXED_TEMPLATE constexpr int& operator -=(int& a, const CASTOR_FIXED& b) { a = (CASTOR_FIXED)a - b; return a; }
+CASTOR_FIXED_TEMPLATE constexpr int& operator *=(int& a, const CASTOR_FIXED& b) { a = (CASTOR_FIXED)a * b; return a; }
+CASTOR_FIXED_TEMPLATE constexpr int& operator /=(int& a, const CASTOR_FIXED& b) { a = (CASTOR_FIXED)a / b; return a; }
+
+CASTOR_FIXED_TEMPLATE constexpr long& operator +=(long& a, const CASTOR_FIXED& b) { a = (CASTOR_FIXED)a + b; return a; }
+CASTOR_FIXED_TEMPLATE constexpr long& operator -=(long& a, const CASTOR_FIXED& b) { a = (CASTOR_FIXED)a - b; return a; }
+CASTOR_FIXED_TEMPLATE constexpr long& operator *=(long& a, const CASTOR_FIXED& b) { a = (CASTOR_FIXED)a * b; return a; }
+CASTOR_FIXED_TEMPLATE constexpr long& operator /=(long& a, const CASTOR_FIXED& b) { a = (CASTOR_FIXED)a / b; return a; }
+
+CASTOR_FIXED_TEMPLATE constexpr float& operator +=(float& a, const CASTOR_FIXED& b) { a = a + b; return a; }
+CASTOR_FIXED_TEMPLATE constexpr float& operator -=(float& a, const CASTOR_FIXED& b) { a = a - b; return a; }
+CASTOR_FIXED_TEMPLATE constexpr float& operator *=(float& a, const CASTOR_FIXED& b) { a = a * b; return a; }
+CASTOR_FIXED_TEMPLATE constexpr float& operator /=(float& a, const CASTOR_FIXED& b) { a = a / b; return a; }
+
+CASTOR_FIXED_TEMPLATE constexpr double& operator +=(double& a, const CASTOR_FIXED& b) { a = a + b; return a; }
+CASTOR_FIXED_TEMPLATE constexpr double& operator -=(double& a, const CASTOR_FIXED& b) { a = a - b; return a; }
+CASTOR_FIXED_TEMPLATE constexpr double& operator *=(double& a, const CASTOR_FIXED& b) { a = a * b; return a; }
+CASTOR_FIXED_TEMPLATE constexpr double& operator /=(double& a, const CASTOR_FIXED& b) { a = a / b; return a; }
+
+#undef CASTOR_FIXED_TEMPLATE
+#undef CASTOR_FIXED
 
 }
 
 #endif /* CASTOR_FIXED_H */
-
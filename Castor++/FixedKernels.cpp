@@ -0,0 +1,681 @@
+/*
+ * $Id$
+ *
+ * Copyright 2008 Carpe Noctem, Distributed Systems Group,
+ * University of Kassel. All right reserved.
+ *
+ * The code is licensed under the Carpe Noctem Userfriendly BSD-Based
+ * License (CNUBBL). Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided that the
+ * conditions of the CNUBBL are met.
+ *
+ * You should have received a copy of the CNUBBL along with this
+ * software. The license is also available on our website:
+ * http://carpenoctem.das-lab.net/license.txt
+ */
+
+#include "FixedKernels.h"
+#include "Exception.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#  include <immintrin.h>
+#  define CASTOR_FIXED_SIMD 1
+#endif
+
+namespace castor {
+
+	// The kernels work on the guts of the values
+	static inline const int *raw(const Fixed *values) {
+		return reinterpret_cast<const int *>(values);
+	}
+
+	static inline int *raw(Fixed *values) {
+		return reinterpret_cast<int *>(values);
+	}
+
+	struct FixedKernelTable {
+		FixedKernels::Level level;
+		void (*add)(const int *a, const int *b, int *result, size_t count);
+		void (*sub)(const int *a, const int *b, int *result, size_t count);
+		void (*mul)(const int *a, const int *b, int *result, size_t count);
+		void (*mulScalar)(const int *a, int b, int *result, size_t count);
+		void (*mac)(const int *a, const int *b, int *result, size_t count);
+		void (*macScalar)(const int *a, int b, int *result, size_t count);
+		void (*less)(const int *a, const int *b, unsigned char *result, size_t count);
+		void (*equal)(const int *a, const int *b, unsigned char *result, size_t count);
+		void (*greater)(const int *a, const int *b, unsigned char *result, size_t count);
+		void (*fromFloat)(const float *values, int *result, size_t count);
+		void (*fromDouble)(const double *values, int *result, size_t count);
+		void (*toFloat)(const int *a, float *result, size_t count);
+		void (*toDouble)(const int *a, double *result, size_t count);
+	};
+
+	/*
+	 * Scalar kernels. They also finish the last few values for the others.
+	 * Products, quotients and conversions use the scalar operators as they
+	 * are, so that the kernels cannot drift from Fixed.
+	 */
+
+	static inline int wrap(unsigned int value) {
+		return static_cast<int>(value);
+	}
+
+	static inline int product(int a, int b) {
+		return (Fixed::fromRaw(a) * Fixed::fromRaw(b)).getRaw();
+	}
+
+	static void addScalar(const int *a, const int *b, int *result, size_t count) {
+		for (size_t i = 0; i < count; i++) {
+			result[i] = wrap(static_cast<unsigned int>(a[i]) + static_cast<unsigned int>(b[i]));
+		}
+	}
+
+	static void subScalar(const int *a, const int *b, int *result, size_t count) {
+		for (size_t i = 0; i < count; i++) {
+			result[i] = wrap(static_cast<unsigned int>(a[i]) - static_cast<unsigned int>(b[i]));
+		}
+	}
+
+	static void mulScalar(const int *a, const int *b, int *result, size_t count) {
+		for (size_t i = 0; i < count; i++) {
+			result[i] = product(a[i], b[i]);
+		}
+	}
+
+	static void mulScalarScalar(const int *a, int b, int *result, size_t count) {
+		for (size_t i = 0; i < count; i++) {
+			result[i] = product(a[i], b);
+		}
+	}
+
+	static void macScalar(const int *a, const int *b, int *result, size_t count) {
+		for (size_t i = 0; i < count; i++) {
+			result[i] = wrap(static_cast<unsigned int>(result[i]) + static_cast<unsigned int>(product(a[i], b[i])));
+		}
+	}
+
+	static void macScalarScalar(const int *a, int b, int *result, size_t count) {
+		for (size_t i = 0; i < count; i++) {
+			result[i] = wrap(static_cast<unsigned int>(result[i]) + static_cast<unsigned int>(product(a[i], b)));
+		}
+	}
+
+	static void divScalar(const int *a, const int *b, int *result, size_t count) {
+		for (size_t i = 0; i < count; i++) {
+			result[i] = (Fixed::fromRaw(a[i]) / Fixed::fromRaw(b[i])).getRaw();
+		}
+	}
+
+	static void lessScalar(const int *a, const int *b, unsigned char *result, size_t count) {
+		for (size_t i = 0; i < count; i++) {
+			result[i] = (a[i] < b[i]);
+		}
+	}
+
+	static void equalScalar(const int *a, const int *b, unsigned char *result, size_t count) {
+		for (size_t i = 0; i < count; i++) {
+			result[i] = (a[i] == b[i]);
+		}
+	}
+
+	static void greaterScalar(const int *a, const int *b, unsigned char *result, size_t count) {
+		for (size_t i = 0; i < count; i++) {
+			result[i] = (a[i] > b[i]);
+		}
+	}
+
+	static void fromFloatScalar(const float *values, int *result, size_t count) {
+		for (size_t i = 0; i < count; i++) {
+			result[i] = Fixed(values[i]).getRaw();
+		}
+	}
+
+	static void fromDoubleScalar(const double *values, int *result, size_t count) {
+		for (size_t i = 0; i < count; i++) {
+			result[i] = Fixed(values[i]).getRaw();
+		}
+	}
+
+	static void toFloatScalar(const int *a, float *result, size_t count) {
+		for (size_t i = 0; i < count; i++) {
+			result[i] = static_cast<float>(Fixed::fromRaw(a[i]));
+		}
+	}
+
+	static void toDoubleScalar(const int *a, double *result, size_t count) {
+		for (size_t i = 0; i < count; i++) {
+			result[i] = static_cast<double>(Fixed::fromRaw(a[i]));
+		}
+	}
+
+	static const FixedKernelTable scalarKernels = {
+		FixedKernels::Scalar,
+		addScalar, subScalar, mulScalar, mulScalarScalar, macScalar, macScalarScalar,
+		lessScalar, equalScalar, greaterScalar,
+		fromFloatScalar, fromDoubleScalar, toFloatScalar, toDoubleScalar
+	};
+
+#ifdef CASTOR_FIXED_SIMD
+
+	/*
+	 * SSE4.1 kernels, four values at a time.
+	 *
+	 * _mm_mul_epi32 multiplies the even lanes to 64 bits. Bits 16 to 47 of
+	 * a product are the 32 bits the scalar operator keeps, so the even
+	 * products are shifted right and the odd ones left into place.
+	 */
+
+#	define CASTOR_SSE4 __attribute__((target("sse4.1")))
+
+	static inline CASTOR_SSE4 __m128i mul4(__m128i a, __m128i b) {
+
+		__m128i even = _mm_srli_epi64(_mm_mul_epi32(a, b), 16);
+		__m128i odd = _mm_slli_epi64(_mm_mul_epi32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32)), 16);
+
+		return _mm_blend_epi16(even, odd, 0xcc);
+	}
+
+	// Stores the lowest byte of the four masks as 1 or 0
+	static inline CASTOR_SSE4 void mask4(__m128i mask, unsigned char *result) {
+
+		__m128i bytes = _mm_packs_epi16(_mm_packs_epi32(mask, mask), mask);
+		int value = _mm_cvtsi128_si32(_mm_and_si128(bytes, _mm_set1_epi8(1)));
+
+		__builtin_memcpy(result, &value, 4);
+	}
+
+	static inline CASTOR_SSE4 __m128i load4(const int *values) {
+		return _mm_loadu_si128(reinterpret_cast<const __m128i *>(values));
+	}
+
+	static inline CASTOR_SSE4 void store4(int *values, __m128i value) {
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(values), value);
+	}
+
+	static CASTOR_SSE4 void addSSE4(const int *a, const int *b, int *result, size_t count) {
+
+		size_t i = 0;
+
+		for (; i + 4 <= count; i += 4) {
+			store4(result + i, _mm_add_epi32(load4(a + i), load4(b + i)));
+		}
+
+		addScalar(a + i, b + i, result + i, count - i);
+	}
+
+	static CASTOR_SSE4 void subSSE4(const int *a, const int *b, int *result, size_t count) {
+
+		size_t i = 0;
+
+		for (; i + 4 <= count; i += 4) {
+			store4(result + i, _mm_sub_epi32(load4(a + i), load4(b + i)));
+		}
+
+		subScalar(a + i, b + i, result + i, count - i);
+	}
+
+	static CASTOR_SSE4 void mulSSE4(const int *a, const int *b, int *result, size_t count) {
+
+		size_t i = 0;
+
+		for (; i + 4 <= count; i += 4) {
+			store4(result + i, mul4(load4(a + i), load4(b + i)));
+		}
+
+		mulScalar(a + i, b + i, result + i, count - i);
+	}
+
+	static CASTOR_SSE4 void mulScalarSSE4(const int *a, int b, int *result, size_t count) {
+
+		__m128i factor = _mm_set1_epi32(b);
+		size_t i = 0;
+
+		for (; i + 4 <= count; i += 4) {
+			store4(result + i, mul4(load4(a + i), factor));
+		}
+
+		mulScalarScalar(a + i, b, result + i, count - i);
+	}
+
+	static CASTOR_SSE4 void macSSE4(const int *a, const int *b, int *result, size_t count) {
+
+		size_t i = 0;
+
+		for (; i + 4 <= count; i += 4) {
+			store4(result + i, _mm_add_epi32(load4(result + i), mul4(load4(a + i), load4(b + i))));
+		}
+
+		macScalar(a + i, b + i, result + i, count - i);
+	}
+
+	static CASTOR_SSE4 void macScalarSSE4(const int *a, int b, int *result, size_t count) {
+
+		__m128i factor = _mm_set1_epi32(b);
+		size_t i = 0;
+
+		for (; i + 4 <= count; i += 4) {
+			store4(result + i, _mm_add_epi32(load4(result + i), mul4(load4(a + i), factor)));
+		}
+
+		macScalarScalar(a + i, b, result + i, count - i);
+	}
+
+	static CASTOR_SSE4 void lessSSE4(const int *a, const int *b, unsigned char *result, size_t count) {
+
+		size_t i = 0;
+
+		for (; i + 4 <= count; i += 4) {
+			mask4(_mm_cmplt_epi32(load4(a + i), load4(b + i)), result + i);
+		}
+
+		lessScalar(a + i, b + i, result + i, count - i);
+	}
+
+	static CASTOR_SSE4 void equalSSE4(const int *a, const int *b, unsigned char *result, size_t count) {
+
+		size_t i = 0;
+
+		for (; i + 4 <= count; i += 4) {
+			mask4(_mm_cmpeq_epi32(load4(a + i), load4(b + i)), result + i);
+		}
+
+		equalScalar(a + i, b + i, result + i, count - i);
+	}
+
+	static CASTOR_SSE4 void greaterSSE4(const int *a, const int *b, unsigned char *result, size_t count) {
+
+		size_t i = 0;
+
+		for (; i + 4 <= count; i += 4) {
+			mask4(_mm_cmpgt_epi32(load4(a + i), load4(b + i)), result + i);
+		}
+
+		greaterScalar(a + i, b + i, result + i, count - i);
+	}
+
+	static CASTOR_SSE4 void fromFloatSSE4(const float *values, int *result, size_t count) {
+
+		__m128 scale = _mm_set1_ps(65536.0f);
+		size_t i = 0;
+
+		for (; i + 4 <= count; i += 4) {
+			store4(result + i, _mm_cvttps_epi32(_mm_mul_ps(_mm_loadu_ps(values + i), scale)));
+		}
+
+		fromFloatScalar(values + i, result + i, count - i);
+	}
+
+	static CASTOR_SSE4 void fromDoubleSSE4(const double *values, int *result, size_t count) {
+
+		__m128d scale = _mm_set1_pd(65536.0);
+		size_t i = 0;
+
+		for (; i + 4 <= count; i += 4) {
+
+			__m128i low = _mm_cvttpd_epi32(_mm_mul_pd(_mm_loadu_pd(values + i), scale));
+			__m128i high = _mm_cvttpd_epi32(_mm_mul_pd(_mm_loadu_pd(values + i + 2), scale));
+
+			store4(result + i, _mm_unpacklo_epi64(low, high));
+		}
+
+		fromDoubleScalar(values + i, result + i, count - i);
+	}
+
+	static CASTOR_SSE4 void toFloatSSE4(const int *a, float *result, size_t count) {
+
+		__m128 scale = _mm_set1_ps(1.0f / 65536);
+		size_t i = 0;
+
+		for (; i + 4 <= count; i += 4) {
+			_mm_storeu_ps(result + i, _mm_mul_ps(_mm_cvtepi32_ps(load4(a + i)), scale));
+		}
+
+		toFloatScalar(a + i, result + i, count - i);
+	}
+
+	static CASTOR_SSE4 void toDoubleSSE4(const int *a, double *result, size_t count) {
+
+		__m128d scale = _mm_set1_pd(1.0 / 65536);
+		size_t i = 0;
+
+		for (; i + 4 <= count; i += 4) {
+
+			__m128i value = load4(a + i);
+
+			_mm_storeu_pd(result + i, _mm_mul_pd(_mm_cvtepi32_pd(value), scale));
+			_mm_storeu_pd(result + i + 2, _mm_mul_pd(_mm_cvtepi32_pd(_mm_unpackhi_epi64(value, value)), scale));
+		}
+
+		toDoubleScalar(a + i, result + i, count - i);
+	}
+
+	static const FixedKernelTable sse4Kernels = {
+		FixedKernels::SSE4,
+		addSSE4, subSSE4, mulSSE4, mulScalarSSE4, macSSE4, macScalarSSE4,
+		lessSSE4, equalSSE4, greaterSSE4,
+		fromFloatSSE4, fromDoubleSSE4, toFloatSSE4, toDoubleSSE4
+	};
+
+	/*
+	 * AVX2 kernels, eight values at a time, the same way.
+	 */
+
+#	define CASTOR_AVX2 __attribute__((target("avx2")))
+
+	static inline CASTOR_AVX2 __m256i mul8(__m256i a, __m256i b) {
+
+		__m256i even = _mm256_srli_epi64(_mm256_mul_epi32(a, b), 16);
+		__m256i odd = _mm256_slli_epi64(_mm256_mul_epi32(_mm256_srli_epi64(a, 32), _mm256_srli_epi64(b, 32)), 16);
+
+		return _mm256_blend_epi32(even, odd, 0xaa);
+	}
+
+	static inline CASTOR_AVX2 void mask8(__m256i mask, unsigned char *result) {
+
+		__m128i words = _mm_packs_epi32(_mm256_castsi256_si128(mask), _mm256_extracti128_si256(mask, 1));
+		__m128i bytes = _mm_and_si128(_mm_packs_epi16(words, words), _mm_set1_epi8(1));
+
+		_mm_storel_epi64(reinterpret_cast<__m128i *>(result), bytes);
+	}
+
+	static inline CASTOR_AVX2 __m256i load8(const int *values) {
+		return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(values));
+	}
+
+	static inline CASTOR_AVX2 void store8(int *values, __m256i value) {
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(values), value);
+	}
+
+	static CASTOR_AVX2 void addAVX2(const int *a, const int *b, int *result, size_t count) {
+
+		size_t i = 0;
+
+		for (; i + 8 <= count; i += 8) {
+			store8(result + i, _mm256_add_epi32(load8(a + i), load8(b + i)));
+		}
+
+		addScalar(a + i, b + i, result + i, count - i);
+	}
+
+	static CASTOR_AVX2 void subAVX2(const int *a, const int *b, int *result, size_t count) {
+
+		size_t i = 0;
+
+		for (; i + 8 <= count; i += 8) {
+			store8(result + i, _mm256_sub_epi32(load8(a + i), load8(b + i)));
+		}
+
+		subScalar(a + i, b + i, result + i, count - i);
+	}
+
+	static CASTOR_AVX2 void mulAVX2(const int *a, const int *b, int *result, size_t count) {
+
+		size_t i = 0;
+
+		for (; i + 8 <= count; i += 8) {
+			store8(result + i, mul8(load8(a + i), load8(b + i)));
+		}
+
+		mulScalar(a + i, b + i, result + i, count - i);
+	}
+
+	static CASTOR_AVX2 void mulScalarAVX2(const int *a, int b, int *result, size_t count) {
+
+		__m256i factor = _mm256_set1_epi32(b);
+		size_t i = 0;
+
+		for (; i + 8 <= count; i += 8) {
+			store8(result + i, mul8(load8(a + i), factor));
+		}
+
+		mulScalarScalar(a + i, b, result + i, count - i);
+	}
+
+	static CASTOR_AVX2 void macAVX2(const int *a, const int *b, int *result, size_t count) {
+
+		size_t i = 0;
+
+		for (; i + 8 <= count; i += 8) {
+			store8(result + i, _mm256_add_epi32(load8(result + i), mul8(load8(a + i), load8(b + i))));
+		}
+
+		macScalar(a + i, b + i, result + i, count - i);
+	}
+
+	static CASTOR_AVX2 void macScalarAVX2(const int *a, int b, int *result, size_t count) {
+
+		__m256i factor = _mm256_set1_epi32(b);
+		size_t i = 0;
+
+		for (; i + 8 <= count; i += 8) {
+			store8(result + i, _mm256_add_epi32(load8(result + i), mul8(load8(a + i), factor)));
+		}
+
+		macScalarScalar(a + i, b, result + i, count - i);
+	}
+
+	static CASTOR_AVX2 void lessAVX2(const int *a, const int *b, unsigned char *result, size_t count) {
+
+		size_t i = 0;
+
+		for (; i + 8 <= count; i += 8) {
+			mask8(_mm256_cmpgt_epi32(load8(b + i), load8(a + i)), result + i);
+		}
+
+		lessScalar(a + i, b + i, result + i, count - i);
+	}
+
+	static CASTOR_AVX2 void equalAVX2(const int *a, const int *b, unsigned char *result, size_t count) {
+
+		size_t i = 0;
+
+		for (; i + 8 <= count; i += 8) {
+			mask8(_mm256_cmpeq_epi32(load8(a + i), load8(b + i)), result + i);
+		}
+
+		equalScalar(a + i, b + i, result + i, count - i);
+	}
+
+	static CASTOR_AVX2 void greaterAVX2(const int *a, const int *b, unsigned char *result, size_t count) {
+
+		size_t i = 0;
+
+		for (; i + 8 <= count; i += 8) {
+			mask8(_mm256_cmpgt_epi32(load8(a + i), load8(b + i)), result + i);
+		}
+
+		greaterScalar(a + i, b + i, result + i, count - i);
+	}
+
+	static CASTOR_AVX2 void fromFloatAVX2(const float *values, int *result, size_t count) {
+
+		__m256 scale = _mm256_set1_ps(65536.0f);
+		size_t i = 0;
+
+		for (; i + 8 <= count; i += 8) {
+			store8(result + i, _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_loadu_ps(values + i), scale)));
+		}
+
+		fromFloatScalar(values + i, result + i, count - i);
+	}
+
+	static CASTOR_AVX2 void fromDoubleAVX2(const double *values, int *result, size_t count) {
+
+		__m256d scale = _mm256_set1_pd(65536.0);
+		size_t i = 0;
+
+		for (; i + 8 <= count; i += 8) {
+
+			__m128i low = _mm256_cvttpd_epi32(_mm256_mul_pd(_mm256_loadu_pd(values + i), scale));
+			__m128i high = _mm256_cvttpd_epi32(_mm256_mul_pd(_mm256_loadu_pd(values + i + 4), scale));
+
+			store8(result + i, _mm256_set_m128i(high, low));
+		}
+
+		fromDoubleScalar(values + i, result + i, count - i);
+	}
+
+	static CASTOR_AVX2 void toFloatAVX2(const int *a, float *result, size_t count) {
+
+		__m256 scale = _mm256_set1_ps(1.0f / 65536);
+		size_t i = 0;
+
+		for (; i + 8 <= count; i += 8) {
+			_mm256_storeu_ps(result + i, _mm256_mul_ps(_mm256_cvtepi32_ps(load8(a + i)), scale));
+		}
+
+		toFloatScalar(a + i, result + i, count - i);
+	}
+
+	static CASTOR_AVX2 void toDoubleAVX2(const int *a, double *result, size_t count) {
+
+		__m256d scale = _mm256_set1_pd(1.0 / 65536);
+		size_t i = 0;
+
+		for (; i + 8 <= count; i += 8) {
+
+			__m256i value = load8(a + i);
+
+			_mm256_storeu_pd(result + i, _mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(value)), scale));
+			_mm256_storeu_pd(result + i + 4, _mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(value, 1)), scale));
+		}
+
+		toDoubleScalar(a + i, result + i, count - i);
+	}
+
+	static const FixedKernelTable avx2Kernels = {
+		FixedKernels::AVX2,
+		addAVX2, subAVX2, mulAVX2, mulScalarAVX2, macAVX2, macScalarAVX2,
+		lessAVX2, equalAVX2, greaterAVX2,
+		fromFloatAVX2, fromDoubleAVX2, toFloatAVX2, toDoubleAVX2
+	};
+
+#endif /* CASTOR_FIXED_SIMD */
+
+	static const FixedKernelTable *kernels(FixedKernels::Level level) {
+
+#ifdef CASTOR_FIXED_SIMD
+		switch (level) {
+			case FixedKernels::AVX2: return &avx2Kernels;
+			case FixedKernels::SSE4: return &sse4Kernels;
+			default: break;
+		}
+#endif /* CASTOR_FIXED_SIMD */
+
+		return &scalarKernels;
+	}
+
+	static const FixedKernelTable *active = NULL;
+
+	/**
+	 * Returns the kernels of the current level, selecting the best on first
+	 * use. Threads racing here all select the same.
+	 */
+	static inline const FixedKernelTable &current() {
+
+		const FixedKernelTable *result = __atomic_load_n(&active, __ATOMIC_ACQUIRE);
+
+		if (result == NULL) {
+			result = kernels(FixedKernels::getSupportedLevel());
+			__atomic_store_n(&active, result, __ATOMIC_RELEASE);
+		}
+
+		return *result;
+	}
+
+	static inline void check(const FixedSpan &a, size_t size) {
+
+		if (a.size() != size) {
+			throw Exception("Fixed arrays differ in size: %lu and %lu!", static_cast<unsigned long>(a.size()),
+				static_cast<unsigned long>(size));
+		}
+	}
+
+	FixedKernels::Level FixedKernels::getSupportedLevel() {
+
+#ifdef CASTOR_FIXED_SIMD
+		if (__builtin_cpu_supports("avx2")) return AVX2;
+		if (__builtin_cpu_supports("sse4.1")) return SSE4;
+#endif /* CASTOR_FIXED_SIMD */
+
+		return Scalar;
+	}
+
+	FixedKernels::Level FixedKernels::getLevel() {
+		return current().level;
+	}
+
+	FixedKernels::Level FixedKernels::setLevel(Level level) {
+
+		Level supported = getSupportedLevel();
+		const FixedKernelTable *table = kernels(level < supported ? level : supported);
+
+		__atomic_store_n(&active, table, __ATOMIC_RELEASE);
+
+		return table->level;
+	}
+
+	void FixedKernels::add(const FixedSpan &a, const FixedSpan &b, Fixed *result) {
+		check(b, a.size());
+		current().add(raw(a.data()), raw(b.data()), raw(result), a.size());
+	}
+
+	void FixedKernels::sub(const FixedSpan &a, const FixedSpan &b, Fixed *result) {
+		check(b, a.size());
+		current().sub(raw(a.data()), raw(b.data()), raw(result), a.size());
+	}
+
+	void FixedKernels::mul(const FixedSpan &a, const FixedSpan &b, Fixed *result) {
+		check(b, a.size());
+		current().mul(raw(a.data()), raw(b.data()), raw(result), a.size());
+	}
+
+	void FixedKernels::mul(const FixedSpan &a, Fixed b, Fixed *result) {
+		current().mulScalar(raw(a.data()), b.getRaw(), raw(result), a.size());
+	}
+
+	void FixedKernels::mac(const FixedSpan &a, const FixedSpan &b, Fixed *result) {
+		check(b, a.size());
+		current().mac(raw(a.data()), raw(b.data()), raw(result), a.size());
+	}
+
+	void FixedKernels::mac(const FixedSpan &a, Fixed b, Fixed *result) {
+		current().macScalar(raw(a.data()), b.getRaw(), raw(result), a.size());
+	}
+
+	void FixedKernels::div(const FixedSpan &a, const FixedSpan &b, Fixed *result) {
+		check(b, a.size());
+		divScalar(raw(a.data()), raw(b.data()), raw(result), a.size());
+	}
+
+	void FixedKernels::less(const FixedSpan &a, const FixedSpan &b, unsigned char *result) {
+		check(b, a.size());
+		current().less(raw(a.data()), raw(b.data()), result, a.size());
+	}
+
+	void FixedKernels::equal(const FixedSpan &a, const FixedSpan &b, unsigned char *result) {
+		check(b, a.size());
+		current().equal(raw(a.data()), raw(b.data()), result, a.size());
+	}
+
+	void FixedKernels::greater(const FixedSpan &a, const FixedSpan &b, unsigned char *result) {
+		check(b, a.size());
+		current().greater(raw(a.data()), raw(b.data()), result, a.size());
+	}
+
+	void FixedKernels::fromFloat(const float *values, size_t count, Fixed *result) {
+		current().fromFloat(values, raw(result), count);
+	}
+
+	void FixedKernels::fromDouble(const double *values, size_t count, Fixed *result) {
+		current().fromDouble(values, raw(result), count);
+	}
+
+	void FixedKernels::toFloat(const FixedSpan &a, float *result) {
+		current().toFloat(raw(a.data()), result, a.size());
+	}
+
+	void FixedKernels::toDouble(const FixedSpan &a, double *result) {
+		current().toDouble(raw(a.data()), result, a.size());
+	}
+}
@@ -0,0 +1,197 @@
+/*
+ * $Id$
+ *
+ * Copyright 2008 Carpe Noctem, Distributed Systems Group,
+ * University of Kassel. All right reserved.
+ *
+ * The code is licensed under the Carpe Noctem Userfriendly BSD-Based
+ * License (CNUBBL). Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided that the
+ * conditions of the CNUBBL are met.
+ *
+ * You should have received a copy of the CNUBBL along with this
+ * software. The license is also available on our website:
+ * http://carpenoctem.das-lab.net/license.txt
+ */
+
+#ifndef CASTOR_FIXEDKERNELS_H
+#define CASTOR_FIXEDKERNELS_H 1
+
+#include <vector>
+#include <cstddef>
+
+#include "Fixed.h"
+
+namespace castor {
+
+	typedef std::vector<Fixed> FixedVector;
+
+	/**
+	 * A read-only view of contiguous Fixed values, e.g. of a FixedVector or
+	 * of a plain array. It does not own the values.
+	 */
+	class FixedSpan {
+
+		protected:
+
+			const Fixed *values;
+			size_t count;
+
+		public:
+
+			FixedSpan(const Fixed *values, size_t count) :
+				values(values), count(count)
+			{
+			}
+
+			FixedSpan(const FixedVector &vector) :
+				values(vector.empty() ? NULL : &vector[0]), count(vector.size())
+			{
+			}
+
+			const Fixed *data() const {
+				return this->values;
+			}
+
+			size_t size() const {
+				return this->count;
+			}
+
+			bool empty() const {
+				return (this->count == 0);
+			}
+
+			const Fixed &operator[](size_t i) const {
+				return this->values[i];
+			}
+
+			const Fixed *begin() const {
+				return this->values;
+			}
+
+			const Fixed *end() const {
+				return this->values + this->count;
+			}
+	};
+
+	/**
+	 * Element-wise arithmetic on arrays of Fixed values.
+	 *
+	 * Every kernel exists as a scalar loop and, where the instruction set
+	 * allows it, as SSE4.1 and AVX2 loops. The best level the CPU supports
+	 * is chosen on first use; all levels give bit-identical results, those
+	 * of the scalar Fixed operators, which wrap around on overflow.
+	 *
+	 * The operands of a kernel must have the same size, otherwise an
+	 * Exception is thrown. Results are written to arrays of at least that
+	 * size, which may be one of the operands.
+	 */
+	class FixedKernels {
+
+		public:
+
+			typedef enum {
+				Scalar = 0,
+				SSE4 = 1,
+				AVX2 = 2,
+			} Level;
+
+			/**
+			 * Returns the level the kernels currently run at.
+			 */
+			static Level getLevel();
+
+			/**
+			 * Returns the best level the CPU supports.
+			 */
+			static Level getSupportedLevel();
+
+			/**
+			 * Selects the level to run at, limited to getSupportedLevel(),
+			 * e.g. to compare the levels. Not to be called while kernels
+			 * are running on other threads.
+			 * @return The level selected
+			 */
+			static Level setLevel(Level level);
+
+			/**
+			 * result[i] = a[i] + b[i]
+			 */
+			static void add(const FixedSpan &a, const FixedSpan &b, Fixed *result);
+
+			/**
+			 * result[i] = a[i] - b[i]
+			 */
+			static void sub(const FixedSpan &a, const FixedSpan &b, Fixed *result);
+
+			/**
+			 * result[i] = a[i] * b[i]
+			 */
+			static void mul(const FixedSpan &a, const FixedSpan &b, Fixed *result);
+
+			/**
+			 * result[i] = a[i] * b
+			 */
+			static void mul(const FixedSpan &a, Fixed b, Fixed *result);
+
+			/**
+			 * result[i] += a[i] * b[i]
+			 */
+			static void mac(const FixedSpan &a, const FixedSpan &b, Fixed *result);
+
+			/**
+			 * result[i] += a[i] * b
+			 */
+			static void mac(const FixedSpan &a, Fixed b, Fixed *result);
+
+			/**
+			 * result[i] = a[i] / b[i]. As with the scalar operator, no b[i]
+			 * may be zero.
+			 *
+			 * There is no SIMD instruction for integer division and a
+			 * division in floating point does not truncate the same way, so
+			 * this is the scalar loop on every level.
+			 */
+			static void div(const FixedSpan &a, const FixedSpan &b, Fixed *result);
+
+			/**
+			 * result[i] = (a[i] < b[i]), as 1 or 0
+			 */
+			static void less(const FixedSpan &a, const FixedSpan &b, unsigned char *result);
+
+			/**
+			 * result[i] = (a[i] == b[i]), as 1 or 0
+			 */
+			static void equal(const FixedSpan &a, const FixedSpan &b, unsigned char *result);
+
+			/**
+			 * result[i] = (a[i] > b[i]), as 1 or 0
+			 */
+			static void greater(const FixedSpan &a, const FixedSpan &b, unsigned char *result);
+
+			/**
+			 * Converts count values like Fixed(float). Values out of range,
+			 * including NaN, become the smallest Fixed as they do with the
+			 * conversion instructions of x86.
+			 */
+			static void fromFloat(const float *values, size_t count, Fixed *result);
+
+			/**
+			 * Converts count values like Fixed(double), see fromFloat().
+			 */
+			static void fromDouble(const double *values, size_t count, Fixed *result);
+
+			/**
+			 * Converts the values like operator float(). Results are
+			 * rounded to nearest.
+			 */
+			static void toFloat(const FixedSpan &a, float *result);
+
+			/**
+			 * Converts the values like operator double(), which is exact.
+			 */
+			static void toDouble(const FixedSpan &a, double *result);
+	};
+}
+
+#endif /* CASTOR_FIXEDKERNELS_H */
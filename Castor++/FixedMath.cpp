@@ -0,0 +1,385 @@
+/*
+ * $Id$
+ *
+ * Copyright 2008 Carpe Noctem, Distributed Systems Group,
+ * University of Kassel. All right reserved.
+ *
+ * The code is licensed under the Carpe Noctem Userfriendly BSD-Based
+ * License (CNUBBL). Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided that the
+ * conditions of the CNUBBL are met.
+ *
+ * You should have received a copy of the CNUBBL along with this
+ * software. The license is also available on our website:
+ * http://carpenoctem.das-lab.net/license.txt
+ */
+
+#include "FixedMath.h"
+#include "Exception.h"
+
+#include <cmath>
+
+namespace castor {
+
+	// Internal values have 30 bits right of the point
+	static const int Q = 30;
+	static const long long ONE = 1LL << Q;
+
+	static const long long HALF_PI = 1686629713LL;               // pi / 2, Q30
+	static const long long PI = 3373259426LL;                    // pi, Q30
+	static const long long LN2 = 744261118LL;                    // ln 2, Q30
+	static const long long QUARTERS = 2935890503282001226LL;     // 2 / pi, Q62
+	static const long long LOG2E = 1663314137230540311LL;        // log2 e, Q60
+	static const long long LN2_62 = 3196577161300663915LL;       // ln 2, Q62
+
+	static const int ROTATIONS = 24;
+
+	/**
+	 * Tables, filled once from libm. Everything after that is integer
+	 * arithmetic.
+	 */
+	struct FixedMathTables {
+
+		// sqrt((i + 64.5) / 256), Q16
+		unsigned long long roots[192];
+
+		// sin(i pi / 512), a quarter wave, Q30
+		long long sine[257];
+
+		// 2^(i / 256), Q62, as results of exp() use up to 46 bits
+		unsigned long long power[256];
+
+		// 1 / (1 + i / 256) rounded, Q30, and -ln of exactly that value
+		long long inverse[256];
+		long long logarithm[256];
+
+		// atan(2^-i), Q30
+		long long arctangent[ROTATIONS];
+
+		// Largest x whose e^x is a Fixed
+		int exponent;
+
+		FixedMathTables() {
+
+			for (int i = 0; i < 192; i++) {
+				this->roots[i] = llround(std::sqrt((i + 64.5) / 256) * 65536);
+			}
+
+			for (int i = 0; i <= 256; i++) {
+				this->sine[i] = llround(std::sin(i * M_PI / 512) * ONE);
+			}
+
+			for (int i = 0; i < 256; i++) {
+				this->power[i] = static_cast<unsigned long long>(std::ldexp(std::pow(2.0, i / 256.0), 62));
+				this->inverse[i] = llround(ONE / (1.0 + i / 256.0));
+				this->logarithm[i] = llround(-std::log(static_cast<double>(this->inverse[i]) / ONE) * ONE);
+			}
+
+			for (int i = 0; i < ROTATIONS; i++) {
+				this->arctangent[i] = llround(std::atan(std::ldexp(1.0, -i)) * ONE);
+			}
+
+			this->exponent = static_cast<int>(std::floor(std::log(Fixed::getMax().getRaw() / 65536.0) * 65536));
+		}
+	};
+
+	static const FixedMathTables &tables() {
+		static const FixedMathTables result;
+		return result;
+	}
+
+	/**
+	 * Rounds a Q30 value to Fixed.
+	 */
+	static inline int narrow(long long value) {
+		return static_cast<int>((value + (1LL << (Q - 17))) >> (Q - 16));
+	}
+
+	/**
+	 * Rounded square root of an integer in [1, 2^62]: an estimate of 8
+	 * bits from the table, two Newton steps to 32 bits, and a last
+	 * correction to the root that is nearest.
+	 */
+	static inline unsigned long long root(const FixedMathTables &t, unsigned long long value) {
+
+		// value * 4^k in [2^62, 2^64) gives the index
+		int shift = __builtin_clzll(value) & ~1;
+		int i = static_cast<int>(((value << shift) >> 56) - 64);
+
+		unsigned long long result = (t.roots[i] << 16) >> (shift / 2);
+
+		result = (result + value / result) >> 1;
+		result = (result + value / result) >> 1;
+
+		// (result - 1/2)^2 < value <= (result + 1/2)^2
+		result -= (result * result - result >= value) ? 1 : 0;
+		result += (result * result + result < value) ? 1 : 0;
+
+		return result;
+	}
+
+	static inline int sqrtRaw(const FixedMathTables &t, int x) {
+
+		if (x <= 0) return 0;
+
+		return static_cast<int>(root(t, static_cast<unsigned long long>(x) << 16));
+	}
+
+	static inline int rsqrtRaw(const FixedMathTables &t, int x) {
+
+		if (x <= 0) return Fixed::getMax().getRaw();
+
+		// Shift by an even number of bits to get a root of 31 bits
+		int bits = 64 - __builtin_clzll(static_cast<unsigned long long>(x));
+		int shift = (62 - bits) / 2;
+
+		unsigned long long s = root(t, static_cast<unsigned long long>(x) << (2 * shift));
+
+		// 1 / sqrt(x / 2^16) = 2^8 / sqrt(x), and s = sqrt(x) * 2^shift
+		unsigned long long result = ((1ULL << (24 + shift)) + s / 2) / s;
+
+		return (result > 0x7fffffffULL) ? Fixed::getMax().getRaw() : static_cast<int>(result);
+	}
+
+	/**
+	 * Sine of quadrant * pi / 2 + theta, theta as quarter of 30 bits.
+	 */
+	static inline int sineRaw(const FixedMathTables &t, unsigned int quadrant, long long quarter) {
+
+		int i = static_cast<int>(quarter >> 22);
+
+		// The rest, in radians
+		long long d = ((quarter & ((1LL << 22) - 1)) * HALF_PI) >> Q;
+		long long d2 = (d * d) >> Q;
+
+		long long cosd = ONE - d2 / 2;
+		long long sind = d - ((d2 * d) >> Q) / 6;
+
+		long long s = t.sine[i];
+		long long c = t.sine[256 - i];
+
+		long long sine = (s * cosd + c * sind) >> Q;
+		long long cosine = (c * cosd - s * sind) >> Q;
+
+		long long result = (quadrant & 1) ? cosine : sine;
+
+		return narrow((quadrant & 2) ? -result : result);
+	}
+
+	/**
+	 * Reduces x to quarter turns, with 62 bits of 2 / pi, and returns the
+	 * sine of x + offset quarters.
+	 */
+	static inline int sinRaw(const FixedMathTables &t, int x, unsigned int offset) {
+
+		// Q16 * Q62, so quarter turns are Q78
+		__int128 phase = static_cast<__int128>(x) * QUARTERS;
+
+		unsigned int quadrant = static_cast<unsigned int>(static_cast<long long>(phase >> 78)) + offset;
+		long long quarter = static_cast<long long>(phase >> 48) & (ONE - 1);
+
+		return sineRaw(t, quadrant, quarter);
+	}
+
+	static inline int atan2Raw(const FixedMathTables &t, int y, int x) {
+
+		if ((x == 0) && (y == 0)) return 0;
+
+		long long X = x;
+		long long Y = y;
+		long long z = 0;
+
+		// Rotate into the right half plane
+		if (X < 0) {
+			z = (Y >= 0) ? PI : -PI;
+			X = -X;
+			Y = -Y;
+		}
+
+		// Scale to 41 bits, the rotations grow it by less than 2.4
+		int bits = 64 - __builtin_clzll(static_cast<unsigned long long>(X | (Y < 0 ? -Y : Y)));
+		X <<= 41 - bits;
+		Y <<= 41 - bits;
+
+		// Rotate towards y = 0, (v ^ m) - m negates v where y < 0
+		for (int i = 0; i < ROTATIONS; i++) {
+
+			long long m = Y >> 63;
+			long long nx = X + (((Y >> i) ^ m) - m);
+
+			Y -= ((X >> i) ^ m) - m;
+			X = nx;
+			z += (t.arctangent[i] ^ m) - m;
+		}
+
+		return narrow(z);
+	}
+
+	static inline int expRaw(const FixedMathTables &t, int x) {
+
+		if (x > t.exponent) return Fixed::getMax().getRaw();
+
+		// x log2 e as Q76, split into 2^k * 2^(i / 256) * 2^r
+		__int128 y = static_cast<__int128>(x) * LOG2E;
+
+		int k = static_cast<int>(static_cast<long long>(y >> 76));
+
+		// Below 2^-17 the result rounds to 0
+		if (k < -17) return 0;
+
+		unsigned long long fraction = static_cast<unsigned long long>(y >> 14) & ((1ULL << 62) - 1);
+		int i = static_cast<int>(fraction >> 54);
+
+		// 2^r = e^(r ln 2) = 1 + u + u^2 / 2 + u^3 / 6, all Q62
+		unsigned long long u = static_cast<unsigned long long>((static_cast<unsigned __int128>(fraction & ((1ULL << 54) - 1)) * LN2_62) >> 62);
+		unsigned long long u2 = static_cast<unsigned long long>((static_cast<unsigned __int128>(u) * u) >> 62);
+		unsigned long long u3 = static_cast<unsigned long long>((static_cast<unsigned __int128>(u2) * u) >> 62);
+		unsigned long long p = (1ULL << 62) + u + u2 / 2 + u3 / 6;
+
+		// 2^(i / 256 + r) in [1, 2) as Q62, times 2^k as Q16
+		unsigned long long m = static_cast<unsigned long long>((static_cast<unsigned __int128>(t.power[i]) * p) >> 62);
+		int shift = 62 - 16 - k;
+
+		m = (m + (1ULL << (shift - 1))) >> shift;
+
+		return (m > 0x7fffffffULL) ? Fixed::getMax().getRaw() : static_cast<int>(m);
+	}
+
+	static inline int logRaw(const FixedMathTables &t, int x) {
+
+		if (x <= 0) return Fixed::getMin().getRaw();
+
+		// x = 2^(n - 16) * m with m in [1, 2) as Q30
+		int n = 63 - __builtin_clzll(static_cast<unsigned long long>(x));
+		long long m = static_cast<long long>(x) << (Q - n);
+
+		// m * inverse[i] is within 2^-8 of 1
+		int i = static_cast<int>((m >> (Q - 8)) & 255);
+		long long r = ((m * t.inverse[i]) >> Q) - ONE;
+
+		// ln(1 + r) = r - r^2 / 2 + r^3 / 3
+		long long r2 = (r * r) >> Q;
+		long long l = r - r2 / 2 + ((r2 * r) >> Q) / 3;
+
+		return narrow((n - 16) * LN2 + t.logarithm[i] + l);
+	}
+
+	static inline const int *raw(const Fixed *values) {
+		return reinterpret_cast<const int *>(values);
+	}
+
+	static inline int *raw(Fixed *values) {
+		return reinterpret_cast<int *>(values);
+	}
+
+	Fixed FixedMath::sqrt(Fixed x) {
+		return Fixed::fromRaw(sqrtRaw(tables(), x.getRaw()));
+	}
+
+	Fixed FixedMath::rsqrt(Fixed x) {
+		return Fixed::fromRaw(rsqrtRaw(tables(), x.getRaw()));
+	}
+
+	Fixed FixedMath::sin(Fixed x) {
+		return Fixed::fromRaw(sinRaw(tables(), x.getRaw(), 0));
+	}
+
+	Fixed FixedMath::cos(Fixed x) {
+		return Fixed::fromRaw(sinRaw(tables(), x.getRaw(), 1));
+	}
+
+	Fixed FixedMath::atan2(Fixed y, Fixed x) {
+		return Fixed::fromRaw(atan2Raw(tables(), y.getRaw(), x.getRaw()));
+	}
+
+	Fixed FixedMath::exp(Fixed x) {
+		return Fixed::fromRaw(expRaw(tables(), x.getRaw()));
+	}
+
+	Fixed FixedMath::log(Fixed x) {
+		return Fixed::fromRaw(logRaw(tables(), x.getRaw()));
+	}
+
+	void FixedMath::sqrt(const FixedSpan &x, Fixed *result) {
+
+		const FixedMathTables &t = tables();
+		const int *a = raw(x.data());
+		int *r = raw(result);
+
+		for (size_t i = 0; i < x.size(); i++) {
+			r[i] = sqrtRaw(t, a[i]);
+		}
+	}
+
+	void FixedMath::rsqrt(const FixedSpan &x, Fixed *result) {
+
+		const FixedMathTables &t = tables();
+		const int *a = raw(x.data());
+		int *r = raw(result);
+
+		for (size_t i = 0; i < x.size(); i++) {
+			r[i] = rsqrtRaw(t, a[i]);
+		}
+	}
+
+	void FixedMath::sin(const FixedSpan &x, Fixed *result) {
+
+		const FixedMathTables &t = tables();
+		const int *a = raw(x.data());
+		int *r = raw(result);
+
+		for (size_t i = 0; i < x.size(); i++) {
+			r[i] = sinRaw(t, a[i], 0);
+		}
+	}
+
+	void FixedMath::cos(const FixedSpan &x, Fixed *result) {
+
+		const FixedMathTables &t = tables();
+		const int *a = raw(x.data());
+		int *r = raw(result);
+
+		for (size_t i = 0; i < x.size(); i++) {
+			r[i] = sinRaw(t, a[i], 1);
+		}
+	}
+
+	void FixedMath::atan2(const FixedSpan &y, const FixedSpan &x, Fixed *result) {
+
+		if (y.size() != x.size()) {
+			throw Exception("Fixed arrays differ in size: %lu and %lu!", static_cast<unsigned long>(y.size()),
+				static_cast<unsigned long>(x.size()));
+		}
+
+		const FixedMathTables &t = tables();
+		const int *a = raw(y.data());
+		const int *b = raw(x.data());
+		int *r = raw(result);
+
+		for (size_t i = 0; i < x.size(); i++) {
+			r[i] = atan2Raw(t, a[i], b[i]);
+		}
+	}
+
+	void FixedMath::exp(const FixedSpan &x, Fixed *result) {
+
+		const FixedMathTables &t = tables();
+		const int *a = raw(x.data());
+		int *r = raw(result);
+
+		for (size_t i = 0; i < x.size(); i++) {
+			r[i] = expRaw(t, a[i]);
+		}
+	}
+
+	void FixedMath::log(const FixedSpan &x, Fixed *result) {
+
+		const FixedMathTables &t = tables();
+		const int *a = raw(x.data());
+		int *r = raw(result);
+
+		for (size_t i = 0; i < x.size(); i++) {
+			r[i] = logRaw(t, a[i]);
+		}
+	}
+}
@@ -0,0 +1,108 @@
+/*
+ * $Id$
+ *
+ * Copyright 2008 Carpe Noctem, Distributed Systems Group,
+ * University of Kassel. All right reserved.
+ *
+ * The code is licensed under the Carpe Noctem Userfriendly BSD-Based
+ * License (CNUBBL). Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided that the
+ * conditions of the CNUBBL are met.
+ *
+ * You should have received a copy of the CNUBBL along with this
+ * software. The license is also available on our website:
+ * http://carpenoctem.das-lab.net/license.txt
+ */
+
+#ifndef CASTOR_FIXEDMATH_H
+#define CASTOR_FIXEDMATH_H 1
+
+#include "Fixed.h"
+#include "FixedKernels.h"
+
+namespace castor {
+
+	/**
+	 * Elementary functions of Fixed values in integer arithmetic only.
+	 *
+	 * The functions work with at least 30 bits right of the point
+	 * internally and round the result to nearest. Error bounds are given
+	 * in units of the last place of Fixed (ulp, 2^-16) against the exact
+	 * result and are checked by castor-fixed-bench --accuracy against
+	 * libm. The tables are filled once, on first use.
+	 *
+	 * Every function also exists for arrays. These are plain loops over
+	 * the scalar code, which only saves the calls and the check of the
+	 * tables per value; with table lookups and 64-bit divisions they are
+	 * not vectorized. They give the same results as the scalar functions.
+	 * Operands of atan2() must have the same size, otherwise an Exception
+	 * is thrown.
+	 */
+	class FixedMath {
+
+		public:
+
+			/**
+			 * Square root: an estimate from a table of 192 roots, two Newton
+			 * steps and a last correction. Correctly rounded, within 0.5 ulp.
+			 * 0 for x <= 0.
+			 */
+			static Fixed sqrt(Fixed x);
+
+			/**
+			 * 1 / sqrt(x), from a square root of 31 bits. Within 0.51 ulp.
+			 * The largest Fixed for x <= 0.
+			 */
+			static Fixed rsqrt(Fixed x);
+
+			/**
+			 * Sine of x radians. The angle is reduced with 62 bits of 2/pi,
+			 * then sin(a + d) = sin a cos d + cos a sin d with a from a
+			 * table of 257 values of a quarter wave and a series for d.
+			 * Within 0.51 ulp.
+			 */
+			static Fixed sin(Fixed x);
+
+			/**
+			 * Cosine of x radians, see sin(). Within 0.51 ulp.
+			 */
+			static Fixed cos(Fixed x);
+
+			/**
+			 * Angle of the point (x, y) in (-pi, pi], by 24 CORDIC rotations
+			 * of the point scaled to 41 bits. Within 0.51 ulp. 0 for (0, 0).
+			 */
+			static Fixed atan2(Fixed y, Fixed x);
+
+			/**
+			 * e^x as 2^(x log2 e): 2^k times a table of 2^(i / 256) times a
+			 * series for the rest, with 62 bits right of the point as results
+			 * up to 2^15 need 46 of them. Within 0.51 ulp. The largest Fixed
+			 * for results beyond it.
+			 */
+			static Fixed exp(Fixed x);
+
+			/**
+			 * Natural logarithm: the exponent of x times ln 2 plus a table
+			 * of 256 logarithms and a series for the rest. Within 0.51 ulp.
+			 * The smallest Fixed for x <= 0.
+			 */
+			static Fixed log(Fixed x);
+
+			static void sqrt(const FixedSpan &x, Fixed *result);
+
+			static void rsqrt(const FixedSpan &x, Fixed *result);
+
+			static void sin(const FixedSpan &x, Fixed *result);
+
+			static void cos(const FixedSpan &x, Fixed *result);
+
+			static void atan2(const FixedSpan &y, const FixedSpan &x, Fixed *result);
+
+			static void exp(const FixedSpan &x, Fixed *result);
+
+			static void log(const FixedSpan &x, Fixed *result);
+	};
+}
+
+#endif /* CASTOR_FIXEDMATH_H */
@@ -0,0 +1,201 @@
+/*
+ * $Id$
+ *
+ * Copyright 2008 Carpe Noctem, Distributed Systems Group,
+ * University of Kassel. All right reserved.
+ *
+ * The code is licensed under the Carpe Noctem Userfriendly BSD-Based
+ * License (CNUBBL). Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided that the
+ * conditions of the CNUBBL are met.
+ *
+ * You should have received a copy of the CNUBBL along with this
+ * software. The license is also available on our website:
+ * http://carpenoctem.das-lab.net/license.txt
+ */
+
+#include "SystemConfig.h"
+
+#include <cstdlib>
+#include <climits>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace castor {
+
+	const size_t SystemConfig::ShardCount;
+
+	bool SystemConfig::initialized = false;
+	std::string SystemConfig::rootPath;
+	std::string SystemConfig::libPath;
+	std::string SystemConfig::logPath;
+	std::string SystemConfig::configPath;
+	std::string SystemConfig::hostname;
+	boost::mutex SystemConfig::lock;
+	SystemConfig::Shard SystemConfig::shards[SystemConfig::ShardCount];
+
+	static std::string trimSlash(const std::string &path) {
+
+		std::string::size_type last = path.find_last_not_of('/');
+
+		return (last == std::string::npos ? std::string() : path.substr(0, last + 1));
+	}
+
+	SystemConfig::SystemConfig() {
+		initialize("ES_ROOT", "ES_CONFIG_ROOT");
+	}
+
+	SystemConfig::SystemConfig(const std::string &envRoot, const std::string &envConfigRoot) {
+		initialize(envRoot, envConfigRoot);
+	}
+
+	void SystemConfig::initialize(const std::string &envRoot, const std::string &envConfigRoot) {
+
+		boost::mutex::scoped_lock guard(lock);
+
+		if (initialized) {
+			return;
+		}
+
+		const char *root = getenv(envRoot.c_str());
+		const char *config = getenv(envConfigRoot.c_str());
+
+		if (root != NULL) {
+
+			rootPath = trimSlash(root) + "/";
+
+			if (!exists(rootPath)) {
+				rootPath.clear();
+			}
+		}
+
+		if (rootPath.empty()) {
+
+			// The parent of the directory the executable lives in
+			char executable[PATH_MAX];
+			ssize_t length = readlink("/proc/self/exe", executable, sizeof(executable) - 1);
+
+			if (length > 0) {
+
+				std::string path = trimSlash(std::string(executable, length));
+				path = trimSlash(path.substr(0, path.rfind('/') + 1));
+
+				std::string::size_type slash = path.rfind('/');
+
+				if ((slash != std::string::npos) && (slash > 0)) {
+					rootPath = trimSlash(path.substr(0, slash)) + "/";
+				}
+			}
+
+			if (!exists(rootPath)) {
+				rootPath.clear();
+			}
+		}
+
+		if (config != NULL) {
+			configPath = trimSlash(config) + "/";
+		} else {
+
+			configPath = rootPath + "etc/";
+
+			if (!exists(configPath)) {
+				configPath = "/etc/";
+			}
+		}
+
+		libPath = rootPath + "lib/";
+		logPath = rootPath + "log/";
+
+		char name[HOST_NAME_MAX + 1];
+
+		if (gethostname(name, sizeof(name)) == 0) {
+			name[HOST_NAME_MAX] = '\0';
+			hostname = name;
+		}
+
+		initialized = true;
+	}
+
+	bool SystemConfig::exists(const std::string &path) {
+
+		struct stat st;
+
+		return ((!path.empty()) && (stat(path.c_str(), &st) == 0));
+	}
+
+	std::string SystemConfig::resolve(const std::string &name) const {
+
+		if (name.empty()) {
+			return std::string();
+		}
+
+		std::string filename = configPath + hostname + "/" + name + ".conf";
+
+		if (exists(filename)) {
+			return filename;
+		}
+
+		filename = configPath + name + ".conf";
+
+		if (exists(filename)) {
+			return filename;
+		}
+
+		filename = name + ".conf";
+
+		if (exists(filename)) {
+			return filename;
+		}
+
+		return std::string();
+	}
+
+	ConfigurationPtr SystemConfig::operator[](const std::string &name) {
+
+		Shard &shard = shards[ConfigSymbols::hash(name.data(), name.size()) % ShardCount];
+		boost::shared_ptr<Entry> entry;
+
+		{
+			boost::mutex::scoped_lock guard(shard.mutex);
+
+			boost::shared_ptr<Entry> &slot = shard.entries[name];
+
+			if (slot.get() == NULL) {
+				slot.reset(new Entry());
+			}
+
+			entry = slot;
+		}
+
+		// Threads asking for the same file wait here until it is loaded,
+		// all others are not held up
+		boost::mutex::scoped_lock guard(entry->mutex);
+
+		if (!entry->loaded) {
+
+			std::string filename = resolve(name);
+
+			if (filename.empty()) {
+				return ConfigurationPtr();
+			}
+
+			entry->config.reset(new Configuration(filename));
+			entry->loaded = true;
+		}
+
+		return entry->config;
+	}
+
+	std::string SystemConfig::completePath(std::string path) const {
+
+		if (path.empty()) {
+			return path;
+		}
+
+		path = trimSlash(path) + "/";
+
+		return (path[0] == '/' ? path : rootPath + path);
+	}
+}
+
@@ -0,0 +1,134 @@
+/*
+ * $Id$
+ *
+ * Copyright 2008 Carpe Noctem, Distributed Systems Group,
+ * University of Kassel. All right reserved.
+ *
+ * The code is licensed under the Carpe Noctem Userfriendly BSD-Based
+ * License (CNUBBL). Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided that the
+ * conditions of the CNUBBL are met.
+ *
+ * You should have received a copy of the CNUBBL along with this
+ * software. The license is also available on our website:
+ * http://carpenoctem.das-lab.net/license.txt
+ */
+
+#ifndef CASTOR_SYSTEMCONFIG_H
+#define CASTOR_SYSTEMCONFIG_H 1
+
+#include <map>
+#include <string>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "Configuration.h"
+
+namespace castor {
+
+	typedef boost::shared_ptr<Configuration> ConfigurationPtr;
+
+	/**
+	 * Process-wide registry of the system configuration files, the C++
+	 * counterpart of Castor.SystemConfig. sys["Globals"] looks for
+	 *
+	 *   <configPath>/<hostname>/Globals.conf
+	 *   <configPath>/Globals.conf
+	 *   Globals.conf
+	 *
+	 * in that order. Files are loaded on first access and shared by all
+	 * threads and SystemConfig instances afterwards.
+	 *
+	 * The paths are determined once per process by the first instance: the
+	 * root path from the environment variable given as envRoot (ES_ROOT) or
+	 * the parent of the directory of the executable, the configuration path
+	 * from envConfigRoot (ES_CONFIG_ROOT) or <root>/etc/ or /etc/.
+	 *
+	 * The cache is split into shards with a lock each, and every entry is
+	 * loaded under a lock of its own, so threads only wait for each other if
+	 * they ask for the same file while it is being loaded. The shared
+	 * configurations are read concurrently; changing them requires snapshot
+	 * mode, see Configuration::setSnapshots().
+	 */
+	class SystemConfig {
+
+		protected:
+
+			struct Entry {
+				boost::mutex mutex;
+				bool loaded;
+				ConfigurationPtr config;
+
+				Entry() : mutex(), loaded(false), config() {}
+			};
+
+			struct Shard {
+				boost::mutex mutex;
+				std::map<std::string, boost::shared_ptr<Entry> > entries;
+			};
+
+			static const size_t ShardCount = 16;
+
+			static bool initialized;
+			static std::string rootPath;
+			static std::string libPath;
+			static std::string logPath;
+			static std::string configPath;
+			static std::string hostname;
+			static boost::mutex lock;
+			static Shard shards[ShardCount];
+
+			static void initialize(const std::string &envRoot, const std::string &envConfigRoot);
+			static bool exists(const std::string &path);
+
+		public:
+
+			SystemConfig();
+			SystemConfig(const std::string &envRoot, const std::string &envConfigRoot);
+
+			/**
+			 * Returns the configuration of the given name, loading it if
+			 * necessary.
+			 * @return NULL if there is no such file, files that appear later
+			 * are found on the next call
+			 * @throws ConfigException if the file cannot be parsed
+			 */
+			ConfigurationPtr operator[](const std::string &name);
+
+			/**
+			 * Returns the file the configuration of the given name would be
+			 * loaded from, or an empty string if there is none.
+			 */
+			std::string resolve(const std::string &name) const;
+
+			const std::string &getRootPath() const {
+				return rootPath;
+			}
+
+			const std::string &getLibPath() const {
+				return libPath;
+			}
+
+			const std::string &getLogPath() const {
+				return logPath;
+			}
+
+			const std::string &getConfigPath() const {
+				return configPath;
+			}
+
+			const std::string &getHostname() const {
+				return hostname;
+			}
+
+			/**
+			 * Prepends the root path to the given path unless it is absolute
+			 * and adds a trailing slash.
+			 */
+			std::string completePath(std::string path) const;
+	};
+}
+
+#endif /* CASTOR_SYSTEMCONFIG_H */
+
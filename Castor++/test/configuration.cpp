@@ -1,9 +1,20 @@
 #include "Configuration.h"
+#include "ConfigWatcher.h"
+#include "ConfigBinary.h"
+#include "SystemConfig.h"
 
 #include <stdint.h>
 #include <iostream>
 #include <iomanip>
 #include <string>
+#include <map>
+#include <stdexcept>
+#include <fstream>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/stat.h>
 
 #ifdef NODEBUG
 #undef NODEBUG
@@ -74,6 +85,39 @@ void read_config(const std::string config)
 	CASTOR_CHECK_THROW(names = c.getNames("ahoi", "bhoi", "choi", NULL));
 	CASTOR_CHECK(names.size() == 0);
 
+	// Every distinct name is interned once
+	CASTOR_CHECK(c.getSymbols().size() == 11);
+	CASTOR_CHECK(c.getSymbols().find("choi", 4) != castor::ConfigSymbols::Unknown);
+	CASTOR_CHECK(c.getSymbols().find("nope", 4) == castor::ConfigSymbols::Unknown);
+
+	// Same lookups through the child index
+	c.setIndexThreshold(2);
+	CASTOR_CHECK_THROW(args = c.getAll<bool>("ahoi", "bhoi.choi", "bla", NULL));
+	CASTOR_CHECK(args.size() == 4);
+	CASTOR_CHECK(c.getIndex().isBuilt());
+	CASTOR_CHECK_THROW(sections = c.getSections("ahoi", "bhoi", NULL));
+	CASTOR_CHECK(sections.size() == 2);
+
+	castor::ConfigNode *added = NULL;
+	CASTOR_CHECK_THROW(added = c.create(c.getRoot()->getLastChild(), castor::ConfigNode::Leaf, "bla3", "3"));
+	CASTOR_CHECK(added->getValue().str() == "3");
+	CASTOR_CHECK(c.get<int>("ahoi.bla3", NULL) == 3);
+	c.setIndexThreshold(0);
+
+	// The index is built up front and follows removals
+	castor::Configuration wide("wide", "[s]\na = 1\nb = 2\na = 3\nc = 4\n[!s]\n");
+	wide.setIndexThreshold(3);
+	CASTOR_CHECK(wide.getIndex().isBuilt());
+	CASTOR_CHECK_THROW(wide.remove(wide.query("s.a").at(0)));
+	CASTOR_CHECK(wide.getAll<int>("s.a", NULL).size() == 1);
+	CASTOR_CHECK(wide.get<int>("s.a", NULL) == 3);
+	CASTOR_CHECK_THROW(wide.remove(wide.query("s.c").at(0)));
+	CASTOR_CHECK(wide.tryGet<int>(-1, "s.c", NULL) == -1);
+	CASTOR_CHECK_THROW(wide.create(wide.getRoot()->getFirstChild(), castor::ConfigNode::Leaf, "d", "5"));
+	CASTOR_CHECK(wide.tryGet<int>(-1, "s.c", NULL) == -1);
+	CASTOR_CHECK(wide.get<int>("s.d", NULL) == 5);
+	CASTOR_CHECK(wide.get<int>("s.a", NULL) == 3);
+
 	bool exception = false;
 	try {
 		std::string arg2 = c.get<std::string>("bla", "blubb", "x", "y.z.h.j", NULL);
@@ -85,6 +129,1136 @@ void read_config(const std::string config)
 	std::cout << c.serialize() << std::endl;
 }
 
+void read_content()
+{
+	boost::shared_ptr<std::istream> content(new std::istringstream(
+		"[a]\n"
+		"\tkey=1\n"
+		"\tquoted = \"[not a tag]\"\n"
+		"\tmixed = x\"y\"z\n"
+		"\treal = -2.5e1\n"
+		"\tflag = No\n"
+		"\tbig = 70000\n"
+		"[!a]\n"));
+
+	castor::Configuration c;
+	bool exception = false;
+
+	CASTOR_CHECK_THROW(c.load("content", content, false, false));
+
+	int key = 0;
+	CASTOR_CHECK_THROW(key = c.get<int>("a.key", NULL));
+	CASTOR_CHECK(key == 1);
+
+	std::string quoted;
+	CASTOR_CHECK_THROW(quoted = c.get<std::string>("a.quoted", NULL));
+	CASTOR_CHECK(quoted == "[not a tag]");
+
+	std::string mixed;
+	CASTOR_CHECK_THROW(mixed = c.get<std::string>("a.mixed", NULL));
+	CASTOR_CHECK(mixed == "xyz");
+
+	// Parsed values are cached per leaf and type
+	CASTOR_CHECK(c.get<double>("a.real", NULL) == -25.0);
+	CASTOR_CHECK(c.get<float>("a.real", NULL) == -25.0f);
+	CASTOR_CHECK(!c.get<bool>("a.flag", NULL));
+	CASTOR_CHECK(c.get<double>("a.big", NULL) == 70000.0);
+	CASTOR_CHECK(c.get<int>("a.big", NULL) == 70000);
+	CASTOR_CHECK(c.get<long long>("a.big", NULL) == 70000);
+
+	castor::ConfigNode *big = c.query("a.big").at(0);
+	CASTOR_CHECK(big->isCached(castor::ConfigNode::Real) && big->isCached(castor::ConfigNode::Integer));
+	CASTOR_CHECK(!big->isCached(castor::ConfigNode::Bool));
+	CASTOR_CHECK(big->getCachedInteger() == 70000 && big->getCachedReal() == 70000.0);
+
+	exception = false;
+	try {
+		c.get<short>("a.big", NULL);
+	} catch (const boost::bad_lexical_cast &) {
+		exception = true;
+	}
+	CASTOR_CHECK(exception);
+
+	CASTOR_CHECK_THROW(c.set<std::string>("1e300", "a.real", NULL));
+	CASTOR_CHECK(c.get<double>("a.real", NULL) == 1e300);
+
+	exception = false;
+	try {
+		c.get<float>("a.real", NULL);
+	} catch (const boost::bad_lexical_cast &) {
+		exception = true;
+	}
+	CASTOR_CHECK(exception);
+
+	CASTOR_CHECK_THROW(c.set<int>(42, "a.key", NULL));
+	CASTOR_CHECK_THROW(key = c.get<int>("a.key", NULL));
+	CASTOR_CHECK(key == 42);
+
+	castor::ConfigPath path("a.key");
+	CASTOR_CHECK(c.get<int>(path) == 42);
+	CASTOR_CHECK_THROW(c.set<int>(7, path));
+	CASTOR_CHECK(c.get<int>(path) == 7);
+	CASTOR_CHECK(c.getAll<int>(path).size() == 1);
+
+	castor::ConfigNode *node = NULL;
+	CASTOR_CHECK_THROW(node = c.create(c.getRoot(), castor::ConfigNode::Leaf, "added", "x"));
+	CASTOR_CHECK(node->getParent() == c.getRoot());
+	CASTOR_CHECK(c.get<std::string>("added", NULL) == "x");
+
+	c.clear();
+	CASTOR_CHECK(c.getRoot()->getChildCount() == 0);
+	CASTOR_CHECK(c.tryGet<int>(-1, "a.key", NULL) == -1);
+	CASTOR_CHECK(c.tryGet<int>(-1, path) == -1);
+
+	// Handles re-resolve after the tree has been reloaded
+	CASTOR_CHECK_THROW(c.load("reloaded", boost::shared_ptr<std::istream>(new std::istringstream("[a] key = 3 [!a]")), false, true));
+	CASTOR_CHECK(c.get<int>(path) == 3);
+
+	// Files rewritten in place, also by store(), leave the tree alone
+	char filename[] = "/tmp/castor-test-XXXXXX";
+	int fd = mkstemp(filename);
+	CASTOR_CHECK(fd >= 0);
+	close(fd);
+	{
+		std::ofstream os(filename);
+		os << "[a]\n\tkey=1\n\tother=2\n[!a]\n";
+	}
+
+	castor::Configuration file(filename);
+	{
+		std::ofstream os(filename);
+	}
+	CASTOR_CHECK_THROW(key = file.get<int>("a.other", NULL));
+	CASTOR_CHECK(key == 2);
+	CASTOR_CHECK_THROW(file.store());
+	CASTOR_CHECK_THROW(key = file.get<int>("a.other", NULL));
+	CASTOR_CHECK(key == 2);
+
+	std::ifstream stored(filename);
+	std::string text((std::istreambuf_iterator<char>(stored)), std::istreambuf_iterator<char>());
+	CASTOR_CHECK(text.find("other") != std::string::npos);
+	unlink(filename);
+
+	exception = false;
+	try {
+		castor::Configuration broken("broken", "[a]\n[!b]\n");
+	} catch (const castor::ConfigException &) {
+		exception = true;
+	}
+	CASTOR_CHECK(exception);
+}
+
+void read_snapshots()
+{
+	castor::Configuration c("snapshots", "[a] key = 1 [!a]\n");
+
+	c.setSnapshots(true);
+	CASTOR_CHECK(c.getSnapshots());
+
+	castor::ConfigSnapshot before = c.snapshot();
+	castor::ConfigPath path("a.key");
+
+	// Edits stay private to the writer until they are committed
+	CASTOR_CHECK_THROW(c.set<int>(2, path));
+	CASTOR_CHECK(c.get<int>(path) == 2);
+	CASTOR_CHECK(c.snapshot().get<int>(path) == 1);
+	CASTOR_CHECK(c.create(c.getRoot()->getFirstChild(), castor::ConfigNode::Leaf, "other", "3") != NULL);
+	CASTOR_CHECK(c.get<int>("a.other", NULL) == 3);
+	CASTOR_CHECK(c.snapshot().tryGet<int>(-1, "a.other", NULL) == -1);
+
+	c.commit();
+	CASTOR_CHECK(c.snapshot().get<int>(path) == 2);
+	CASTOR_CHECK(c.snapshot().get<int>("a.other", NULL) == 3);
+
+	// A reload publishes a new tree, old snapshots keep the old one
+	CASTOR_CHECK_THROW(c.load("snapshots", boost::shared_ptr<std::istream>(new std::istringstream("[a] key = 4 [!a]")), false, true));
+	CASTOR_CHECK(c.snapshot().get<int>(path) == 4);
+	CASTOR_CHECK(before.get<int>(path) == 1);
+	CASTOR_CHECK(before.getGeneration() != c.snapshot().getGeneration());
+
+	// Snapshots of a file own their bytes, truncating and reloading the
+	// file does not touch them
+	char filename[] = "/tmp/castor-test-XXXXXX";
+	int fd = mkstemp(filename);
+	CASTOR_CHECK(fd >= 0);
+	close(fd);
+	{
+		std::ofstream os(filename);
+		os << "[a]\n\tkey=5\n\tname=first\n[!a]\n";
+	}
+
+	castor::Configuration file(filename);
+	file.setSnapshots(true);
+	castor::ConfigSnapshot loaded = file.snapshot();
+	{
+		std::ofstream os(filename);
+		os << "[b]\n[!b]\n";
+	}
+	CASTOR_CHECK_THROW(file.reload());
+	CASTOR_CHECK(file.snapshot().tryGet<int>(-1, path) == -1);
+	CASTOR_CHECK(loaded.get<int>(path) == 5);
+	CASTOR_CHECK(loaded.get<std::string>("a.name", NULL) == "first");
+	unlink(filename);
+	CASTOR_CHECK(loaded.get<std::string>("a.name", NULL) == "first");
+}
+
+static void replace_file(const std::string &filename, const std::string &content)
+{
+	std::string temp = filename + ".tmp";
+
+	{
+		std::ofstream os(temp.c_str());
+		os << content;
+	}
+
+	rename(temp.c_str(), filename.c_str());
+}
+
+static std::string read_file(const std::string &filename)
+{
+	std::ifstream is(filename.c_str());
+	std::ostringstream content;
+	content << is.rdbuf();
+	return content.str();
+}
+
+struct ErrorRecorder
+{
+	std::string *error;
+
+	ErrorRecorder(std::string *error) : error(error) {}
+
+	void operator()(castor::Configuration *, const std::string &reason) {
+		*this->error = reason;
+	}
+};
+
+struct Unwatcher
+{
+	castor::ConfigWatcher *watcher;
+	castor::Configuration *config;
+	int *calls;
+
+	Unwatcher(castor::ConfigWatcher *watcher, castor::Configuration *config, int *calls) :
+		watcher(watcher), config(config), calls(calls) {}
+
+	void operator()(const castor::ConfigSnapshot &, const std::string &) {
+		(*this->calls)++;
+		this->watcher->unwatch(*this->config);
+	}
+};
+
+void watch_files()
+{
+	char directory[] = "/tmp/castor-test-XXXXXX";
+	CASTOR_CHECK(mkdtemp(directory) != NULL);
+
+	std::string filename = std::string(directory) + "/watched.conf";
+	replace_file(filename, "# head\n[a]\n    x = 1\n[!a]\n[b]\n    y = 2\n[!b] [c] z = 3 [!c]\n");
+
+	castor::Configuration c(filename);
+	c.setSnapshots(true);
+
+	// Replacing the file only parses the sections that changed
+	replace_file(filename, "# head\n[a]\n    x = 1\n[!a]\n[b]\n    y = 4\n[!b] [c] z = 3 [!c]\nw = 5\n");
+	CASTOR_CHECK_THROW(c.reload());
+	CASTOR_CHECK(c.snapshot().get<int>("a.x", NULL) == 1);
+	CASTOR_CHECK(c.snapshot().get<int>("b.y", NULL) == 4);
+	CASTOR_CHECK(c.snapshot().get<int>("c.z", NULL) == 3);
+	CASTOR_CHECK(c.snapshot().get<int>("w", NULL) == 5);
+	CASTOR_CHECK(c.getRoot()->getChildCount() == 5);
+
+	std::string spelled = std::string(directory) + "/./other.conf";
+	replace_file(spelled, "[o] v = 1 [!o]\n");
+
+	castor::Configuration other(spelled);
+
+	castor::ConfigWatcher watcher(50);
+	watcher.watch(c);
+
+	// A burst of writes results in a single reload
+	replace_file(filename, "[a] x = 6 [!a]\n");
+	replace_file(filename, "[a] x = 7 [!a]\n");
+
+	{
+		std::ofstream os(filename.c_str(), std::ios_base::app);
+		os << "[d] v = 8 [!d]\n";
+	}
+
+	size_t reloads = 0;
+
+	for (int i = 0; (i < 40) && (reloads == 0); i++) {
+		reloads += watcher.poll(100);
+	}
+
+	CASTOR_CHECK(reloads == 1);
+	CASTOR_CHECK(watcher.poll(0) == 0);
+	CASTOR_CHECK(c.snapshot().get<int>("a.x", NULL) == 7);
+	CASTOR_CHECK(c.snapshot().get<int>("d.v", NULL) == 8);
+
+	// The thread of the watcher keeps the previous content on errors
+	std::string error;
+	watcher.setErrorHandler(ErrorRecorder(&error));
+	watcher.start();
+
+	replace_file(filename, "[a] x = 9 [!b]\n");
+
+	for (int i = 0; (i < 40) && (error.empty()); i++) {
+		usleep(50000);
+	}
+
+	watcher.stop();
+
+	CASTOR_CHECK(!error.empty());
+	CASTOR_CHECK(c.snapshot().get<int>("a.x", NULL) == 7);
+
+	// Another spelling of the same directory does not hide the files
+	// watched before, and a file still open for writing is not reloaded
+	watcher.watch(other);
+
+	reloads = 0;
+
+	{
+		std::ofstream os(filename.c_str());
+		os << "[a] x = 10 [!a]\n";
+		os.flush();
+
+		for (int i = 0; i < 3; i++) {
+			reloads += watcher.poll(100);
+		}
+
+		CASTOR_CHECK(reloads == 0);
+	}
+
+	for (int i = 0; (i < 40) && (reloads == 0); i++) {
+		reloads += watcher.poll(100);
+	}
+
+	CASTOR_CHECK(reloads == 1);
+	CASTOR_CHECK(c.snapshot().get<int>("a.x", NULL) == 10);
+
+	// Subscribers may unwatch the configuration that is reloaded
+	int calls = 0;
+	other.subscribe("o", Unwatcher(&watcher, &other, &calls));
+	replace_file(spelled, "[o] v = 2 [!o]\n");
+
+	reloads = 0;
+
+	for (int i = 0; (i < 40) && (reloads == 0); i++) {
+		reloads += watcher.poll(100);
+	}
+
+	CASTOR_CHECK(calls == 1);
+	CASTOR_CHECK(other.get<int>("o.v", NULL) == 2);
+
+	replace_file(spelled, "[o] v = 3 [!o]\n");
+	CASTOR_CHECK(watcher.poll(200) == 0);
+	CASTOR_CHECK(other.get<int>("o.v", NULL) == 2);
+
+	watcher.unwatch(c);
+	unlink(spelled.c_str());
+
+	unlink(filename.c_str());
+	rmdir(directory);
+}
+
+void compile_files()
+{
+	char directory[] = "/tmp/castor-test-XXXXXX";
+	CASTOR_CHECK(mkdtemp(directory) != NULL);
+
+	std::string filename = std::string(directory) + "/compiled.conf";
+	std::string binary = castor::ConfigBinary::getBinaryName(filename);
+
+	replace_file(filename, "[a]\n    # note\n    i = 42\n    r = 2.5\n    s = \"text\"\n    [b] [!b]\n[!a]\n");
+
+	// Writes use a temporary file of their own, not a fixed name
+	std::string taken = binary + ".tmp";
+	CASTOR_CHECK(mkdir(taken.c_str(), 0700) == 0);
+
+	{
+		castor::Configuration c(filename);
+		CASTOR_CHECK_THROW(castor::ConfigBinary::write(*c.getTree(), binary));
+	}
+
+	CASTOR_CHECK(rmdir(taken.c_str()) == 0);
+
+	// The compiled file is newer, so it is loaded instead of the source
+	castor::Configuration c(filename);
+	castor::ConfigNode *leaf = c.getRoot()->getFirstChild()->getFirstChild()->getNext();
+
+	CASTOR_CHECK(c.getFilename() == filename);
+	CASTOR_CHECK(leaf->isCached(castor::ConfigNode::Integer));
+	CASTOR_CHECK(c.get<int>("a.i", NULL) == 42);
+	CASTOR_CHECK(c.get<double>("a.r", NULL) == 2.5);
+	CASTOR_CHECK(c.get<std::string>("a.s", NULL) == "text");
+	CASTOR_CHECK(c.getSections("a", NULL).size() == 1);
+	CASTOR_CHECK(c.getRoot()->getFirstChild()->getChildCount() == 5);
+
+	castor::Configuration direct(binary);
+	CASTOR_CHECK(direct.get<int>("a.i", NULL) == 42);
+
+	// It still refers to the source, text is never written to a compiled file
+	// (a full store is wrapped in [root], see store_files())
+	struct timeval times[2] = { { 1, 0 }, { 1, 0 } };
+	CASTOR_CHECK(utimes(binary.c_str(), times) == 0);
+
+	CASTOR_CHECK(direct.getFilename() == filename);
+	CASTOR_CHECK_THROW(direct.set(44, "a.i", NULL));
+	CASTOR_CHECK_THROW(direct.store());
+	CASTOR_CHECK(castor::ConfigBinary::isBinary(*castor::ConfigBuffer::load(binary)));
+	CASTOR_CHECK(castor::Configuration(filename).get<int>("root.a.i", NULL) == 44);
+
+	CASTOR_CHECK_THROW(direct.store(binary));
+	CASTOR_CHECK(castor::ConfigBinary::isCurrent(binary, filename));
+	CASTOR_CHECK(castor::ConfigBinary::isBinary(*castor::ConfigBuffer::load(binary)));
+	CASTOR_CHECK(castor::Configuration(binary).get<int>("a.i", NULL) == 44);
+
+	// A newer file that is not compiled is no replacement for the source
+	replace_file(binary, "[a] i = 45 [!a]\n");
+	CASTOR_CHECK(castor::Configuration(filename).get<int>("root.a.i", NULL) == 44);
+
+	// A stale compiled file is ignored
+	CASTOR_CHECK(utimes(binary.c_str(), times) == 0);
+
+	replace_file(filename, "[a] i = 43 [!a]\n");
+	CASTOR_CHECK(castor::Configuration(filename).get<int>("a.i", NULL) == 43);
+	CASTOR_CHECK(castor::Configuration(binary).get<int>("a.i", NULL) == 43);
+
+	bool exception = false;
+	try {
+		castor::Configuration broken("broken", std::string("CASTORC\0\2", 9) + std::string(23, '\0'));
+	} catch (const castor::ConfigException &) {
+		exception = true;
+	}
+	CASTOR_CHECK(exception);
+
+	// No temporary files are left behind
+	unlink(binary.c_str());
+	unlink(filename.c_str());
+	CASTOR_CHECK(rmdir(directory) == 0);
+}
+
+void store_files()
+{
+	char directory[] = "/tmp/castor-test-XXXXXX";
+	CASTOR_CHECK(mkdtemp(directory) != NULL);
+
+	std::string filename = std::string(directory) + "/stored.conf";
+
+	// Deeper than the block of spaces used for indentation
+	std::string content;
+	for (int i = 0; i < 20; i++) content += "[s]";
+	content += " k = v ";
+	for (int i = 0; i < 20; i++) content += "[!s]";
+
+	castor::Configuration c("stored", content);
+
+	std::ostringstream os;
+	castor::ConfigStreamSink sink(&os);
+	CASTOR_CHECK_THROW(c.serialize(sink));
+	CASTOR_CHECK(os.str() == c.serialize());
+	CASTOR_CHECK(c.serialize().find(std::string(84, ' ') + "k = v\n") != std::string::npos);
+
+	CASTOR_CHECK_THROW(c.store(filename));
+
+	std::ifstream is(filename.c_str());
+	std::ostringstream stored;
+	stored << is.rdbuf();
+	CASTOR_CHECK(stored.str() == c.serialize());
+
+	// Links are followed, the file they refer to is replaced
+	std::string link = std::string(directory) + "/link.conf";
+	CASTOR_CHECK(symlink("stored.conf", link.c_str()) == 0);
+	CASTOR_CHECK_THROW(c.set<int>(1, "s.s.s.s.s.s.s.s.s.s.s.s.s.s.s.s.s.s.s.s.k", NULL));
+	CASTOR_CHECK_THROW(c.store(link));
+
+	struct stat st;
+	CASTOR_CHECK((lstat(link.c_str(), &st) == 0) && S_ISLNK(st.st_mode));
+	CASTOR_CHECK(castor::Configuration(filename).get<int>("root.s.s.s.s.s.s.s.s.s.s.s.s.s.s.s.s.s.s.s.s.k", NULL) == 1);
+	CASTOR_CHECK(unlink(link.c_str()) == 0);
+
+	// Only the stored file is left behind
+	CASTOR_CHECK(rmdir(directory) != 0);
+	CASTOR_CHECK(unlink(filename.c_str()) == 0);
+	CASTOR_CHECK(rmdir(directory) == 0);
+
+	bool exception = false;
+	try {
+		c.store(filename);
+	} catch (const castor::ConfigException &) {
+		exception = true;
+	}
+	CASTOR_CHECK(exception);
+}
+
+void store_incremental()
+{
+	char directory[] = "/tmp/castor-test-XXXXXX";
+	CASTOR_CHECK(mkdtemp(directory) != NULL);
+
+	std::string filename = std::string(directory) + "/patched.conf";
+	std::string original =
+		"# hand written\n"
+		"[a]\n"
+		"  x = 1\n"
+		"  # keep me\n"
+		"\ty = \"two\"\n"
+		"[!a]\n"
+		"\n"
+		"[b] [c]\n"
+		"        z = 3\n"
+		"[!c] [!b]\n"
+		"top = 4\n";
+
+	replace_file(filename, original);
+
+	castor::Configuration c(filename);
+	CASTOR_CHECK(!c.isDirty());
+	CASTOR_CHECK(c.dirtyPaths().empty());
+
+	// A changed value replaces exactly its own text
+	CASTOR_CHECK_THROW(c.set(42, "a.x", NULL));
+	CASTOR_CHECK_THROW(c.set(43, "a.x", NULL));
+	CASTOR_CHECK(c.isDirty());
+	CASTOR_CHECK(c.dirtyPaths().size() == 1);
+	CASTOR_CHECK(c.dirtyPaths()[0] == "a.x");
+
+	CASTOR_CHECK_THROW(c.store(filename));
+	CASTOR_CHECK(!c.isDirty());
+	CASTOR_CHECK(c.dirtyPaths().empty());
+
+	std::string expected = original;
+	expected.replace(expected.find("x = 1") + 4, 1, "43");
+	CASTOR_CHECK(read_file(filename) == expected);
+
+	// Later stores still patch against the text that has been parsed
+	CASTOR_CHECK_THROW(c.set(std::string("three"), "a.y", NULL));
+	CASTOR_CHECK(c.dirtyPaths().size() == 1);
+	CASTOR_CHECK(c.dirtyPaths()[0] == "a.y");
+	CASTOR_CHECK_THROW(c.store(filename));
+
+	expected.replace(expected.find("two"), 3, "three");
+	CASTOR_CHECK(read_file(filename) == expected);
+
+	// A new node rewrites the top-level section it is in, nothing else
+	CASTOR_CHECK_THROW(c.create(c.query("b.c").at(0), castor::ConfigNode::Leaf, "w", "5"));
+	CASTOR_CHECK(c.dirtyPaths().size() == 1);
+	CASTOR_CHECK(c.dirtyPaths()[0] == "b.c");
+	CASTOR_CHECK_THROW(c.store(filename));
+
+	std::string stored = read_file(filename);
+	CASTOR_CHECK(stored.compare(0, expected.find("[b]"), expected, 0, expected.find("[b]")) == 0);
+	CASTOR_CHECK(stored.find("  x = 43\n  # keep me\n\ty = \"three\"\n") != std::string::npos);
+	CASTOR_CHECK(stored.find("top = 4\n") != std::string::npos);
+
+	// Edits of removed nodes are covered by their section
+	CASTOR_CHECK_THROW(c.set(5, "a.x", NULL));
+	CASTOR_CHECK_THROW(c.remove(c.query("a.x").at(0)));
+	CASTOR_CHECK(c.dirtyPaths().size() == 1);
+	CASTOR_CHECK(c.dirtyPaths()[0] == "a");
+
+	castor::Configuration reloaded(filename);
+	CASTOR_CHECK(reloaded.get<int>("b.c.z", NULL) == 3);
+	CASTOR_CHECK(reloaded.get<int>("b.c.w", NULL) == 5);
+	CASTOR_CHECK(reloaded.get<int>("a.x", NULL) == 43);
+	CASTOR_CHECK(reloaded.get<std::string>("a.y", NULL) == "three");
+
+	// Top-level additions and other files are written in full
+	CASTOR_CHECK_THROW(reloaded.create(reloaded.getRoot(), castor::ConfigNode::Leaf, "bottom", "6"));
+	CASTOR_CHECK_THROW(reloaded.store(filename));
+	CASTOR_CHECK(read_file(filename) == reloaded.serialize());
+
+	// Snapshot mode patches the committed tree; full stores are wrapped in [root]
+	castor::Configuration s(filename);
+	s.setSnapshots(true);
+	CASTOR_CHECK_THROW(s.set(7, "root.bottom", NULL));
+	CASTOR_CHECK_THROW(s.commit());
+	CASTOR_CHECK(s.dirtyPaths().size() == 1);
+
+	expected = reloaded.serialize();
+	expected.replace(expected.find("bottom = 6") + 9, 1, "7");
+	CASTOR_CHECK_THROW(s.store(filename));
+	CASTOR_CHECK(read_file(filename) == expected);
+	CASTOR_CHECK(!s.isDirty());
+
+	CASTOR_CHECK(unlink(filename.c_str()) == 0);
+	CASTOR_CHECK(rmdir(directory) == 0);
+}
+
+void diff_patch()
+{
+	std::string before =
+		"# fleet\n"
+		"[robot1]\n    id = 1\n    speed = 10\n[!robot1]\n"
+		"[robot2]\n    id = 2\n    speed = 20\n    tag = x\n    tag = y\n[!robot2]\n"
+		"mode = fast\n"
+		"limit = 5\n";
+
+	std::string after =
+		"[robot1]\n    # checked\n    id = 1\n    speed = 10\n[!robot1]\n"
+		"[robot2]\n    id = 2\n    speed = 25\n    tag = x\n    gain = 3\n[!robot2]\n"
+		"limit = 5\n"
+		"[mode]\n    kind = fast\n[!mode]\n"
+		"[robot3]\n    id = 3\n[!robot3]\n";
+
+	castor::Configuration a("before", before);
+	castor::Configuration b("after", after);
+	castor::Configuration copy("copy", before);
+
+	// Equal content has equal hashes, comments aside
+	CASTOR_CHECK(a.getHash() == copy.getHash());
+	CASTOR_CHECK(a.getHash() != b.getHash());
+	CASTOR_CHECK(a.getTree()->getHash(a.query("robot1").at(0)) == b.getTree()->getHash(b.query("robot1").at(0)));
+	CASTOR_CHECK(castor::ConfigSnapshot::diff(a, copy).empty());
+
+	// Changes update the hashes of the subtrees they are in
+	unsigned long long hash = copy.getHash();
+	CASTOR_CHECK_THROW(copy.set(11, "robot1.speed", NULL));
+	CASTOR_CHECK(copy.getHash() != hash);
+	CASTOR_CHECK_THROW(copy.set(10, "robot1.speed", NULL));
+	CASTOR_CHECK(copy.getHash() == hash);
+
+	CASTOR_CHECK_THROW(copy.remove(copy.query("robot2.tag").at(1)));
+	CASTOR_CHECK(copy.getAll<std::string>("robot2.tag", NULL).size() == 1);
+	CASTOR_CHECK(copy.getHash() != hash);
+
+	castor::ConfigPatch patch = castor::ConfigSnapshot::diff(a, b);
+	CASTOR_CHECK(patch.size() == 8);
+
+	CASTOR_CHECK(patch[0].kind == castor::ConfigChange::Changed);
+	CASTOR_CHECK(patch[0].path == "robot2.speed");
+	CASTOR_CHECK(patch[0].previous == "20");
+	CASTOR_CHECK(patch[0].value == "25");
+	CASTOR_CHECK(patch[1].kind == castor::ConfigChange::Added);
+	CASTOR_CHECK(patch[1].path == "robot2.gain");
+	CASTOR_CHECK(patch[2].kind == castor::ConfigChange::Removed);
+	CASTOR_CHECK(patch[2].path == "robot2.tag");
+	CASTOR_CHECK(patch[2].previous == "y");
+
+	// A value that became a section is replaced
+	CASTOR_CHECK(patch[3].kind == castor::ConfigChange::Removed);
+	CASTOR_CHECK(patch[3].path == "mode");
+	CASTOR_CHECK(patch[4].kind == castor::ConfigChange::Added);
+	CASTOR_CHECK(patch[4].type == castor::ConfigNode::Node);
+	CASTOR_CHECK(patch[5].path == "mode.kind");
+	CASTOR_CHECK(patch[5].parent == 4);
+	CASTOR_CHECK(patch[6].path == "robot3");
+	CASTOR_CHECK(patch[7].path == "robot3.id");
+
+	// Nothing is changed if the patch does not fit
+	castor::Configuration other("other", "limit = 5\n");
+	bool exception = false;
+	try {
+		other.apply(patch);
+	} catch (const castor::ConfigException &) {
+		exception = true;
+	}
+	CASTOR_CHECK(exception);
+	CASTOR_CHECK(other.getRoot()->getChildCount() == 1);
+
+	CASTOR_CHECK_THROW(a.apply(patch));
+	CASTOR_CHECK(castor::ConfigSnapshot::diff(a, b).empty());
+	CASTOR_CHECK(a.getHash() == b.getHash());
+	CASTOR_CHECK(a.get<int>("robot3.id", NULL) == 3);
+	CASTOR_CHECK(a.get<std::string>("mode.kind", NULL) == "fast");
+	CASTOR_CHECK(a.getAll<std::string>("robot2.tag", NULL).size() == 1);
+
+	// Added nodes keep their position among their siblings
+	castor::Configuration gap("gap", "[s]\n    x = 1\n    z = 3\n[!s]\n");
+	castor::Configuration full("full", "[s]\n    x = 1\n    y = 2\n    z = 3\n[!s]\n[t] w = 4 [!t]\n");
+
+	castor::ConfigPatch inserted = castor::ConfigSnapshot::diff(gap, full);
+	CASTOR_CHECK(inserted[0].path == "s.y");
+	CASTOR_CHECK(inserted[0].after.name == "x");
+	CASTOR_CHECK_THROW(gap.apply(inserted));
+	CASTOR_CHECK(gap.getHash() == full.getHash());
+	CASTOR_CHECK(gap.getRoot()->getFirstChild()->getFirstChild()->getNext()->getValue().str() == "2");
+
+	castor::Configuration first("first", "[s]\n    z = 3\n[!s]\n");
+	CASTOR_CHECK_THROW(first.apply(castor::ConfigSnapshot::diff(first, gap)));
+	CASTOR_CHECK(first.getHash() == full.getHash());
+
+	// Siblings of the same name that change their order are moved
+	castor::Configuration moved("moved", "[s]\n    P = 1\n    Q = 2\n    P = 3\n[!s]\n");
+	castor::Configuration target("target", "[s]\n    Q = 2\n    P = 3\n    Z = 9\n[!s]\n");
+	CASTOR_CHECK_THROW(moved.apply(castor::ConfigSnapshot::diff(moved, target)));
+	CASTOR_CHECK(moved.getHash() == target.getHash());
+	CASTOR_CHECK(castor::ConfigSnapshot::diff(moved, target).empty());
+
+	castor::Configuration swapped("swapped", "[s]\n    x = 1\n    y = 2\n    x = 3\n    y = 4\n[!s]\n");
+	castor::Configuration order("order", "[s]\n    y = 2\n    x = 1\n    y = 4\n    x = 3\n[!s]\n");
+	castor::ConfigPatch reordered = castor::ConfigSnapshot::diff(swapped, order);
+	CASTOR_CHECK(!reordered.empty() && (swapped.getHash() != order.getHash()));
+	CASTOR_CHECK_THROW(swapped.apply(reordered));
+	CASTOR_CHECK(swapped.getHash() == order.getHash());
+	CASTOR_CHECK(castor::ConfigSnapshot::diff(swapped, order).empty());
+
+	// In snapshot mode a patch is published by commit()
+	castor::Configuration s("snapshots", before);
+	s.setSnapshots(true);
+	castor::ConfigSnapshot published = s.snapshot();
+	CASTOR_CHECK_THROW(s.apply(patch));
+	CASTOR_CHECK(s.snapshot().getHash() == published.getHash());
+	CASTOR_CHECK_THROW(s.commit());
+	CASTOR_CHECK(s.snapshot().getHash() == b.getHash());
+	CASTOR_CHECK(castor::ConfigSnapshot::diff(published, s.snapshot()).size() == 8);
+}
+
+struct CachedReader
+{
+	castor::ConfigSnapshot snapshot;
+	long long *sum;
+
+	CachedReader(const castor::ConfigSnapshot &snapshot, long long *sum) : snapshot(snapshot), sum(sum) {}
+
+	void operator()() {
+		for (int i = 0; i < 1000; i++) {
+			*this->sum += this->snapshot.get<int>("Drive.Motor.maxSpeed", NULL);
+		}
+	}
+};
+
+void thread_cache()
+{
+	castor::Configuration c("cached", "[Drive] [Motor] maxSpeed = 5 [!Motor] [!Drive]\n");
+	c.setThreadCache(true);
+	CASTOR_CHECK(c.getThreadCache());
+
+	castor::ConfigCache::Statistics before = castor::ConfigCache::getStatistics();
+
+	CASTOR_CHECK(c.get<int>("Drive.Motor.maxSpeed", NULL) == 5);
+	CASTOR_CHECK(c.get<int>("Drive", "Motor", "maxSpeed") == 5);
+	CASTOR_CHECK(c.get<int>("Drive.Motor", "maxSpeed") == 5);
+	CASTOR_CHECK(c.tryGet<int>(7, "Drive.Motor.minSpeed", NULL) == 7);
+	CASTOR_CHECK(c.tryGet<int>(7, "Drive.Motor.minSpeed", NULL) == 7);
+
+	castor::ConfigCache::Statistics after = castor::ConfigCache::getStatistics();
+	CASTOR_CHECK(after.misses - before.misses == 2);
+	CASTOR_CHECK(after.hits - before.hits == 3);
+
+	// Values are read from the cached nodes, new nodes invalidate them
+	CASTOR_CHECK_THROW(c.set(6, "Drive.Motor.maxSpeed", NULL));
+	CASTOR_CHECK(c.get<int>("Drive.Motor.maxSpeed", NULL) == 6);
+
+	CASTOR_CHECK_THROW(c.create(c.query("Drive.Motor").at(0), castor::ConfigNode::Leaf, "minSpeed", "1"));
+	CASTOR_CHECK(c.tryGet<int>(7, "Drive.Motor.minSpeed", NULL) == 1);
+
+	CASTOR_CHECK_THROW(c.load("cached", boost::shared_ptr<std::istream>(new std::istringstream("[Drive] [Motor] maxSpeed = 8 [!Motor] [!Drive]\n")), false, true));
+	CASTOR_CHECK(c.get<int>("Drive.Motor.maxSpeed", NULL) == 8);
+	CASTOR_CHECK(c.tryGet<int>(7, "Drive.Motor.minSpeed", NULL) == 7);
+
+	// Every thread fills its own table
+	c.setSnapshots(true);
+	castor::ConfigSnapshot snapshot = c.snapshot();
+	CASTOR_CHECK(snapshot.getThreadCache());
+
+	before = castor::ConfigCache::getStatistics();
+
+	std::vector<long long> sums(4, 0);
+	boost::thread_group group;
+
+	for (size_t i = 0; i < sums.size(); i++) {
+		group.create_thread(CachedReader(snapshot, &sums[i]));
+	}
+
+	group.join_all();
+
+	after = castor::ConfigCache::getStatistics();
+	CASTOR_CHECK(after.misses - before.misses == 4);
+	CASTOR_CHECK(after.hits - before.hits == 4 * 999);
+
+	for (size_t i = 0; i < sums.size(); i++) {
+		CASTOR_CHECK(sums[i] == 8000);
+	}
+
+	// Disabled by default
+	castor::Configuration plain("plain", "x = 1\n");
+	CASTOR_CHECK(!plain.getThreadCache());
+	before = castor::ConfigCache::getStatistics();
+	CASTOR_CHECK(plain.get<int>("x", NULL) == 1);
+	after = castor::ConfigCache::getStatistics();
+	CASTOR_CHECK(after.hits + after.misses == before.hits + before.misses);
+}
+
+struct Recorder
+{
+	std::map<std::string, int> *calls;
+	std::string *value;
+
+	Recorder(std::map<std::string, int> *calls, std::string *value) : calls(calls), value(value) {}
+
+	void operator()(const castor::ConfigSnapshot &snapshot, const std::string &path) {
+
+		(*this->calls)[path]++;
+
+		castor::ConfigSnapshot copy(snapshot);
+		*this->value = copy.tryGet<std::string>("", "Vision.fps", NULL);
+	}
+};
+
+struct Thrower
+{
+	void operator()(const castor::ConfigSnapshot &, const std::string &) {
+		throw std::runtime_error("broken");
+	}
+};
+
+struct Queue
+{
+	std::vector<boost::function<void ()> > *tasks;
+
+	Queue(std::vector<boost::function<void ()> > *tasks) : tasks(tasks) {}
+
+	void operator()(const boost::function<void ()> &task) {
+		this->tasks->push_back(task);
+	}
+};
+
+void subscriptions()
+{
+	castor::Configuration c("subscribed",
+		"[Drive]\n    [Motor]\n        maxSpeed = 5\n        gain = 1\n    [!Motor]\n[!Drive]\n"
+		"[Vision]\n    fps = 30\n[!Vision]\n");
+
+	std::map<std::string, int> calls;
+	std::string fps;
+	Recorder recorder(&calls, &fps);
+
+	c.subscribe("Drive", recorder);
+	c.subscribe("Drive.Motor.*", recorder);
+	c.subscribe("Vision.fps", recorder);
+	size_t missing = c.subscribe("Missing", recorder);
+
+	// Changes are announced once per commit
+	CASTOR_CHECK_THROW(c.set(6, "Drive.Motor.maxSpeed", NULL));
+	CASTOR_CHECK_THROW(c.set(2, "Drive.Motor.gain", NULL));
+	CASTOR_CHECK(calls.empty());
+	CASTOR_CHECK_THROW(c.commit());
+	CASTOR_CHECK(calls.size() == 2);
+	CASTOR_CHECK(calls["Drive"] == 1);
+	CASTOR_CHECK(calls["Drive.Motor.*"] == 1);
+
+	CASTOR_CHECK_THROW(c.commit());
+	CASTOR_CHECK_THROW(c.set(6, "Drive.Motor.maxSpeed", NULL));
+	CASTOR_CHECK_THROW(c.commit());
+	CASTOR_CHECK(calls["Drive"] == 1);
+
+	// Only the subscribers of changed subtrees are called after a load
+	calls.clear();
+	CASTOR_CHECK_THROW(c.load("subscribed", boost::shared_ptr<std::istream>(new std::istringstream(
+		"[Drive]\n    # tuned\n    [Motor]\n        maxSpeed = 6\n        gain = 2\n    [!Motor]\n[!Drive]\n"
+		"[Vision]\n    fps = 60\n[!Vision]\n")), false, true));
+	CASTOR_CHECK(calls.size() == 1);
+	CASTOR_CHECK(calls["Vision.fps"] == 1);
+	CASTOR_CHECK(fps == "60");
+
+	CASTOR_CHECK_THROW(c.create(c.getRoot(), castor::ConfigNode::Node, "Missing"));
+	CASTOR_CHECK_THROW(c.commit());
+	CASTOR_CHECK(calls["Missing"] == 1);
+	c.unsubscribe(missing);
+
+	// In snapshot mode as well, the executor gets one task per commit
+	std::vector<boost::function<void ()> > tasks;
+	c.setSnapshots(true);
+	c.setExecutor(Queue(&tasks));
+	calls.clear();
+
+	CASTOR_CHECK_THROW(c.set(25, "Vision.fps", NULL));
+	CASTOR_CHECK_THROW(c.set(7, "Drive.Motor.maxSpeed", NULL));
+	CASTOR_CHECK_THROW(c.create(c.getRoot(), castor::ConfigNode::Leaf, "Missing", "1"));
+	CASTOR_CHECK_THROW(c.commit());
+	CASTOR_CHECK(calls.empty());
+	CASTOR_CHECK(tasks.size() == 1);
+	CASTOR_CHECK_THROW(tasks[0]());
+	CASTOR_CHECK(calls.size() == 3);
+	CASTOR_CHECK(fps == "25");
+
+	// A failing subscriber does not keep the others from being called
+	c.setExecutor(castor::Configuration::Executor());
+	c.subscribe("Drive", Thrower());
+	calls.clear();
+
+	CASTOR_CHECK_THROW(c.set(8, "Drive.Motor.maxSpeed", NULL));
+
+	bool exception = false;
+	try {
+		c.commit();
+	} catch (const castor::ConfigException &) {
+		exception = true;
+	}
+	CASTOR_CHECK(exception);
+	CASTOR_CHECK(calls["Drive"] == 1);
+	CASTOR_CHECK(calls["Drive.Motor.*"] == 1);
+	CASTOR_CHECK(c.snapshot().get<int>("Drive.Motor.maxSpeed", NULL) == 8);
+}
+
+void parse_parallel()
+{
+	std::ostringstream content;
+
+	content << "# fleet\n";
+	for (int i = 0; i < 200; i++) {
+		content << "[robot" << i << "]\n    id = " << i << "\n    name = \"r[" << i << "]\"\n";
+		content << "    [drive] speed = " << (i * 2) << " [!drive]\n[!robot" << i << "]" << (i % 3 == 0 ? " " : "\n");
+	}
+	content << "global = 1\n";
+
+	castor::Configuration serial("fleet", content.str());
+
+	castor::Configuration parallel;
+	parallel.setParseThreads(4, 0);
+	CASTOR_CHECK(parallel.getParseThreads() == 4);
+	CASTOR_CHECK_THROW(parallel.load("fleet", boost::shared_ptr<std::istream>(new std::istringstream(content.str())), false, true));
+
+	CASTOR_CHECK(parallel.serialize() == serial.serialize());
+	CASTOR_CHECK(parallel.getRoot()->getChildCount() == 202);
+	CASTOR_CHECK(parallel.get<int>("robot150.drive.speed", NULL) == 300);
+	CASTOR_CHECK(parallel.get<std::string>("robot7.name", NULL) == "r[7]");
+	CASTOR_CHECK(parallel.getAll<int>("robot3.id", NULL).size() == 1);
+
+	// Errors are reported with their line in the whole file
+	std::string broken = content.str() + "[tail]\n[!tail]\n";
+	broken.replace(broken.find("[!robot120]"), 11, "[!robot121]");
+
+	std::string serialError;
+	std::string parallelError;
+
+	try {
+		castor::Configuration c("fleet", broken);
+	} catch (const castor::ConfigException &e) {
+		serialError = e.what();
+	}
+
+	try {
+		parallel.load("fleet", boost::shared_ptr<std::istream>(new std::istringstream(broken)), false, true);
+	} catch (const castor::ConfigException &e) {
+		parallelError = e.what();
+	}
+
+	CASTOR_CHECK(!serialError.empty());
+	CASTOR_CHECK(parallelError == serialError);
+	CASTOR_CHECK(parallel.get<int>("robot150.drive.speed", NULL) == 300);
+}
+
+void variadic_paths()
+{
+	// Literal keys are split and hashed by the compiler
+	static constexpr castor::ConfigKey motor("Drive.Motor");
+	static_assert(motor.getCount() == 2, "split at compile time");
+	static_assert(motor.getComponent(1).hash == castor::ConfigSymbols::hash("Motor", 5), "hashed at compile time");
+	static_assert(castor::ConfigKeyArgument<char[12]>::get("Drive.Motor").getComponent(1).hash == motor.getComponent(1).hash,
+		"inline literals are constant expressions");
+
+	castor::Configuration c("variadic",
+		"[Drive] [Motor] maxSpeed = 300 [!Motor] [Motor] maxSpeed = 200 [!Motor] [!Drive]\n"
+		"[a] [b] [c] [d] [e] [f] [g] [h] [i] x = 9 [!i] [!h] [!g] [!f] [!e] [!d] [!c] [!b] [!a]\n");
+
+	CASTOR_CHECK(c.get<int>("Drive", "Motor", "maxSpeed") == 300);
+	CASTOR_CHECK(c.get<int>(castor::ConfigKey("Drive.Motor.maxSpeed")) == 300);
+	CASTOR_CHECK(c.get<int>(motor, "maxSpeed") == 300);
+	CASTOR_CHECK(c.get<int>("Drive.Motor", "maxSpeed", NULL) == 300);
+
+	// The former API keeps its signature
+	int (castor::ConfigSnapshot::*former)(const char *, ...) = &castor::ConfigSnapshot::get<int>;
+	CASTOR_CHECK((c.*former)("Drive.Motor.maxSpeed", NULL) == 300);
+	CASTOR_CHECK(c.getAll<int>(motor, "maxSpeed").size() == 2);
+
+	std::string name("Drive.Motor");
+	const char *leaf = "maxSpeed";
+	CASTOR_CHECK(c.get<int>(name, leaf) == 300);
+
+	// More components than a key splits in advance
+	CASTOR_CHECK(c.get<int>(castor::ConfigKey("a.b.c.d.e.f.g.h.i.x")) == 9);
+	CASTOR_CHECK(c.get<int>("a.b.c.d.e.f.g.h.i", "x") == 9);
+	CASTOR_CHECK(c.tryGet<int>(-1, castor::ConfigKey("a.b.c.d.e.f.g.h.i.y")) == -1);
+
+	CASTOR_CHECK(c.getSections(castor::ConfigKey("Drive")).size() == 2);
+	CASTOR_CHECK(c.getNames(motor, "maxSpeed").size() == 2);
+	CASTOR_CHECK(c.tryGet<int>(-1, "Drive", "Wheel") == -1);
+	CASTOR_CHECK(c.tryGetAll<int>(-1, "Drive", "Wheel")->size() == 1);
+
+	CASTOR_CHECK_THROW(c.set<int>(100, motor, "maxSpeed"));
+	CASTOR_CHECK(c.get<int>(castor::ConfigKey("Drive.Motor.maxSpeed")) == 100);
+
+	std::string message;
+	try {
+		c.get<int>("Drive", "Wheel.radius");
+	} catch (const castor::ConfigException &e) {
+		message = e.what();
+	}
+	CASTOR_CHECK(message.find("'Drive.Wheel.radius'") != std::string::npos);
+}
+
+void batch_reads()
+{
+	castor::Configuration c("batch",
+		"[Drive] [Motor]\nmaxSpeed = 300\ngain = 0.5\nname = left\n[!Motor] [Motor] maxSpeed = 200 [!Motor] [!Drive]\n"
+		"[Other]\nx = 1\ny = text\n[!Other]\n");
+
+	int maxSpeed = 0;
+	double gain = 0.0;
+	std::string name;
+	int missing = 0;
+	int fallback = 0;
+	int invalid = 0;
+	std::string x;
+
+	castor::ConfigBatch batch;
+	size_t first = batch.add("Drive.Motor.maxSpeed", &maxSpeed);
+	batch.add("Drive.Motor.gain", &gain);
+	batch.add("Drive.Motor.name", &name);
+	size_t absent = batch.add("Drive.Motor.missing", &missing);
+	size_t unknown = batch.add("Drive.Wheel.radius", &fallback, 7);
+	size_t broken = batch.add("Other.y", &invalid, 3);
+	batch.add("Other.x", &x);
+
+	CASTOR_CHECK(batch.size() == 7);
+	CASTOR_CHECK(!c.read(batch));
+
+	// Same results as single lookups
+	CASTOR_CHECK(maxSpeed == c.get<int>("Drive.Motor.maxSpeed", NULL));
+	CASTOR_CHECK(gain == 0.5);
+	CASTOR_CHECK(name == "left");
+	CASTOR_CHECK(x == "1");
+	CASTOR_CHECK(batch.isFound(first));
+	CASTOR_CHECK(batch.getError(first).empty());
+
+	// Misses and conversion errors are reported per entry
+	CASTOR_CHECK(!batch.isFound(absent));
+	CASTOR_CHECK(batch.getError(absent).find("'Drive.Motor.missing'") != std::string::npos);
+	CASTOR_CHECK(!batch.isFound(unknown));
+	CASTOR_CHECK(batch.getError(unknown).empty());
+	CASTOR_CHECK(fallback == 7);
+	CASTOR_CHECK(batch.isFound(broken));
+	CASTOR_CHECK(!batch.getError(broken).empty());
+	CASTOR_CHECK(invalid == 3);
+	CASTOR_CHECK(batch.getErrors().size() == 2);
+
+	// Indexed sections, read again after a reload
+	c.setIndexThreshold(2);
+	c.load("batch", boost::shared_ptr<std::istream>(new std::istringstream(
+		"[Drive] [Motor]\nmaxSpeed = 100\ngain = 2.5\nname = right\nmissing = 4\n[!Motor] [!Drive]\n"
+		"[Other]\nx = 2\ny = 5\n[!Other]\n")), false, true);
+
+	CASTOR_CHECK(c.read(batch));
+	CASTOR_CHECK(maxSpeed == 100);
+	CASTOR_CHECK(gain == 2.5);
+	CASTOR_CHECK(name == "right");
+	CASTOR_CHECK(missing == 4);
+	CASTOR_CHECK(invalid == 5);
+	CASTOR_CHECK(x == "2");
+	CASTOR_CHECK(batch.getErrors().empty());
+}
+
+void query_patterns()
+{
+	const char *content =
+		"[Sensors]\n"
+		"# Front sensors\n"
+		"[Left] [Calibration]\noffset = 1\n[!Calibration] [!Left]\n"
+		"[Right] [Calibration]\noffset = 2\n[!Calibration] [!Right]\n"
+		"[Rear] [Raw]\noffset = 9\n[!Raw] [!Rear]\n"
+		"[!Sensors]\n"
+		"[Team]\nip = 10.0.0.1\n"
+		"[Robot] [Net]\nip = 10.0.0.2\n[!Net] [Net]\nip = 10.0.0.3\n[!Net] [!Robot]\n"
+		"[!Team]\n";
+
+	for (unsigned int threshold = 0; threshold <= 1; threshold++) {
+
+		castor::Configuration c;
+		c.setIndexThreshold(threshold);
+		c.load("query", boost::shared_ptr<std::istream>(new std::istringstream(content)), false, true);
+
+		std::vector<int> offsets = c.queryAll<int>("Sensors.*.Calibration.offset");
+		CASTOR_CHECK(offsets.size() == 2);
+		CASTOR_CHECK((offsets[0] == 1) && (offsets[1] == 2));
+
+		// Comments do not match *
+		CASTOR_CHECK(c.query("Sensors.*").size() == 3);
+
+		// ** matches any number of levels, every node once and in order
+		std::vector<std::string> ips = c.queryAll<std::string>("Team.**.ip");
+		CASTOR_CHECK(ips.size() == 3);
+		CASTOR_CHECK((ips[0] == "10.0.0.1") && (ips[2] == "10.0.0.3"));
+		CASTOR_CHECK(c.query("**.ip").size() == 3);
+		CASTOR_CHECK(c.query("**.**.Net.**.ip").size() == 2);
+		CASTOR_CHECK(c.query("**.offset").size() == 3);
+		CASTOR_CHECK(c.query("Sensors.**.Calibration.*").size() == 2);
+
+		CASTOR_CHECK(c.query("Team.Robot.Net.ip").size() == 2);
+		CASTOR_CHECK(c.query("Team.*.Unknown").empty());
+		CASTOR_CHECK(c.query("Nothing.**").empty());
+		// All sections and values including the root, no comments
+		CASTOR_CHECK(c.query("**").size() == 18);
+	}
+}
+
+struct SystemConfigReader
+{
+	castor::ConfigurationPtr *result;
+
+	SystemConfigReader(castor::ConfigurationPtr *result) : result(result) {}
+
+	void operator()() {
+		castor::SystemConfig sys;
+		*this->result = sys["Globals"];
+	}
+};
+
+void system_config()
+{
+	char directory[] = "/tmp/castor-test-XXXXXX";
+	CASTOR_CHECK(mkdtemp(directory) != NULL);
+
+	setenv("ES_CONFIG_ROOT", directory, 1);
+
+	castor::SystemConfig sys;
+	CASTOR_CHECK(sys.getConfigPath() == std::string(directory) + "/");
+
+	std::string host = sys.getConfigPath() + sys.getHostname();
+	CASTOR_CHECK(mkdir(host.c_str(), 0755) == 0);
+
+	replace_file(host + "/Globals.conf", "[Globals] host = 1 [!Globals]\n");
+	replace_file(sys.getConfigPath() + "Globals.conf", "[Globals] host = 0 [!Globals]\n");
+	replace_file(sys.getConfigPath() + "Drive.conf", "[Drive] speed = 3 [!Drive]\n");
+
+	// Host specific files come first, all threads share one instance
+	std::vector<castor::ConfigurationPtr> results(8);
+	boost::thread_group group;
+
+	for (size_t i = 0; i < results.size(); i++) {
+		group.create_thread(SystemConfigReader(&results[i]));
+	}
+
+	group.join_all();
+
+	CASTOR_CHECK(results[0].get() != NULL);
+	CASTOR_CHECK(results[0]->get<int>("Globals.host", NULL) == 1);
+
+	for (size_t i = 1; i < results.size(); i++) {
+		CASTOR_CHECK(results[i] == results[0]);
+	}
+
+	CASTOR_CHECK(sys["Globals"] == results[0]);
+	CASTOR_CHECK(sys["Drive"]->get<int>("Drive.speed", NULL) == 3);
+	CASTOR_CHECK(sys.resolve("Drive") == sys.getConfigPath() + "Drive.conf");
+
+	CASTOR_CHECK(sys["Missing"].get() == NULL);
+	replace_file(sys.getConfigPath() + "Missing.conf", "[Missing] x = 1 [!Missing]\n");
+	CASTOR_CHECK(sys["Missing"].get() != NULL);
+
+	CASTOR_CHECK(sys.completePath("/abs//") == "/abs/");
+	CASTOR_CHECK(sys.completePath("rel") == sys.getRootPath() + "rel/");
+
+	unlink((host + "/Globals.conf").c_str());
+	rmdir(host.c_str());
+	unlink((sys.getConfigPath() + "Globals.conf").c_str());
+	unlink((sys.getConfigPath() + "Drive.conf").c_str());
+	unlink((sys.getConfigPath() + "Missing.conf").c_str());
+	rmdir(directory);
+}
+
 int main(int argc, char *argv[])
 {
 	if (argc < 2)
@@ -94,4 +1268,18 @@ int main(int argc, char *argv[])
 	}
 
 	read_config(std::string(argv[1]) + "/test-configuration.conf");
+	read_content();
+	read_snapshots();
+	watch_files();
+	compile_files();
+	store_files();
+	parse_parallel();
+	system_config();
+	variadic_paths();
+	batch_reads();
+	query_patterns();
+	store_incremental();
+	diff_patch();
+	thread_cache();
+	subscriptions();
 }
@@ -0,0 +1,195 @@
+#include "DateTime.h"
+#include "Exception.h"
+
+#include <stdint.h>
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+#include <cstdlib>
+#include <sys/time.h>
+
+#ifdef NODEBUG
+#undef NODEBUG
+#endif /* NODEBUG */
+#include <cassert>
+
+#define CASTOR_CHECK_INIT														\
+	static uint32_t count = 0;													
+
+#define CASTOR_CHECK(n)															\
+{																				\
+	std::cout << std::setw(4) << std::setfill('0')								\
+		<< count++ << " Checking '" << #n << "'" << std::endl;					\
+	assert(n);																	\
+}
+
+#define CASTOR_CHECK_THROW(n)													\
+try																				\
+{																				\
+	std::cout << std::setw(4) << std::setfill('0')								\
+		<< count++ << " Checking '" << #n << "'" << std::endl;					\
+	n;																			\
+}																				\
+catch (const std::exception &e)													\
+{																				\
+	std::cout << std::endl;														\
+	std::cout << __func__ << ": " << __FILE__ << ":" << __LINE__ << ": "		\
+		<< "Caught exception " << e.what() << std::endl;						\
+	exit(1);																	\
+}																				\
+catch (...)																		\
+{																				\
+	std::cout << std::endl;														\
+	std::cout << __func__ << ": " << __FILE__ << ":" << __LINE__ << ": "		\
+		<< "Caught unknown exception " << std::endl;							\
+	exit(1);																	\
+}
+
+
+CASTOR_CHECK_INIT
+
+
+void date_time()
+{
+	using castor::DateTime;
+
+	CASTOR_CHECK(DateTime::getClock() == DateTime::Realtime);
+	CASTOR_CHECK(DateTime::setClock(DateTime::Tsc) == (DateTime::isTscAvailable() ? DateTime::Tsc : DateTime::Realtime));
+	CASTOR_CHECK(DateTime::setClock(static_cast<DateTime::Clock>(7)) == DateTime::Realtime);
+
+	// Every source is close to the wall clock, in ticks of 100 ns
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	long long wall = ((static_cast<long long>(tv.tv_sec) + EPOCH_ADJUST) * 1000000 + tv.tv_usec) * 10;
+
+	const DateTime::Clock clocks[] = { DateTime::Realtime, DateTime::Monotonic, DateTime::Coarse, DateTime::Tsc };
+	for (size_t c = 0; c < sizeof(clocks) / sizeof(clocks[0]); c++)
+	{
+		CASTOR_CHECK(DateTime::setClock(clocks[c]) == clocks[c] || clocks[c] == DateTime::Tsc);
+		CASTOR_CHECK(std::llabs(DateTime::getUtcNow().getTicks() - wall) < 10000000LL);
+		CASTOR_CHECK(std::llabs(static_cast<long long>(DateTime::getUtcNowC()) - wall) < 10000000LL);
+		CASTOR_CHECK(std::llabs(DateTime::getUtcNow(clocks[c]).getTicks() - wall) < 10000000LL);
+	}
+
+	// Monotonic never goes back, Realtime and Tsc resolve below a microsecond
+	bool forward = true;
+	long long previous = DateTime::getUtcNow(DateTime::Monotonic).getTicks();
+	for (int i = 0; i < 100000; i++)
+	{
+		long long ticks = DateTime::getUtcNow(DateTime::Monotonic).getTicks();
+		forward = forward && (ticks >= previous);
+		previous = ticks;
+	}
+	CASTOR_CHECK(forward);
+
+	bool fine = false;
+	previous = DateTime::getUtcNow(DateTime::Tsc).getTicks();
+	for (int i = 0; (i < 100000) && !fine; i++)
+	{
+		long long ticks = DateTime::getUtcNow(DateTime::Tsc).getTicks();
+		fine = (ticks > previous) && (ticks - previous < 10);
+		previous = ticks;
+	}
+	CASTOR_CHECK(fine);
+
+	CASTOR_CHECK(DateTime::setClock(DateTime::Realtime) == DateTime::Realtime);
+}
+
+void date_format()
+{
+	using castor::DateTime;
+
+	char buffer[DateTime::IsoLength];
+	DateTime t = DateTime::fromCalendar(2009, 6, 15, 13, 45, 30, 1234567);
+
+	// The Unix epoch and the ends of the range
+	CASTOR_CHECK(DateTime::fromCalendar(1970, 1, 1).getTicks() == EPOCH_ADJUST * DateTime::TicksPerSecond);
+	CASTOR_CHECK(DateTime::fromCalendar(1, 1, 1).getTicks() == 0);
+	CASTOR_CHECK(DateTime::fromCalendar(10000, 1, 1).getTicks() == DateTime::MaxTicks + 1);
+	CASTOR_CHECK(DateTime::fromCalendar(2009, 13, 1) == DateTime::fromCalendar(2010, 1, 1));
+
+	CASTOR_CHECK(t.formatIso(buffer, sizeof(buffer)) == 28 && strcmp(buffer, "2009-06-15T13:45:30.1234567Z") == 0);
+	CASTOR_CHECK(t.formatIso(buffer, sizeof(buffer), 3) == 24 && strcmp(buffer, "2009-06-15T13:45:30.123Z") == 0);
+	CASTOR_CHECK(t.formatIso(buffer, sizeof(buffer), 0) == 20 && strcmp(buffer, "2009-06-15T13:45:30Z") == 0);
+	CASTOR_CHECK(t.formatCompact(buffer, sizeof(buffer)) == 24 && strcmp(buffer, "20090615T134530.1234567Z") == 0);
+	CASTOR_CHECK(DateTime(0).formatIso(buffer, sizeof(buffer), 1) == 22 && strcmp(buffer, "0001-01-01T00:00:00.0Z") == 0);
+	CASTOR_CHECK(DateTime(DateTime::MaxTicks).formatIso(buffer, sizeof(buffer)) == 28
+		&& strcmp(buffer, "9999-12-31T23:59:59.9999999Z") == 0);
+
+	// Too small a buffer or out of range
+	CASTOR_CHECK(t.formatIso(buffer, 28) == 0 && buffer[0] == '\0');
+	CASTOR_CHECK(t.formatCompact(buffer, DateTime::CompactLength) == 24);
+	CASTOR_CHECK(DateTime(-1).formatIso(buffer, sizeof(buffer)) == 0);
+
+	// The cached prefix follows seconds and days
+	CASTOR_CHECK(t.add(8 * DateTime::TicksPerSecond).formatIso(buffer, sizeof(buffer), 0) == 20
+		&& strcmp(buffer, "2009-06-15T13:45:38Z") == 0);
+	CASTOR_CHECK(t.add(DateTime::TicksPerDay).formatCompact(buffer, sizeof(buffer), 0) == 16
+		&& strcmp(buffer, "20090616T134530Z") == 0);
+	CASTOR_CHECK(t.formatIso(buffer, sizeof(buffer), 0) == 20 && strcmp(buffer, "2009-06-15T13:45:30Z") == 0);
+
+	// Parsing what was formatted, and other forms
+	DateTime parsed(0);
+	const char *iso = "2009-06-15T13:45:30.1234567Z";
+	CASTOR_CHECK(DateTime::parse(iso, strlen(iso), &parsed) && parsed == t);
+	const char *compact = "20090615T134530.1234567Z";
+	CASTOR_CHECK(DateTime::parse(compact, strlen(compact), &parsed) && parsed == t);
+	const char *zoned = "2009-06-15 15:45:30.123456789+02:00";
+	CASTOR_CHECK(DateTime::parse(zoned, strlen(zoned), &parsed) && parsed == t);
+	const char *date = "2009-06-15";
+	CASTOR_CHECK(DateTime::parse(date, strlen(date), &parsed) && parsed == DateTime::fromCalendar(2009, 6, 15));
+	const char *leap = "2008-02-29T00:00:00";
+	CASTOR_CHECK(DateTime::parse(leap, strlen(leap), &parsed) && parsed == DateTime::fromCalendar(2008, 2, 29));
+
+	const char *invalid[] = { "", "2009", "2009-06-1", "2009-0615", "2009-02-29", "2009-06-15T24:00:00",
+		"2009-06-15T13:45", "2009-06-15T13:45:30.", "2009-06-15T13:45:30Zx", "2009-06-15T13:45:30+2" };
+	bool rejected = true;
+	for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++)
+	{
+		rejected = rejected && !DateTime::parse(invalid[i], strlen(invalid[i]), &parsed);
+	}
+	CASTOR_CHECK(rejected);
+
+	// Round trips over the whole range
+	bool same = true;
+	for (long long ticks = 0; ticks <= DateTime::MaxTicks; ticks += DateTime::MaxTicks / 9973)
+	{
+		size_t length = DateTime(ticks).formatIso(buffer, sizeof(buffer));
+		same = same && DateTime::parse(buffer, length, &parsed) && (parsed.getTicks() == ticks);
+		length = DateTime(ticks).formatCompact(buffer, sizeof(buffer));
+		same = same && DateTime::parse(buffer, length, &parsed) && (parsed.getTicks() == ticks);
+	}
+	CASTOR_CHECK(same);
+
+	// Arithmetic
+	int year, month, day, hour, minute, second;
+	long long fraction;
+	t.getCalendar(&year, &month, &day, &hour, &minute, &second, &fraction);
+	CASTOR_CHECK(year == 2009 && month == 6 && day == 15 && hour == 13 && minute == 45 && second == 30 && fraction == 1234567);
+
+	CASTOR_CHECK(t.truncate(DateTime::TicksPerSecond) == DateTime::fromCalendar(2009, 6, 15, 13, 45, 30));
+	CASTOR_CHECK(t.truncate(DateTime::TicksPerDay) == DateTime::fromCalendar(2009, 6, 15));
+	CASTOR_CHECK(t.truncate(7 * DateTime::TicksPerDay) == DateTime::fromCalendar(2009, 6, 15));
+	CASTOR_CHECK(DateTime(-1).truncate(DateTime::TicksPerSecond).getTicks() == -DateTime::TicksPerSecond);
+
+	bool exception = false;
+	try {
+		t.truncate(0);
+	} catch (const castor::Exception &e) {
+		exception = true;
+	}
+	CASTOR_CHECK(exception);
+
+	CASTOR_CHECK(t.add(DateTime::TicksPerHour).diff(t) == DateTime::TicksPerHour);
+	CASTOR_CHECK(t.addMonths(7) == DateTime::fromCalendar(2010, 1, 15, 13, 45, 30, 1234567));
+	CASTOR_CHECK(t.addMonths(-18) == DateTime::fromCalendar(2007, 12, 15, 13, 45, 30, 1234567));
+	CASTOR_CHECK(DateTime::fromCalendar(2008, 1, 31).addMonths(1) == DateTime::fromCalendar(2008, 2, 29));
+	CASTOR_CHECK(DateTime::fromCalendar(2008, 2, 29).addYears(1) == DateTime::fromCalendar(2009, 2, 28));
+	CASTOR_CHECK(t < t.add(1) && t.add(1) > t && t <= t && t >= t && t != t.add(1));
+}
+
+int main()
+{
+	date_time();
+	date_format();
+}
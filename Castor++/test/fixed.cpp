@@ -0,0 +1,349 @@
+#include "FixedKernels.h"
+#include "FixedMath.h"
+#include "Exception.h"
+
+#include <stdint.h>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstring>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+
+#ifdef NODEBUG
+#undef NODEBUG
+#endif /* NODEBUG */
+#include <cassert>
+
+#define CASTOR_CHECK_INIT														\
+	static uint32_t count = 0;													
+
+#define CASTOR_CHECK(n)															\
+{																				\
+	std::cout << std::setw(4) << std::setfill('0')								\
+		<< count++ << " Checking '" << #n << "'" << std::endl;					\
+	assert(n);																	\
+}
+
+#define CASTOR_CHECK_THROW(n)													\
+try																				\
+{																				\
+	std::cout << std::setw(4) << std::setfill('0')								\
+		<< count++ << " Checking '" << #n << "'" << std::endl;					\
+	n;																			\
+}																				\
+catch (const std::exception &e)													\
+{																				\
+	std::cout << std::endl;														\
+	std::cout << __func__ << ": " << __FILE__ << ":" << __LINE__ << ": "		\
+		<< "Caught exception " << e.what() << std::endl;						\
+	exit(1);																	\
+}																				\
+catch (...)																		\
+{																				\
+	std::cout << std::endl;														\
+	std::cout << __func__ << ": " << __FILE__ << ":" << __LINE__ << ": "		\
+		<< "Caught unknown exception " << std::endl;							\
+	exit(1);																	\
+}
+
+
+CASTOR_CHECK_INIT
+
+
+static inline uint32_t xorshift(uint32_t *state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+
+	return *state;
+}
+
+void fixed_kernels()
+{
+	using castor::Fixed;
+	using castor::FixedKernels;
+	using castor::FixedVector;
+
+	// Not a multiple of the vector width, so the scalar tail runs as well
+	const size_t n = 1003;
+	uint32_t state = 2463534242u;
+
+	// Small values stay clear of overflow, where the scalar operators are
+	// undefined, large ones check that every level wraps the same way
+	FixedVector small(n), large(n), other(n), divisor(n);
+	std::vector<float> floats(n);
+	std::vector<double> doubles(n);
+
+	for (size_t i = 0; i < n; i++) {
+		small[i] = Fixed::fromRaw(static_cast<int>(xorshift(&state) % 0x1000000) - 0x800000);
+		other[i] = Fixed::fromRaw(static_cast<int>(xorshift(&state) % 0x1000000) - 0x800000);
+		large[i] = Fixed::fromRaw(static_cast<int>(xorshift(&state)));
+		divisor[i] = Fixed::fromRaw(static_cast<int>(xorshift(&state) % 0x100000) + 0x1000);
+		floats[i] = (static_cast<int>(xorshift(&state) % 2000001) - 1000000) / 997.0f;
+		doubles[i] = (static_cast<int>(xorshift(&state) % 2000001) - 1000000) / 997.0;
+	}
+
+	small[0] = other[0];
+	floats[1] = 1e12f;
+	floats[2] = -1e12f;
+	floats[3] = NAN;
+	doubles[1] = 40000.0;
+	doubles[2] = -32768.0;
+
+	FixedVector result(n);
+	std::vector<unsigned char> mask(n);
+	std::vector<float> convertedFloats(n);
+	std::vector<double> convertedDoubles(n);
+
+	// The scalar level as reference, against the scalar operators
+	CASTOR_CHECK(FixedKernels::setLevel(FixedKernels::Scalar) == FixedKernels::Scalar);
+
+	FixedKernels::mul(small, other, &result[0]);
+	bool same = true;
+	for (size_t i = 0; i < n; i++) same = same && (result[i] == small[i] * other[i]);
+	CASTOR_CHECK(same);
+
+	FixedKernels::div(small, divisor, &result[0]);
+	same = true;
+	for (size_t i = 0; i < n; i++) same = same && (result[i] == small[i] / divisor[i]);
+	CASTOR_CHECK(same);
+
+	result = small;
+	FixedKernels::mac(other, Fixed(0.5f), &result[0]);
+	same = true;
+	for (size_t i = 0; i < n; i++) same = same && (result[i] == small[i] + other[i] * Fixed(0.5f));
+	CASTOR_CHECK(same);
+
+	FixedKernels::fromFloat(&floats[0], n, &result[0]);
+	same = true;
+	for (size_t i = 4; i < n; i++) same = same && (result[i] == Fixed(floats[i]));
+	CASTOR_CHECK(same);
+	CASTOR_CHECK(result[1].getRaw() == INT_MIN && result[2].getRaw() == INT_MIN && result[3].getRaw() == INT_MIN);
+
+	FixedKernels::toDouble(small, &convertedDoubles[0]);
+	CASTOR_CHECK(convertedDoubles[5] == static_cast<double>(small[5]));
+
+	FixedKernels::less(small, other, &mask[0]);
+	CASTOR_CHECK(mask[0] == 0 && mask[5] == (small[5] < other[5]));
+
+	// Every level gives the same bits as the scalar one
+	std::vector<std::vector<int> > reference;
+
+	for (int level = FixedKernels::Scalar; level <= FixedKernels::AVX2; level++) {
+
+		if (FixedKernels::setLevel(static_cast<FixedKernels::Level>(level)) != level) {
+			std::cout << "Level " << level << " is not supported" << std::endl;
+			break;
+		}
+
+		std::vector<int> bits;
+		const FixedVector *operands[] = { &small, &large };
+
+		for (size_t j = 0; j < 2; j++) {
+
+			const FixedVector &a = *operands[j];
+
+			FixedKernels::add(a, other, &result[0]);
+			for (size_t i = 0; i < n; i++) bits.push_back(result[i].getRaw());
+			FixedKernels::sub(a, other, &result[0]);
+			for (size_t i = 0; i < n; i++) bits.push_back(result[i].getRaw());
+			FixedKernels::mul(a, large, &result[0]);
+			for (size_t i = 0; i < n; i++) bits.push_back(result[i].getRaw());
+			FixedKernels::mul(a, Fixed(-1.75), &result[0]);
+			for (size_t i = 0; i < n; i++) bits.push_back(result[i].getRaw());
+			result = large;
+			FixedKernels::mac(a, other, &result[0]);
+			for (size_t i = 0; i < n; i++) bits.push_back(result[i].getRaw());
+			FixedKernels::mac(a, Fixed(3), &result[0]);
+			for (size_t i = 0; i < n; i++) bits.push_back(result[i].getRaw());
+			FixedKernels::div(a, divisor, &result[0]);
+			for (size_t i = 0; i < n; i++) bits.push_back(result[i].getRaw());
+			FixedKernels::less(a, other, &mask[0]);
+			bits.insert(bits.end(), mask.begin(), mask.end());
+			FixedKernels::equal(a, small, &mask[0]);
+			bits.insert(bits.end(), mask.begin(), mask.end());
+			FixedKernels::greater(a, other, &mask[0]);
+			bits.insert(bits.end(), mask.begin(), mask.end());
+
+			FixedKernels::toFloat(a, &convertedFloats[0]);
+			for (size_t i = 0; i < n; i++) {
+				int value;
+				memcpy(&value, &convertedFloats[i], sizeof(value));
+				bits.push_back(value);
+			}
+
+			FixedKernels::toDouble(a, &convertedDoubles[0]);
+			for (size_t i = 0; i < n; i++) bits.push_back(static_cast<int>(convertedDoubles[i] * 65536.0));
+		}
+
+		FixedKernels::fromFloat(&floats[0], n, &result[0]);
+		for (size_t i = 0; i < n; i++) bits.push_back(result[i].getRaw());
+		FixedKernels::fromDouble(&doubles[0], n, &result[0]);
+		for (size_t i = 0; i < n; i++) bits.push_back(result[i].getRaw());
+
+		// Results may overwrite an operand
+		result = small;
+		FixedKernels::add(result, other, &result[0]);
+		for (size_t i = 0; i < n; i++) bits.push_back(result[i].getRaw());
+
+		reference.push_back(bits);
+	}
+
+	for (size_t level = 1; level < reference.size(); level++) {
+		CASTOR_CHECK(reference[level] == reference[0]);
+	}
+
+	FixedKernels::setLevel(FixedKernels::getSupportedLevel());
+	CASTOR_CHECK(FixedKernels::getLevel() == FixedKernels::getSupportedLevel());
+
+	bool exception = false;
+	try {
+		FixedKernels::add(small, castor::FixedSpan(&other[0], n - 1), &result[0]);
+	} catch (const castor::Exception &) {
+		exception = true;
+	}
+	CASTOR_CHECK(exception);
+}
+
+void fixed_point()
+{
+	using castor::Fixed;
+
+	typedef castor::FixedPoint<15, 16, castor::FixedSaturate, castor::FixedRound> Saturated;
+	typedef castor::FixedPoint<31, 32> Wide;
+	typedef castor::FixedPoint<7, 24> Narrow;
+
+	// Arithmetic works at compile time
+	constexpr Fixed folded = Fixed(1.5) * Fixed(2.25) + Fixed(3) / Fixed(1.5) - 0.5f * Fixed(1.5);
+	CASTOR_CHECK(folded == 4.625);
+	CASTOR_CHECK(sizeof(Fixed) == 4 && sizeof(Wide) == 8);
+
+	// Float constructors scale by STEP, which used to be an int of 0
+	CASTOR_CHECK(Fixed(0.25f).getRaw() == 0x4000);
+	CASTOR_CHECK(Fixed(-0.25).getRaw() == -0x4000);
+	CASTOR_CHECK(static_cast<double>(Fixed::fromRaw(1)) == Fixed::STEP);
+
+	// Products with floats keep all bits right of the point
+	CASTOR_CHECK(Fixed::fromRaw(3) * 0.5f == Fixed::fromRaw(1));
+	CASTOR_CHECK(Fixed::fromRaw(0x10001) * 3.0 == Fixed::fromRaw(0x30003));
+
+	// Truncation rounds down, rounding to nearest
+	CASTOR_CHECK(Fixed(-1) / Fixed(3) == Fixed::fromRaw(-21846));
+	CASTOR_CHECK(Saturated(-1) / Saturated(3) == Saturated::fromRaw(-21845));
+	CASTOR_CHECK(Fixed::fromRaw(-3) * Fixed(0.5) == Fixed::fromRaw(-2));
+	CASTOR_CHECK(Saturated::fromRaw(-3) * Saturated(0.5) == Saturated::fromRaw(-2));
+	CASTOR_CHECK(Saturated::fromRaw(3) * Saturated(0.5) == Saturated::fromRaw(2));
+	CASTOR_CHECK(Fixed(1.99999999).getRaw() == 0x1ffff);
+	CASTOR_CHECK(Saturated(1.99999999).getRaw() == 0x20000);
+
+	// Wrapping and saturation
+	CASTOR_CHECK(Fixed(30000) + Fixed(30000) == Fixed(60000 - 65536));
+	CASTOR_CHECK(Saturated(30000) + Saturated(30000) == Saturated::getMax());
+	CASTOR_CHECK(Saturated(-300) * Saturated(300) == Saturated::getMin());
+	CASTOR_CHECK(Saturated(1) / Saturated(0) == Saturated::getMax());
+	CASTOR_CHECK(-Saturated::getMin() == Saturated::getMax());
+	CASTOR_CHECK(Saturated(1e12) == Saturated::getMax());
+	CASTOR_CHECK(Saturated(100000) == Saturated::getMax());
+	CASTOR_CHECK(Fixed(1e12f) == Fixed::getMin());
+
+	// 64 bit storage multiplies and divides in 128 bits
+	Wide big(1000000);
+	CASTOR_CHECK(static_cast<long>(big * Wide(1000)) == 1000000000);
+	CASTOR_CHECK(static_cast<double>(Wide(1) / Wide(3)) == static_cast<double>(Wide::fromRaw(0x55555555)));
+
+	// Between formats, with the target's policies
+	CASTOR_CHECK(Wide(Fixed(-2.5)) == -2.5);
+	CASTOR_CHECK(Fixed(Narrow(0.1)).getRaw() == 6553);
+	CASTOR_CHECK(Saturated(Narrow(0.1)).getRaw() == 6554);
+	CASTOR_CHECK(Narrow(Saturated(200)) == Narrow(200 - 256));
+	CASTOR_CHECK((castor::FixedPoint<7, 24, castor::FixedSaturate>(Fixed(200)) == castor::FixedPoint<7, 24, castor::FixedSaturate>::getMax()));
+
+	int i = 7;
+	i += Fixed(0.5);
+	double d = 1.0;
+	d *= Fixed(1.5);
+	CASTOR_CHECK(i == 7 && d == 1.5);
+}
+
+void fixed_math()
+{
+	using castor::Fixed;
+	using castor::FixedMath;
+
+	// Within about half a step of libm, checked on a sweep of every domain
+	double worst = 0.0;
+	for (long long raw = 1; raw <= INT_MAX; raw += 2147483)
+	{
+		Fixed x = Fixed::fromRaw(static_cast<int>(raw));
+		worst = std::max(worst, std::fabs(static_cast<double>(FixedMath::sqrt(x)) - std::sqrt(static_cast<double>(x))));
+		worst = std::max(worst, std::fabs(static_cast<double>(FixedMath::log(x)) - std::log(static_cast<double>(x))));
+	}
+	for (int raw = -10 * 65536; raw < 10 * 65536; raw += 997)
+	{
+		Fixed x = Fixed::fromRaw(raw);
+		worst = std::max(worst, std::fabs(static_cast<double>(FixedMath::sin(x)) - std::sin(static_cast<double>(x))));
+		worst = std::max(worst, std::fabs(static_cast<double>(FixedMath::cos(x)) - std::cos(static_cast<double>(x))));
+		worst = std::max(worst, std::fabs(static_cast<double>(FixedMath::exp(x)) - std::exp(static_cast<double>(x))));
+		worst = std::max(worst, std::fabs(static_cast<double>(FixedMath::atan2(x, Fixed(-3))) - std::atan2(static_cast<double>(x), -3.0)));
+	}
+	CASTOR_CHECK(worst <= 0.51 * Fixed::STEP);
+
+	// Exact where the result is a Fixed
+	CASTOR_CHECK(FixedMath::sqrt(Fixed(2.25)) == 1.5);
+	CASTOR_CHECK(FixedMath::rsqrt(Fixed(4)) == 0.5);
+	CASTOR_CHECK(FixedMath::exp(Fixed(0)) == Fixed(1) && FixedMath::log(Fixed(1)) == Fixed(0));
+
+	// Edges of the domains
+	CASTOR_CHECK(FixedMath::sqrt(Fixed(-1)) == Fixed(0));
+	CASTOR_CHECK(FixedMath::rsqrt(Fixed(0)) == Fixed::getMax());
+	CASTOR_CHECK(FixedMath::log(Fixed(0)) == Fixed::getMin());
+	CASTOR_CHECK(FixedMath::exp(Fixed(11)) == Fixed::getMax());
+	CASTOR_CHECK(FixedMath::exp(Fixed(-20)) == Fixed(0));
+	CASTOR_CHECK(FixedMath::atan2(Fixed(0), Fixed(0)) == Fixed(0));
+	CASTOR_CHECK(FixedMath::atan2(Fixed(0), Fixed(-1)) == Fixed(M_PI));
+
+	// Arrays give the scalar results
+	const size_t size = 1000;
+	castor::FixedVector a(size), b(size), result(size);
+	uint32_t state = 2463534242u;
+	for (size_t i = 0; i < size; i++)
+	{
+		a[i] = Fixed::fromRaw(static_cast<int>(xorshift(&state)) >> 8);
+		b[i] = Fixed::fromRaw(static_cast<int>(xorshift(&state)) >> 4);
+	}
+
+	bool same = true;
+	FixedMath::sqrt(a, &result[0]);
+	for (size_t i = 0; i < size; i++) same = same && (result[i] == FixedMath::sqrt(a[i]));
+	FixedMath::rsqrt(a, &result[0]);
+	for (size_t i = 0; i < size; i++) same = same && (result[i] == FixedMath::rsqrt(a[i]));
+	FixedMath::sin(b, &result[0]);
+	for (size_t i = 0; i < size; i++) same = same && (result[i] == FixedMath::sin(b[i]));
+	FixedMath::cos(b, &result[0]);
+	for (size_t i = 0; i < size; i++) same = same && (result[i] == FixedMath::cos(b[i]));
+	FixedMath::atan2(a, b, &result[0]);
+	for (size_t i = 0; i < size; i++) same = same && (result[i] == FixedMath::atan2(a[i], b[i]));
+	FixedMath::exp(a, &result[0]);
+	for (size_t i = 0; i < size; i++) same = same && (result[i] == FixedMath::exp(a[i]));
+	FixedMath::log(a, &result[0]);
+	for (size_t i = 0; i < size; i++) same = same && (result[i] == FixedMath::log(a[i]));
+	CASTOR_CHECK(same);
+
+	bool exception = false;
+	try {
+		FixedMath::atan2(a, castor::FixedSpan(&b[0], size - 1), &result[0]);
+	} catch (const castor::Exception &) {
+		exception = true;
+	}
+	CASTOR_CHECK(exception);
+}
+
+int main()
+{
+	fixed_kernels();
+	fixed_point();
+	fixed_math();
+}
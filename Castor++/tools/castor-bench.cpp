@@ -0,0 +1,625 @@
+/*
+ * $Id$
+ *
+ * Copyright 2008 Carpe Noctem, Distributed Systems Group,
+ * University of Kassel. All right reserved.
+ *
+ * The code is licensed under the Carpe Noctem Userfriendly BSD-Based
+ * License (CNUBBL). Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided that the
+ * conditions of the CNUBBL are met.
+ *
+ * You should have received a copy of the CNUBBL along with this
+ * software. The license is also available on our website:
+ * http://carpenoctem.das-lab.net/license.txt
+ */
+
+/*
+ * Microbenchmarks for Configuration. Generates a synthetic configuration,
+ * measures the latency of every single operation and reports throughput and
+ * percentiles, optionally as JSON to track results across commits.
+ */
+
+#include "Configuration.h"
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+struct Options
+{
+	unsigned int depth;
+	unsigned int width;
+	unsigned int keys;
+	unsigned int valueSize;
+	unsigned int iterations;
+	unsigned int repeat;
+	unsigned int seed;
+	unsigned int index;
+	unsigned int threads;
+	std::string output;
+	std::string label;
+	std::string directory;
+
+	Options() :
+		depth(3), width(4), keys(10000), valueSize(16), iterations(100000), repeat(20), seed(1), index(0), threads(1),
+		output(), label(), directory("/tmp")
+	{
+	}
+};
+
+struct Result
+{
+	std::string operation;
+	std::vector<double> samples;
+	double total;
+	size_t bytes;
+
+	Result(const std::string &operation) :
+		operation(operation), samples(), total(0), bytes(0)
+	{
+	}
+
+	double percentile(double p) const {
+
+		if (this->samples.empty()) return 0;
+
+		size_t index = static_cast<size_t>(p * (this->samples.size() - 1) + 0.5);
+		return this->samples[index];
+	}
+
+	double mean() const {
+		return (this->samples.empty() ? 0 : this->total / this->samples.size());
+	}
+};
+
+/**
+ * Synthetic configuration: width^depth leaf sections, keys distributed
+ * round-robin among them. Even keys hold integers, odd keys strings.
+ */
+struct Generated
+{
+	std::string content;
+	std::vector<std::string> integers;
+	std::vector<std::string> sections;
+};
+
+static inline uint64_t now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
+
+static inline uint32_t next(uint32_t *state)
+{
+	// xorshift32, deterministic across platforms
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+
+	return *state;
+}
+
+static void generate(const Options &options, const std::string &path, unsigned int level, unsigned int *leaf,
+	unsigned int leaves, Generated *generated)
+{
+	std::string indent(4 * level, ' ');
+
+	if (level == options.depth) {
+
+		for (unsigned int key = *leaf; key < options.keys; key += leaves) {
+
+			std::ostringstream name;
+			name << "k" << key;
+
+			if (key % 2 == 0) {
+				generated->content += indent + name.str() + " = " + boost::lexical_cast<std::string>(key) + "\n";
+				generated->integers.push_back(path + name.str());
+			} else {
+				generated->content += indent + name.str() + " = " + std::string(options.valueSize, 'v') + "\n";
+			}
+		}
+
+		(*leaf)++;
+
+		return;
+	}
+
+	if (level + 1 == options.depth) {
+		generated->sections.push_back(path.empty() ? std::string("s0") : path.substr(0, path.size() - 1));
+	}
+
+	for (unsigned int i = 0; i < options.width; i++) {
+
+		std::ostringstream name;
+		name << "s" << i;
+
+		generated->content += indent + "[" + name.str() + "]\n";
+		generate(options, path + name.str() + ".", level + 1, leaf, leaves, generated);
+		generated->content += indent + "[!" + name.str() + "]\n";
+	}
+}
+
+static void finish(Result *result)
+{
+	std::sort(result->samples.begin(), result->samples.end());
+}
+
+static void report(const Options &options, const std::vector<Result> &results, size_t size)
+{
+	std::cout << "keys " << options.keys << ", depth " << options.depth << ", width " << options.width
+		<< ", value size " << options.valueSize << ", index " << options.index << ", threads " << options.threads << ", " << size << " bytes" << std::endl;
+
+	std::cout << std::setw(14) << std::left << "operation" << std::right
+		<< std::setw(10) << "count" << std::setw(14) << "ops/s" << std::setw(10) << "MB/s"
+		<< std::setw(12) << "mean ns" << std::setw(12) << "p50 ns" << std::setw(12) << "p90 ns"
+		<< std::setw(12) << "p99 ns" << std::setw(12) << "p99.9 ns" << std::setw(12) << "max ns" << std::endl;
+
+	for (size_t i = 0; i < results.size(); i++) {
+
+		const Result &r = results[i];
+
+		std::cout << std::setw(14) << std::left << r.operation << std::right << std::fixed << std::setprecision(0)
+			<< std::setw(10) << r.samples.size()
+			<< std::setw(14) << (r.samples.size() * 1e9 / r.total)
+			<< std::setw(10) << std::setprecision(1) << (r.bytes * 1e3 / r.total) << std::setprecision(0)
+			<< std::setw(12) << r.mean() << std::setw(12) << r.percentile(0.5) << std::setw(12) << r.percentile(0.9)
+			<< std::setw(12) << r.percentile(0.99) << std::setw(12) << r.percentile(0.999)
+			<< std::setw(12) << r.percentile(1.0) << std::endl;
+	}
+
+	if (options.output.empty()) {
+		return;
+	}
+
+	std::ofstream os(options.output.c_str());
+
+	os << std::fixed << std::setprecision(1);
+	os << "{\n";
+	os << "  \"label\": \"" << options.label << "\",\n";
+	os << "  \"keys\": " << options.keys << ",\n";
+	os << "  \"depth\": " << options.depth << ",\n";
+	os << "  \"width\": " << options.width << ",\n";
+	os << "  \"value_size\": " << options.valueSize << ",\n";
+	os << "  \"index\": " << options.index << ",\n";
+	os << "  \"threads\": " << options.threads << ",\n";
+	os << "  \"bytes\": " << size << ",\n";
+	os << "  \"results\": [\n";
+
+	for (size_t i = 0; i < results.size(); i++) {
+
+		const Result &r = results[i];
+
+		os << "    { \"operation\": \"" << r.operation << "\", \"count\": " << r.samples.size()
+			<< ", \"ops_per_sec\": " << (r.samples.size() * 1e9 / r.total)
+			<< ", \"mb_per_sec\": " << (r.bytes * 1e3 / r.total)
+			<< ", \"mean_ns\": " << r.mean() << ", \"p50_ns\": " << r.percentile(0.5)
+			<< ", \"p90_ns\": " << r.percentile(0.9) << ", \"p99_ns\": " << r.percentile(0.99)
+			<< ", \"p999_ns\": " << r.percentile(0.999) << ", \"max_ns\": " << r.percentile(1.0) << " }"
+			<< (i + 1 < results.size() ? "," : "") << "\n";
+	}
+
+	os << "  ]\n";
+	os << "}\n";
+
+	if (!os) {
+		std::cerr << "Unable to write " << options.output << std::endl;
+		exit(1);
+	}
+}
+
+static void usage(const char *name)
+{
+	std::cerr << name << " [options]" << std::endl
+		<< "  --keys N         number of keys (default 10000)" << std::endl
+		<< "  --depth N        nesting depth of the sections (default 3)" << std::endl
+		<< "  --width N        subsections per section (default 4)" << std::endl
+		<< "  --value-size N   size of string values (default 16)" << std::endl
+		<< "  --iterations N   samples for lookups and updates (default 100000)" << std::endl
+		<< "  --repeat N       samples for load, serialize and store (default 20)" << std::endl
+		<< "  --seed N         seed for the lookup order (default 1)" << std::endl
+		<< "  --index N        child index threshold, 0 disables it (default 0)" << std::endl
+		<< "  --threads N      parse threads, 0 uses all cores (default 1)" << std::endl
+		<< "  --dir PATH       directory for temporary files (default /tmp)" << std::endl
+		<< "  --output FILE    write the results as JSON" << std::endl
+		<< "  --label TEXT     label stored with the results, e.g. a commit" << std::endl;
+	exit(1);
+}
+
+static unsigned int number(const char *value, const char *name)
+{
+	char *end = NULL;
+	unsigned long result = strtoul(value, &end, 10);
+
+	if ((end == value) || (*end != '\0')) {
+		std::cerr << "Invalid value for " << name << ": " << value << std::endl;
+		exit(1);
+	}
+
+	return static_cast<unsigned int>(result);
+}
+
+int main(int argc, char *argv[])
+{
+	Options options;
+
+	for (int i = 1; i < argc; i++) {
+
+		std::string arg(argv[i]);
+
+		if (i + 1 >= argc) usage(argv[0]);
+
+		const char *value = argv[++i];
+
+		if (arg == "--keys") options.keys = number(value, "--keys");
+		else if (arg == "--depth") options.depth = number(value, "--depth");
+		else if (arg == "--width") options.width = number(value, "--width");
+		else if (arg == "--value-size") options.valueSize = number(value, "--value-size");
+		else if (arg == "--iterations") options.iterations = number(value, "--iterations");
+		else if (arg == "--repeat") options.repeat = number(value, "--repeat");
+		else if (arg == "--seed") options.seed = number(value, "--seed");
+		else if (arg == "--index") options.index = number(value, "--index");
+		else if (arg == "--threads") options.threads = number(value, "--threads");
+		else if (arg == "--dir") options.directory = value;
+		else if (arg == "--output") options.output = value;
+		else if (arg == "--label") options.label = value;
+		else usage(argv[0]);
+	}
+
+	if ((options.depth == 0) || (options.width == 0) || (options.keys < 2) || (options.repeat == 0) || (options.iterations == 0)) {
+		usage(argv[0]);
+	}
+
+	unsigned int leaves = 1;
+
+	for (unsigned int i = 0; i < options.depth; i++) {
+		leaves *= options.width;
+	}
+
+	Generated generated;
+	unsigned int leaf = 0;
+
+	generate(options, "", 0, &leaf, leaves, &generated);
+
+	std::string filename = options.directory + "/castor-bench-" + boost::lexical_cast<std::string>(getpid()) + ".conf";
+
+	{
+		std::ofstream os(filename.c_str());
+		os << generated.content;
+	}
+
+	std::vector<Result> results;
+	uint32_t state = (options.seed == 0 ? 1 : options.seed);
+
+	try {
+
+		castor::Configuration config;
+		config.setIndexThreshold(options.index);
+		config.setParseThreads(options.threads, 0);
+
+		// load: read and parse the whole file
+		{
+			Result result("load");
+
+			for (unsigned int i = 0; i < options.repeat; i++) {
+
+				uint64_t start = now();
+				config.load(filename);
+				uint64_t time = now() - start;
+
+				result.samples.push_back(time);
+				result.total += time;
+				result.bytes += generated.content.size();
+			}
+
+			finish(&result);
+			results.push_back(result);
+		}
+
+		std::vector<size_t> order(options.iterations);
+
+		for (size_t i = 0; i < order.size(); i++) {
+			order[i] = next(&state) % generated.integers.size();
+		}
+
+		// get<int> with dotted paths, resolved on every call
+		{
+			Result result("get");
+			long long sum = 0;
+
+			for (size_t i = 0; i < order.size(); i++) {
+
+				const char *path = generated.integers[order[i]].c_str();
+
+				uint64_t start = now();
+				sum += config.get<int>(path, NULL);
+				uint64_t time = now() - start;
+
+				result.samples.push_back(time);
+				result.total += time;
+			}
+
+			if (sum < 0) std::cout << sum << std::endl;
+
+			finish(&result);
+			results.push_back(result);
+		}
+
+		// get<int> with keys split and hashed in advance, as the compiler does for literals
+		{
+			std::vector<castor::ConfigKey> keys;
+
+			for (size_t i = 0; i < generated.integers.size(); i++) {
+				keys.push_back(castor::ConfigKey(generated.integers[i].data(), generated.integers[i].size()));
+			}
+
+			Result result("get_key");
+			long long sum = 0;
+
+			for (size_t i = 0; i < order.size(); i++) {
+
+				uint64_t start = now();
+				sum += config.get<int>(keys[order[i]]);
+				uint64_t time = now() - start;
+
+				result.samples.push_back(time);
+				result.total += time;
+			}
+
+			if (sum < 0) std::cout << sum << std::endl;
+
+			finish(&result);
+			results.push_back(result);
+		}
+
+		// get<int> with precompiled paths
+		{
+			std::vector<castor::ConfigPath> paths;
+
+			for (size_t i = 0; i < generated.integers.size(); i++) {
+				paths.push_back(castor::ConfigPath(generated.integers[i]));
+			}
+
+			Result result("get_path");
+			long long sum = 0;
+
+			for (size_t i = 0; i < order.size(); i++) {
+
+				uint64_t start = now();
+				sum += config.get<int>(paths[order[i]]);
+				uint64_t time = now() - start;
+
+				result.samples.push_back(time);
+				result.total += time;
+			}
+
+			if (sum < 0) std::cout << sum << std::endl;
+
+			finish(&result);
+			results.push_back(result);
+		}
+
+		// get<int> with dotted paths through the per-thread cache
+		{
+			Result result("get_cached");
+			long long sum = 0;
+
+			config.setThreadCache(true);
+			castor::ConfigCache::Statistics before = castor::ConfigCache::getStatistics();
+
+			for (size_t i = 0; i < order.size(); i++) {
+
+				const char *path = generated.integers[order[i]].c_str();
+
+				uint64_t start = now();
+				sum += config.get<int>(path, NULL);
+				uint64_t time = now() - start;
+
+				result.samples.push_back(time);
+				result.total += time;
+			}
+
+			castor::ConfigCache::Statistics after = castor::ConfigCache::getStatistics();
+			config.setThreadCache(false);
+
+			if (sum < 0) std::cout << sum << std::endl;
+
+			std::cerr << "get_cached: " << (after.hits - before.hits) << " hits, " << (after.misses - before.misses) << " misses" << std::endl;
+
+			finish(&result);
+			results.push_back(result);
+		}
+
+		// The same keys read 100 at a time in one walk, reported per key
+		{
+			const size_t size = 100;
+
+			Result result("batch");
+			long long sum = 0;
+
+			for (size_t i = 0; i + size <= order.size(); i += size) {
+
+				std::vector<int> values(size);
+				castor::ConfigBatch batch;
+
+				for (size_t j = 0; j < size; j++) {
+					batch.add(generated.integers[order[i + j]], &values[j]);
+				}
+
+				uint64_t start = now();
+				config.read(batch);
+				uint64_t time = now() - start;
+
+				for (size_t j = 0; j < size; j++) {
+					sum += values[j];
+					result.samples.push_back(static_cast<double>(time) / size);
+				}
+
+				result.total += time;
+			}
+
+			if (sum < 0) std::cout << sum << std::endl;
+
+			finish(&result);
+			results.push_back(result);
+		}
+
+		{
+			Result result("getAll");
+			size_t count = 0;
+
+			for (size_t i = 0; i < order.size(); i++) {
+
+				const char *path = generated.integers[order[i]].c_str();
+
+				uint64_t start = now();
+				count += config.getAll<int>(path, NULL).size();
+				uint64_t time = now() - start;
+
+				result.samples.push_back(time);
+				result.total += time;
+			}
+
+			if (count == 0) std::cout << count << std::endl;
+
+			finish(&result);
+			results.push_back(result);
+		}
+
+		{
+			Result result("getSections");
+			size_t count = 0;
+
+			for (size_t i = 0; i < order.size(); i++) {
+
+				const char *path = generated.sections[order[i] % generated.sections.size()].c_str();
+
+				uint64_t start = now();
+				count += config.getSections(path, NULL).size();
+				uint64_t time = now() - start;
+
+				result.samples.push_back(time);
+				result.total += time;
+			}
+
+			if (count == 0) std::cout << count << std::endl;
+
+			finish(&result);
+			results.push_back(result);
+		}
+
+		{
+			Result result("set");
+
+			for (size_t i = 0; i < order.size(); i++) {
+
+				const char *path = generated.integers[order[i]].c_str();
+
+				uint64_t start = now();
+				config.set<int>(static_cast<int>(i), path, NULL);
+				uint64_t time = now() - start;
+
+				result.samples.push_back(time);
+				result.total += time;
+			}
+
+			finish(&result);
+			results.push_back(result);
+		}
+
+		// diff of two loads of the file that differ in one value
+		{
+			castor::Configuration base;
+			castor::Configuration other;
+
+			base.load(filename);
+			other.load(filename);
+
+			Result result("diff");
+			size_t count = 0;
+
+			for (unsigned int i = 0; i < options.repeat; i++) {
+
+				other.set<int>(-static_cast<int>(i) - 1, generated.integers[order[i % order.size()]].c_str(), NULL);
+
+				uint64_t start = now();
+				count += castor::ConfigSnapshot::diff(base, other).size();
+				uint64_t time = now() - start;
+
+				result.samples.push_back(time);
+				result.total += time;
+			}
+
+			if (count == 0) std::cout << count << std::endl;
+
+			finish(&result);
+			results.push_back(result);
+		}
+
+		size_t serialized = 0;
+
+		{
+			Result result("serialize");
+
+			for (unsigned int i = 0; i < options.repeat; i++) {
+
+				uint64_t start = now();
+				std::string content = config.serialize();
+				uint64_t time = now() - start;
+
+				result.samples.push_back(time);
+				result.total += time;
+				result.bytes += content.size();
+				serialized = content.size();
+			}
+
+			finish(&result);
+			results.push_back(result);
+		}
+
+		{
+			Result result("store");
+			std::string target = filename + ".stored";
+
+			for (unsigned int i = 0; i < options.repeat; i++) {
+
+				uint64_t start = now();
+				config.store(target);
+				uint64_t time = now() - start;
+
+				result.samples.push_back(time);
+				result.total += time;
+				result.bytes += serialized;
+			}
+
+			unlink(target.c_str());
+
+			finish(&result);
+			results.push_back(result);
+		}
+
+	} catch (const std::exception &e) {
+		std::cerr << argv[0] << ": " << e.what() << std::endl;
+		unlink(filename.c_str());
+		exit(1);
+	}
+
+	unlink(filename.c_str());
+
+	report(options, results, generated.content.size());
+
+	return 0;
+}
@@ -0,0 +1,354 @@
+/*
+ * $Id$
+ *
+ * Copyright 2008 Carpe Noctem, Distributed Systems Group,
+ * University of Kassel. All right reserved.
+ *
+ * The code is licensed under the Carpe Noctem Userfriendly BSD-Based
+ * License (CNUBBL). Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided that the
+ * conditions of the CNUBBL are met.
+ *
+ * You should have received a copy of the CNUBBL along with this
+ * software. The license is also available on our website:
+ * http://carpenoctem.das-lab.net/license.txt
+ */
+
+/*
+ * Microbenchmark for the clock sources of DateTime. Reads every source in
+ * a tight loop and reports the time per call, the smallest step between
+ * two readings, how often a reading went back and how far the source is
+ * from CLOCK_REALTIME. gettimeofday() is the former implementation.
+ * With --format the formatting and parsing of DateTime instead, against
+ * gmtime_r() with strftime() and strptime() with timegm().
+ */
+
+#include "DateTime.h"
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include <stdint.h>
+#include <time.h>
+#include <sys/time.h>
+
+struct Options
+{
+	unsigned int calls;
+	unsigned int repeat;
+	bool format;
+	std::string output;
+	std::string label;
+
+	Options() :
+		calls(1000), repeat(2000), format(false), output(), label()
+	{
+	}
+};
+
+struct Result
+{
+	std::string clock;
+	std::vector<double> samples;
+	double total;
+	long long resolution;
+	unsigned long long backwards;
+	long long offset;
+
+	Result(const std::string &clock) :
+		clock(clock), samples(), total(0), resolution(0), backwards(0), offset(0)
+	{
+	}
+
+	double percentile(double p) const {
+
+		if (this->samples.empty()) return 0;
+
+		size_t index = static_cast<size_t>(p * (this->samples.size() - 1) + 0.5);
+		return this->samples[index];
+	}
+
+	double mean() const {
+		return (this->samples.empty() ? 0 : this->total / this->samples.size());
+	}
+};
+
+static inline uint64_t now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
+
+static long long timeOfDay()
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+
+	return ((static_cast<long long>(tv.tv_sec) + EPOCH_ADJUST) * 1000000 + tv.tv_usec) * 10;
+}
+
+template <typename Read>
+static Result measure(const Options &options, const std::string &name, Read read)
+{
+	Result result(name);
+	long long previous = read();
+
+	result.resolution = -1;
+
+	for (unsigned int r = 0; r < options.repeat; r++) {
+
+		uint64_t start = now();
+
+		for (unsigned int i = 0; i < options.calls; i++) {
+
+			long long ticks = read();
+			long long step = ticks - previous;
+
+			if (step < 0) {
+				result.backwards++;
+			} else if ((step > 0) && ((result.resolution < 0) || (step < result.resolution))) {
+				result.resolution = step;
+			}
+
+			previous = ticks;
+		}
+
+		double elapsed = static_cast<double>(now() - start) / options.calls;
+
+		result.samples.push_back(elapsed);
+		result.total += elapsed;
+	}
+
+	std::sort(result.samples.begin(), result.samples.end());
+
+	// The largest distance from the wall clock, read on both sides
+	for (int i = 0; i < 100; i++) {
+
+		long long before = castor::DateTime::getUtcNow(castor::DateTime::Realtime).getTicks();
+		long long ticks = read();
+		long long after = castor::DateTime::getUtcNow(castor::DateTime::Realtime).getTicks();
+		long long distance = (ticks < before) ? before - ticks : (ticks > after ? ticks - after : 0);
+
+		result.offset = std::max(result.offset, distance);
+	}
+
+	return result;
+}
+
+template <castor::DateTime::Clock clock>
+static long long source()
+{
+	return castor::DateTime::getUtcNow(clock).getTicks();
+}
+
+// Keeps the results of the formatters alive
+static volatile size_t sink;
+
+/**
+ * Time per call of f(i) for timestamps 1 ms apart, so that the cached
+ * second of the formatters changes every 1000 calls.
+ */
+template <typename Function>
+static void measureFormat(const Options &options, const std::string &name, Function f)
+{
+	std::vector<double> samples;
+	size_t check = 0;
+
+	for (unsigned int r = 0; r < options.repeat; r++) {
+
+		uint64_t start = now();
+
+		for (unsigned int i = 0; i < options.calls; i++) {
+			check += f(static_cast<long long>(r) * options.calls + i);
+		}
+
+		samples.push_back(static_cast<double>(now() - start) / options.calls);
+	}
+
+	std::sort(samples.begin(), samples.end());
+
+	sink = check;
+
+	std::cout << std::setw(14) << std::left << name << std::right << std::fixed << std::setprecision(3)
+		<< std::setw(12) << samples[samples.size() / 2] << std::setw(12) << samples[samples.size() * 99 / 100]
+		<< std::endl;
+}
+
+static void format(const Options &options)
+{
+	static const long long base = castor::DateTime::fromCalendar(2009, 6, 15, 13, 45, 30).getTicks();
+	static char buffer[64];
+	static char text[castor::DateTime::IsoLength];
+
+	size_t length = castor::DateTime(base).formatIso(text, sizeof(text));
+
+	std::cout << std::setw(14) << std::left << "operation" << std::right
+		<< std::setw(12) << "p50 ns" << std::setw(12) << "p99 ns" << std::endl;
+
+	measureFormat(options, "formatIso", [](long long i) {
+		return castor::DateTime(base + i * castor::DateTime::TicksPerMillisecond).formatIso(buffer, sizeof(buffer));
+	});
+
+	measureFormat(options, "formatCompact", [](long long i) {
+		return castor::DateTime(base + i * castor::DateTime::TicksPerMillisecond).formatCompact(buffer, sizeof(buffer));
+	});
+
+	measureFormat(options, "strftime", [](long long i) {
+		long long ticks = base + i * castor::DateTime::TicksPerMillisecond;
+		time_t seconds = static_cast<time_t>(ticks / castor::DateTime::TicksPerSecond - EPOCH_ADJUST);
+		struct tm tm;
+		gmtime_r(&seconds, &tm);
+		size_t n = strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S", &tm);
+		return n + snprintf(buffer + n, sizeof(buffer) - n, ".%07lldZ", ticks % castor::DateTime::TicksPerSecond);
+	});
+
+	measureFormat(options, "parse", [length](long long i) {
+		castor::DateTime result(0);
+		text[length - 2] = static_cast<char>('0' + i % 10);
+		return castor::DateTime::parse(text, length, &result) ? static_cast<size_t>(result.getTicks() & 1) : 0;
+	});
+
+	measureFormat(options, "strptime", [length](long long i) {
+		struct tm tm;
+		memset(&tm, 0, sizeof(tm));
+		text[length - 2] = static_cast<char>('0' + i % 10);
+		const char *rest = strptime(text, "%Y-%m-%dT%H:%M:%S", &tm);
+		return (rest != NULL) ? static_cast<size_t>(timegm(&tm) & 1) + strtoul(rest + 1, NULL, 10) % 2 : 0;
+	});
+}
+
+static void report(const Options &options, const std::vector<Result> &results)
+{
+	std::cout << "calls " << options.calls << ", repeat " << options.repeat << ", tsc "
+		<< (castor::DateTime::isTscAvailable() ? "invariant" : "not available") << std::endl;
+
+	std::cout << std::setw(14) << std::left << "clock" << std::right
+		<< std::setw(12) << "mean ns" << std::setw(12) << "p50 ns" << std::setw(12) << "p99 ns"
+		<< std::setw(14) << "step ns" << std::setw(12) << "back" << std::setw(14) << "offset ns" << std::endl;
+
+	for (size_t i = 0; i < results.size(); i++) {
+
+		const Result &r = results[i];
+
+		std::cout << std::setw(14) << std::left << r.clock << std::right
+			<< std::fixed << std::setprecision(3) << std::setw(12) << r.mean() << std::setw(12) << r.percentile(0.5)
+			<< std::setw(12) << r.percentile(0.99) << std::setw(14) << (r.resolution * 100)
+			<< std::setw(12) << r.backwards << std::setw(14) << (r.offset * 100) << std::endl;
+	}
+
+	if (options.output.empty()) {
+		return;
+	}
+
+	std::ofstream os(options.output.c_str());
+
+	os << std::fixed << std::setprecision(3);
+	os << "{\n";
+	os << "  \"label\": \"" << options.label << "\",\n";
+	os << "  \"calls\": " << options.calls << ",\n";
+	os << "  \"repeat\": " << options.repeat << ",\n";
+	os << "  \"results\": [\n";
+
+	for (size_t i = 0; i < results.size(); i++) {
+
+		const Result &r = results[i];
+
+		os << "    { \"clock\": \"" << r.clock << "\""
+			<< ", \"mean_ns\": " << r.mean() << ", \"p50_ns\": " << r.percentile(0.5)
+			<< ", \"p99_ns\": " << r.percentile(0.99) << ", \"step_ns\": " << (r.resolution * 100)
+			<< ", \"backwards\": " << r.backwards << ", \"offset_ns\": " << (r.offset * 100) << " }"
+			<< (i + 1 < results.size() ? "," : "") << "\n";
+	}
+
+	os << "  ]\n";
+	os << "}\n";
+
+	if (!os) {
+		std::cerr << "Unable to write " << options.output << std::endl;
+		exit(1);
+	}
+}
+
+static void usage(const char *name)
+{
+	std::cerr << name << " [options]" << std::endl
+		<< "  --calls N        calls per sample (default 1000)" << std::endl
+		<< "  --repeat N       samples of every clock (default 2000)" << std::endl
+		<< "  --format         measure formatting and parsing instead" << std::endl
+		<< "  --output FILE    write the results as JSON" << std::endl
+		<< "  --label TEXT     label stored with the results, e.g. a commit" << std::endl;
+	exit(1);
+}
+
+static unsigned int number(const char *value, const char *name)
+{
+	char *end = NULL;
+	long result = strtol(value, &end, 10);
+
+	if ((end == value) || (*end != '\0') || (result <= 0)) {
+		std::cerr << "Invalid value for " << name << ": " << value << std::endl;
+		exit(1);
+	}
+
+	return static_cast<unsigned int>(result);
+}
+
+int main(int argc, char *argv[])
+{
+	Options options;
+
+	for (int i = 1; i < argc; i++) {
+
+		if (strcmp(argv[i], "--format") == 0) {
+			options.format = true;
+			continue;
+		}
+
+		if (i + 1 >= argc) usage(argv[0]);
+
+		if (strcmp(argv[i], "--calls") == 0) {
+			options.calls = number(argv[++i], "--calls");
+		} else if (strcmp(argv[i], "--repeat") == 0) {
+			options.repeat = number(argv[++i], "--repeat");
+		} else if (strcmp(argv[i], "--output") == 0) {
+			options.output = argv[++i];
+		} else if (strcmp(argv[i], "--label") == 0) {
+			options.label = argv[++i];
+		} else {
+			usage(argv[0]);
+		}
+	}
+
+	if (options.format) {
+		format(options);
+		return 0;
+	}
+
+	// Calibrate before measuring
+	castor::DateTime::setClock(castor::DateTime::Monotonic);
+	castor::DateTime::setClock(castor::DateTime::Tsc);
+	castor::DateTime::setClock(castor::DateTime::Realtime);
+
+	std::vector<Result> results;
+
+	results.push_back(measure(options, "gettimeofday", timeOfDay));
+	results.push_back(measure(options, "Realtime", source<castor::DateTime::Realtime>));
+	results.push_back(measure(options, "Monotonic", source<castor::DateTime::Monotonic>));
+	results.push_back(measure(options, "Coarse", source<castor::DateTime::Coarse>));
+
+	if (castor::DateTime::isTscAvailable()) {
+		results.push_back(measure(options, "Tsc", source<castor::DateTime::Tsc>));
+	}
+
+	report(options, results);
+
+	return 0;
+}
@@ -0,0 +1,50 @@
+/*
+ * $Id$
+ *
+ * Copyright 2008 Carpe Noctem, Distributed Systems Group,
+ * University of Kassel. All right reserved.
+ *
+ * The code is licensed under the Carpe Noctem Userfriendly BSD-Based
+ * License (CNUBBL). Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided that the
+ * conditions of the CNUBBL are met.
+ *
+ * You should have received a copy of the CNUBBL along with this
+ * software. The license is also available on our website:
+ * http://carpenoctem.das-lab.net/license.txt
+ */
+
+#include "Configuration.h"
+#include "ConfigBinary.h"
+
+#include <iostream>
+#include <cstdlib>
+
+int main(int argc, char *argv[])
+{
+	if ((argc < 2) || (argc > 3))
+	{
+		std::cerr << argv[0] << " <configuration file> [compiled file]" << std::endl;
+		exit(1);
+	}
+
+	std::string source(argv[1]);
+	std::string binary(argc > 2 ? argv[2] : castor::ConfigBinary::getBinaryName(source));
+
+	try
+	{
+		// Always parse the text, an existing compiled file is what is
+		// about to be replaced
+		castor::Configuration config;
+		config.load(source, castor::ConfigBuffer::load(source), true);
+
+		castor::ConfigBinary::write(*config.getTree(), binary);
+	}
+	catch (const std::exception &e)
+	{
+		std::cerr << argv[0] << ": " << e.what() << std::endl;
+		exit(1);
+	}
+
+	return 0;
+}
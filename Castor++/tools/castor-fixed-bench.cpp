@@ -0,0 +1,584 @@
+/*
+ * $Id$
+ *
+ * Copyright 2008 Carpe Noctem, Distributed Systems Group,
+ * University of Kassel. All right reserved.
+ *
+ * The code is licensed under the Carpe Noctem Userfriendly BSD-Based
+ * License (CNUBBL). Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided that the
+ * conditions of the CNUBBL are met.
+ *
+ * You should have received a copy of the CNUBBL along with this
+ * software. The license is also available on our website:
+ * http://carpenoctem.das-lab.net/license.txt
+ */
+
+/*
+ * Microbenchmarks for the fixed point types. Runs the same element-wise
+ * kernels over arrays of float, double and several FixedPoint formats,
+ * and over Fixed with the batch kernels, and reports the time per element.
+ * The same for FixedMath against libm, and with --accuracy the errors of
+ * FixedMath against libm in double.
+ */
+
+#include "Fixed.h"
+#include "FixedKernels.h"
+#include "FixedMath.h"
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+
+#include <stdint.h>
+#include <time.h>
+
+typedef castor::FixedPoint<15, 16, castor::FixedSaturate, castor::FixedRound> Saturated;
+typedef castor::FixedPoint<31, 32> Wide;
+
+struct Options
+{
+	unsigned int size;
+	unsigned int repeat;
+	bool accuracy;
+	std::string output;
+	std::string label;
+
+	Options() :
+		size(4096), repeat(2000), accuracy(false), output(), label()
+	{
+	}
+};
+
+struct Result
+{
+	std::string operation;
+	std::string type;
+	std::vector<double> samples;
+	double total;
+	size_t count;
+
+	Result(const std::string &operation, const std::string &type) :
+		operation(operation), type(type), samples(), total(0), count(0)
+	{
+	}
+
+	double percentile(double p) const {
+
+		if (this->samples.empty()) return 0;
+
+		size_t index = static_cast<size_t>(p * (this->samples.size() - 1) + 0.5);
+		return this->samples[index];
+	}
+
+	double mean() const {
+		return (this->samples.empty() ? 0 : this->total / this->samples.size());
+	}
+};
+
+static inline uint64_t now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
+
+static inline uint32_t next(uint32_t *state)
+{
+	// xorshift32, deterministic across platforms
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+
+	return *state;
+}
+
+/**
+ * Operands of a kernel, the same values in every type.
+ */
+template <typename T>
+struct Operands
+{
+	std::vector<T> a;
+	std::vector<T> b;
+	std::vector<T> divisor;
+	std::vector<T> result;
+
+	Operands(const std::vector<double> &a, const std::vector<double> &b, const std::vector<double> &divisor) :
+		a(a.begin(), a.end()), b(b.begin(), b.end()), divisor(divisor.begin(), divisor.end()), result(a.size())
+	{
+	}
+};
+
+/*
+ * The elementary functions by type, libm for float and double
+ */
+
+static inline float sqrtOf(float x) { return std::sqrt(x); }
+static inline double sqrtOf(double x) { return std::sqrt(x); }
+static inline castor::Fixed sqrtOf(castor::Fixed x) { return castor::FixedMath::sqrt(x); }
+
+static inline float rsqrtOf(float x) { return 1.0f / std::sqrt(x); }
+static inline double rsqrtOf(double x) { return 1.0 / std::sqrt(x); }
+static inline castor::Fixed rsqrtOf(castor::Fixed x) { return castor::FixedMath::rsqrt(x); }
+
+static inline float sinOf(float x) { return std::sin(x); }
+static inline double sinOf(double x) { return std::sin(x); }
+static inline castor::Fixed sinOf(castor::Fixed x) { return castor::FixedMath::sin(x); }
+
+static inline float cosOf(float x) { return std::cos(x); }
+static inline double cosOf(double x) { return std::cos(x); }
+static inline castor::Fixed cosOf(castor::Fixed x) { return castor::FixedMath::cos(x); }
+
+static inline float atan2Of(float y, float x) { return std::atan2(y, x); }
+static inline double atan2Of(double y, double x) { return std::atan2(y, x); }
+static inline castor::Fixed atan2Of(castor::Fixed y, castor::Fixed x) { return castor::FixedMath::atan2(y, x); }
+
+static inline float expOf(float x) { return std::exp(x); }
+static inline double expOf(double x) { return std::exp(x); }
+static inline castor::Fixed expOf(castor::Fixed x) { return castor::FixedMath::exp(x); }
+
+static inline float logOf(float x) { return std::log(x); }
+static inline double logOf(double x) { return std::log(x); }
+static inline castor::Fixed logOf(castor::Fixed x) { return castor::FixedMath::log(x); }
+
+template <typename T>
+static void add(Operands<T> *o, size_t n)
+{
+	for (size_t i = 0; i < n; i++) o->result[i] = o->a[i] + o->b[i];
+}
+
+template <typename T>
+static void mul(Operands<T> *o, size_t n)
+{
+	for (size_t i = 0; i < n; i++) o->result[i] = o->a[i] * o->b[i];
+}
+
+template <typename T>
+static void mac(Operands<T> *o, size_t n)
+{
+	for (size_t i = 0; i < n; i++) o->result[i] += o->a[i] * o->b[i];
+}
+
+template <typename T>
+static void div(Operands<T> *o, size_t n)
+{
+	for (size_t i = 0; i < n; i++) o->result[i] = o->a[i] / o->divisor[i];
+}
+
+// Square roots and logarithms of the divisors, which are positive
+template <typename T>
+static void sqrtLoop(Operands<T> *o, size_t n)
+{
+	for (size_t i = 0; i < n; i++) o->result[i] = sqrtOf(o->divisor[i]);
+}
+
+template <typename T>
+static void rsqrtLoop(Operands<T> *o, size_t n)
+{
+	for (size_t i = 0; i < n; i++) o->result[i] = rsqrtOf(o->divisor[i]);
+}
+
+template <typename T>
+static void sinLoop(Operands<T> *o, size_t n)
+{
+	for (size_t i = 0; i < n; i++) o->result[i] = sinOf(o->a[i]);
+}
+
+template <typename T>
+static void cosLoop(Operands<T> *o, size_t n)
+{
+	for (size_t i = 0; i < n; i++) o->result[i] = cosOf(o->a[i]);
+}
+
+template <typename T>
+static void atan2Loop(Operands<T> *o, size_t n)
+{
+	for (size_t i = 0; i < n; i++) o->result[i] = atan2Of(o->a[i], o->b[i]);
+}
+
+template <typename T>
+static void expLoop(Operands<T> *o, size_t n)
+{
+	for (size_t i = 0; i < n; i++) o->result[i] = expOf(o->a[i]);
+}
+
+template <typename T>
+static void logLoop(Operands<T> *o, size_t n)
+{
+	for (size_t i = 0; i < n; i++) o->result[i] = logOf(o->divisor[i]);
+}
+
+static void addBatch(Operands<castor::Fixed> *o, size_t n)
+{
+	castor::FixedKernels::add(o->a, o->b, &o->result[0]);
+}
+
+static void mulBatch(Operands<castor::Fixed> *o, size_t n)
+{
+	castor::FixedKernels::mul(o->a, o->b, &o->result[0]);
+}
+
+static void macBatch(Operands<castor::Fixed> *o, size_t n)
+{
+	castor::FixedKernels::mac(o->a, o->b, &o->result[0]);
+}
+
+static void divBatch(Operands<castor::Fixed> *o, size_t n)
+{
+	castor::FixedKernels::div(o->a, o->divisor, &o->result[0]);
+}
+
+static void sqrtBatch(Operands<castor::Fixed> *o, size_t n)
+{
+	castor::FixedMath::sqrt(o->divisor, &o->result[0]);
+}
+
+static void rsqrtBatch(Operands<castor::Fixed> *o, size_t n)
+{
+	castor::FixedMath::rsqrt(o->divisor, &o->result[0]);
+}
+
+static void sinBatch(Operands<castor::Fixed> *o, size_t n)
+{
+	castor::FixedMath::sin(o->a, &o->result[0]);
+}
+
+static void cosBatch(Operands<castor::Fixed> *o, size_t n)
+{
+	castor::FixedMath::cos(o->a, &o->result[0]);
+}
+
+static void atan2Batch(Operands<castor::Fixed> *o, size_t n)
+{
+	castor::FixedMath::atan2(o->a, o->b, &o->result[0]);
+}
+
+static void expBatch(Operands<castor::Fixed> *o, size_t n)
+{
+	castor::FixedMath::exp(o->a, &o->result[0]);
+}
+
+static void logBatch(Operands<castor::Fixed> *o, size_t n)
+{
+	castor::FixedMath::log(o->divisor, &o->result[0]);
+}
+
+/**
+ * Runs a kernel repeat times over the operands, one sample per run.
+ */
+template <typename T>
+static Result measure(const Options &options, const std::string &operation, const std::string &type,
+	void (*kernel)(Operands<T> *, size_t), Operands<T> *operands)
+{
+	Result result(operation, type);
+	size_t n = operands->a.size();
+
+	// Warm up the caches and the dispatch
+	kernel(operands, n);
+
+	for (unsigned int i = 0; i < options.repeat; i++) {
+
+		uint64_t start = now();
+		kernel(operands, n);
+		double elapsed = static_cast<double>(now() - start) / n;
+
+		result.samples.push_back(elapsed);
+		result.total += elapsed;
+		result.count += n;
+	}
+
+	std::sort(result.samples.begin(), result.samples.end());
+
+	return result;
+}
+
+template <typename T>
+static void run(const Options &options, const std::string &type, Operands<T> *operands, std::vector<Result> *results)
+{
+	results->push_back(measure(options, "add", type, add<T>, operands));
+	results->push_back(measure(options, "mul", type, mul<T>, operands));
+	results->push_back(measure(options, "mac", type, mac<T>, operands));
+	results->push_back(measure(options, "div", type, div<T>, operands));
+}
+
+template <typename T>
+static void runMath(const Options &options, const std::string &type, Operands<T> *operands, std::vector<Result> *results)
+{
+	results->push_back(measure(options, "sqrt", type, sqrtLoop<T>, operands));
+	results->push_back(measure(options, "rsqrt", type, rsqrtLoop<T>, operands));
+	results->push_back(measure(options, "sin", type, sinLoop<T>, operands));
+	results->push_back(measure(options, "cos", type, cosLoop<T>, operands));
+	results->push_back(measure(options, "atan2", type, atan2Loop<T>, operands));
+	results->push_back(measure(options, "exp", type, expLoop<T>, operands));
+	results->push_back(measure(options, "log", type, logLoop<T>, operands));
+}
+
+/**
+ * Largest and mean error of a FixedMath function, in units of the last
+ * place of Fixed.
+ */
+struct Accuracy
+{
+	std::string function;
+	size_t count;
+	double max;
+	double total;
+	double worst;
+
+	Accuracy(const std::string &function) :
+		function(function), count(0), max(0), total(0), worst(0)
+	{
+	}
+
+	void add(double x, castor::Fixed result, double exact) {
+
+		double error = std::fabs(result.getRaw() - exact * 65536.0);
+
+		if (error > this->max) {
+			this->max = error;
+			this->worst = x;
+		}
+
+		this->total += error;
+		this->count++;
+	}
+};
+
+/**
+ * Every value up to 16 away from 0 and from there on every 4099th,
+ * within [first, last].
+ */
+static int step(int raw)
+{
+	return ((raw > -(1 << 20)) && (raw < (1 << 20))) ? 1 : 4099;
+}
+
+static void accuracy()
+{
+	using castor::Fixed;
+	using castor::FixedMath;
+
+	Accuracy sqrtError("sqrt"), rsqrtError("rsqrt"), sinError("sin"), cosError("cos");
+	Accuracy atan2Error("atan2"), expError("exp"), logError("log");
+
+	for (long long raw = 1; raw <= 0x7fffffff; raw += step(raw)) {
+
+		Fixed x = Fixed::fromRaw(raw);
+		double d = raw / 65536.0;
+
+		sqrtError.add(d, FixedMath::sqrt(x), std::sqrt(d));
+		rsqrtError.add(d, FixedMath::rsqrt(x), 1.0 / std::sqrt(d));
+		logError.add(d, FixedMath::log(x), std::log(d));
+	}
+
+	for (long long raw = -0x80000000LL; raw <= 0x7fffffff; raw += step(raw)) {
+
+		Fixed x = Fixed::fromRaw(raw);
+		double d = raw / 65536.0;
+
+		sinError.add(d, FixedMath::sin(x), std::sin(d));
+		cosError.add(d, FixedMath::cos(x), std::cos(d));
+	}
+
+	// Up to the largest result
+	for (int raw = -12 * 65536; std::exp(raw / 65536.0) < 32768.0 - 1.0 / 65536; raw++) {
+
+		double d = raw / 65536.0;
+
+		expError.add(d, FixedMath::exp(Fixed::fromRaw(raw)), std::exp(d));
+	}
+
+	// Points of all magnitudes in all directions
+	uint32_t state = 1;
+
+	for (int i = 0; i < 2000000; i++) {
+
+		int y = static_cast<int>(next(&state)) >> (i % 31);
+		int x = static_cast<int>(next(&state)) >> (i % 29);
+
+		atan2Error.add(y / 65536.0, FixedMath::atan2(Fixed::fromRaw(y), Fixed::fromRaw(x)), std::atan2(y, x));
+	}
+
+	const Accuracy *results[] = { &sqrtError, &rsqrtError, &sinError, &cosError, &atan2Error, &expError, &logError };
+
+	std::cout << std::setw(10) << std::left << "function" << std::right << std::setw(12) << "values"
+		<< std::setw(12) << "max ulp" << std::setw(12) << "mean ulp" << std::setw(16) << "worst x" << std::endl;
+
+	for (size_t i = 0; i < sizeof(results) / sizeof(results[0]); i++) {
+
+		const Accuracy &r = *results[i];
+
+		std::cout << std::setw(10) << std::left << r.function << std::right << std::setw(12) << r.count
+			<< std::fixed << std::setprecision(4) << std::setw(12) << r.max << std::setw(12) << (r.total / r.count)
+			<< std::setw(16) << r.worst << std::endl;
+	}
+}
+
+static void report(const Options &options, const std::vector<Result> &results)
+{
+	std::cout << "size " << options.size << ", repeat " << options.repeat << ", batch level "
+		<< castor::FixedKernels::getLevel() << std::endl;
+
+	std::cout << std::setw(10) << std::left << "operation" << std::setw(12) << "type" << std::right
+		<< std::setw(14) << "Melem/s" << std::setw(12) << "mean ns" << std::setw(12) << "p50 ns"
+		<< std::setw(12) << "p99 ns" << std::endl;
+
+	for (size_t i = 0; i < results.size(); i++) {
+
+		const Result &r = results[i];
+
+		std::cout << std::setw(10) << std::left << r.operation << std::setw(12) << r.type << std::right
+			<< std::fixed << std::setprecision(1) << std::setw(14) << (1e3 / r.mean())
+			<< std::setprecision(3) << std::setw(12) << r.mean() << std::setw(12) << r.percentile(0.5)
+			<< std::setw(12) << r.percentile(0.99) << std::endl;
+	}
+
+	if (options.output.empty()) {
+		return;
+	}
+
+	std::ofstream os(options.output.c_str());
+
+	os << std::fixed << std::setprecision(3);
+	os << "{\n";
+	os << "  \"label\": \"" << options.label << "\",\n";
+	os << "  \"size\": " << options.size << ",\n";
+	os << "  \"repeat\": " << options.repeat << ",\n";
+	os << "  \"level\": " << castor::FixedKernels::getLevel() << ",\n";
+	os << "  \"results\": [\n";
+
+	for (size_t i = 0; i < results.size(); i++) {
+
+		const Result &r = results[i];
+
+		os << "    { \"operation\": \"" << r.operation << "\", \"type\": \"" << r.type << "\""
+			<< ", \"mean_ns\": " << r.mean() << ", \"p50_ns\": " << r.percentile(0.5)
+			<< ", \"p99_ns\": " << r.percentile(0.99) << " }"
+			<< (i + 1 < results.size() ? "," : "") << "\n";
+	}
+
+	os << "  ]\n";
+	os << "}\n";
+
+	if (!os) {
+		std::cerr << "Unable to write " << options.output << std::endl;
+		exit(1);
+	}
+}
+
+static void usage(const char *name)
+{
+	std::cerr << name << " [options]" << std::endl
+		<< "  --size N         elements per array (default 4096)" << std::endl
+		<< "  --repeat N       runs of every kernel (default 2000)" << std::endl
+		<< "  --level N        batch kernels: 0 scalar, 1 SSE4.1, 2 AVX2 (default best)" << std::endl
+		<< "  --accuracy       measure the errors of FixedMath instead" << std::endl
+		<< "  --output FILE    write the results as JSON" << std::endl
+		<< "  --label TEXT     label stored with the results, e.g. a commit" << std::endl;
+	exit(1);
+}
+
+static unsigned int number(const char *value, const char *name)
+{
+	char *end = NULL;
+	long result = strtol(value, &end, 10);
+
+	if ((end == value) || (*end != '\0') || (result < 0)) {
+		std::cerr << "Invalid value for " << name << ": " << value << std::endl;
+		exit(1);
+	}
+
+	return static_cast<unsigned int>(result);
+}
+
+int main(int argc, char *argv[])
+{
+	Options options;
+
+	for (int i = 1; i < argc; i++) {
+
+		if (strcmp(argv[i], "--accuracy") == 0) {
+			options.accuracy = true;
+			continue;
+		}
+
+		if (i + 1 >= argc) usage(argv[0]);
+
+		if (strcmp(argv[i], "--size") == 0) {
+			options.size = number(argv[++i], "--size");
+		} else if (strcmp(argv[i], "--repeat") == 0) {
+			options.repeat = number(argv[++i], "--repeat");
+		} else if (strcmp(argv[i], "--level") == 0) {
+			castor::FixedKernels::setLevel(static_cast<castor::FixedKernels::Level>(number(argv[++i], "--level")));
+		} else if (strcmp(argv[i], "--output") == 0) {
+			options.output = argv[++i];
+		} else if (strcmp(argv[i], "--label") == 0) {
+			options.label = argv[++i];
+		} else {
+			usage(argv[0]);
+		}
+	}
+
+	if (options.size == 0) usage(argv[0]);
+
+	if (options.accuracy) {
+		accuracy();
+		return 0;
+	}
+
+	// Values in [-8, 8), divisors in [0.5, 8.5)
+	std::vector<double> a(options.size), b(options.size), divisor(options.size);
+	uint32_t state = 1;
+
+	for (size_t i = 0; i < options.size; i++) {
+		a[i] = (next(&state) % 1048576) / 65536.0 - 8.0;
+		b[i] = (next(&state) % 1048576) / 65536.0 - 8.0;
+		divisor[i] = (next(&state) % 524288) / 65536.0 + 0.5;
+	}
+
+	std::vector<Result> results;
+
+	Operands<float> floats(a, b, divisor);
+	run(options, "float", &floats, &results);
+
+	Operands<double> doubles(a, b, divisor);
+	run(options, "double", &doubles, &results);
+
+	Operands<castor::Fixed> fixed(a, b, divisor);
+	run(options, "Q15.16", &fixed, &results);
+
+	Operands<Saturated> saturated(a, b, divisor);
+	run(options, "Q15.16s", &saturated, &results);
+
+	Operands<Wide> wide(a, b, divisor);
+	run(options, "Q31.32", &wide, &results);
+
+	results.push_back(measure(options, "add", "batch", addBatch, &fixed));
+	results.push_back(measure(options, "mul", "batch", mulBatch, &fixed));
+	results.push_back(measure(options, "mac", "batch", macBatch, &fixed));
+	results.push_back(measure(options, "div", "batch", divBatch, &fixed));
+
+	runMath(options, "float", &floats, &results);
+	runMath(options, "double", &doubles, &results);
+	runMath(options, "Q15.16", &fixed, &results);
+
+	results.push_back(measure(options, "sqrt", "batch", sqrtBatch, &fixed));
+	results.push_back(measure(options, "rsqrt", "batch", rsqrtBatch, &fixed));
+	results.push_back(measure(options, "sin", "batch", sinBatch, &fixed));
+	results.push_back(measure(options, "cos", "batch", cosBatch, &fixed));
+	results.push_back(measure(options, "atan2", "batch", atan2Batch, &fixed));
+	results.push_back(measure(options, "exp", "batch", expBatch, &fixed));
+	results.push_back(measure(options, "log", "batch", logBatch, &fixed));
+
+	report(options, results);
+
+	return 0;
+}